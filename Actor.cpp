@@ -9,7 +9,8 @@ Actor::Actor(Game* game) :
 	mPosition(Vector3::Zero),
 	mRotation(Quaternion::Identity),
 	mScale(1.0f),
-	mRecomputeWorldTransform(true){
+	mRecomputeWorldTransform(true),
+	mStatic(false){
 	// add itself to active actors using game
 	mGame->AddActor(this);
 }
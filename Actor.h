@@ -39,6 +39,9 @@ public:
 	Vector3 GetForward() const { return Vector3::Transform(Vector3::UnitX, mRotation); }
 	class Game* GetGame() const { return mGame; }
 	Matrix4 GetWorldTransform() const { return mWorldTransform; }
+	// Static actors don't move after the level is loaded, so the renderer can merge their meshes (see StaticBatch)
+	bool IsStatic() const { return mStatic; }
+	void SetStatic(bool isStatic) { mStatic = isStatic; }
 
 	// Create world transform matrix
 	void ComputeWorldTransform();
@@ -58,6 +61,8 @@ protected:
 	Matrix4 mWorldTransform; // components (x, y, z, w)
 	// we need to recalculate world transformation? For example, when actor change position, scale or rotation
 	bool mRecomputeWorldTransform;
+	// The actor never moves
+	bool mStatic;
 	// List of Actor's components
 	std::vector<class Component*> mComponents;
 	// Game pointer. Used to call specific Game functions
@@ -0,0 +1,151 @@
+#include "AsyncLoader.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include <SDL.h>
+
+AsyncLoader::AsyncLoader(Renderer* renderer) :
+	mRenderer(renderer),
+	mPixelBuffer(0),
+	mReading(0),
+	mRunning(true)
+{
+	for (unsigned int i = 0; i < NumThreads; i++) {
+		mThreads.emplace_back(&AsyncLoader::ThreadLoop, this);
+	}
+}
+
+AsyncLoader::~AsyncLoader() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+	}
+	mCondition.notify_all();
+	for (std::thread& thread : mThreads) {
+		thread.join();
+	}
+}
+
+void AsyncLoader::QueueMesh(Mesh* mesh, const std::string& fileName) {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueue.push_back(Request{ mesh, nullptr, fileName, false });
+		mPending.insert(mesh);
+	}
+	mCondition.notify_one();
+}
+
+void AsyncLoader::QueueTexture(Texture* texture, const std::string& fileName, bool streamed) {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueue.push_back(Request{ nullptr, texture, fileName, streamed });
+		mPending.insert(texture);
+	}
+	mCondition.notify_one();
+}
+
+void AsyncLoader::QueueUpload(Mesh* mesh) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mUploads.push_back(Request{ mesh, nullptr, std::string(), false });
+}
+
+void AsyncLoader::GetRead(std::vector<Mesh*>& outMeshes) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	outMeshes.swap(mRead);
+	mRead.clear();
+}
+
+void AsyncLoader::GetUploaded(std::vector<Mesh*>& outMeshes, std::vector<Texture*>& outTextures) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	outMeshes.swap(mUploadedMeshes);
+	mUploadedMeshes.clear();
+	outTextures.swap(mUploadedTextures);
+	mUploadedTextures.clear();
+}
+
+bool AsyncLoader::IsPending(const void* resource) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPending.count(resource) != 0;
+}
+
+void AsyncLoader::Cancel() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	mQueue.clear();
+	// The files being read are dropped when they are done (they are not pending anymore)
+	mPending.clear();
+	mCondition.wait(lock, [this] { return mReading == 0; });
+	mRead.clear();
+	mUploads.clear();
+	mUploadedMeshes.clear();
+	mUploadedTextures.clear();
+}
+
+void AsyncLoader::ProcessUploads(float budgetMs) {
+	const uint64_t start = SDL_GetPerformanceCounter();
+	const double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+	RenderDevice* device = RenderDevice::Get();
+	while (true) {
+		Request request;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mUploads.empty()) return;
+			request = std::move(mUploads.front());
+			mUploads.pop_front();
+		}
+		bool uploaded = false;
+		if (request.mMesh) {
+			uploaded = request.mMesh->Upload(mRenderer);
+		}
+		else {
+			// The texels are copied in the pixel buffer, then to the texture without stalling on the transfer
+			if (!mPixelBuffer) mPixelBuffer = device->CreateBuffer(EPixelUnpackBuffer, 0, nullptr, EStreamBuffer);
+			uploaded = request.mTexture->Upload(mPixelBuffer);
+		}
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (uploaded && request.mMesh) mUploadedMeshes.emplace_back(request.mMesh);
+			else if (uploaded) mUploadedTextures.emplace_back(request.mTexture);
+			mPending.erase(request.mMesh ? static_cast<const void*>(request.mMesh) : request.mTexture);
+		}
+		// The rest waits for the next frame once the slice of this one is spent
+		if (budgetMs > 0.f && (SDL_GetPerformanceCounter() - start) * msPerCount >= budgetMs) return;
+	}
+}
+
+void AsyncLoader::DestroyDeviceObjects() {
+	if (mPixelBuffer) RenderDevice::Get()->DestroyBuffer(mPixelBuffer);
+	mPixelBuffer = 0;
+}
+
+void AsyncLoader::ThreadLoop() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true) {
+		mCondition.wait(lock, [this] { return !mQueue.empty() || !mRunning; });
+		if (!mRunning) return;
+		Request request = std::move(mQueue.front());
+		mQueue.pop_front();
+		mReading++;
+		lock.unlock();
+
+		// Parse and decode the file, without device calls
+		const bool read = request.mMesh ? request.mMesh->Read(request.mFileName) :
+			request.mTexture->Read(request.mFileName, request.mStreamed);
+
+		lock.lock();
+		mReading--;
+		const void* resource = request.mMesh ? static_cast<const void*>(request.mMesh) : request.mTexture;
+		// Resources cancelled while they were read are dropped
+		if (mPending.count(resource) != 0) {
+			if (!read) {
+				SDL_Log("Failed to load %s asynchronously", request.mFileName.c_str());
+				mPending.erase(resource);
+			}
+			else if (request.mMesh) {
+				mRead.emplace_back(request.mMesh);
+			}
+			else {
+				mUploads.push_back(std::move(request));
+			}
+		}
+		mCondition.notify_all();
+	}
+}
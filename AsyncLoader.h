@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "RenderDevice.h"
+
+// Loads meshes and textures without stalling the frame.
+// The renderer hands out the resource at once, unloaded; loading threads read and decode the files (Mesh::Read,
+// Texture::Read) and the thread of the device creates the device objects in slices of a few milliseconds per
+// frame (ProcessUploads), the texels going through a pixel unpack buffer. Between the two, the renderer sets the
+// textures of the meshes on the game thread. Resources are marked loaded by the renderer, on the game thread
+class AsyncLoader {
+public:
+	// Start the loading threads. The renderer gives the geometry arenas to the meshes
+	AsyncLoader(class Renderer* renderer);
+	// Stop the loading threads
+	~AsyncLoader();
+
+	// Queue the reading of a resource. Game thread
+	void QueueMesh(class Mesh* mesh, const std::string& fileName);
+	void QueueTexture(class Texture* texture, const std::string& fileName, bool streamed);
+	// Queue the upload of a mesh taken from GetRead, once its textures are set. Game thread
+	void QueueUpload(class Mesh* mesh);
+	// Meshes read since the last call, waiting for their textures and QueueUpload. Game thread
+	void GetRead(std::vector<class Mesh*>& outMeshes);
+	// Resources uploaded since the last call, ready to be marked loaded. Game thread
+	void GetUploaded(std::vector<class Mesh*>& outMeshes, std::vector<class Texture*>& outTextures);
+	// The resource is queued, being read or waiting for its upload. Resources that failed are not pending
+	bool IsPending(const void* resource);
+	// Forget every queued resource, before they are unloaded. Waits for the reads in progress; the device
+	// thread must not be in ProcessUploads
+	void Cancel();
+
+	// Create the device objects of the resources read, for about budgetMs milliseconds (at least one resource;
+	// 0: all of them). Thread of the device
+	void ProcessUploads(float budgetMs);
+	// Destroy the pixel unpack buffer. Thread of the device, at shutdown
+	void DestroyDeviceObjects();
+
+	// Number of loading threads
+	static const unsigned int NumThreads = 2;
+
+private:
+	// Resource to read (only one of mMesh and mTexture is set)
+	struct Request {
+		class Mesh* mMesh;
+		class Texture* mTexture;
+		std::string mFileName;
+		bool mStreamed;
+	};
+
+	// Main loop of the loading threads
+	void ThreadLoop();
+
+	class Renderer* mRenderer;
+	std::vector<std::thread> mThreads;
+	// Staging buffer of the texels, created with the first texture upload (0: none)
+	BufferHandle mPixelBuffer;
+	// Protect everything below
+	std::mutex mMutex;
+	// Wake up the loading threads (new request or stop) and Cancel (read finished)
+	std::condition_variable mCondition;
+	// Files waiting for a loading thread
+	std::deque<Request> mQueue;
+	// Meshes read, waiting for their textures (GetRead)
+	std::vector<class Mesh*> mRead;
+	// Resources read, waiting for ProcessUploads (only one of mMesh and mTexture is set)
+	std::deque<Request> mUploads;
+	// Resources uploaded, waiting for GetUploaded
+	std::vector<class Mesh*> mUploadedMeshes;
+	std::vector<class Texture*> mUploadedTextures;
+	// Resources queued and not uploaded yet
+	std::unordered_set<const void*> mPending;
+	// Number of files being read
+	unsigned int mReading;
+	// Cleared by the destructor
+	bool mRunning;
+};
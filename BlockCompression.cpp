@@ -0,0 +1,236 @@
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Bytes of a block of the given format
+static unsigned int GetBlockSize(TextureFormat format) {
+	return format == ETextureBC1 ? 8 : 16;
+}
+
+// 565 color from 8 bit channels, rounded to the nearest value
+static uint16_t PackColor565(float r, float g, float b) {
+	int r5 = static_cast<int>(std::lround(std::min(std::max(r, 0.f), 255.f) * 31.f / 255.f));
+	int g6 = static_cast<int>(std::lround(std::min(std::max(g, 0.f), 255.f) * 63.f / 255.f));
+	int b5 = static_cast<int>(std::lround(std::min(std::max(b, 0.f), 255.f) * 31.f / 255.f));
+	return static_cast<uint16_t>((r5 << 11) | (g6 << 5) | b5);
+}
+
+// 8 bit channels of a 565 color, as the GPU expands them
+static void UnpackColor565(uint16_t color, int* outRgb) {
+	int r5 = (color >> 11) & 31;
+	int g6 = (color >> 5) & 63;
+	int b5 = color & 31;
+	outRgb[0] = (r5 << 3) | (r5 >> 2);
+	outRgb[1] = (g6 << 2) | (g6 >> 4);
+	outRgb[2] = (b5 << 3) | (b5 >> 2);
+}
+
+unsigned int BlockCompression::GetImageSize(TextureFormat format, int width, int height) {
+	if (format == ETextureRGBA8) return static_cast<unsigned int>(width * height * 4);
+	return static_cast<unsigned int>(((width + 3) / 4) * ((height + 3) / 4)) * GetBlockSize(format);
+}
+
+void BlockCompression::Compress(TextureFormat format, int width, int height, const unsigned char* rgba, std::vector<unsigned char>& outData) {
+	outData.resize(GetImageSize(format, width, height));
+	if (format == ETextureRGBA8) {
+		std::copy(rgba, rgba + outData.size(), outData.begin());
+		return;
+	}
+	const unsigned int blocksX = static_cast<unsigned int>((width + 3) / 4);
+	const unsigned int blocksY = static_cast<unsigned int>((height + 3) / 4);
+	const unsigned int blockSize = GetBlockSize(format);
+	unsigned char* data = outData.data();
+	JobSystem::ParallelFor(blocksY, 4, [=](unsigned int begin, unsigned int end) {
+		unsigned char texels[64];
+		for (unsigned int by = begin; by < end; by++) {
+			for (unsigned int bx = 0; bx < blocksX; bx++) {
+				// Blocks past the border of the image repeat the last row and column
+				for (int i = 0; i < 16; i++) {
+					int x = std::min(static_cast<int>(bx * 4) + (i & 3), width - 1);
+					int y = std::min(static_cast<int>(by * 4) + (i >> 2), height - 1);
+					std::copy(rgba + (y * width + x) * 4, rgba + (y * width + x) * 4 + 4, texels + i * 4);
+				}
+				unsigned char* block = data + (by * blocksX + bx) * blockSize;
+				if (format == ETextureBC3) {
+					EncodeAlphaBlock(texels, block);
+					block += 8;
+				}
+				EncodeColorBlock(texels, block);
+			}
+		}
+	});
+}
+
+void BlockCompression::Decompress(TextureFormat format, int width, int height, const unsigned char* data, std::vector<unsigned char>& outRgba) {
+	outRgba.resize(static_cast<size_t>(width) * height * 4);
+	if (format == ETextureRGBA8) {
+		std::copy(data, data + outRgba.size(), outRgba.begin());
+		return;
+	}
+	const unsigned int blocksX = static_cast<unsigned int>((width + 3) / 4);
+	const unsigned int blocksY = static_cast<unsigned int>((height + 3) / 4);
+	const unsigned int blockSize = GetBlockSize(format);
+	unsigned char texels[64];
+	for (unsigned int by = 0; by < blocksY; by++) {
+		for (unsigned int bx = 0; bx < blocksX; bx++) {
+			const unsigned char* block = data + (by * blocksX + bx) * blockSize;
+			if (format == ETextureBC3) {
+				DecodeColorBlock(block + 8, texels, false);
+				DecodeAlphaBlock(block, texels);
+			}
+			else {
+				DecodeColorBlock(block, texels, true);
+			}
+			for (int i = 0; i < 16; i++) {
+				int x = static_cast<int>(bx * 4) + (i & 3);
+				int y = static_cast<int>(by * 4) + (i >> 2);
+				if (x >= width || y >= height) continue;
+				std::copy(texels + i * 4, texels + i * 4 + 4, outRgba.begin() + (y * width + x) * 4);
+			}
+		}
+	}
+}
+
+void BlockCompression::EncodeColorBlock(const unsigned char* texels, unsigned char* outBlock) {
+	// Principal axis of the colors: the endpoints are its extremes, the other colors are close to the line
+	float mean[3] = { 0.f, 0.f, 0.f };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) mean[c] += texels[i * 4 + c] / 16.f;
+	}
+	float cov[6] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+	for (int i = 0; i < 16; i++) {
+		float r = texels[i * 4] - mean[0];
+		float g = texels[i * 4 + 1] - mean[1];
+		float b = texels[i * 4 + 2] - mean[2];
+		cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+		cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+	}
+	// Power iteration, starting from the luminance direction
+	float axis[3] = { 0.577f, 0.577f, 0.577f };
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float length = std::sqrt(x * x + y * y + z * z);
+		// Single color block
+		if (length < 1e-6f) break;
+		axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+	}
+	float minT = 0.f;
+	float maxT = 0.f;
+	for (int i = 0; i < 16; i++) {
+		float t = (texels[i * 4] - mean[0]) * axis[0] + (texels[i * 4 + 1] - mean[1]) * axis[1] + (texels[i * 4 + 2] - mean[2]) * axis[2];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+	// Move the endpoints inside the range: the extremes are rarely worth a whole palette entry
+	const float inset = (maxT - minT) / 16.f;
+	minT += inset;
+	maxT -= inset;
+	uint16_t color0 = PackColor565(mean[0] + axis[0] * maxT, mean[1] + axis[1] * maxT, mean[2] + axis[2] * maxT);
+	uint16_t color1 = PackColor565(mean[0] + axis[0] * minT, mean[1] + axis[1] * minT, mean[2] + axis[2] * minT);
+	// color0 > color1 selects the 4 colors mode (no transparent entry)
+	if (color0 < color1) std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		int palette[4][3];
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			int bestDistance = 0x7fffffff;
+			for (int p = 0; p < 4; p++) {
+				int dr = texels[i * 4] - palette[p][0];
+				int dg = texels[i * 4 + 1] - palette[p][1];
+				int db = texels[i * 4 + 2] - palette[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(best) << (i * 2);
+		}
+	}
+	// Little endian: color0, color1, then 2 bits per texel starting from the first one
+	outBlock[0] = static_cast<unsigned char>(color0 & 0xff);
+	outBlock[1] = static_cast<unsigned char>(color0 >> 8);
+	outBlock[2] = static_cast<unsigned char>(color1 & 0xff);
+	outBlock[3] = static_cast<unsigned char>(color1 >> 8);
+	for (int i = 0; i < 4; i++) outBlock[4 + i] = static_cast<unsigned char>(indices >> (i * 8));
+}
+
+void BlockCompression::DecodeColorBlock(const unsigned char* block, unsigned char* outTexels, bool bc1) {
+	const uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	const uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+	int palette[4][4];
+	UnpackColor565(color0, palette[0]);
+	UnpackColor565(color1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	// BC1 blocks with color0 <= color1 have 3 colors and transparent black. BC3 color blocks always have 4 colors
+	const bool fourColors = !bc1 || color0 > color1;
+	for (int c = 0; c < 3; c++) {
+		if (fourColors) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	if (!fourColors) palette[3][3] = 0;
+	const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+	for (int i = 0; i < 16; i++) {
+		const int* color = palette[(indices >> (i * 2)) & 3];
+		for (int c = 0; c < 4; c++) outTexels[i * 4 + c] = static_cast<unsigned char>(color[c]);
+	}
+}
+
+void BlockCompression::EncodeAlphaBlock(const unsigned char* texels, unsigned char* outBlock) {
+	int alpha0 = 0;
+	int alpha1 = 255;
+	for (int i = 0; i < 16; i++) {
+		alpha0 = std::max(alpha0, static_cast<int>(texels[i * 4 + 3]));
+		alpha1 = std::min(alpha1, static_cast<int>(texels[i * 4 + 3]));
+	}
+	// alpha0 > alpha1 selects the 8 alphas mode: alpha0, alpha1 and 6 values between them
+	uint64_t indices = 0;
+	if (alpha0 > alpha1) {
+		for (int i = 0; i < 16; i++) {
+			// Nearest of the 8 steps from alpha1 (0) to alpha0 (7). Step 7 is index 0, step 0 index 1, step s index 8 - s
+			int step = static_cast<int>(std::lround((texels[i * 4 + 3] - alpha1) * 7.f / (alpha0 - alpha1)));
+			uint64_t index = step == 7 ? 0 : step == 0 ? 1 : static_cast<uint64_t>(8 - step);
+			indices |= index << (i * 3);
+		}
+	}
+	outBlock[0] = static_cast<unsigned char>(alpha0);
+	outBlock[1] = static_cast<unsigned char>(alpha1);
+	for (int i = 0; i < 6; i++) outBlock[2 + i] = static_cast<unsigned char>(indices >> (i * 8));
+}
+
+void BlockCompression::DecodeAlphaBlock(const unsigned char* block, unsigned char* outTexels) {
+	const int alpha0 = block[0];
+	const int alpha1 = block[1];
+	int palette[8] = { alpha0, alpha1 };
+	if (alpha0 > alpha1) {
+		for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+	}
+	else {
+		for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++) indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+	for (int i = 0; i < 16; i++) {
+		outTexels[i * 4 + 3] = static_cast<unsigned char>(palette[(indices >> (i * 3)) & 7]);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include "RenderDevice.h"
+
+// CPU encoder and decoder of the BC1 (DXT1) and BC3 (DXT5) block compressed formats.
+// Images are RGBA8; every 4x4 block of texels is encoded in 8 bytes (BC1: two 565 colors and 2 bit indices)
+// or 16 bytes (BC3: BC1 color block after an alpha block of two 8 bit alphas and 3 bit indices)
+class BlockCompression {
+public:
+	// Size in bytes of an image of the given format
+	static unsigned int GetImageSize(TextureFormat format, int width, int height);
+
+	// Encode an image. The block rows are split across the job system threads
+	static void Compress(TextureFormat format, int width, int height, const unsigned char* rgba, std::vector<unsigned char>& outData);
+	// Decode an image, for the drivers without the S3TC extension
+	static void Decompress(TextureFormat format, int width, int height, const unsigned char* data, std::vector<unsigned char>& outRgba);
+
+private:
+	// support method. Encode/decode the color block of 4x4 texels (64 bytes of RGBA)
+	static void EncodeColorBlock(const unsigned char* texels, unsigned char* outBlock);
+	// The color blocks of BC1 (bc1 true) can also use 3 colors and transparent black
+	static void DecodeColorBlock(const unsigned char* block, unsigned char* outTexels, bool bc1);
+	// support method. Encode/decode the alpha block of BC3
+	static void EncodeAlphaBlock(const unsigned char* texels, unsigned char* outBlock);
+	static void DecodeAlphaBlock(const unsigned char* block, unsigned char* outTexels);
+};
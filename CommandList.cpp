@@ -0,0 +1,40 @@
+#include "CommandList.h"
+#include <algorithm>
+#include <cstring>
+
+CommandList::CommandList() :
+	mTrianglesSubmitted(0),
+	mTrianglesFullDetail(0)
+{}
+
+void CommandList::Reset() {
+	mPackets.clear();
+	mTextureRequests.clear();
+	mTrianglesSubmitted = 0;
+	mTrianglesFullDetail = 0;
+}
+
+void CommandList::AddTriangles(unsigned int submitted, unsigned int fullDetail) {
+	mTrianglesSubmitted += submitted;
+	mTrianglesFullDetail += fullDetail;
+}
+
+void CommandList::Sort() {
+	std::sort(mPackets.begin(), mPackets.end(), [](const DrawPacket& a, const DrawPacket& b) {
+		return a.mSortKey < b.mSortKey;
+	});
+}
+
+uint64_t CommandList::MakeSortKey(DrawPass pass, unsigned int shader, unsigned int texture, uint32_t order) {
+	return (static_cast<uint64_t>(pass & 0x3) << 62) |
+		(static_cast<uint64_t>(shader & 0x3f) << 56) |
+		(static_cast<uint64_t>(texture & 0xffffff) << 32) |
+		order;
+}
+
+uint32_t CommandList::DepthOrder(float depth) {
+	depth = std::max(depth, 0.f);
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Math.h"
+
+// Render state a packet is drawn with
+enum DrawPass {
+	// Meshes: depth test on, no blending
+	EOpaquePass = 0,
+	// Sprites: drawn after the meshes with alpha blending and without depth test
+	ESpritePass = 1
+};
+
+// One draw call, recorded without touching OpenGL. The GL thread only binds and draws what the packet says
+struct DrawPacket {
+	// Packets are executed in increasing key order (see CommandList::MakeSortKey)
+	uint64_t mSortKey;
+	// Value of uWorldTransform
+	Matrix4 mWorldTransform;
+	class Shader* mShader;
+	// Texture to bind (nullptr keeps the bound one)
+	class Texture* mTexture;
+	// Geometry to draw from. nullptr for sprites, drawn with the sprite quad
+	const struct GeometryAllocation* mGeometry;
+	// Index range inside the geometry
+	unsigned int mFirstIndex;
+	unsigned int mIndexCount;
+	// Value of uSpecPower (meshes only)
+	float mSpecPower;
+	DrawPass mPass;
+};
+
+// Finest mip level of a texture needed by a recorded packet (texture streaming)
+struct TextureRequest {
+	class Texture* mTexture;
+	unsigned int mLevel;
+};
+
+// Linear buffer of draw packets filled by one recording job. Lists are reused from frame to frame, so
+// recording does not allocate once the buffers have grown to the size of the scene
+class CommandList {
+public:
+	CommandList();
+
+	// Forget the packets and the statistics, keep the memory
+	void Reset();
+	void AddDraw(const DrawPacket& packet) { mPackets.emplace_back(packet); }
+	// Count the triangles drawn at the selected level of detail and at full detail
+	void AddTriangles(unsigned int submitted, unsigned int fullDetail);
+	// Ask for the levels of a texture down to the given one
+	void AddTextureRequest(class Texture* texture, unsigned int level) { mTextureRequests.push_back({ texture, level }); }
+	// Sort the packets by key
+	void Sort();
+
+	const std::vector<DrawPacket>& GetPackets() const { return mPackets; }
+	unsigned int GetTrianglesSubmitted() const { return mTrianglesSubmitted; }
+	unsigned int GetTrianglesFullDetail() const { return mTrianglesFullDetail; }
+	const std::vector<TextureRequest>& GetTextureRequests() const { return mTextureRequests; }
+
+	// Key ordering the packets by pass (2 bits), shader (6 bits), texture (24 bits), then by order (32 bits):
+	// the view depth of meshes (front to back, see DepthOrder) or the draw order of sprites
+	static uint64_t MakeSortKey(DrawPass pass, unsigned int shader, unsigned int texture, uint32_t order);
+	// Order of a view depth: the bits of a positive float sort like its value
+	static uint32_t DepthOrder(float depth);
+
+private:
+	std::vector<DrawPacket> mPackets;
+	std::vector<TextureRequest> mTextureRequests;
+	// Triangles of the recorded packets, and the triangles at full detail
+	unsigned int mTrianglesSubmitted;
+	unsigned int mTrianglesFullDetail;
+};
@@ -15,6 +15,7 @@ public:
 	virtual void OnUpdateWorldTransform() {}
 
 	int GetUpdateOrder() const { return mUpdateOrder; }
+	class Actor* GetOwner() const { return mOwner; }
 	// Update component in base of player input
 	virtual void ProcessInput(const uint8_t* keyState){}
 
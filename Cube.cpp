@@ -21,7 +21,8 @@ Cube::Cube(Game* game) :
 	SetActorScale(Random::GetFloatRange(10.f, 100.f));
 
 	mMeshComp = new MeshComponent(this);
-	mMeshComp->SetMesh(game->GetRenderer()->GetMesh("Assets/Cube.gpmesh"));
+	// Cubes spawned during the game don't wait for the mesh: they show up once it is loaded
+	mMeshComp->SetMesh(game->GetRenderer()->GetMeshAsync("Assets/Cube.gpmesh"));
 
 	mMoveComp = new MoveComponent(this);
 }
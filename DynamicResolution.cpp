@@ -0,0 +1,78 @@
+#include "DynamicResolution.h"
+#include "Math.h"
+
+const float DynamicResolution::DefaultTargetMs = 15.f;
+const float DynamicResolution::DefaultMinScale = 0.5f;
+
+// Gains of the controller, on the area. The proportional term reacts to the changes of the error, the integral
+// term moves the area until the error is 0. Low enough to settle without oscillating over the GPU latency
+static const float ProportionalGain = 0.2f;
+static const float IntegralGain = 0.4f;
+// Errors smaller than this leave the scale as it is, so it doesn't change at every update around the target
+static const float ErrorDeadband = 0.05f;
+
+DynamicResolution::DynamicResolution() :
+	mEnabled(false),
+	mTargetMs(DefaultTargetMs),
+	mMinScale(DefaultMinScale),
+	mMaxScale(1.f),
+	mScale(1.f),
+	mArea(1.f),
+	mLastError(0.f),
+	mTimeSum(0.f),
+	mSamples(0),
+	mScaleFrame(0),
+	mMeasuredFrame(-1)
+{}
+
+void DynamicResolution::SetEnabled(bool enabled) {
+	if (enabled == mEnabled) return;
+	mEnabled = enabled;
+	// Start again from the full resolution
+	mScale = mMaxScale;
+	mArea = mMaxScale * mMaxScale;
+	mLastError = 0.f;
+	mTimeSum = 0.f;
+	mSamples = 0;
+}
+
+void DynamicResolution::SetScaleRange(float minScale, float maxScale) {
+	mMinScale = Math::Clamp(minScale, 0.1f, 1.f);
+	mMaxScale = Math::Clamp(maxScale, mMinScale, 1.f);
+	mScale = Math::Clamp(mScale, mMinScale, mMaxScale);
+	mArea = mScale * mScale;
+}
+
+void DynamicResolution::AddFrameTime(int64_t frame, float gpuMs) {
+	// The same frame is reported until the next read back
+	if (frame <= mMeasuredFrame) return;
+	mMeasuredFrame = frame;
+	if (!mEnabled || frame < mScaleFrame || gpuMs <= 0.f) return;
+	mTimeSum += gpuMs;
+	mSamples++;
+}
+
+float DynamicResolution::Update(int64_t frame) {
+	if (!mEnabled) return 1.f;
+	if (mSamples < SamplesPerUpdate) return mScale;
+
+	const float average = mTimeSum / mSamples;
+	mTimeSum = 0.f;
+	mSamples = 0;
+	// Relative to the measured time: the area that would meet the target is area * (1 + error)
+	const float error = (mTargetMs - average) / average;
+	if (Math::Abs(error) < ErrorDeadband) return mScale;
+	// Incremental form: the area integrates the output, so clamping it also stops the integral from winding up
+	const float minArea = mMinScale * mMinScale;
+	const float maxArea = mMaxScale * mMaxScale;
+	mArea = Math::Clamp(mArea + ProportionalGain * (error - mLastError) + IntegralGain * error, minArea, maxArea);
+	mLastError = error;
+
+	const float scale = Math::Sqrt(mArea);
+	if (scale != mScale) {
+		mScale = scale;
+		// The frames in flight were drawn at the old scale
+		mScaleFrame = frame;
+	}
+	return mScale;
+}
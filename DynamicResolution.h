@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+// Chooses the resolution of the 3D scene from the GPU time of the frames, so the frame time stays under a budget.
+// The scene is drawn in the bottom left part of an offscreen target, scale times the window size on each axis, then
+// stretched to the window. The GPU time of the scene grows with its pixels (scale squared), so the controller works
+// on that area: every SamplesPerUpdate measured frames, a PI controller moves it by the relative distance of the
+// average GPU time from the target. GPU times come back a few frames late (see GpuTimer): the frames drawn before
+// the last change of scale are not measured
+class DynamicResolution {
+public:
+	DynamicResolution();
+
+	// Disabled, the scale is 1 and the scene is drawn directly in the window
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return mEnabled; }
+	// GPU time aimed at for a whole frame, in ms
+	void SetTargetTime(float ms) { mTargetMs = ms; }
+	float GetTargetTime() const { return mTargetMs; }
+	// Bounds of the scale
+	void SetScaleRange(float minScale, float maxScale);
+
+	// GPU time of a frame read back (frames already added are ignored). Game thread
+	void AddFrameTime(int64_t frame, float gpuMs);
+	// Scale of the frame about to be built, updated once enough frames were measured. Game thread
+	float Update(int64_t frame);
+	float GetScale() const { return mEnabled ? mScale : 1.f; }
+
+	// Measured frames averaged by each update of the scale
+	static const unsigned int SamplesPerUpdate = 8;
+	// Default frame time: 60 Hz with some margin for the CPU and the driver
+	static const float DefaultTargetMs;
+	static const float DefaultMinScale;
+
+private:
+	bool mEnabled;
+	float mTargetMs;
+	float mMinScale;
+	float mMaxScale;
+	// Current scale, and the fraction of the window area it draws (the controlled value)
+	float mScale;
+	float mArea;
+	// Relative error of the last update (positive: the GPU is under the target)
+	float mLastError;
+	// GPU times measured since the last update
+	float mTimeSum;
+	unsigned int mSamples;
+	// First frame drawn at the current scale, and last frame measured
+	int64_t mScaleFrame;
+	int64_t mMeasuredFrame;
+};
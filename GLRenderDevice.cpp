@@ -0,0 +1,708 @@
+#include <glew.h>
+#include "GLRenderDevice.h"
+#include "VertexLayout.h"
+#include <cstring>
+
+GLRenderDevice::GLRenderDevice() :
+	mWindow(nullptr),
+	mContext(nullptr),
+	mNextFence(1),
+	mProgramBinaries(false),
+	mBufferStorage(false),
+	mUniformBufferAlignment(256),
+	mPixelUnpackBuffer(0)
+{}
+
+GLRenderDevice::~GLRenderDevice() {}
+
+bool GLRenderDevice::Initialize(const std::string& title, int width, int height) {
+	// Set OpneGL window's attribute
+	// return 0 if successfull, otherwise negative value
+	// Use the core OpenGL profile
+	SDL_GL_SetAttribute(
+		SDL_GL_CONTEXT_PROFILE_MASK,
+		SDL_GL_CONTEXT_PROFILE_CORE
+	);
+	// Specify OpenGL 3.3
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	// Request a color buffer with 8-bits per RGBA channel
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	// Request a z-buffer (depth buffer) of 24 bit
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	// Enable double buffering
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	// Force OpenGL to use hardware acceleration (GPU)
+	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+
+	// Create a window with support to OpenGL
+	mWindow = SDL_CreateWindow(title.c_str(), 100, 100, width, height, SDL_WINDOW_OPENGL);
+	if (!mWindow) {
+		SDL_Log("Failed to create window: %s", SDL_GetError());
+		return false;
+	}
+
+	// Create OpenGL Context
+	mContext = SDL_GL_CreateContext(mWindow);
+	mState.Reset();
+
+	// Enable GLEW library. Automatically initialize all extension functions supported by the current OpenGL context's version (3.3 in this case)
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK) {
+		SDL_Log("Failed to initialize GLEW: %s", SDL_GetError());
+		return false;
+	}
+	// Clear benign error
+	glGetError();
+
+	// Program binaries need at least one binary format, some drivers don't have any
+	GLint numBinaryFormats = 0;
+	if (GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+	mProgramBinaries = numBinaryFormats > 0;
+	mBufferStorage = GLEW_ARB_buffer_storage != 0;
+	GLint uniformBufferAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformBufferAlignment);
+	if (uniformBufferAlignment > 0) mUniformBufferAlignment = static_cast<unsigned int>(uniformBufferAlignment);
+	// Let the driver compile the shaders on as many threads as it wants
+	if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	return true;
+}
+
+std::string GLRenderDevice::GetDriverId() const {
+	auto getString = [](GLenum name) {
+		const GLubyte* str = glGetString(name);
+		return str ? std::string(reinterpret_cast<const char*>(str)) : std::string();
+	};
+	return getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION);
+}
+
+void GLRenderDevice::Shutdown() {
+	if (mContext) SDL_GL_DeleteContext(mContext);
+	if (mWindow) SDL_DestroyWindow(mWindow);
+	mContext = nullptr;
+	mWindow = nullptr;
+}
+
+void GLRenderDevice::AcquireContext() {
+	SDL_GL_MakeCurrent(mWindow, mContext);
+}
+
+void GLRenderDevice::ReleaseContext() {
+	SDL_GL_MakeCurrent(mWindow, nullptr);
+}
+
+void GLRenderDevice::Present() {
+	// Swap back and front buffer to render the scene (equivalent to SDL_RenderPresent of SDL)
+	SDL_GL_SwapWindow(mWindow);
+	mCounters.mSkippedStateChanges += mState.TakeSkipped();
+	EndFrameCounters();
+}
+
+static GLenum GetBufferUsage(BufferUsage usage) {
+	switch (usage) {
+	case EDynamicBuffer: return GL_DYNAMIC_DRAW;
+	case EStreamBuffer: return GL_STREAM_DRAW;
+	default: return GL_STATIC_DRAW;
+	}
+}
+
+BufferHandle GLRenderDevice::CreateBuffer(BufferType, unsigned int size, const void* data, BufferUsage usage) {
+	// Every buffer is written through the copy target, so the element buffer of the bound vertex array is not touched.
+	// The type doesn't matter to OpenGL: a buffer can be bound to any target
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	if (mState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer)) glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, data, GetBufferUsage(usage));
+	if (data) mCounters.mBufferBytes += size;
+	return buffer;
+}
+
+void GLRenderDevice::DestroyBuffer(BufferHandle buffer) {
+	glDeleteBuffers(1, &buffer);
+	mState.ForgetBuffer(buffer);
+}
+
+void GLRenderDevice::ResizeBuffer(BufferHandle buffer, unsigned int size, BufferUsage usage) {
+	if (mState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer)) glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GetBufferUsage(usage));
+}
+
+void GLRenderDevice::UpdateBuffer(BufferHandle buffer, unsigned int offset, unsigned int size, const void* data) {
+	if (mState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer)) glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+	mCounters.mBufferBytes += size;
+}
+
+void GLRenderDevice::CopyBuffer(BufferHandle source, unsigned int sourceOffset, BufferHandle dest, unsigned int destOffset, unsigned int size) {
+	if (mState.BindBuffer(GL_COPY_READ_BUFFER, source)) glBindBuffer(GL_COPY_READ_BUFFER, source);
+	if (mState.BindBuffer(GL_COPY_WRITE_BUFFER, dest)) glBindBuffer(GL_COPY_WRITE_BUFFER, dest);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destOffset, size);
+}
+
+void GLRenderDevice::BindUniformBuffer(BufferHandle buffer, unsigned int bindingPoint) {
+	// Attach the whole buffer to the binding point. Every program whose uniform block is bound to the
+	// same point reads from this buffer, so there is no need to rebind it when switching shader
+	// glBindBufferBase also binds the generic GL_UNIFORM_BUFFER target, which is never used on its own
+	if (mState.BindBufferBase(bindingPoint, buffer)) glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+}
+
+void GLRenderDevice::BindUniformBufferRange(BufferHandle buffer, unsigned int bindingPoint, unsigned int offset, unsigned int size) {
+	if (mState.BindBufferRange(bindingPoint, buffer, offset, size)) glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, buffer, offset, size);
+}
+
+unsigned int GLRenderDevice::GetUniformBufferAlignment() const {
+	return mUniformBufferAlignment;
+}
+
+BufferHandle GLRenderDevice::CreateMappedBuffer(BufferType, unsigned int size, void** outData) {
+	if (!mBufferStorage) return 0;
+	// Immutable storage, mapped once. Coherent: the writes are seen by the GPU without flushing
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	if (mState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer)) glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+	*outData = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+	if (!*outData) {
+		glDeleteBuffers(1, &buffer);
+		mState.ForgetBuffer(buffer);
+		return 0;
+	}
+	return buffer;
+}
+
+void* GLRenderDevice::MapBufferRange(BufferHandle buffer, unsigned int offset, unsigned int size) {
+	// Unsynchronized: the driver neither waits for the GPU nor copies the buffer (the fences of the caller guard the range)
+	if (mState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer)) glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	return glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void GLRenderDevice::UnmapBuffer(BufferHandle buffer) {
+	if (mState.BindBuffer(GL_COPY_WRITE_BUFFER, buffer)) glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+}
+
+TextureHandle GLRenderDevice::CreateTexture2D(int width, int height, int channels, const void* pixels) {
+	// Set color format. Check channels: RGB = 3; RGBA = 4
+	GLenum format = channels == 4 ? GL_RGBA : GL_RGB;
+
+	// Generate a openGL texture object and store its ID
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	if (mState.BindTexture(GL_TEXTURE_2D, texture)) glBindTexture(GL_TEXTURE_2D, texture); // GL_TEXTURE_2D is the most commot texture target
+
+	// Copy the raw image data into the texture
+	glTexImage2D(
+		GL_TEXTURE_2D,		// Texture target
+		0,					// Level of detail (assume 0 for now)
+		format,				// Color format OpenGL should use (RGB/RGBA)
+		width,				// Width of texture
+		height,				// Height of texture
+		0,					// Border - "MUST BE 0"
+		format,				// Color format of input data
+		GL_UNSIGNED_BYTE,	// Bit depth of input data. Unsigned byte specifies 8-bit channels
+		pixels				// Pointer to image data
+	);
+
+	// Enable bilinear filtering
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	if (!mPixelUnpackBuffer) mCounters.mBufferBytes += static_cast<uint64_t>(width) * height * channels;
+	mTextureTargets[texture] = GL_TEXTURE_2D;
+	return texture;
+}
+
+TextureHandle GLRenderDevice::CreateTextureMips(TextureFormat format, const std::vector<TextureLevel>& levels) {
+	if (levels.empty()) return 0;
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	mTextureTargets[texture] = GL_TEXTURE_2D;
+	mTextureLevels[texture] = 0;
+	UpdateTextureMips(texture, format, levels);
+	return texture;
+}
+
+bool GLRenderDevice::UpdateTextureMips(TextureHandle texture, TextureFormat format, const std::vector<TextureLevel>& levels) {
+	auto iter = mTextureLevels.find(texture);
+	if (iter == mTextureLevels.end() || levels.empty()) return false;
+	if (mState.BindTexture(GL_TEXTURE_2D, texture)) glBindTexture(GL_TEXTURE_2D, texture);
+	// Rows of the small levels are not 4 bytes aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t level = 0; level < levels.size(); level++) {
+		const TextureLevel& mip = levels[level];
+		switch (format) {
+		case ETextureBC1:
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, mip.mWidth, mip.mHeight, 0, mip.mSize, mip.mData);
+			break;
+		case ETextureBC3:
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, mip.mWidth, mip.mHeight, 0, mip.mSize, mip.mData);
+			break;
+		default:
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, mip.mWidth, mip.mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.mData);
+			break;
+		}
+		if (!mPixelUnpackBuffer) mCounters.mBufferBytes += mip.mSize;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// Empty images free the levels left from the previous chain
+	for (size_t level = levels.size(); level < iter->second; level++) {
+		glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	iter->second = static_cast<unsigned int>(levels.size());
+
+	// Trilinear filtering, only over the levels that were given
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()) - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return true;
+}
+
+TextureHandle GLRenderDevice::CreateTextureArray(TextureFormat format, const std::vector<std::vector<TextureLevel>>& layers) {
+	if (layers.empty() || layers[0].empty()) return 0;
+	const std::vector<TextureLevel>& first = layers[0];
+	const GLsizei numLayers = static_cast<GLsizei>(layers.size());
+	const GLenum internalFormat = format == ETextureBC1 ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT :
+		format == ETextureBC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_RGBA8;
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	if (mState.BindTexture(GL_TEXTURE_2D_ARRAY, texture)) glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t level = 0; level < first.size(); level++) {
+		// Allocate the level for all the layers, then fill each layer
+		const GLint mip = static_cast<GLint>(level);
+		const GLsizei width = first[level].mWidth;
+		const GLsizei height = first[level].mHeight;
+		if (format == ETextureRGBA8) {
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_RGBA8, width, height, numLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+		else {
+			// Compressed images can't be allocated without data: upload zeros
+			std::vector<unsigned char> zeros(static_cast<size_t>(first[level].mSize) * numLayers, 0);
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, mip, internalFormat, width, height, numLayers, 0,
+				static_cast<GLsizei>(zeros.size()), zeros.data());
+		}
+		for (GLsizei layer = 0; layer < numLayers; layer++) {
+			const TextureLevel& image = layers[layer][level];
+			if (format == ETextureRGBA8) {
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, image.mData);
+			}
+			else {
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, layer, width, height, 1, internalFormat, image.mSize, image.mData);
+			}
+			if (!mPixelUnpackBuffer) mCounters.mBufferBytes += image.mSize;
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(first.size()) - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, first.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	mTextureTargets[texture] = GL_TEXTURE_2D_ARRAY;
+	return texture;
+}
+
+bool GLRenderDevice::SupportsTextureFormat(TextureFormat format) const {
+	return format == ETextureRGBA8 || GLEW_EXT_texture_compression_s3tc;
+}
+
+TextureHandle GLRenderDevice::CreateBufferTexture(BufferHandle buffer, TexelFormat format) {
+	GLenum internalFormat = GL_RGBA32F;
+	if (format == ETexelRG32UI) internalFormat = GL_RG32UI;
+	else if (format == ETexelR16UI) internalFormat = GL_R16UI;
+
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	// Connect the texture to the buffer: texels are read directly from the buffer storage
+	if (mState.BindTexture(GL_TEXTURE_BUFFER, texture)) glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer);
+	if (mState.BindTexture(GL_TEXTURE_BUFFER, 0)) glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	mTextureTargets[texture] = GL_TEXTURE_BUFFER;
+	return texture;
+}
+
+void GLRenderDevice::SetPixelUnpackBuffer(BufferHandle buffer) {
+	if (mState.BindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer)) glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	mPixelUnpackBuffer = buffer;
+}
+
+void GLRenderDevice::DestroyTexture(TextureHandle texture) {
+	glDeleteTextures(1, &texture);
+	mState.ForgetTexture(texture);
+	mTextureTargets.erase(texture);
+	mTextureLevels.erase(texture);
+}
+
+void GLRenderDevice::BindTexture(TextureHandle texture, unsigned int unit) {
+	auto iter = mTextureTargets.find(texture);
+	if (iter == mTextureTargets.end()) return;
+	if (mState.SetActiveTextureUnit(unit)) glActiveTexture(GL_TEXTURE0 + unit);
+	if (!mState.BindTexture(iter->second, texture)) return;
+	glBindTexture(iter->second, texture);
+	mCounters.mTextureBinds++;
+}
+
+VertexArrayHandle GLRenderDevice::CreateVertexArray(const VertexLayout& layout, BufferHandle vertices, BufferHandle indices) {
+	// First create the vertex array object and store its ID
+	GLuint vertexArray = 0;
+	glGenVertexArrays(1, &vertexArray);
+	if (mState.BindVertexArray(vertexArray)) glBindVertexArray(vertexArray);
+
+	// Specify vertex layout (vertex attributes), reading from the vertex buffer
+	if (mState.BindBuffer(GL_ARRAY_BUFFER, vertices)) glBindBuffer(GL_ARRAY_BUFFER, vertices);
+	for (const VertexAttribute& attribute : layout.GetAttributes()) {
+		glEnableVertexAttribArray(attribute.mLocation);
+		const void* offset = reinterpret_cast<const void*>(static_cast<size_t>(attribute.mOffset));
+		if (attribute.mInteger) {
+			glVertexAttribIPointer(attribute.mLocation, attribute.mComponents, attribute.mType, layout.GetStride(), offset);
+		}
+		else {
+			glVertexAttribPointer(attribute.mLocation, attribute.mComponents, attribute.mType,
+				attribute.mNormalized ? GL_TRUE : GL_FALSE, layout.GetStride(), offset);
+		}
+	}
+	// The element buffer binding is part of the vertex array state (not cached: it changes with the vertex array)
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
+	return vertexArray;
+}
+
+void GLRenderDevice::DestroyVertexArray(VertexArrayHandle vertexArray) {
+	glDeleteVertexArrays(1, &vertexArray);
+	mState.ForgetVertexArray(vertexArray);
+}
+
+void GLRenderDevice::BindVertexArray(VertexArrayHandle vertexArray) {
+	if (!mState.BindVertexArray(vertexArray)) return;
+	glBindVertexArray(vertexArray);
+	mCounters.mVertexArrayBinds++;
+}
+
+unsigned int GLRenderDevice::CompileShader(const std::string& source, unsigned int stage) {
+	const char* contentsChar = source.c_str();
+	// create a shader of the specified type
+	GLuint shader = glCreateShader(stage);
+	// puts the entire program inside the char array into the shader source and compile it.
+	// The status is not queried here: that would wait for the compilation to end
+	glShaderSource(shader, 1, &(contentsChar), nullptr);
+	glCompileShader(shader);
+	return shader;
+}
+
+ProgramHandle GLRenderDevice::BeginProgram(const std::string& vertexSource, const std::string& fragmentSource) {
+	GLuint vertexShader = CompileShader(vertexSource, GL_VERTEX_SHADER);
+	GLuint fragShader = CompileShader(fragmentSource, GL_FRAGMENT_SHADER);
+
+	// Create a program that link vertex and fragment shaders
+	GLuint program = glCreateProgram();
+	// Keep the linked binary available for the program cache
+	if (mProgramBinaries) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragShader);
+	glLinkProgram(program);
+	// The shaders are deleted with the program. Until then they stay attached, so FinishProgram can read their log
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragShader);
+	return program;
+}
+
+bool GLRenderDevice::FinishProgram(ProgramHandle program, std::string& outError) {
+	// Query the linking status of the program. This waits for the compilation and the link
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_TRUE) return true;
+
+	char errMsg[512];
+	// A failed compilation makes the link fail: report the messages of the stages first
+	GLuint shaders[2] = {};
+	GLsizei numShaders = 0;
+	glGetAttachedShaders(program, 2, &numShaders, shaders);
+	for (GLsizei i = 0; i < numShaders; i++) {
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &status);
+		if (status == GL_TRUE) continue;
+		memset(errMsg, 0, 512);
+		glGetShaderInfoLog(shaders[i], 511, nullptr, errMsg);
+		outError += "GLSL Compile failed:\n";
+		outError += errMsg;
+	}
+	memset(errMsg, 0, 512);
+	glGetProgramInfoLog(program, 511, nullptr, errMsg);
+	outError += "GLSL Link Failed:\n";
+	outError += errMsg;
+	glDeleteProgram(program);
+	return false;
+}
+
+bool GLRenderDevice::GetProgramBinary(ProgramHandle program, uint32_t& outFormat, std::vector<unsigned char>& outBinary) {
+	if (!mProgramBinaries) return false;
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return false;
+	outBinary.resize(static_cast<size_t>(length));
+	GLenum format = 0;
+	glGetProgramBinary(program, length, nullptr, &format, outBinary.data());
+	outFormat = format;
+	return true;
+}
+
+ProgramHandle GLRenderDevice::CreateProgramFromBinary(uint32_t format, const std::vector<unsigned char>& binary) {
+	if (!mProgramBinaries || binary.empty()) return 0;
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+	// The driver rejects binaries of another version: the program is not linked
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void GLRenderDevice::DestroyProgram(ProgramHandle program) {
+	glDeleteProgram(program);
+	mState.ForgetProgram(program);
+}
+
+void GLRenderDevice::UseProgram(ProgramHandle program) {
+	// Use the specified shader program to draw polygons
+	if (!mState.UseProgram(program)) return;
+	glUseProgram(program);
+	mCounters.mProgramBinds++;
+}
+
+void GLRenderDevice::GetProgramUniforms(ProgramHandle program, std::vector<ProgramUniform>& outUniforms) {
+	outUniforms.clear();
+	// Number of active uniforms and length of the longest name
+	GLint numUniforms = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<char> name(static_cast<size_t>(maxNameLength) + 1, '\0');
+
+	for (GLint i = 0; i < numUniforms; i++) {
+		GLint count = 0;
+		GLenum type = 0;
+		glGetActiveUniform(program, static_cast<GLuint>(i), maxNameLength, nullptr, &count, &type, name.data());
+		// Members of uniform blocks have no location: they are written through uniform buffers
+		GLint location = glGetUniformLocation(program, name.data());
+		if (location < 0) continue;
+
+		// Size of a single element
+		unsigned int elementSize = sizeof(float);
+		switch (type) {
+		case GL_FLOAT_VEC2: elementSize = 2 * sizeof(float); break;
+		case GL_FLOAT_VEC3: elementSize = 3 * sizeof(float); break;
+		case GL_FLOAT_VEC4: elementSize = 4 * sizeof(float); break;
+		case GL_FLOAT_MAT3: elementSize = 9 * sizeof(float); break;
+		case GL_FLOAT_MAT4: elementSize = 16 * sizeof(float); break;
+		default: break; // float, int, bool and samplers
+		}
+		outUniforms.emplace_back(ProgramUniform{ std::string(name.data()), location, static_cast<unsigned int>(count), elementSize });
+	}
+}
+
+bool GLRenderDevice::BindUniformBlock(ProgramHandle program, const std::string& blockName, unsigned int bindingPoint) {
+	// Find the index of the block inside this program
+	GLuint blockIndex = glGetUniformBlockIndex(program, blockName.c_str());
+	if (blockIndex == GL_INVALID_INDEX) return false;
+	// The block reads its data from the buffer attached to the binding point
+	glUniformBlockBinding(program, blockIndex, bindingPoint);
+	return true;
+}
+
+void GLRenderDevice::SetUniform(int location, UniformType type, unsigned int count, const void* data) {
+	switch (type) {
+	case EUniformFloat:
+		glUniform1fv(location, count, static_cast<const float*>(data));
+		break;
+	case EUniformInt:
+		// Also used for sampler units
+		glUniform1iv(location, count, static_cast<const int*>(data));
+		break;
+	case EUniformVec3:
+		glUniform3fv(location, count, static_cast<const float*>(data));
+		break;
+	case EUniformMat4:
+		// Transpose: the engine uses row vectors for multiplication
+		glUniformMatrix4fv(location, count, GL_TRUE, static_cast<const float*>(data));
+		break;
+	}
+	mCounters.mUniformUploads++;
+}
+
+RenderTargetHandle GLRenderDevice::CreateRenderTarget(int width, int height) {
+	// Renderbuffers: the color is only read back by BlitToWindow, never sampled
+	GLuint renderbuffers[2] = { 0, 0 };
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	if (mState.BindRenderTarget(framebuffer)) glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (mState.BindRenderTarget(0)) glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		SDL_Log("Render target %dx%d is incomplete (status 0x%x)", width, height, status);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(2, renderbuffers);
+		mState.ForgetRenderTarget(framebuffer);
+		return 0;
+	}
+	mRenderTargets[framebuffer] = RenderTarget{ renderbuffers[0], renderbuffers[1], width, height };
+	return framebuffer;
+}
+
+void GLRenderDevice::DestroyRenderTarget(RenderTargetHandle target) {
+	auto iter = mRenderTargets.find(target);
+	if (iter == mRenderTargets.end()) return;
+	GLuint renderbuffers[2] = { iter->second.mColor, iter->second.mDepth };
+	glDeleteFramebuffers(1, &target);
+	glDeleteRenderbuffers(2, renderbuffers);
+	mState.ForgetRenderTarget(target);
+	mRenderTargets.erase(iter);
+}
+
+void GLRenderDevice::BindRenderTarget(RenderTargetHandle target) {
+	if (!mState.BindRenderTarget(target)) return;
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	mCounters.mStateChanges++;
+}
+
+void GLRenderDevice::BlitToWindow(RenderTargetHandle source, int sourceWidth, int sourceHeight, int width, int height) {
+	// The read framebuffer is not mirrored by the state cache: only the blit reads from it
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	if (mState.BindRenderTarget(0)) glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	mCounters.mStateChanges++;
+}
+
+void GLRenderDevice::SetPipelineState(const PipelineState& state) {
+	// Only the enables that differ from the current state are sent
+	bool changed = false;
+	if (mState.SetDepthTest(state.mDepthTest)) {
+		if (state.mDepthTest) glEnable(GL_DEPTH_TEST);
+		else glDisable(GL_DEPTH_TEST);
+		changed = true;
+	}
+	if (mState.SetBlend(state.mBlend)) {
+		if (state.mBlend) glEnable(GL_BLEND);
+		else glDisable(GL_BLEND);
+		changed = true;
+	}
+	// Standard alpha blending is the only blend function: it is set once
+	if (state.mBlend && mState.SetBlendFunc(GL_SRC_ALPHA)) {
+		glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
+	}
+	if (mState.SetCullFace(state.mCullBackFaces)) {
+		if (state.mCullBackFaces) glEnable(GL_CULL_FACE);
+		else glDisable(GL_CULL_FACE);
+		changed = true;
+	}
+	if (mState.SetDepthWrite(state.mDepthWrite)) {
+		glDepthMask(state.mDepthWrite ? GL_TRUE : GL_FALSE);
+		changed = true;
+	}
+	if (mState.SetColorWrite(state.mColorWrite)) {
+		const GLboolean write = state.mColorWrite ? GL_TRUE : GL_FALSE;
+		glColorMask(write, write, write, write);
+		changed = true;
+	}
+	const GLenum depthFunc = state.mDepthFunc == ELessEqualDepth ? GL_LEQUAL : GL_LESS;
+	if (mState.SetDepthFunc(depthFunc)) {
+		glDepthFunc(depthFunc);
+		changed = true;
+	}
+	if (changed) mCounters.mStateChanges++;
+}
+
+void GLRenderDevice::SetViewport(int x, int y, int width, int height) {
+	if (mState.SetViewport(x, y, width, height)) glViewport(x, y, width, height);
+}
+
+void GLRenderDevice::Clear(float red, float green, float blue, float alpha) {
+	// Set the clear color (equivalent to SDL_SetRendererDrawColor of SDL)
+	if (mState.SetClearColor(red, green, blue, alpha)) glClearColor(red, green, blue, alpha);
+	// The write masks also mask the clear
+	if (mState.SetDepthWrite(true)) glDepthMask(GL_TRUE);
+	if (mState.SetColorWrite(true)) glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	// Clear the color buffer (equivalent to SDL_RenderClear of SDL) and Depth Buffer
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void GLRenderDevice::DrawIndexed(unsigned int count, unsigned int indexSize, unsigned int indexOffset, int baseVertex) {
+	const GLenum indexType = indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	const void* offset = reinterpret_cast<const void*>(static_cast<size_t>(indexOffset));
+	if (baseVertex == 0) {
+		glDrawElements(GL_TRIANGLES, count, indexType, offset);
+	}
+	else {
+		glDrawElementsBaseVertex(GL_TRIANGLES, count, indexType, const_cast<void*>(offset), baseVertex);
+	}
+	mCounters.mDraws++;
+	mCounters.mTriangles += count / 3;
+}
+
+QueryHandle GLRenderDevice::CreateTimerQuery() {
+	GLuint query = 0;
+	glGenQueries(1, &query);
+	return query;
+}
+
+void GLRenderDevice::DestroyTimerQuery(QueryHandle query) {
+	glDeleteQueries(1, &query);
+}
+
+void GLRenderDevice::BeginTimerQuery(QueryHandle query) {
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void GLRenderDevice::EndTimerQuery() {
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+bool GLRenderDevice::GetTimerQueryResult(QueryHandle query, uint64_t& outNanoseconds) {
+	// Asking for the result before it is available would stall until the GPU catches up
+	GLint available = 0;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return false;
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+	outNanoseconds = elapsed;
+	return true;
+}
+
+FenceHandle GLRenderDevice::InsertFence() {
+	GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (!sync) return 0;
+	FenceHandle fence = mNextFence++;
+	mFences[fence] = static_cast<void*>(sync);
+	return fence;
+}
+
+bool GLRenderDevice::WaitFence(FenceHandle fence, uint64_t timeoutNanoseconds) {
+	auto iter = mFences.find(fence);
+	if (iter == mFences.end()) return false;
+	// Flush, otherwise the fence may never reach the GPU and the wait would time out
+	const GLenum result = glClientWaitSync(static_cast<GLsync>(iter->second), GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNanoseconds);
+	return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+void GLRenderDevice::DestroyFence(FenceHandle fence) {
+	auto iter = mFences.find(fence);
+	if (iter == mFences.end()) return;
+	glDeleteSync(static_cast<GLsync>(iter->second));
+	mFences.erase(iter);
+}
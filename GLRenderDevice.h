@@ -0,0 +1,111 @@
+#pragma once
+#include <SDL.h>
+#include <unordered_map>
+#include "RenderDevice.h"
+#include "RenderStateCache.h"
+
+// OpenGL 3.3 core profile backend. The handles are the OpenGL object names
+class GLRenderDevice : public RenderDevice {
+public:
+	GLRenderDevice();
+	~GLRenderDevice();
+
+	bool Initialize(const std::string& title, int width, int height) override;
+	void Shutdown() override;
+	void AcquireContext() override;
+	void ReleaseContext() override;
+	void Present() override;
+	RenderBackend GetBackend() const override { return EOpenGLBackend; }
+	std::string GetDriverId() const override;
+
+	BufferHandle CreateBuffer(BufferType type, unsigned int size, const void* data, BufferUsage usage) override;
+	void DestroyBuffer(BufferHandle buffer) override;
+	void ResizeBuffer(BufferHandle buffer, unsigned int size, BufferUsage usage) override;
+	void UpdateBuffer(BufferHandle buffer, unsigned int offset, unsigned int size, const void* data) override;
+	void CopyBuffer(BufferHandle source, unsigned int sourceOffset, BufferHandle dest, unsigned int destOffset, unsigned int size) override;
+	void BindUniformBuffer(BufferHandle buffer, unsigned int bindingPoint) override;
+	void BindUniformBufferRange(BufferHandle buffer, unsigned int bindingPoint, unsigned int offset, unsigned int size) override;
+	unsigned int GetUniformBufferAlignment() const override;
+	BufferHandle CreateMappedBuffer(BufferType type, unsigned int size, void** outData) override;
+	void* MapBufferRange(BufferHandle buffer, unsigned int offset, unsigned int size) override;
+	void UnmapBuffer(BufferHandle buffer) override;
+
+	TextureHandle CreateTexture2D(int width, int height, int channels, const void* pixels) override;
+	TextureHandle CreateTextureMips(TextureFormat format, const std::vector<TextureLevel>& levels) override;
+	bool UpdateTextureMips(TextureHandle texture, TextureFormat format, const std::vector<TextureLevel>& levels) override;
+	TextureHandle CreateTextureArray(TextureFormat format, const std::vector<std::vector<TextureLevel>>& layers) override;
+	bool SupportsTextureFormat(TextureFormat format) const override;
+	TextureHandle CreateBufferTexture(BufferHandle buffer, TexelFormat format) override;
+	void SetPixelUnpackBuffer(BufferHandle buffer) override;
+	void DestroyTexture(TextureHandle texture) override;
+	void BindTexture(TextureHandle texture, unsigned int unit) override;
+
+	VertexArrayHandle CreateVertexArray(const class VertexLayout& layout, BufferHandle vertices, BufferHandle indices) override;
+	void DestroyVertexArray(VertexArrayHandle vertexArray) override;
+	void BindVertexArray(VertexArrayHandle vertexArray) override;
+
+	ProgramHandle BeginProgram(const std::string& vertexSource, const std::string& fragmentSource) override;
+	bool FinishProgram(ProgramHandle program, std::string& outError) override;
+	bool GetProgramBinary(ProgramHandle program, uint32_t& outFormat, std::vector<unsigned char>& outBinary) override;
+	ProgramHandle CreateProgramFromBinary(uint32_t format, const std::vector<unsigned char>& binary) override;
+	void DestroyProgram(ProgramHandle program) override;
+	void UseProgram(ProgramHandle program) override;
+	void GetProgramUniforms(ProgramHandle program, std::vector<ProgramUniform>& outUniforms) override;
+	bool BindUniformBlock(ProgramHandle program, const std::string& blockName, unsigned int bindingPoint) override;
+	void SetUniform(int location, UniformType type, unsigned int count, const void* data) override;
+
+	RenderTargetHandle CreateRenderTarget(int width, int height) override;
+	void DestroyRenderTarget(RenderTargetHandle target) override;
+	void BindRenderTarget(RenderTargetHandle target) override;
+	void BlitToWindow(RenderTargetHandle source, int sourceWidth, int sourceHeight, int width, int height) override;
+
+	void SetPipelineState(const PipelineState& state) override;
+	void SetViewport(int x, int y, int width, int height) override;
+	void Clear(float red, float green, float blue, float alpha) override;
+	void DrawIndexed(unsigned int count, unsigned int indexSize, unsigned int indexOffset, int baseVertex) override;
+
+	QueryHandle CreateTimerQuery() override;
+	void DestroyTimerQuery(QueryHandle query) override;
+	void BeginTimerQuery(QueryHandle query) override;
+	void EndTimerQuery() override;
+	bool GetTimerQueryResult(QueryHandle query, uint64_t& outNanoseconds) override;
+
+	FenceHandle InsertFence() override;
+	bool WaitFence(FenceHandle fence, uint64_t timeoutNanoseconds) override;
+	void DestroyFence(FenceHandle fence) override;
+
+private:
+	// support method. Create one stage and start its compilation
+	unsigned int CompileShader(const std::string& source, unsigned int stage);
+
+	// Window created by SDL
+	SDL_Window* mWindow;
+	// OpenGL Context: this is the "world" of OpenGL that contains every item that OpengGl knows about
+	// such as color buffer, images, model loaded and any other OpenGL objects
+	SDL_GLContext mContext;
+	// Target of each texture (GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or GL_TEXTURE_BUFFER), needed to bind it
+	std::unordered_map<TextureHandle, unsigned int> mTextureTargets;
+	// Number of levels of the textures made by CreateTextureMips, released when they are replaced
+	std::unordered_map<TextureHandle, unsigned int> mTextureLevels;
+	// Renderbuffers of the render targets (the handles are the framebuffer names)
+	struct RenderTarget {
+		unsigned int mColor;
+		unsigned int mDepth;
+		int mWidth;
+		int mHeight;
+	};
+	std::unordered_map<RenderTargetHandle, RenderTarget> mRenderTargets;
+	// Sync objects (GLsync) of the fences
+	std::unordered_map<FenceHandle, void*> mFences;
+	FenceHandle mNextFence;
+	// The driver can save and load program binaries (GL 4.1 or ARB_get_program_binary)
+	bool mProgramBinaries;
+	// The driver can map buffers persistently (GL 4.4 or ARB_buffer_storage)
+	bool mBufferStorage;
+	// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	unsigned int mUniformBufferAlignment;
+	// Buffer the texels are read from (0: client memory). Its bytes were counted when it was written
+	BufferHandle mPixelUnpackBuffer;
+	// Bindings and enables of the context: the calls that would not change them are skipped
+	RenderStateCache mState;
+};
@@ -9,6 +9,22 @@
 #include "SpriteComponent.h"
 #include "PlaneActor.h"
 #include "Sphere.h"
+#include "JobSystem.h"
+#include "DynamicResolution.h"
+#include "KtxFile.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Potentially visible sets of the level, baked with "-bakepvs" (see Main.cpp)
+static const char* LevelPvsFile = "Assets/Level.pvs";
+// Height of the floor and of the top of the walls: the camera moves between them
+static const float FloorHeight = -100.f;
+static const float WallTop = 250.f;
+// Textures of the many-material scene (see Game::LoadManyMaterials): two pages of texture array, one of each size
+static const int NumMaterials = 128;
+static const int MaterialSizes[2] = { 64, 128 };
+static const char* MaterialFolder = "Assets/Materials/";
 
 Game::Game() : 
 	mWinHeight(0),
@@ -16,7 +32,15 @@ Game::Game() :
 	mTicksCount(0),
 	mIsRunning(true),
 	mUpdatingActors(false),
-	mRenderer(nullptr)
+	mRenderer(nullptr),
+	mRenderBackend(EOpenGLBackend),
+	mFrameLimit(0),
+	mFrameCount(0),
+	mTextureBudget(0),
+	mTextureArrays(false),
+	mManyMaterials(false),
+	mDepthPrepass(false),
+	mDynamicResolution(true)
 {}
 
 void Game::SetWindowWidthHeight(int width, int height) {
@@ -25,23 +49,35 @@ void Game::SetWindowWidthHeight(int width, int height) {
 }
 
 bool Game::Initialize() {
-	// Initialize SDL
-	int sdlResult = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+	// Initialize SDL. The null render device has no window: only events and timer are needed
+	Uint32 sdlFlags = mRenderBackend == ENullBackend ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_AUDIO;
+	int sdlResult = SDL_Init(sdlFlags);
 	if (sdlResult != 0) {
 		SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
 		return false;
 	}
 
 	mRenderer = new Renderer(this);
-	if (!mRenderer->Initialize(mWinWidth, mWinHeight)) {
+	if (!mRenderer->Initialize(mWinWidth, mWinHeight, mRenderBackend)) {
 		SDL_Log("Failed to create renderer: %s", SDL_GetError());
 		return false;
 	}
 
+	if (mTextureBudget > 0) mRenderer->SetTextureBudget(mTextureBudget);
+	mRenderer->SetDepthPrepass(mDepthPrepass);
+	mRenderer->SetDynamicResolution(mDynamicResolution);
+
 	Random::Init();
+	// Start the worker threads used to split CPU work (light assignment, ...)
+	JobSystem::Init();
 
 	// Load all objects and lights
 	LoadData();
+	if (!mStatsFile.empty()) {
+		mRenderer->StartStatsCapture(mStatsFile);
+	}
+	// From now on the frames are drawn by the render thread, while the game updates the next one
+	mRenderer->StartRenderThread();
 
 	mTicksCount = SDL_GetTicks();
 
@@ -50,16 +86,26 @@ bool Game::Initialize() {
 }
 
 void Game::ShutDown() {
+	// Take the OpenGL context back before the resources are released
+	if (mRenderer) mRenderer->StopRenderThread();
 	UnloadData();
 	if (mRenderer) mRenderer->ShutDown();
+	JobSystem::Shutdown();
 	SDL_Quit();
 }
 
 void Game::RunLoop() {
+	Uint64 start = SDL_GetPerformanceCounter();
 	while (mIsRunning) {
 		ProcessInput();
 		UpdateGame();
 		GenerateOutput();
+		mFrameCount++;
+		if (mFrameLimit > 0 && mFrameCount >= mFrameLimit) mIsRunning = false;
+	}
+	if (mFrameLimit > 0) {
+		double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+		SDL_Log("%u frames in %.1f ms (%.3f ms per frame)", mFrameCount, ms, ms / Math::Max(mFrameCount, 1u));
 	}
 }
 
@@ -75,6 +121,19 @@ void Game::ProcessInput() {
 			case SDL_QUIT : 
 				mIsRunning = false;
 				break;
+			// F2 switches the depth pre-pass on and off, F3 the dynamic resolution, to compare the frame times with
+			// and without them
+			case SDL_KEYDOWN :
+				if (event.key.keysym.scancode == SDL_SCANCODE_F2 && !event.key.repeat) {
+					mRenderer->SetDepthPrepass(!mRenderer->GetDepthPrepass());
+					SDL_Log("Depth pre-pass %s", mRenderer->GetDepthPrepass() ? "on" : "off");
+				}
+				else if (event.key.keysym.scancode == SDL_SCANCODE_F3 && !event.key.repeat) {
+					DynamicResolution* resolution = mRenderer->GetDynamicResolution();
+					mRenderer->SetDynamicResolution(!resolution->IsEnabled());
+					SDL_Log("Dynamic resolution %s", resolution->IsEnabled() ? "on" : "off");
+				}
+				break;
 		}
 	}
 
@@ -89,12 +148,16 @@ void Game::ProcessInput() {
 }
 
 void Game::UpdateGame() {
-	// wait until 16ms has elapsed since last frame. Guarantee fixed 60FPS
-	while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16));
-	// calculate deltatime in milliseconds
-	float deltatime = (SDL_GetTicks() - mTicksCount) / 1000.0f;
-	// clamp deltatime to fixed value
-	if (deltatime > 0.05f) deltatime = 0.05f;
+	// A run with a frame limit doesn't wait and always advances by 16ms: the same frames are drawn on every machine
+	float deltatime = 0.016f;
+	if (mFrameLimit == 0) {
+		// wait until 16ms has elapsed since last frame. Guarantee fixed 60FPS
+		while (!SDL_TICKS_PASSED(SDL_GetTicks(), mTicksCount + 16));
+		// calculate deltatime in milliseconds
+		deltatime = (SDL_GetTicks() - mTicksCount) / 1000.0f;
+		// clamp deltatime to fixed value
+		if (deltatime > 0.05f) deltatime = 0.05f;
+	}
 
 	// update tick counts
 	mTicksCount = SDL_GetTicks();
@@ -174,7 +237,7 @@ void Game::LoadData() {
 		for (int j = 0; j < wallNum; j++)
 		{
 			a = new PlaneActor(this);
-			a->SetActorPosition(Vector3(start + i * size, start + j * size, -100.0f));
+			a->SetActorPosition(Vector3(start + i * size, start + j * size, FloorHeight));
 		}
 	}
 
@@ -210,18 +273,25 @@ void Game::LoadData() {
 	dirLight.mDirection = Vector3(Random::GetFloatRange(-800.f, 800.f), Random::GetFloatRange(-800.f, 800.f), 10.f);
 	dirLight.mDiffuseColor = Vector3(Random::GetFloat(), Random::GetFloat(), Random::GetFloat());
 	dirLight.mSpecularColor = Vector3(Random::GetFloat(), Random::GetFloat(), Random::GetFloat());
-	PointLight* pointLights = mRenderer->GetPointLights();
-	const unsigned int numPointLights = 4;
-	for (int i = 0; i < numPointLights; i++) {
-		pointLights[i].mPosition = Vector3(Random::GetFloatRange(-800.f, 800.f), Random::GetFloatRange(-800.f, 800.f), 10.f);
+	// Point lights are assigned to clusters, so each fragment only pays for the few lights around it
+	std::vector<PointLight>& pointLights = mRenderer->GetPointLights();
+	const unsigned int numPointLights = 256;
+	pointLights.resize(numPointLights);
+	for (unsigned int i = 0; i < numPointLights; i++) {
+		pointLights[i].mPosition = Vector3(Random::GetFloatRange(start, -start), Random::GetFloatRange(start, -start), 10.f);
 		pointLights[i].mDiffuseColor = Vector3(Random::GetFloat(), Random::GetFloat(), Random::GetFloat());
-		pointLights[i].mSpecularColor = Vector3(Random::GetFloat(), Random::GetFloat(), Random::GetFloat());;
+		pointLights[i].mSpecularColor = Vector3(Random::GetFloat(), Random::GetFloat(), Random::GetFloat());
 		pointLights[i].mSpecPower = 1.f;
-		pointLights[i].mRadius = 250.f;
+		pointLights[i].mRadius = Random::GetFloatRange(150.f, 250.f);
 	}
 	
 	mCameraActor = new CameraActor(this);
 
+	// Floor and walls are static: merge them in a few large meshes
+	mRenderer->BuildStaticBatches();
+	// Skip the actors in the cells that can't be seen from the camera cell
+	mRenderer->LoadPvs(LevelPvsFile);
+
 	// UI elements
 	a = new Actor(this);
 	SpriteComponent* sc = new SpriteComponent(a);
@@ -238,6 +308,56 @@ void Game::LoadData() {
 	a->SetActorScale(0.75f);
 	sc->SetTexture(tex);
 
+	if (mManyMaterials) LoadManyMaterials();
+
+	// Textures of the same size and format are bound once for all their draws
+	if (mTextureArrays) mRenderer->BuildTextureArrays();
+
+}
+
+bool Game::BakePvs() {
+	// Sample just above the floor, where the camera can be
+	return mRenderer->BakePvs(LevelPvsFile, FloorHeight + 1.f, WallTop);
+}
+
+void Game::LoadManyMaterials() {
+	std::error_code error;
+	fs::create_directories(MaterialFolder, error);
+	std::vector<Texture*> textures;
+	for (int i = 0; i < NumMaterials; i++) {
+		// Plain color texture with its whole mip chain, written again at each run so the scene is always the same
+		const int size = MaterialSizes[i % 2];
+		const unsigned char color[4] = { static_cast<unsigned char>(i * 2), static_cast<unsigned char>(255 - i * 2),
+			static_cast<unsigned char>(i * 97 % 256), 255 };
+		KtxImage image = { ETextureRGBA8, size, size, 0, {} };
+		for (int levelSize = size; levelSize > 0; levelSize /= 2) {
+			image.mLevels.emplace_back();
+			for (int t = 0; t < levelSize * levelSize; t++) {
+				image.mLevels.back().insert(image.mLevels.back().end(), color, color + 4);
+			}
+		}
+		const std::string fileName = MaterialFolder + std::string("Material") + std::to_string(i) + ".ktx";
+		Texture* tex = KtxFile::Write(fileName, image) ? mRenderer->GetTexture(fileName) : nullptr;
+		if (tex) textures.emplace_back(tex);
+	}
+
+	// A copy of the cube mesh holds the textures: each cube selects its own by texture index
+	Mesh* cube = mRenderer->GetMesh("Assets/Cube.gpmesh");
+	Mesh* mesh = cube ? mRenderer->CreateMeshCopy("ManyMaterials", cube, textures) : nullptr;
+	if (!mesh) return;
+	// The cubes are not static: they stay out of the static batches and the potentially visible sets
+	const int columns = 16;
+	const float spacing = 120.f;
+	for (size_t i = 0; i < textures.size(); i++) {
+		Actor* a = new Actor(this);
+		a->SetActorPosition(Vector3((static_cast<int>(i) % columns - columns / 2) * spacing,
+			(static_cast<int>(i) / columns - NumMaterials / columns / 2) * spacing, FloorHeight + 50.f));
+		a->SetActorScale(25.f);
+		MeshComponent* mc = new MeshComponent(a);
+		mc->SetMesh(mesh);
+		mc->SetTextureIndex(i);
+	}
+	SDL_Log("Many materials: %u cubes with a texture each", static_cast<unsigned>(textures.size()));
 }
 
 void Game::UnloadData() {
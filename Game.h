@@ -27,6 +27,27 @@ public:
 
 	class Renderer* GetRenderer() const { return mRenderer; }
 
+	// Bake the potentially visible sets of the level loaded by Initialize
+	bool BakePvs();
+	// Render device created by Initialize (OpenGL by default, null for headless runs)
+	void SetRenderBackend(RenderBackend backend) { mRenderBackend = backend; }
+	// Stop after the given number of frames (0: run until the player quits). A limited run doesn't wait for
+	// the frame time and updates with a fixed time step, so it is repeatable and can be used as a benchmark
+	void SetFrameLimit(unsigned int frames) { mFrameLimit = frames; }
+	// Write the render stats of every frame to the file (CSV, or JSON if it ends with ".json")
+	void SetStatsFile(const std::string& fileName) { mStatsFile = fileName; }
+	// Device memory of the streamed texture levels, in bytes (0: the renderer default)
+	void SetTextureBudget(size_t bytes) { mTextureBudget = bytes; }
+	// Pack the textures of the level in texture arrays once it is loaded (see Renderer::BuildTextureArrays)
+	void SetTextureArrays(bool enabled) { mTextureArrays = enabled; }
+	// Add a grid of cubes that each have their own texture (see LoadManyMaterials), to measure the texture binds
+	void SetManyMaterials(bool enabled) { mManyMaterials = enabled; }
+	// Start with the depth pre-pass of the renderer (F2 toggles it while running, see Renderer::SetDepthPrepass)
+	void SetDepthPrepass(bool enabled) { mDepthPrepass = enabled; }
+	// Adjust the resolution of the 3D scene to the GPU time of the frames (on by default, F3 toggles it while running,
+	// see Renderer::SetDynamicResolution)
+	void SetDynamicResolution(bool enabled) { mDynamicResolution = enabled; }
+
 private:
 	// Helper function for the game loop. Main Game steps for each frame: Process Inputs, update the game world, generate any output
 	void ProcessInput();
@@ -34,6 +55,8 @@ private:
 	void GenerateOutput();
 	// Load game stuff
 	void LoadData();
+	// Grid of cubes, each drawn with its own generated texture of a plain color. Half of the textures have each of two sizes
+	void LoadManyMaterials();
 	// Delete all game's stuff
 	void UnloadData();
 	
@@ -53,4 +76,20 @@ private:
 	class Renderer* mRenderer;
 	// Camera actor
 	class CameraActor* mCameraActor;
+	// Backend of the render device
+	RenderBackend mRenderBackend;
+	// Frames to run (0: no limit) and frames run so far
+	unsigned int mFrameLimit;
+	unsigned int mFrameCount;
+	// File of the render stats (empty: no capture)
+	std::string mStatsFile;
+	// Texture streaming budget (0: default)
+	size_t mTextureBudget;
+	// Build the texture arrays after LoadData
+	bool mTextureArrays;
+	// Load the many-material scene with the level
+	bool mManyMaterials;
+	// Depth pre-pass and dynamic resolution at startup
+	bool mDepthPrepass;
+	bool mDynamicResolution;
 };
@@ -0,0 +1,221 @@
+#include "GeometryArena.h"
+#include <algorithm>
+
+const float GeometryArena::DefragmentThreshold = 0.5f;
+GeometryArena* GeometryArena::sBoundArena = nullptr;
+
+GeometryArena::GeometryArena(const VertexLayout& layout, unsigned int vertexCapacity, unsigned int indexCapacity) :
+	mLayout(layout),
+	mVertexArray(0),
+	mVertexBuffer(0),
+	mIndexBuffer(0),
+	mFreeVertices(vertexCapacity),
+	mFreeIndices(indexCapacity)
+{
+	Reallocate(vertexCapacity, indexCapacity, false);
+}
+
+GeometryArena::~GeometryArena() {
+	for (GeometryAllocation* allocation : mAllocations) {
+		delete allocation;
+	}
+	if (sBoundArena == this) sBoundArena = nullptr;
+	RenderDevice* device = RenderDevice::Get();
+	device->DestroyVertexArray(mVertexArray);
+	device->DestroyBuffer(mVertexBuffer);
+	device->DestroyBuffer(mIndexBuffer);
+}
+
+GeometryAllocation* GeometryArena::Allocate(const void* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices) {
+	const unsigned int stride = mLayout.GetStride();
+	const unsigned int indexSize = numVerts <= 65536 ? sizeof(unsigned short) : sizeof(unsigned int);
+	// Index ranges start on 4 bytes boundaries
+	const unsigned int indexBytes = (numIndices * indexSize + 3) & ~3u;
+
+	unsigned int baseVertex = 0;
+	unsigned int indexOffset = 0;
+	if (!mFreeVertices.Allocate(numVerts, baseVertex) || !mFreeIndices.Allocate(indexBytes, indexOffset)) {
+		// Not enough contiguous space: grow the buffers if needed and compact them, so the free space is a single block at the end.
+		// Compacting rebuilds the free lists from the live allocations, so a vertex range taken above is released
+		unsigned int usedVertices = 0;
+		unsigned int usedIndices = 0;
+		for (const GeometryAllocation* allocation : mAllocations) {
+			usedVertices += allocation->mNumVerts;
+			usedIndices += (allocation->mNumIndices * allocation->mIndexSize + 3) & ~3u;
+		}
+		unsigned int vertexCapacity = std::max(mFreeVertices.GetCapacity(), usedVertices + numVerts);
+		unsigned int indexCapacity = std::max(mFreeIndices.GetCapacity(), usedIndices + indexBytes);
+		if (vertexCapacity > mFreeVertices.GetCapacity()) vertexCapacity = std::max(vertexCapacity, mFreeVertices.GetCapacity() * 2);
+		if (indexCapacity > mFreeIndices.GetCapacity()) indexCapacity = std::max(indexCapacity, mFreeIndices.GetCapacity() * 2);
+		Reallocate(vertexCapacity, indexCapacity, true);
+		mFreeVertices.Allocate(numVerts, baseVertex);
+		mFreeIndices.Allocate(indexBytes, indexOffset);
+	}
+
+	GeometryAllocation* allocation = new GeometryAllocation{ this, baseVertex, numVerts, indexOffset, numIndices, indexSize };
+	mAllocations.emplace_back(allocation);
+
+	RenderDevice* device = RenderDevice::Get();
+	device->UpdateBuffer(mVertexBuffer, baseVertex * stride, numVerts * stride, verts);
+	if (indexSize == sizeof(unsigned short)) {
+		std::vector<unsigned short> shortIndices(indices, indices + numIndices);
+		device->UpdateBuffer(mIndexBuffer, indexOffset, numIndices * indexSize, shortIndices.data());
+	}
+	else {
+		device->UpdateBuffer(mIndexBuffer, indexOffset, numIndices * indexSize, indices);
+	}
+	return allocation;
+}
+
+void GeometryArena::Free(GeometryAllocation* allocation) {
+	auto iter = std::find(mAllocations.begin(), mAllocations.end(), allocation);
+	if (iter == mAllocations.end()) return;
+	mAllocations.erase(iter);
+	mFreeVertices.Free(allocation->mBaseVertex, allocation->mNumVerts);
+	mFreeIndices.Free(allocation->mIndexOffset, (allocation->mNumIndices * allocation->mIndexSize + 3) & ~3u);
+	delete allocation;
+
+	// Compact the live ranges if the free space is split in small blocks
+	if (!mAllocations.empty() &&
+		(mFreeVertices.GetLargestBlock() < mFreeVertices.GetFreeSize() * DefragmentThreshold ||
+		 mFreeIndices.GetLargestBlock() < mFreeIndices.GetFreeSize() * DefragmentThreshold)) {
+		Defragment();
+	}
+}
+
+void GeometryArena::Defragment() {
+	Reallocate(mFreeVertices.GetCapacity(), mFreeIndices.GetCapacity(), true);
+}
+
+void GeometryArena::SetActive() {
+	if (sBoundArena != this) {
+		RenderDevice::Get()->BindVertexArray(mVertexArray);
+		sBoundArena = this;
+	}
+}
+
+void GeometryArena::Draw(const GeometryAllocation& allocation, unsigned int firstIndex, unsigned int count) {
+	SetActive();
+	RenderDevice::Get()->DrawIndexed(count, allocation.mIndexSize, allocation.mIndexOffset + firstIndex * allocation.mIndexSize,
+		static_cast<int>(allocation.mBaseVertex));
+}
+
+unsigned int GeometryArena::GetUsedBytes() const {
+	return (mFreeVertices.GetCapacity() - mFreeVertices.GetFreeSize()) * mLayout.GetStride() +
+		mFreeIndices.GetCapacity() - mFreeIndices.GetFreeSize();
+}
+
+unsigned int GeometryArena::GetCapacityBytes() const {
+	return mFreeVertices.GetCapacity() * mLayout.GetStride() + mFreeIndices.GetCapacity();
+}
+
+void GeometryArena::Reallocate(unsigned int vertexCapacity, unsigned int indexCapacity, bool compact) {
+	const unsigned int stride = mLayout.GetStride();
+	RenderDevice* device = RenderDevice::Get();
+	BufferHandle vertexBuffer = device->CreateBuffer(EVertexBuffer, vertexCapacity * stride, nullptr, EStaticBuffer);
+	BufferHandle indexBuffer = device->CreateBuffer(EIndexBuffer, indexCapacity, nullptr, EStaticBuffer);
+
+	// Copy the live ranges on the GPU. Compacting keeps the order of the ranges inside the buffers
+	unsigned int nextVertex = 0;
+	unsigned int nextIndex = 0;
+	if (mVertexBuffer != 0) {
+		std::vector<GeometryAllocation*> byVertex(mAllocations);
+		std::sort(byVertex.begin(), byVertex.end(), [](const GeometryAllocation* a, const GeometryAllocation* b) { return a->mBaseVertex < b->mBaseVertex; });
+		for (GeometryAllocation* allocation : byVertex) {
+			unsigned int base = compact ? nextVertex : allocation->mBaseVertex;
+			device->CopyBuffer(mVertexBuffer, allocation->mBaseVertex * stride, vertexBuffer, base * stride, allocation->mNumVerts * stride);
+			allocation->mBaseVertex = base;
+			nextVertex = base + allocation->mNumVerts;
+		}
+
+		std::vector<GeometryAllocation*> byIndex(mAllocations);
+		std::sort(byIndex.begin(), byIndex.end(), [](const GeometryAllocation* a, const GeometryAllocation* b) { return a->mIndexOffset < b->mIndexOffset; });
+		for (GeometryAllocation* allocation : byIndex) {
+			unsigned int offset = compact ? nextIndex : allocation->mIndexOffset;
+			unsigned int bytes = (allocation->mNumIndices * allocation->mIndexSize + 3) & ~3u;
+			device->CopyBuffer(mIndexBuffer, allocation->mIndexOffset, indexBuffer, offset, bytes);
+			allocation->mIndexOffset = offset;
+			nextIndex = offset + bytes;
+		}
+	}
+
+	if (compact) {
+		mFreeVertices = FreeList(vertexCapacity);
+		mFreeVertices.Reset(nextVertex);
+		mFreeIndices = FreeList(indexCapacity);
+		mFreeIndices.Reset(nextIndex);
+	}
+	else {
+		mFreeVertices.Grow(vertexCapacity);
+		mFreeIndices.Grow(indexCapacity);
+	}
+
+	// Replace the VAO by one reading the new buffers. It is left bound
+	if (mVertexArray != 0) device->DestroyVertexArray(mVertexArray);
+	mVertexArray = device->CreateVertexArray(mLayout, vertexBuffer, indexBuffer);
+	sBoundArena = this;
+
+	if (mVertexBuffer != 0) {
+		device->DestroyBuffer(mVertexBuffer);
+		device->DestroyBuffer(mIndexBuffer);
+	}
+	mVertexBuffer = vertexBuffer;
+	mIndexBuffer = indexBuffer;
+}
+
+GeometryArena::FreeList::FreeList(unsigned int capacity) :
+	mCapacity(capacity)
+{
+	if (capacity > 0) mBlocks.emplace_back(Block{ 0, capacity });
+}
+
+bool GeometryArena::FreeList::Allocate(unsigned int size, unsigned int& outOffset) {
+	for (auto iter = mBlocks.begin(); iter != mBlocks.end(); ++iter) {
+		if (iter->mSize >= size) {
+			outOffset = iter->mOffset;
+			iter->mOffset += size;
+			iter->mSize -= size;
+			if (iter->mSize == 0) mBlocks.erase(iter);
+			return true;
+		}
+	}
+	return false;
+}
+
+void GeometryArena::FreeList::Free(unsigned int offset, unsigned int size) {
+	if (size == 0) return;
+	auto next = std::lower_bound(mBlocks.begin(), mBlocks.end(), offset, [](const Block& block, unsigned int value) { return block.mOffset < value; });
+	next = mBlocks.insert(next, Block{ offset, size });
+	// Merge with the following block, then with the previous one
+	if (next + 1 != mBlocks.end() && next->mOffset + next->mSize == (next + 1)->mOffset) {
+		next->mSize += (next + 1)->mSize;
+		mBlocks.erase(next + 1);
+	}
+	if (next != mBlocks.begin() && (next - 1)->mOffset + (next - 1)->mSize == next->mOffset) {
+		(next - 1)->mSize += next->mSize;
+		mBlocks.erase(next);
+	}
+}
+
+void GeometryArena::FreeList::Grow(unsigned int newCapacity) {
+	if (newCapacity <= mCapacity) return;
+	Free(mCapacity, newCapacity - mCapacity);
+	mCapacity = newCapacity;
+}
+
+void GeometryArena::FreeList::Reset(unsigned int used) {
+	mBlocks.clear();
+	if (used < mCapacity) mBlocks.emplace_back(Block{ used, mCapacity - used });
+}
+
+unsigned int GeometryArena::FreeList::GetFreeSize() const {
+	unsigned int size = 0;
+	for (const Block& block : mBlocks) size += block.mSize;
+	return size;
+}
+
+unsigned int GeometryArena::FreeList::GetLargestBlock() const {
+	unsigned int largest = 0;
+	for (const Block& block : mBlocks) largest = std::max(largest, block.mSize);
+	return largest;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+#include "VertexLayout.h"
+#include "RenderDevice.h"
+
+// Range of a geometry arena holding the vertices and indices of a mesh.
+// Owned by the arena: the offsets change when the arena grows or is defragmented
+struct GeometryAllocation {
+	// Arena that owns the range
+	class GeometryArena* mArena;
+	// First vertex of the mesh inside the vertex buffer, added to every index by the draw call
+	unsigned int mBaseVertex;
+	unsigned int mNumVerts;
+	// Offset in bytes of the first index inside the index buffer
+	unsigned int mIndexOffset;
+	unsigned int mNumIndices;
+	// Indices are relative to mBaseVertex, so they are 16 bit (size 2) if the mesh has at most 65536 vertices
+	unsigned int mIndexSize;
+};
+
+// Large vertex and index buffers shared by all the meshes with the same vertex layout, drawn from a single VAO.
+// Meshes get a range of each buffer from a free list allocator and draw with a base vertex.
+// When a mesh is freed and the free space is too fragmented, the live ranges are compacted
+class GeometryArena {
+public:
+	GeometryArena(const VertexLayout& layout, unsigned int vertexCapacity, unsigned int indexCapacity);
+	~GeometryArena();
+
+	// Copy the mesh into the arena (the buffers grow if needed). Indices are relative to the first vertex of the mesh
+	GeometryAllocation* Allocate(const void* verts, unsigned int numVerts, const unsigned int* indices, unsigned int numIndices);
+	// Release the range of a mesh. The allocation is deleted
+	void Free(GeometryAllocation* allocation);
+	// Move all the live ranges to the start of the buffers, leaving a single free block
+	void Defragment();
+
+	// Bind the VAO of the arena, unless it is already bound
+	void SetActive();
+	// Draw count indices of the allocation starting from firstIndex
+	void Draw(const GeometryAllocation& allocation, unsigned int firstIndex, unsigned int count);
+	// Forget the bound arena. Call it after another VAO was bound
+	static void InvalidateBinding() { sBoundArena = nullptr; }
+
+	const VertexLayout& GetLayout() const { return mLayout; }
+	// Used/total bytes of the vertex and index buffers
+	unsigned int GetUsedBytes() const;
+	unsigned int GetCapacityBytes() const;
+
+	// Defragment when the largest free block is smaller than this fraction of the free space
+	static const float DefragmentThreshold;
+
+private:
+	// First fit allocator of the ranges of a buffer. Free blocks are sorted by offset and merged with their neighbours
+	class FreeList {
+	public:
+		explicit FreeList(unsigned int capacity);
+		// Return false if no block is large enough
+		bool Allocate(unsigned int size, unsigned int& outOffset);
+		void Free(unsigned int offset, unsigned int size);
+		// Add space at the end of the range
+		void Grow(unsigned int newCapacity);
+		// Everything free except the first used bytes
+		void Reset(unsigned int used);
+
+		unsigned int GetCapacity() const { return mCapacity; }
+		unsigned int GetFreeSize() const;
+		unsigned int GetLargestBlock() const;
+
+	private:
+		struct Block {
+			unsigned int mOffset;
+			unsigned int mSize;
+		};
+		std::vector<Block> mBlocks;
+		unsigned int mCapacity;
+	};
+
+	// support method. Create the buffers with the given capacity and copy the live ranges into them.
+	// If compact is true the ranges are packed at the start of the buffers, otherwise they keep their offsets
+	void Reallocate(unsigned int vertexCapacity, unsigned int indexCapacity, bool compact);
+
+	// Layout of the vertices
+	VertexLayout mLayout;
+	// Render device handles of the vertex array object and of the buffers
+	VertexArrayHandle mVertexArray;
+	BufferHandle mVertexBuffer;
+	BufferHandle mIndexBuffer;
+	// Free ranges of the vertex buffer (in vertices) and of the index buffer (in bytes)
+	FreeList mFreeVertices;
+	FreeList mFreeIndices;
+	// Live allocations
+	std::vector<GeometryAllocation*> mAllocations;
+
+	// Arena whose VAO is bound
+	static GeometryArena* sBoundArena;
+};
@@ -0,0 +1,83 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer() :
+	mQueries{},
+	mIssued{},
+	mFrame(-1),
+	mSlot(0),
+	mActivePass(-1),
+	mPassTimes{},
+	mMeasuredFrame(-1),
+	mDroppedFrames(0)
+{
+	for (unsigned int i = 0; i < RingSize; i++) mSlotFrames[i] = -1;
+}
+
+GpuTimer::~GpuTimer() {}
+
+void GpuTimer::Create() {
+	RenderDevice* device = RenderDevice::Get();
+	for (unsigned int slot = 0; slot < RingSize; slot++) {
+		for (unsigned int pass = 0; pass < ENumGpuPasses; pass++) {
+			mQueries[slot][pass] = device->CreateTimerQuery();
+		}
+	}
+}
+
+void GpuTimer::Destroy() {
+	RenderDevice* device = RenderDevice::Get();
+	EndPass();
+	for (unsigned int slot = 0; slot < RingSize; slot++) {
+		for (unsigned int pass = 0; pass < ENumGpuPasses; pass++) {
+			if (mQueries[slot][pass]) device->DestroyTimerQuery(mQueries[slot][pass]);
+			mQueries[slot][pass] = 0;
+		}
+	}
+}
+
+void GpuTimer::BeginFrame(int64_t frame) {
+	EndPass();
+	mFrame++;
+	mSlot = static_cast<unsigned int>(mFrame % RingSize);
+	if (mSlotFrames[mSlot] >= 0) {
+		// Read the frame that used the slot. If a query is not ready, the whole frame is dropped
+		RenderDevice* device = RenderDevice::Get();
+		float times[ENumGpuPasses] = {};
+		bool ready = true;
+		for (unsigned int pass = 0; pass < ENumGpuPasses && ready; pass++) {
+			if (!mIssued[mSlot][pass]) continue;
+			uint64_t nanoseconds = 0;
+			ready = device->GetTimerQueryResult(mQueries[mSlot][pass], nanoseconds);
+			times[pass] = nanoseconds / 1000000.f;
+		}
+		if (ready) {
+			for (unsigned int pass = 0; pass < ENumGpuPasses; pass++) mPassTimes[pass] = times[pass];
+			mMeasuredFrame = mSlotFrames[mSlot];
+		}
+		else {
+			mDroppedFrames++;
+		}
+	}
+	mSlotFrames[mSlot] = frame;
+	for (unsigned int pass = 0; pass < ENumGpuPasses; pass++) mIssued[mSlot][pass] = false;
+}
+
+void GpuTimer::BeginPass(GpuPass pass) {
+	if (mFrame < 0 || !mQueries[mSlot][pass]) return;
+	EndPass();
+	RenderDevice::Get()->BeginTimerQuery(mQueries[mSlot][pass]);
+	mIssued[mSlot][pass] = true;
+	mActivePass = pass;
+}
+
+void GpuTimer::EndPass() {
+	if (mActivePass < 0) return;
+	RenderDevice::Get()->EndTimerQuery();
+	mActivePass = -1;
+}
+
+float GpuTimer::GetTotalTime() const {
+	float total = 0.f;
+	for (unsigned int pass = 0; pass < ENumGpuPasses; pass++) total += mPassTimes[pass];
+	return total;
+}
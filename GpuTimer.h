@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include "RenderDevice.h"
+
+// Passes of a frame measured on the GPU. They run one after the other (timer queries can't be nested)
+enum GpuPass {
+	// Frame constants and light lists uploads
+	EUploadGpuPass,
+	// Depth-only pre-pass of the meshes (0 when disabled)
+	EDepthGpuPass,
+	// Meshes and static batches
+	EOpaqueGpuPass,
+	// Scene stretched to the window (dynamic resolution) and sprites
+	ESpriteGpuPass,
+	ENumGpuPasses
+};
+
+// GPU time of each pass, measured with timer queries. The queries of a frame are read when their slot of the ring
+// comes back, RingSize frames later: by then the GPU is done with them and reading the result never stalls.
+// A frame whose results are still not available is dropped. Used by the thread that holds the device context
+class GpuTimer {
+public:
+	// Frames between the queries of a frame and their read back
+	static const unsigned int RingSize = 4;
+
+	GpuTimer();
+	~GpuTimer();
+
+	// Create/destroy the queries
+	void Create();
+	void Destroy();
+
+	// Start a new frame, tagged with the caller's frame index: read back the frame that used the slot of the ring
+	void BeginFrame(int64_t frame);
+	// Measure the commands until the next BeginPass or EndPass
+	void BeginPass(GpuPass pass);
+	void EndPass();
+
+	// Time of the pass (ms) in the last frame read back, 0 if the pass didn't run
+	float GetPassTime(GpuPass pass) const { return mPassTimes[pass]; }
+	float GetTotalTime() const;
+	// Index (given to BeginFrame) of the frame the times belong to, -1 before the first read back
+	int64_t GetMeasuredFrame() const { return mMeasuredFrame; }
+	// Frames dropped because their queries were not ready
+	unsigned int GetDroppedFrames() const { return mDroppedFrames; }
+
+private:
+	// Queries of each frame of the ring and which ones ran
+	QueryHandle mQueries[RingSize][ENumGpuPasses];
+	bool mIssued[RingSize][ENumGpuPasses];
+	// Index of the frame that used each slot (-1: none)
+	int64_t mSlotFrames[RingSize];
+	// Frames started and slot of the current one
+	int64_t mFrame;
+	unsigned int mSlot;
+	// Running pass (-1: none)
+	int mActivePass;
+	// Last read back times
+	float mPassTimes[ENumGpuPasses];
+	int64_t mMeasuredFrame;
+	unsigned int mDroppedFrames;
+};
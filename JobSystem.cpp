@@ -0,0 +1,104 @@
+#include "JobSystem.h"
+#include <atomic>
+#include <algorithm>
+
+void JobSystem::Init(unsigned int numWorkers) {
+	if (numWorkers == 0) {
+		// hardware_concurrency may return 0 if the number of cores is unknown
+		unsigned int cores = std::thread::hardware_concurrency();
+		numWorkers = cores > 1 ? cores - 1 : 1;
+	}
+	sRunning = true;
+	for (unsigned int i = 0; i < numWorkers; i++) {
+		sWorkers.emplace_back(&JobSystem::WorkerLoop);
+	}
+}
+
+void JobSystem::Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(sMutex);
+		sRunning = false;
+	}
+	sCondition.notify_all();
+	for (auto& worker : sWorkers) {
+		worker.join();
+	}
+	sWorkers.clear();
+}
+
+void JobSystem::Submit(std::function<void()> job) {
+	// Without workers (not initialized) run the job immediately
+	if (sWorkers.empty()) {
+		job();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(sMutex);
+		sJobs.emplace_back(std::move(job));
+	}
+	sCondition.notify_one();
+}
+
+void JobSystem::ParallelFor(unsigned int count, unsigned int minBatch, const std::function<void(unsigned int, unsigned int)>& func) {
+	if (count == 0) return;
+	minBatch = std::max(minBatch, 1u);
+	// One batch per thread, unless batches would become smaller than minBatch
+	unsigned int numBatches = std::min(GetNumThreads(), (count + minBatch - 1) / minBatch);
+	if (numBatches <= 1) {
+		func(0, count);
+		return;
+	}
+
+	unsigned int batchSize = (count + numBatches - 1) / numBatches;
+	std::atomic<unsigned int> remaining(numBatches);
+	for (unsigned int batch = 1; batch < numBatches; batch++) {
+		unsigned int begin = batch * batchSize;
+		unsigned int end = std::min(count, begin + batchSize);
+		Submit([&func, &remaining, begin, end]() {
+			if (begin < end) func(begin, end);
+			remaining.fetch_sub(1, std::memory_order_release);
+		});
+	}
+
+	// The calling thread takes the first batch
+	func(0, std::min(count, batchSize));
+	remaining.fetch_sub(1, std::memory_order_release);
+
+	// Help with queued jobs (they may belong to this loop) until every batch is done
+	while (remaining.load(std::memory_order_acquire) > 0) {
+		if (!RunPendingJob()) std::this_thread::yield();
+	}
+}
+
+void JobSystem::WorkerLoop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(sMutex);
+			sCondition.wait(lock, []() { return !sRunning || !sJobs.empty(); });
+			// On shutdown, finish the queued jobs before leaving
+			if (sJobs.empty()) return;
+			job = std::move(sJobs.front());
+			sJobs.pop_front();
+		}
+		job();
+	}
+}
+
+bool JobSystem::RunPendingJob() {
+	std::function<void()> job;
+	{
+		std::lock_guard<std::mutex> lock(sMutex);
+		if (sJobs.empty()) return false;
+		job = std::move(sJobs.front());
+		sJobs.pop_front();
+	}
+	job();
+	return true;
+}
+
+std::vector<std::thread> JobSystem::sWorkers;
+std::deque<std::function<void()>> JobSystem::sJobs;
+std::mutex JobSystem::sMutex;
+std::condition_variable JobSystem::sCondition;
+bool JobSystem::sRunning = false;
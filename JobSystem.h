@@ -0,0 +1,43 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Pool of worker threads shared by the engine systems that split CPU work across cores
+class JobSystem {
+public:
+	// Start the worker threads. With 0 workers, use one thread per core minus the calling thread
+	static void Init(unsigned int numWorkers = 0);
+	// Wait for the queued jobs and join the worker threads
+	static void Shutdown();
+
+	// Number of threads that execute jobs (workers + calling thread)
+	static unsigned int GetNumThreads() { return static_cast<unsigned int>(sWorkers.size()) + 1; }
+
+	// Queue a job to be executed by any worker thread
+	static void Submit(std::function<void()> job);
+
+	// Split the range [0, count) in batches of at least minBatch elements and call func(begin, end) for each batch.
+	// The calling thread executes batches too and returns when the whole range has been processed
+	static void ParallelFor(unsigned int count, unsigned int minBatch, const std::function<void(unsigned int, unsigned int)>& func);
+
+private:
+	// Main loop of the worker threads: pop and execute jobs until shutdown
+	static void WorkerLoop();
+	// Pop and execute one job, if any. Return false if the queue was empty
+	static bool RunPendingJob();
+
+	// Worker threads
+	static std::vector<std::thread> sWorkers;
+	// Queue of jobs waiting for a thread
+	static std::deque<std::function<void()>> sJobs;
+	// Protect the job queue
+	static std::mutex sMutex;
+	// Wake up the workers when a job is queued or on shutdown
+	static std::condition_variable sCondition;
+	// Workers keep running until Shutdown is called
+	static bool sRunning;
+};
@@ -0,0 +1,114 @@
+#include "KtxFile.h"
+#include "BlockCompression.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <SDL_log.h>
+
+const unsigned char KtxFile::Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// GL enums of the header (the file is read without a GL context)
+static const uint32_t GlUnsignedByte = 0x1401;
+static const uint32_t GlRgba = 0x1908;
+static const uint32_t GlRgba8 = 0x8058;
+static const uint32_t GlCompressedRgbaS3tcDxt1 = 0x83F1;
+static const uint32_t GlCompressedRgbaS3tcDxt5 = 0x83F3;
+
+bool KtxFile::Read(const std::string& fileName, KtxImage& outImage, int maxSize) {
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open()) {
+		SDL_Log("File not found: Texture %s", fileName.c_str());
+		return false;
+	}
+	unsigned char identifier[sizeof(Identifier)];
+	Header header;
+	if (!file.read(reinterpret_cast<char*>(identifier), sizeof(identifier)) ||
+		memcmp(identifier, Identifier, sizeof(Identifier)) != 0 ||
+		!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+		SDL_Log("Texture %s is not a KTX file", fileName.c_str());
+		return false;
+	}
+	if (header.mEndianness != Endianness || header.mPixelDepth > 1 || header.mNumberOfArrayElements > 0 ||
+		header.mNumberOfFaces != 1 || header.mPixelWidth == 0 || header.mPixelHeight == 0) {
+		SDL_Log("Texture %s: only 2D textures in the byte order of the CPU are supported", fileName.c_str());
+		return false;
+	}
+	if (header.mGlInternalFormat == GlCompressedRgbaS3tcDxt1) outImage.mFormat = ETextureBC1;
+	else if (header.mGlInternalFormat == GlCompressedRgbaS3tcDxt5) outImage.mFormat = ETextureBC3;
+	else if (header.mGlInternalFormat == GlRgba8 && header.mGlType == GlUnsignedByte) outImage.mFormat = ETextureRGBA8;
+	else {
+		SDL_Log("Texture %s: unsupported format 0x%x", fileName.c_str(), header.mGlInternalFormat);
+		return false;
+	}
+	outImage.mWidth = static_cast<int>(header.mPixelWidth);
+	outImage.mHeight = static_cast<int>(header.mPixelHeight);
+	file.seekg(header.mBytesOfKeyValueData, std::ios::cur);
+
+	// 0 levels asks for the mip chain to be generated at load: it is cooked, so only the first level is used
+	const uint32_t numLevels = std::max(header.mNumberOfMipmapLevels, 1u);
+	outImage.mFirstLevel = 0;
+	outImage.mLevels.clear();
+	int width = outImage.mWidth;
+	int height = outImage.mHeight;
+	for (uint32_t level = 0; level < numLevels; level++) {
+		uint32_t imageSize = 0;
+		if (!file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize)) ||
+			imageSize != BlockCompression::GetImageSize(outImage.mFormat, width, height)) {
+			SDL_Log("Texture %s: level %u is truncated", fileName.c_str(), level);
+			return false;
+		}
+		// Levels are padded to 4 bytes
+		const uint32_t padding = 3 - ((imageSize + 3) % 4);
+		// The last level is always read
+		if (maxSize > 0 && (width > maxSize || height > maxSize) && level + 1 < numLevels) {
+			file.seekg(imageSize + padding, std::ios::cur);
+			outImage.mFirstLevel = level + 1;
+		}
+		else {
+			outImage.mLevels.emplace_back(imageSize);
+			if (!file.read(reinterpret_cast<char*>(outImage.mLevels.back().data()), imageSize)) {
+				SDL_Log("Texture %s: level %u is truncated", fileName.c_str(), level);
+				return false;
+			}
+			file.seekg(padding, std::ios::cur);
+		}
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return true;
+}
+
+bool KtxFile::Write(const std::string& fileName, const KtxImage& image) {
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		SDL_Log("Failed to write texture %s", fileName.c_str());
+		return false;
+	}
+	Header header = {};
+	header.mEndianness = Endianness;
+	if (image.mFormat == ETextureRGBA8) {
+		header.mGlType = GlUnsignedByte;
+		header.mGlFormat = GlRgba;
+		header.mGlInternalFormat = GlRgba8;
+	}
+	else {
+		// Compressed formats have no type and format
+		header.mGlInternalFormat = image.mFormat == ETextureBC1 ? GlCompressedRgbaS3tcDxt1 : GlCompressedRgbaS3tcDxt5;
+	}
+	header.mGlTypeSize = 1;
+	header.mGlBaseInternalFormat = GlRgba;
+	header.mPixelWidth = static_cast<uint32_t>(image.mWidth);
+	header.mPixelHeight = static_cast<uint32_t>(image.mHeight);
+	header.mNumberOfFaces = 1;
+	header.mNumberOfMipmapLevels = static_cast<uint32_t>(image.mLevels.size());
+	file.write(reinterpret_cast<const char*>(Identifier), sizeof(Identifier));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	const char padding[3] = { 0, 0, 0 };
+	for (const std::vector<unsigned char>& data : image.mLevels) {
+		uint32_t imageSize = static_cast<uint32_t>(data.size());
+		file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		file.write(padding, 3 - ((imageSize + 3) % 4));
+	}
+	return file.good();
+}
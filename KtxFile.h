@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "RenderDevice.h"
+
+// Texture with its whole mip chain, as stored in a .ktx file
+struct KtxImage {
+	TextureFormat mFormat;
+	// Size of the full size level (level 0)
+	int mWidth;
+	int mHeight;
+	// Level of mLevels[0]: 0 unless the big levels were skipped
+	unsigned int mFirstLevel;
+	// Data of each level, from mFirstLevel down to 1x1
+	std::vector<std::vector<unsigned char>> mLevels;
+};
+
+// Reader/writer of KTX 1.1 files (2D textures of a single face, no array, no key/value data) in the
+// formats of TextureFormat. The levels are ready for the GPU: loading a file does no decoding
+class KtxFile {
+public:
+	// Read the levels of the file. With maxSize, the levels wider or taller than maxSize are skipped (not read)
+	static bool Read(const std::string& fileName, KtxImage& outImage, int maxSize = 0);
+	// Write the levels of the image, which must start from level 0
+	static bool Write(const std::string& fileName, const KtxImage& image);
+
+	// KTX header, after the 12 bytes of the file identifier
+	struct Header {
+		uint32_t mEndianness;
+		uint32_t mGlType;
+		uint32_t mGlTypeSize;
+		uint32_t mGlFormat;
+		uint32_t mGlInternalFormat;
+		uint32_t mGlBaseInternalFormat;
+		uint32_t mPixelWidth;
+		uint32_t mPixelHeight;
+		uint32_t mPixelDepth;
+		uint32_t mNumberOfArrayElements;
+		uint32_t mNumberOfFaces;
+		uint32_t mNumberOfMipmapLevels;
+		uint32_t mBytesOfKeyValueData;
+	};
+	static const unsigned char Identifier[12];
+	static const uint32_t Endianness = 0x04030201;
+};
@@ -0,0 +1,208 @@
+#include "LightClusters.h"
+#include "Renderer.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <SDL.h>
+
+// Use SSE to test 4 clusters at once when the target supports it (always on x64)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLUSTERS_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+static_assert(LightClusters::TilesX % 4 == 0, "Rows of clusters are tested 4 at a time");
+static_assert(LightClusters::TilesX <= 32, "A row of clusters must fit in a 32 bit mask");
+
+LightClusters::LightClusters() :
+	mXScale(1.f),
+	mYScale(1.f),
+	mNear(1.f),
+	mFar(2.f),
+	mSliceScale(0.f),
+	mSliceBias(0.f),
+	mMinX(NumClusters), mMaxX(NumClusters),
+	mMinY(NumClusters), mMaxY(NumClusters),
+	mMinZ(NumClusters), mMaxZ(NumClusters),
+	mSliceHits(Slices),
+	mSliceIndices(Slices),
+	mClusterGrid(NumClusters * 2, 0)
+{}
+
+void LightClusters::SetProjection(float xScale, float yScale, float nearPlane, float farPlane) {
+	mXScale = xScale;
+	mYScale = yScale;
+	mNear = nearPlane;
+	mFar = farPlane;
+
+	// Exponential slices: slice k covers [near * (far/near)^(k/S), near * (far/near)^((k+1)/S)]
+	// so that clusters keep roughly the same proportions at every depth
+	float logRatio = logf(mFar / mNear);
+	mSliceScale = static_cast<float>(Slices) / logRatio;
+	mSliceBias = -static_cast<float>(Slices) * logf(mNear) / logRatio;
+
+	for (unsigned int slice = 0; slice < Slices; slice++) {
+		float z0 = mNear * powf(mFar / mNear, static_cast<float>(slice) / Slices);
+		float z1 = mNear * powf(mFar / mNear, static_cast<float>(slice + 1) / Slices);
+		for (unsigned int y = 0; y < TilesY; y++) {
+			// Tile bounds in normalized device coordinates
+			float ny0 = -1.f + 2.f * y / TilesY;
+			float ny1 = -1.f + 2.f * (y + 1) / TilesY;
+			for (unsigned int x = 0; x < TilesX; x++) {
+				float nx0 = -1.f + 2.f * x / TilesX;
+				float nx1 = -1.f + 2.f * (x + 1) / TilesX;
+				// A point at NDC n and depth z is at n * z / scale in view space.
+				// The cluster is a piece of frustum: its AABB is given by the corners at the two slice depths
+				unsigned int c = x + y * TilesX + slice * ClustersPerSlice;
+				mMinX[c] = Math::Min(nx0 * z0, nx0 * z1) / mXScale;
+				mMaxX[c] = Math::Max(nx1 * z0, nx1 * z1) / mXScale;
+				mMinY[c] = Math::Min(ny0 * z0, ny0 * z1) / mYScale;
+				mMaxY[c] = Math::Max(ny1 * z0, ny1 * z1) / mYScale;
+				mMinZ[c] = z0;
+				mMaxZ[c] = z1;
+			}
+		}
+	}
+}
+
+unsigned int LightClusters::GetSlice(float depth) const {
+	float slice = logf(Math::Max(depth, mNear)) * mSliceScale + mSliceBias;
+	return static_cast<unsigned int>(Math::Clamp(slice, 0.f, static_cast<float>(Slices - 1)));
+}
+
+void LightClusters::AssignLights(const std::vector<PointLight>& lights, const Matrix4& view) {
+	// Cull the lights against the frustum and find the range of clusters covered by each one
+	mCulledLights.clear();
+	size_t numLights = lights.size();
+	if (numLights > MaxLights) {
+		SDL_Log("Too many point lights (%u), only the first %u are used", static_cast<unsigned int>(numLights), MaxLights);
+		numLights = MaxLights;
+	}
+	for (size_t i = 0; i < numLights; i++) {
+		const PointLight& light = lights[i];
+		if (light.mRadius <= 0.f) continue;
+
+		Vector3 c = Vector3::Transform(light.mPosition, view);
+		float r = light.mRadius;
+		// Outside the depth range
+		if (c.z + r < mNear || c.z - r > mFar) continue;
+
+		CulledLight cl;
+		cl.mCenter = c;
+		cl.mRadius = r;
+		cl.mIndex = static_cast<uint16_t>(i);
+		cl.mMinSlice = GetSlice(c.z - r);
+		cl.mMaxSlice = GetSlice(c.z + r);
+
+		if (c.z - r <= mNear) {
+			// The sphere crosses the near plane: its projection is unbounded, use the whole screen
+			cl.mMinX = 0; cl.mMaxX = TilesX - 1;
+			cl.mMinY = 0; cl.mMaxY = TilesY - 1;
+		}
+		else {
+			// For a fixed x, x/z is monotonic in z, so the NDC bounds of the sphere's box are found at its corners
+			float zNear = c.z - r;
+			float zFar = c.z + r;
+			float nx0 = Math::Min((c.x - r) / zNear, (c.x - r) / zFar) * mXScale;
+			float nx1 = Math::Max((c.x + r) / zNear, (c.x + r) / zFar) * mXScale;
+			float ny0 = Math::Min((c.y - r) / zNear, (c.y - r) / zFar) * mYScale;
+			float ny1 = Math::Max((c.y + r) / zNear, (c.y + r) / zFar) * mYScale;
+			// Outside the screen
+			if (nx1 < -1.f || nx0 > 1.f || ny1 < -1.f || ny0 > 1.f) continue;
+			cl.mMinX = static_cast<unsigned int>(Math::Clamp((nx0 + 1.f) * 0.5f * TilesX, 0.f, TilesX - 1.f));
+			cl.mMaxX = static_cast<unsigned int>(Math::Clamp((nx1 + 1.f) * 0.5f * TilesX, 0.f, TilesX - 1.f));
+			cl.mMinY = static_cast<unsigned int>(Math::Clamp((ny0 + 1.f) * 0.5f * TilesY, 0.f, TilesY - 1.f));
+			cl.mMaxY = static_cast<unsigned int>(Math::Clamp((ny1 + 1.f) * 0.5f * TilesY, 0.f, TilesY - 1.f));
+		}
+		mCulledLights.emplace_back(cl);
+	}
+
+	// Every slice owns its clusters, so slices can be processed in parallel without locks
+	JobSystem::ParallelFor(Slices, 2, [this](unsigned int begin, unsigned int end) {
+		for (unsigned int slice = begin; slice < end; slice++) {
+			AssignSlice(slice);
+		}
+	});
+
+	// Concatenate the slice lists and turn the local offsets into offsets in the global index list
+	mLightIndices.clear();
+	for (unsigned int slice = 0; slice < Slices; slice++) {
+		uint32_t base = static_cast<uint32_t>(mLightIndices.size());
+		for (unsigned int c = slice * ClustersPerSlice; c < (slice + 1) * ClustersPerSlice; c++) {
+			mClusterGrid[c * 2] += base;
+		}
+		mLightIndices.insert(mLightIndices.end(), mSliceIndices[slice].begin(), mSliceIndices[slice].end());
+	}
+}
+
+void LightClusters::AssignSlice(unsigned int slice) {
+	std::vector<uint32_t>& hits = mSliceHits[slice];
+	hits.clear();
+
+	// Test each light against the clusters of its tile range in this slice
+	for (const CulledLight& light : mCulledLights) {
+		if (slice < light.mMinSlice || slice > light.mMaxSlice) continue;
+		for (unsigned int y = light.mMinY; y <= light.mMaxY; y++) {
+			unsigned int rowStart = y * TilesX + slice * ClustersPerSlice;
+			unsigned int mask = TestRow(rowStart, light.mMinX, light.mMaxX, light);
+			while (mask) {
+				// Index of the lowest set bit
+				unsigned int bit = 0;
+				while (!(mask & (1u << bit))) bit++;
+				mask &= mask - 1;
+				unsigned int local = y * TilesX + light.mMinX + bit;
+				hits.emplace_back((local << 16) | light.mIndex);
+			}
+		}
+	}
+
+	// Counting sort of the hits by cluster, so that the lights of each cluster are contiguous
+	uint32_t* grid = &mClusterGrid[slice * ClustersPerSlice * 2];
+	unsigned int counts[ClustersPerSlice] = {};
+	for (uint32_t hit : hits) counts[hit >> 16]++;
+	uint32_t offset = 0;
+	for (unsigned int c = 0; c < ClustersPerSlice; c++) {
+		grid[c * 2] = offset;
+		grid[c * 2 + 1] = counts[c];
+		offset += counts[c];
+		counts[c] = grid[c * 2];
+	}
+	std::vector<uint16_t>& indices = mSliceIndices[slice];
+	indices.resize(hits.size());
+	for (uint32_t hit : hits) {
+		indices[counts[hit >> 16]++] = static_cast<uint16_t>(hit & 0xFFFF);
+	}
+}
+
+unsigned int LightClusters::TestRow(unsigned int rowStart, unsigned int x0, unsigned int x1, const CulledLight& light) const {
+	const float r2 = light.mRadius * light.mRadius;
+	// Bit x is set if cluster x of the row is touched
+	unsigned int rowMask = 0;
+#ifdef CLUSTERS_USE_SSE
+	const __m128 cx = _mm_set1_ps(light.mCenter.x);
+	const __m128 cy = _mm_set1_ps(light.mCenter.y);
+	const __m128 cz = _mm_set1_ps(light.mCenter.z);
+	const __m128 radiusSq = _mm_set1_ps(r2);
+	const __m128 zero = _mm_setzero_ps();
+	for (unsigned int x = x0 & ~3u; x <= x1; x += 4) {
+		unsigned int c = rowStart + x;
+		// Distance from the sphere center to the box along each axis (0 if inside the slab)
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinX[c]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&mMaxX[c]))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinY[c]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&mMaxY[c]))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&mMinZ[c]), cz), _mm_sub_ps(cz, _mm_loadu_ps(&mMaxZ[c]))), zero);
+		__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		rowMask |= static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(distSq, radiusSq))) << x;
+	}
+#else
+	for (unsigned int x = x0; x <= x1; x++) {
+		unsigned int c = rowStart + x;
+		float dx = Math::Max(Math::Max(mMinX[c] - light.mCenter.x, light.mCenter.x - mMaxX[c]), 0.f);
+		float dy = Math::Max(Math::Max(mMinY[c] - light.mCenter.y, light.mCenter.y - mMaxY[c]), 0.f);
+		float dz = Math::Max(Math::Max(mMinZ[c] - light.mCenter.z, light.mCenter.z - mMaxZ[c]), 0.f);
+		if (dx * dx + dy * dy + dz * dz <= r2) rowMask |= 1u << x;
+	}
+#endif
+	// Keep only the requested range and move tile x0 to bit 0
+	unsigned int width = x1 - x0 + 1;
+	unsigned int rangeMask = width >= 32 ? ~0u : ((1u << width) - 1);
+	return (rowMask >> x0) & rangeMask;
+}
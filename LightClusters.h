@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Math.h"
+
+// Clustered forward lighting: the view frustum is split in a 3D grid of clusters (screen tiles x depth slices)
+// and every point light is assigned on the CPU to the clusters its sphere of influence touches.
+// The Phong shader finds the cluster of each fragment and only evaluates the lights listed there
+class LightClusters {
+public:
+	// Number of clusters along screen x, screen y and view depth
+	static const unsigned int TilesX = 16;
+	static const unsigned int TilesY = 9;
+	static const unsigned int Slices = 24;
+	static const unsigned int ClustersPerSlice = TilesX * TilesY;
+	static const unsigned int NumClusters = ClustersPerSlice * Slices;
+	// Light indices are stored in 16 bits in the index list
+	static const unsigned int MaxLights = 4096;
+
+	LightClusters();
+
+	// Compute the view space bounds of every cluster. Call it when the projection changes
+	// xScale/yScale are the first two diagonal elements of the projection matrix
+	void SetProjection(float xScale, float yScale, float nearPlane, float farPlane);
+	// Assign the lights (world space) to the clusters. The work is split by depth slice across the job system
+	void AssignLights(const std::vector<struct PointLight>& lights, const Matrix4& view);
+
+	// Two values per cluster: offset of the first light in the index list and number of lights
+	const std::vector<uint32_t>& GetClusterGrid() const { return mClusterGrid; }
+	// Light indices of all the clusters, one list after the other
+	const std::vector<uint16_t>& GetLightIndices() const { return mLightIndices; }
+	// The shader computes the slice of a fragment as log(viewDepth) * SliceScale + SliceBias
+	float GetSliceScale() const { return mSliceScale; }
+	float GetSliceBias() const { return mSliceBias; }
+	// Lights that touch at least one cluster in the last assignment
+	unsigned int GetNumVisibleLights() const { return static_cast<unsigned int>(mCulledLights.size()); }
+
+private:
+	// Light that survived frustum culling, with the range of clusters its bounds overlap
+	struct CulledLight {
+		// Sphere in view space
+		Vector3 mCenter;
+		float mRadius;
+		// Index of the light in the renderer array
+		uint16_t mIndex;
+		// Range of tiles and slices (inclusive)
+		unsigned int mMinX, mMaxX;
+		unsigned int mMinY, mMaxY;
+		unsigned int mMinSlice, mMaxSlice;
+	};
+
+	// Slice that contains the given view depth
+	unsigned int GetSlice(float depth) const;
+	// Test the lights against the clusters of one slice and build the slice light lists
+	void AssignSlice(unsigned int slice);
+	// Sphere vs AABB test for the clusters [x0, x1] of a row. Bit i of the result is set if tile x0 + i is touched
+	unsigned int TestRow(unsigned int rowStart, unsigned int x0, unsigned int x1, const CulledLight& light) const;
+
+	// Projection parameters
+	float mXScale, mYScale;
+	float mNear, mFar;
+	float mSliceScale, mSliceBias;
+
+	// Cluster bounds in view space. Structure of arrays, so that 4 consecutive clusters along x are tested at once
+	std::vector<float> mMinX, mMaxX;
+	std::vector<float> mMinY, mMaxY;
+	std::vector<float> mMinZ, mMaxZ;
+
+	// Lights visible in the current frame
+	std::vector<CulledLight> mCulledLights;
+	// Per slice (written by one job each): hits as (cluster in slice << 16 | light) and the sorted light lists
+	std::vector<std::vector<uint32_t>> mSliceHits;
+	std::vector<std::vector<uint16_t>> mSliceIndices;
+
+	// Output of the assignment
+	std::vector<uint32_t> mClusterGrid;
+	std::vector<uint16_t> mLightIndices;
+};
@@ -1,13 +1,79 @@
 #include "Game.h"
+#include "MeshCooker.h"
+#include "TextureCooker.h"
+#include "JobSystem.h"
+#include <cstring>
+#include <cstdlib>
 
 #define WIDTH 1280
 #define HEIGHT 720
 
 int main(int argc, char* argv[]) {
+	// Offline tools: "-cooklods <mesh.gpmesh> ..." generates the levels of detail of the given meshes
+	if (argc > 2 && strcmp(argv[1], "-cooklods") == 0) {
+		bool cooked = true;
+		for (int i = 2; i < argc; i++) {
+			cooked = MeshCooker::CookLods(argv[i]) && cooked;
+		}
+		return cooked ? 0 : 1;
+	}
+	// "-cooktextures <image> ..." writes the compressed mip chains of the given textures as .ktx files
+	if (argc > 2 && strcmp(argv[1], "-cooktextures") == 0) {
+		// The blocks are compressed on all the cores
+		JobSystem::Init();
+		bool cooked = true;
+		for (int i = 2; i < argc; i++) {
+			cooked = TextureCooker::Cook(argv[i]) && cooked;
+		}
+		JobSystem::Shutdown();
+		return cooked ? 0 : 1;
+	}
+	// "-bakepvs" loads the level and bakes its potentially visible sets
+	if (argc > 1 && strcmp(argv[1], "-bakepvs") == 0) {
+		Game game;
+		game.SetWindowWidthHeight(WIDTH, HEIGHT);
+		bool baked = game.Initialize() && game.BakePvs();
+		game.ShutDown();
+		return baked ? 0 : 1;
+	}
+
 	// Create a Game
 	Game game;
 	// Set width and height of the game window
 	game.SetWindowWidthHeight(WIDTH, HEIGHT);
+	// "-null" draws with the null render device (no window, no GPU), "-frames <n>" quits after n frames,
+	// "-stats <file>" writes the render stats of each frame to a .csv or .json file,
+	// "-texturebudget <MB>" sets the device memory of the streamed texture levels,
+	// "-texturearrays" packs the textures of the same size and format in texture arrays,
+	// "-manymaterials" adds cubes with a texture each (compare the texture binds of -stats with and without -texturearrays),
+	// "-depthprepass" starts with the depth pre-pass (F2 toggles it),
+	// "-fixedresolution" draws the scene at the window resolution instead of adjusting it to the GPU time (F3 toggles it)
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-null") == 0) {
+			game.SetRenderBackend(ENullBackend);
+		}
+		else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc) {
+			game.SetFrameLimit(static_cast<unsigned int>(atoi(argv[++i])));
+		}
+		else if (strcmp(argv[i], "-stats") == 0 && i + 1 < argc) {
+			game.SetStatsFile(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-texturebudget") == 0 && i + 1 < argc) {
+			game.SetTextureBudget(static_cast<size_t>(atoi(argv[++i])) << 20);
+		}
+		else if (strcmp(argv[i], "-texturearrays") == 0) {
+			game.SetTextureArrays(true);
+		}
+		else if (strcmp(argv[i], "-manymaterials") == 0) {
+			game.SetManyMaterials(true);
+		}
+		else if (strcmp(argv[i], "-depthprepass") == 0) {
+			game.SetDepthPrepass(true);
+		}
+		else if (strcmp(argv[i], "-fixedresolution") == 0) {
+			game.SetDynamicResolution(false);
+		}
+	}
 	// Initialize the Game
 	bool isGameInitialized = game.Initialize();
 	if (isGameInitialized) {
@@ -17,4 +83,4 @@ int main(int argc, char* argv[]) {
 	// if any error or Player quit, shutdown the game
 	game.ShutDown();
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,23 +1,82 @@
 #include "Mesh.h"
 #include "Texture.h"
-#include "VertexArray.h"
+#include "GeometryArena.h"
+#include "MeshOptimizer.h"
+#include "VertexLayout.h"
 #include <fstream>
 #include <sstream>
+#include <cstring>
 #include <rapidjson/document.h>
 #include <SDL_log.h>
 #include "Math.h"
 #include "Renderer.h"
 
 Mesh::Mesh() :
-	mVertexArray(nullptr),
+	mGeometry(nullptr),
 	mRadius(0.f),
-	mSpecPower(100.f)
+	mSpecPower(100.f),
+	mVertexSize(0),
+	mSkinned(false),
+	mPackedLayout(nullptr),
+	mSourceVertexBytes(0),
+	mLoaded(false)
 {}
 
-Mesh::~Mesh(){}
+Mesh::~Mesh(){
+	delete mPackedLayout;
+}
+
+// Append an array of triangles ([[a,b,c], ...]) to the index list. Return false if the array is malformed
+static bool LoadIndices(const rapidjson::Value& indJson, std::vector<unsigned int>& indices)
+{
+	if (!indJson.IsArray() || indJson.Size() < 1)
+	{
+		return false;
+	}
+	for (rapidjson::SizeType i = 0; i < indJson.Size(); i++)
+	{
+		const rapidjson::Value& ind = indJson[i];
+		if (!ind.IsArray() || ind.Size() != 3)
+		{
+			return false;
+		}
+
+		indices.emplace_back(ind[0].GetUint());
+		indices.emplace_back(ind[1].GetUint());
+		indices.emplace_back(ind[2].GetUint());
+	}
+	return true;
+}
 
 bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 {
+	if (!Read(fileName))
+	{
+		return false;
+	}
+	for (const std::string& texName : mTextureNames)
+	{
+		// Is this texture already loaded?
+		Texture* t = renderer->GetTexture(texName);
+		if (t == nullptr)
+		{
+			// Try loading the texture
+			t = renderer->GetTexture(texName);
+			if (t == nullptr)
+			{
+				// If it's still null, just use the default texture
+				t = renderer->GetTexture("Assets/Default.png");
+			}
+		}
+		mTextures.emplace_back(t);
+	}
+	mLoaded = Upload(renderer);
+	return mLoaded;
+}
+
+bool Mesh::Read(const std::string& fileName)
+{
+	mName = fileName;
 	std::ifstream file(fileName);
 	if (!file.is_open())
 	{
@@ -49,9 +108,15 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 
 	mShaderName = doc["shader"].GetString();
 
-	// Skip the vertex format/shader for now
-	// (This is changed in a later chapter's code)
-	size_t vertSize = 8;
+	// Vertex format written by the exporter: position, normal, [bone indices, bone weights,] UV
+	std::string vertFormat = doc.HasMember("vertexformat") ? doc["vertexformat"].GetString() : "PosNormTex";
+	bool skinned = vertFormat == "PosNormSkinTex";
+	if (!skinned && vertFormat != "PosNormTex")
+	{
+		SDL_Log("Mesh %s has unknown vertex format %s", fileName.c_str(), vertFormat.c_str());
+		return false;
+	}
+	unsigned int vertSize = skinned ? 16 : 8;
 
 	// Load textures
 	const rapidjson::Value& textures = doc["textures"];
@@ -63,22 +128,11 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 
 	mSpecPower = static_cast<float>(doc["specularPower"].GetDouble());
 
+	// Textures are loaded by the renderer, after the file is read
+	mTextureNames.clear();
 	for (rapidjson::SizeType i = 0; i < textures.Size(); i++)
 	{
-		// Is this texture already loaded?
-		std::string texName = textures[i].GetString();
-		Texture* t = renderer->GetTexture(texName);
-		if (t == nullptr)
-		{
-			// Try loading the texture
-			t = renderer->GetTexture(texName);
-			if (t == nullptr)
-			{
-				// If it's still null, just use the default texture
-				t = renderer->GetTexture("Assets/Default.png");
-			}
-		}
-		mTextures.emplace_back(t);
+		mTextureNames.emplace_back(textures[i].GetString());
 	}
 
 	// Load in the vertices
@@ -94,9 +148,8 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 	mRadius = 0.0f;
 	for (rapidjson::SizeType i = 0; i < vertsJson.Size(); i++)
 	{
-		// For now, just assume we have 8 elements
 		const rapidjson::Value& vert = vertsJson[i];
-		if (!vert.IsArray() || vert.Size() != 8)
+		if (!vert.IsArray() || vert.Size() != vertSize)
 		{
 			SDL_Log("Unexpected vertex format for %s", fileName.c_str());
 			return false;
@@ -125,29 +178,302 @@ bool Mesh::Load(const std::string& fileName, Renderer* renderer)
 
 	std::vector<unsigned int> indices;
 	indices.reserve(indJson.Size() * 3);
-	for (rapidjson::SizeType i = 0; i < indJson.Size(); i++)
+	if (!LoadIndices(indJson, indices))
 	{
-		const rapidjson::Value& ind = indJson[i];
-		if (!ind.IsArray() || ind.Size() != 3)
+		SDL_Log("Invalid indices for %s", fileName.c_str());
+		return false;
+	}
+	mLods.clear();
+	mLods.emplace_back(MeshLod{ 0, static_cast<unsigned>(indices.size()), 0.f, Math::Infinity });
+
+	// Load the optional levels of detail (generated offline by MeshCooker).
+	// They reference the same vertices, so all the index lists go in the same index buffer
+	if (doc.HasMember("lods"))
+	{
+		const rapidjson::Value& lodsJson = doc["lods"];
+		for (rapidjson::SizeType i = 0; lodsJson.IsArray() && i < lodsJson.Size(); i++)
 		{
-			SDL_Log("Invalid indices for %s", fileName.c_str());
-			return false;
+			const rapidjson::Value& lodJson = lodsJson[i];
+			MeshLod lod;
+			lod.mIndexOffset = static_cast<unsigned>(indices.size());
+			if (!lodJson.IsObject() || !lodJson.HasMember("indices") || !LoadIndices(lodJson["indices"], indices))
+			{
+				SDL_Log("Invalid level of detail %u for %s", i + 1, fileName.c_str());
+				return false;
+			}
+			lod.mIndexCount = static_cast<unsigned>(indices.size()) - lod.mIndexOffset;
+			lod.mError = lodJson.HasMember("error") ? static_cast<float>(lodJson["error"].GetDouble()) : 0.f;
+			// By default every level halves the screen size of the previous one
+			lod.mScreenSize = lodJson.HasMember("screenSize") ? static_cast<float>(lodJson["screenSize"].GetDouble()) : 0.4f / static_cast<float>(2 << i);
+			mLods.emplace_back(lod);
 		}
+	}
 
-		indices.emplace_back(ind[0].GetUint());
-		indices.emplace_back(ind[1].GetUint());
-		indices.emplace_back(ind[2].GetUint());
+	Prepare(vertices, vertSize, skinned, indices);
+	return true;
+}
+
+bool Mesh::Create(const std::string& name, const std::string& shaderName, const std::vector<Texture*>& textures, float specPower,
+	std::vector<float>& vertices, unsigned int vertSize, std::vector<unsigned int>& indices, Renderer* renderer)
+{
+	mName = name;
+	mShaderName = shaderName;
+	mTextures = textures;
+	mSpecPower = specPower;
+	mRadius = 0.0f;
+	for (size_t i = 0; i + 2 < vertices.size(); i += vertSize)
+	{
+		mRadius = Math::Max(mRadius, Vector3(vertices[i], vertices[i + 1], vertices[i + 2]).LengthSq());
 	}
+	mRadius = Math::Sqrt(mRadius);
+	mLods.clear();
+	mLods.emplace_back(MeshLod{ 0, static_cast<unsigned>(indices.size()), 0.f, Math::Infinity });
+	Prepare(vertices, vertSize, false, indices);
+	mLoaded = Upload(renderer);
+	return mLoaded;
+}
+
+void Mesh::Prepare(std::vector<float>& vertices, unsigned int vertSize, bool skinned, std::vector<unsigned int>& indices)
+{
+	// Optimise the mesh for the GPU: the exporters write vertices and triangles in authoring order
+	const unsigned int sourceVerts = static_cast<unsigned>(vertices.size()) / vertSize;
+	unsigned int numVerts = sourceVerts;
+	MeshOptimizer::CacheStats before = MeshOptimizer::AnalyzeVertexCache(indices.data(), mLods[0].mIndexCount, numVerts);
+	numVerts = MeshOptimizer::WeldVertices(vertices, vertSize, indices);
+	for (const MeshLod& lod : mLods)
+	{
+		MeshOptimizer::OptimizeVertexCache(&indices[lod.mIndexOffset], lod.mIndexCount, numVerts);
+		MeshOptimizer::OptimizeOverdraw(&indices[lod.mIndexOffset], lod.mIndexCount, vertices, vertSize, 1.05f);
+	}
+	// Vertex order follows the full detail mesh, the coarser levels use a subset of its vertices
+	unsigned int weldedVerts = numVerts;
+	numVerts = MeshOptimizer::OptimizeVertexFetch(vertices, vertSize, indices);
+	MeshOptimizer::CacheStats after = MeshOptimizer::AnalyzeVertexCache(indices.data(), mLods[0].mIndexCount, numVerts);
+	SDL_Log("Mesh %s: %u vertices (%u welded), ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", mName.c_str(),
+		numVerts, sourceVerts - weldedVerts, before.mACMR, after.mACMR, before.mATVR, after.mATVR);
+
+	// Compact vertices, copied in the geometry arena by Upload
+	delete mPackedLayout;
+	mPackedLayout = new VertexLayout();
+	PackVertices(vertices, vertSize, skinned, *mPackedLayout, mPackedVertices);
+	mSourceVertexBytes = static_cast<unsigned>(sourceVerts * vertSize * sizeof(float));
 
-	// Now create a vertex array
-	mVertexArray = new VertexArray(vertices.data(), static_cast<unsigned>(vertices.size()) / vertSize,
-		indices.data(), static_cast<unsigned>(indices.size()));
+	// Keep the optimised vertices on the CPU for the static batches
+	mVertexSize = vertSize;
+	mSkinned = skinned;
+	mVertices.swap(vertices);
+	mIndices.swap(indices);
+}
+
+bool Mesh::Upload(Renderer* renderer)
+{
+	if (!mPackedLayout)
+	{
+		return false;
+	}
+	// Copy the compact vertices in the geometry arena shared by the meshes with the same layout
+	const unsigned int numVerts = static_cast<unsigned>(mPackedVertices.size()) / mPackedLayout->GetStride();
+	mGeometry = renderer->GetGeometryArena(*mPackedLayout)->Allocate(mPackedVertices.data(), numVerts,
+		mIndices.data(), static_cast<unsigned>(mIndices.size()));
+	SDL_Log("Mesh %s: %u bytes per vertex, vertex buffer %u -> %u bytes, index buffer %u -> %u bytes", mName.c_str(),
+		mPackedLayout->GetStride(), mSourceVertexBytes, numVerts * mPackedLayout->GetStride(),
+		static_cast<unsigned>(mIndices.size() * sizeof(unsigned int)), static_cast<unsigned>(mIndices.size()) * mGeometry->mIndexSize);
+	// The arena has its own copy
+	std::vector<unsigned char>().swap(mPackedVertices);
+	delete mPackedLayout;
+	mPackedLayout = nullptr;
 	return true;
 }
 
+void Mesh::PackVertices(const std::vector<float>& vertices, unsigned int vertSize, bool skinned, VertexLayout& layout, std::vector<unsigned char>& packed)
+{
+	unsigned int numVerts = static_cast<unsigned>(vertices.size()) / vertSize;
+	unsigned int uvOffset = vertSize - 2;
+
+	// Bounds of the positions and range of the UVs
+	Vector3 minPos(Math::Infinity, Math::Infinity, Math::Infinity);
+	Vector3 maxPos(-Math::Infinity, -Math::Infinity, -Math::Infinity);
+	float minUV = Math::Infinity;
+	float maxUV = -Math::Infinity;
+	for (unsigned int i = 0; i < numVerts; i++)
+	{
+		const float* vert = &vertices[i * vertSize];
+		minPos = Vector3(Math::Min(minPos.x, vert[0]), Math::Min(minPos.y, vert[1]), Math::Min(minPos.z, vert[2]));
+		maxPos = Vector3(Math::Max(maxPos.x, vert[0]), Math::Max(maxPos.y, vert[1]), Math::Max(maxPos.z, vert[2]));
+		minUV = Math::Min(minUV, Math::Min(vert[uvOffset], vert[uvOffset + 1]));
+		maxUV = Math::Max(maxUV, Math::Max(vert[uvOffset], vert[uvOffset + 1]));
+	}
+
+	// Positions: snorm16 relative to the center of the bounds. The same scale on every axis,
+	// so the dequantize transform doesn't change the direction of the normals
+	Vector3 center = (minPos + maxPos) * 0.5f;
+	Vector3 extents = (maxPos - minPos) * 0.5f;
+	float scale = Math::Max(extents.x, Math::Max(extents.y, extents.z));
+	if (scale <= 0.f)
+	{
+		scale = 1.f;
+	}
+	mDequantize = Matrix4::CreateScale(scale) * Matrix4::CreateTranslation(center);
+	// The 4th component is 1, so the shader reads the position as a vec4 with w = 1
+	layout.AddAttribute(EPositionAttribute, 4, GL_SHORT, true);
+	// Normals: octahedral encoding, 2 x snorm16
+	layout.AddAttribute(ENormalAttribute, 2, GL_SHORT, true);
+	if (skinned)
+	{
+		layout.AddAttribute(ESkinIndicesAttribute, 4, GL_UNSIGNED_BYTE, false, true);
+		layout.AddAttribute(ESkinWeightsAttribute, 4, GL_UNSIGNED_BYTE, true);
+	}
+	// UVs: unorm16 or snorm16 if they fit, otherwise half floats
+	GLenum uvType = GL_HALF_FLOAT;
+	if (minUV >= 0.f && maxUV <= 1.f)
+	{
+		uvType = GL_UNSIGNED_SHORT;
+	}
+	else if (minUV >= -1.f && maxUV <= 1.f)
+	{
+		uvType = GL_SHORT;
+	}
+	layout.AddAttribute(ETexCoordAttribute, 2, uvType, uvType != GL_HALF_FLOAT);
+
+	const std::vector<VertexAttribute>& attributes = layout.GetAttributes();
+	packed.assign(numVerts * layout.GetStride(), 0);
+	for (unsigned int i = 0; i < numVerts; i++)
+	{
+		const float* vert = &vertices[i * vertSize];
+		unsigned char* out = &packed[i * layout.GetStride()];
+
+		short position[4] = {
+			QuantizeSnorm16((vert[0] - center.x) / scale),
+			QuantizeSnorm16((vert[1] - center.y) / scale),
+			QuantizeSnorm16((vert[2] - center.z) / scale),
+			32767
+		};
+		memcpy(out + attributes[0].mOffset, position, sizeof(position));
+
+		short normal[2];
+		EncodeOctahedral(Vector3(vert[3], vert[4], vert[5]), normal);
+		memcpy(out + attributes[1].mOffset, normal, sizeof(normal));
+
+		if (skinned)
+		{
+			unsigned char skin[8];
+			for (unsigned int k = 0; k < 8; k++)
+			{
+				skin[k] = static_cast<unsigned char>(Math::Clamp(vert[6 + k], 0.f, 255.f));
+			}
+			memcpy(out + attributes[2].mOffset, skin, 4);
+			memcpy(out + attributes[3].mOffset, skin + 4, 4);
+		}
+
+		unsigned short uv[2];
+		for (unsigned int k = 0; k < 2; k++)
+		{
+			float value = vert[uvOffset + k];
+			if (uvType == GL_UNSIGNED_SHORT)
+			{
+				uv[k] = static_cast<unsigned short>(value * 65535.f + 0.5f);
+			}
+			else if (uvType == GL_SHORT)
+			{
+				uv[k] = static_cast<unsigned short>(QuantizeSnorm16(value));
+			}
+			else
+			{
+				uv[k] = FloatToHalf(value);
+			}
+		}
+		memcpy(out + attributes.back().mOffset, uv, sizeof(uv));
+	}
+}
+
+short Mesh::QuantizeSnorm16(float value)
+{
+	value = Math::Clamp(value, -1.f, 1.f) * 32767.f;
+	return static_cast<short>(value >= 0.f ? value + 0.5f : value - 0.5f);
+}
+
+void Mesh::EncodeOctahedral(const Vector3& normal, short* out)
+{
+	// Project on the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one
+	float l1 = Math::Abs(normal.x) + Math::Abs(normal.y) + Math::Abs(normal.z);
+	if (l1 <= 0.f)
+	{
+		out[0] = out[1] = 0;
+		return;
+	}
+	float x = normal.x / l1;
+	float y = normal.y / l1;
+	if (normal.z < 0.f)
+	{
+		float foldedX = (1.f - Math::Abs(y)) * (x >= 0.f ? 1.f : -1.f);
+		float foldedY = (1.f - Math::Abs(x)) * (y >= 0.f ? 1.f : -1.f);
+		x = foldedX;
+		y = foldedY;
+	}
+	out[0] = QuantizeSnorm16(x);
+	out[1] = QuantizeSnorm16(y);
+}
+
+unsigned short Mesh::FloatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned int sign = (bits >> 16) & 0x8000;
+	int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = bits & 0x7fffff;
+	if (exponent >= 31)
+	{
+		// Too large (or infinity/NaN): infinity
+		return static_cast<unsigned short>(sign | 0x7c00);
+	}
+	if (exponent <= 0)
+	{
+		// Denormalized half, or zero if too small
+		if (exponent < -10)
+		{
+			return static_cast<unsigned short>(sign);
+		}
+		mantissa |= 0x800000;
+		unsigned int shift = static_cast<unsigned int>(14 - exponent);
+		unsigned int half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+		{
+			half++;
+		}
+		return static_cast<unsigned short>(sign | half);
+	}
+	// Round to nearest. A carry into the exponent is still the correct result
+	unsigned int half = sign | (static_cast<unsigned int>(exponent) << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000)
+	{
+		half++;
+	}
+	return static_cast<unsigned short>(half);
+}
+
+unsigned int Mesh::SelectLod(float screenSize, unsigned int currentLod, float hysteresis) const
+{
+	unsigned int numLods = static_cast<unsigned int>(mLods.size());
+	unsigned int lod = Math::Min(currentLod, numLods - 1);
+	// Coarser while the size is clearly below the threshold of the next level
+	while (lod + 1 < numLods && screenSize < mLods[lod + 1].mScreenSize * (1.f - hysteresis))
+	{
+		lod++;
+	}
+	// Finer while the size is clearly above the threshold of the current level
+	while (lod > 0 && screenSize > mLods[lod].mScreenSize * (1.f + hysteresis))
+	{
+		lod--;
+	}
+	return lod;
+}
+
 void Mesh::Unload() {
-	delete mVertexArray;
-	mVertexArray = nullptr;
+	if (mGeometry) {
+		mGeometry->mArena->Free(mGeometry);
+		mGeometry = nullptr;
+	}
+	mLoaded = false;
 }
 
 Texture* Mesh::GetTexture(size_t index) {
@@ -1,6 +1,18 @@
 #pragma once
 #include <vector>
 #include <string>
+#include "Math.h"
+
+// Level of detail of a mesh: a range of the index buffer shared by all the levels
+struct MeshLod {
+	// First index and number of indices of this level
+	unsigned int mIndexOffset;
+	unsigned int mIndexCount;
+	// Geometric error of this level compared to the full detail mesh (object space)
+	float mError;
+	// The level is used while the bounding sphere covers less than this fraction of the screen height
+	float mScreenSize;
+};
 
 class Mesh {
 public:
@@ -9,10 +21,24 @@ public:
 
 	// Load mesh. Use game reference to get mesh texture from game's texture map
 	bool Load(const std::string& fileName, class Renderer* renderer);
+	// Asynchronous loading is done in steps. Read parses and optimises the file (any thread, no device call),
+	// the renderer then sets the textures named by the file, and Upload copies the geometry in its arena
+	// (thread of the device). The mesh is drawn once the renderer marks it loaded
+	bool Read(const std::string& fileName);
+	const std::vector<std::string>& GetTextureNames() const { return mTextureNames; }
+	void SetTextures(const std::vector<class Texture*>& textures) { mTextures = textures; }
+	bool Upload(class Renderer* renderer);
+	// Loaded meshes can be drawn. Game thread
+	bool IsLoaded() const { return mLoaded; }
+	void SetLoaded() { mLoaded = true; }
+	// Create a mesh (single level of detail) from vertices built at runtime, like the static batches.
+	// Vertices have the PosNormTex format (8 floats). vertices and indices are consumed
+	bool Create(const std::string& name, const std::string& shaderName, const std::vector<class Texture*>& textures, float specPower,
+		std::vector<float>& vertices, unsigned int vertSize, std::vector<unsigned int>& indices, class Renderer* renderer);
 	// Unload mesh
 	void Unload();
-	// Get the vertex array associated with this mesh
-	class VertexArray* GetVertexArray() const { return mVertexArray; }
+	// Get the range of the shared geometry buffers with the vertices and indices of this mesh
+	struct GeometryAllocation* GetGeometry() const { return mGeometry; }
 	// Get a texture from i-position
 	class Texture* GetTexture(size_t index);
 	// Get name of shader
@@ -21,12 +47,40 @@ public:
 	float GetRadius() const { return mRadius; }
 	// Get specular power
 	float GetSpecPower() const { return mSpecPower; }
+	// Transform from the quantized vertex positions to object space. Concatenate it before the world transform
+	const Matrix4& GetDequantizeTransform() const { return mDequantize; }
+	// Optimised vertices (GetVertexSize floats each, in the file format) and indices of all the levels, kept on the CPU
+	const std::vector<float>& GetVertices() const { return mVertices; }
+	unsigned int GetVertexSize() const { return mVertexSize; }
+	// Vertices have bone indices and weights (drawn with the skinning variant of the shader)
+	bool IsSkinned() const { return mSkinned; }
+	const std::vector<unsigned int>& GetIndices() const { return mIndices; }
+	// Levels of detail (level 0 is the full detail mesh)
+	unsigned int GetNumLods() const { return static_cast<unsigned int>(mLods.size()); }
+	const MeshLod& GetLod(unsigned int lod) const { return mLods[lod]; }
+	// Choose the level of detail for the given projected size, starting from the level used in the previous frame.
+	// A level changes only when the size is past its threshold by the hysteresis factor, to avoid popping back and forth
+	unsigned int SelectLod(float screenSize, unsigned int currentLod, float hysteresis) const;
 
 private:
-	// Textures associated with this mesh
+	// support method. Optimise the geometry and pack the vertices for Upload
+	void Prepare(std::vector<float>& vertices, unsigned int vertSize, bool skinned, std::vector<unsigned int>& indices);
+	// support method. Convert the vertices read from the file to the compact layout and fill the layout description
+	void PackVertices(const std::vector<float>& vertices, unsigned int vertSize, bool skinned, class VertexLayout& layout, std::vector<unsigned char>& packed);
+	// support method. Convert a value in [-1, 1] to a normalized 16 bit integer
+	static short QuantizeSnorm16(float value);
+	// support method. Octahedral encoding of an unit vector in two snorm16 values
+	static void EncodeOctahedral(const Vector3& normal, short* out);
+	// support method. Convert a float to IEEE half precision
+	static unsigned short FloatToHalf(float value);
+
+	// Name of the file (or of the batch) for the messages
+	std::string mName;
+	// Textures associated with this mesh, and their names in the file
 	std::vector<class Texture*> mTextures;
-	// Vertex array associated with this mesh
-	class VertexArray* mVertexArray;
+	std::vector<std::string> mTextureNames;
+	// Vertices and indices of this mesh inside the geometry arena of its vertex layout
+	struct GeometryAllocation* mGeometry;
 	// Name of shader specified by mesh
 	std::string mShaderName;
 	// Stores object space bounding sphere radius
@@ -35,4 +89,19 @@ private:
 	float mRadius;
 	// Specular value
 	float mSpecPower;
+	// Positions are stored as 16 bit integers relative to the bounds of the mesh: scale and offset back to object space
+	Matrix4 mDequantize;
+	// Levels of detail, from the finest to the coarsest
+	std::vector<MeshLod> mLods;
+	// CPU copy of the geometry
+	std::vector<float> mVertices;
+	unsigned int mVertexSize;
+	std::vector<unsigned int> mIndices;
+	bool mSkinned;
+	// Packed vertices waiting for Upload, their layout and the size of the vertices read from the file
+	std::vector<unsigned char> mPackedVertices;
+	class VertexLayout* mPackedLayout;
+	unsigned int mSourceVertexBytes;
+	// Uploaded and marked loaded (see SetLoaded)
+	bool mLoaded;
 };
\ No newline at end of file
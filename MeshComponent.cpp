@@ -3,38 +3,64 @@
 #include "Actor.h"
 #include "Game.h"
 #include "Texture.h"
-#include "VertexArray.h"
+#include "CommandList.h"
 #include "Mesh.h"
 
 MeshComponent::MeshComponent(Actor* owner) :
 	Component(owner),
 	mMesh(nullptr),
-	mTextureIndex(0){
+	mTextureIndex(0),
+	mLod(0),
+	mBatched(false){
 	//owner->GetGame()->GetRenderer()->AddMeshComp(this);
 }
 
 MeshComponent::~MeshComponent(){
-	mOwner->GetGame()->GetRenderer()->RemoveMeshComp(mMesh->GetShaderName(), this);
+	// The shader of a mesh still loading is not known yet
+	mOwner->GetGame()->GetRenderer()->RemoveMeshComp(mMesh->IsLoaded() ? mMesh->GetShaderName() : std::string(), this);
 }
 
-void MeshComponent::Draw(Shader* shader) {
-	if (mMesh) {
-		// Set the world transform
-		shader->SetMatrixUniform("uWorldTransform", mOwner->GetWorldTransform());
-		// Set the specular uniform
-		shader->SetFloatUniform("uSpecPower", mMesh->GetSpecPower());
-		// Set the active texture
-		Texture* tex = mMesh->GetTexture(mTextureIndex);
-		if (tex) tex->SetActive();
-		// Set the mesh's vertex array object as active
-		VertexArray* vao = mMesh->GetVertexArray();
-		if (vao) vao->SetActive();
-		// Draw mesh
-		glDrawElements(GL_TRIANGLES, vao->GetNumIndices(), GL_UNSIGNED_INT, nullptr);
+void MeshComponent::Record(CommandList& list, Shader* shader, unsigned int shaderIndex, float viewDepth) {
+	if (!mMesh || !mMesh->GetGeometry()) return;
+	const MeshLod& lod = mMesh->GetLod(mLod);
+	Texture* tex = mMesh->GetTexture(mTextureIndex);
+	DrawPacket packet;
+	packet.mSortKey = CommandList::MakeSortKey(EOpaquePass, shaderIndex, tex ? tex->GetTextureID() : 0, CommandList::DepthOrder(viewDepth));
+	// The vertex positions are quantized, dequantize them before the world transform
+	packet.mWorldTransform = mMesh->GetDequantizeTransform() * mOwner->GetWorldTransform();
+	packet.mShader = shader;
+	packet.mTexture = tex;
+	// Draw the index range of the current level of detail from the shared geometry buffers
+	packet.mGeometry = mMesh->GetGeometry();
+	packet.mFirstIndex = lod.mIndexOffset;
+	packet.mIndexCount = lod.mIndexCount;
+	packet.mSpecPower = mMesh->GetSpecPower();
+	packet.mPass = EOpaquePass;
+	list.AddDraw(packet);
+	list.AddTriangles(lod.mIndexCount / 3, mMesh->GetLod(0).mIndexCount / 3);
+}
+
+void MeshComponent::UpdateLod(const Matrix4& view, float yScale, float nearPlane, float hysteresis) {
+	if (!mMesh || mMesh->GetNumLods() < 2) {
+		mLod = 0;
+		return;
+	}
+	// The bounding sphere is centered on the object space origin, so its world center is the actor position
+	float radius = mMesh->GetRadius() * mOwner->GetActorScale();
+	float depth = Vector3::Transform(mOwner->GetActorPosition(), view).z;
+	if (depth - radius <= nearPlane) {
+		// Close to the camera: always full detail
+		mLod = 0;
+		return;
 	}
+	// Diameter of the projected sphere as a fraction of the screen height (NDC height is 2)
+	float screenSize = radius * yScale / depth;
+	mLod = mMesh->SelectLod(screenSize, mLod, hysteresis);
 }
 
 void MeshComponent::SetMesh(Mesh* mesh) {
 	mMesh = mesh;
-	mOwner->GetGame()->GetRenderer()->AddMeshComp(mesh->GetShaderName(), this);
+	// Meshes loading in the background are drawn once loaded
+	if (mesh->IsLoaded()) mOwner->GetGame()->GetRenderer()->AddMeshComp(mesh->GetShaderName(), this);
+	else mOwner->GetGame()->GetRenderer()->AddPendingMeshComp(this);
 }
\ No newline at end of file
@@ -1,18 +1,33 @@
 #pragma once
 #include "Component.h"
 #include "Mesh.h"
+#include "Math.h"
 
 class MeshComponent : public Component {
 public:
 	MeshComponent(class Actor* owner);
 	~MeshComponent();
-	// Draw this mesh with provided shader
-	virtual void Draw(class Shader* shader);
+	// Record the draw packet of the current level of detail. Called by the recording jobs: no OpenGL calls
+	// shaderIndex and viewDepth are used to sort the packet
+	virtual void Record(class CommandList& list, class Shader* shader, unsigned int shaderIndex, float viewDepth);
 	// Set mesh/texture index used by this mesh
 	virtual void SetMesh(class Mesh* mesh);
 	Mesh* GetMesh() const { return mMesh; }
 	void SetTextureIndex(size_t index) { mTextureIndex = index; };
+	size_t GetTextureIndex() const { return mTextureIndex; }
+	// Batched components are drawn by a static batch instead of one by one
+	void SetBatched(bool batched) { mBatched = batched; }
+	bool IsBatched() const { return mBatched; }
+	// Choose the level of detail from the projected size of the world space bounding sphere
+	// view is the camera view matrix, yScale the vertical scale of the projection matrix
+	void UpdateLod(const Matrix4& view, float yScale, float nearPlane, float hysteresis);
+	// Level of detail drawn by this component
+	unsigned int GetLod() const { return mLod; }
 private:
 	class Mesh* mMesh;
 	size_t mTextureIndex;
+	// Current level of detail
+	unsigned int mLod;
+	// The mesh is merged in a static batch
+	bool mBatched;
 };
\ No newline at end of file
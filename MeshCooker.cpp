@@ -0,0 +1,143 @@
+#include "MeshCooker.h"
+#include "MeshSimplifier.h"
+#include "Math.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <rapidjson/document.h>
+#include <SDL_log.h>
+
+const float MeshCooker::LodReduction = 0.5f;
+
+// Write a number so that the value read back is the same double parsed from the source file
+static void WriteNumber(std::ostream& out, double value) {
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.15g", value);
+	out << buffer;
+}
+
+// Write a list of triangles with the same layout used by the exporters
+static void WriteIndices(std::ostream& out, const std::vector<unsigned int>& indices, const std::string& indent) {
+	out << "[\n";
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		out << indent << "\t[" << indices[i] << "," << indices[i + 1] << "," << indices[i + 2] << "]";
+		out << (i + 3 < indices.size() ? ",\n" : "\n");
+	}
+	out << indent << "]";
+}
+
+bool MeshCooker::CookLods(const std::string& fileName) {
+	std::ifstream file(fileName);
+	if (!file.is_open()) {
+		SDL_Log("File not found: Mesh %s", fileName.c_str());
+		return false;
+	}
+	std::stringstream fileStream;
+	fileStream << file.rdbuf();
+	std::string contents = fileStream.str();
+	file.close();
+	rapidjson::StringStream jsonStr(contents.c_str());
+	rapidjson::Document doc;
+	doc.ParseStream(jsonStr);
+	if (!doc.IsObject() || !doc.HasMember("vertices") || !doc.HasMember("indices")) {
+		SDL_Log("Mesh %s is not valid json", fileName.c_str());
+		return false;
+	}
+
+	// Vertices are kept as doubles so that they are written back unchanged
+	const rapidjson::Value& vertsJson = doc["vertices"];
+	unsigned int numVerts = vertsJson.Size();
+	unsigned int stride = numVerts > 0 ? vertsJson[0].Size() : 0;
+	if (stride < 3) {
+		SDL_Log("Mesh %s has no vertices", fileName.c_str());
+		return false;
+	}
+	std::vector<double> vertices;
+	std::vector<float> positions;
+	for (rapidjson::SizeType i = 0; i < numVerts; i++) {
+		const rapidjson::Value& vert = vertsJson[i];
+		if (vert.Size() != stride) {
+			SDL_Log("Unexpected vertex format for %s", fileName.c_str());
+			return false;
+		}
+		for (rapidjson::SizeType j = 0; j < stride; j++) vertices.emplace_back(vert[j].GetDouble());
+		for (rapidjson::SizeType j = 0; j < 3; j++) positions.emplace_back(static_cast<float>(vert[j].GetDouble()));
+	}
+	const rapidjson::Value& indJson = doc["indices"];
+	std::vector<unsigned int> indices;
+	for (rapidjson::SizeType i = 0; i < indJson.Size(); i++) {
+		for (rapidjson::SizeType j = 0; j < 3; j++) indices.emplace_back(indJson[i][j].GetUint());
+	}
+
+	// Every level is simplified from the full detail mesh, which gives better results than chaining levels
+	MeshSimplifier simplifier(positions.data(), numVerts, 3, indices);
+	std::vector<std::vector<unsigned int>> lods;
+	std::vector<float> errors;
+	unsigned int previousCount = static_cast<unsigned int>(indices.size());
+	for (unsigned int level = 1; level < MaxLods; level++) {
+		unsigned int target = static_cast<unsigned int>(previousCount * LodReduction);
+		float error = 0.f;
+		std::vector<unsigned int> lod = simplifier.Simplify(target, Math::Infinity, error);
+		// Stop when the simplifier is blocked by seams and borders: a level must remove at least 20% of the triangles
+		if (lod.empty() || lod.size() > previousCount * 0.8f) break;
+		previousCount = static_cast<unsigned int>(lod.size());
+		lods.emplace_back(std::move(lod));
+		errors.emplace_back(error);
+	}
+
+	// Write the file back with the levels of detail
+	std::ofstream out(fileName);
+	if (!out.is_open()) {
+		SDL_Log("Failed to write mesh %s", fileName.c_str());
+		return false;
+	}
+	out << "{\n";
+	out << "\t\"version\":" << doc["version"].GetInt() << ",\n";
+	if (doc.HasMember("vertexformat")) out << "\t\"vertexformat\":\"" << doc["vertexformat"].GetString() << "\",\n";
+	out << "\t\"shader\":\"" << doc["shader"].GetString() << "\",\n";
+	out << "\t\"textures\":[\n";
+	const rapidjson::Value& textures = doc["textures"];
+	for (rapidjson::SizeType i = 0; i < textures.Size(); i++) {
+		out << "\t\t\"" << textures[i].GetString() << "\"" << (i + 1 < textures.Size() ? ",\n" : "\n");
+	}
+	out << "\t],\n";
+	out << "\t\"specularPower\":";
+	WriteNumber(out, doc["specularPower"].GetDouble());
+	out << ",\n";
+	out << "\t\"vertices\":[\n";
+	for (unsigned int i = 0; i < numVerts; i++) {
+		out << "\t\t[";
+		for (unsigned int j = 0; j < stride; j++) {
+			WriteNumber(out, vertices[i * stride + j]);
+			if (j + 1 < stride) out << ",";
+		}
+		out << (i + 1 < numVerts ? "],\n" : "]\n");
+	}
+	out << "\t],\n";
+	out << "\t\"indices\":";
+	WriteIndices(out, indices, "\t");
+	out << ",\n";
+	out << "\t\"lods\":[\n";
+	for (size_t i = 0; i < lods.size(); i++) {
+		out << "\t\t{\n";
+		out << "\t\t\t\"error\":";
+		WriteNumber(out, errors[i]);
+		out << ",\n";
+		// Same default used by Mesh::Load: every level halves the screen size of the previous one
+		out << "\t\t\t\"screenSize\":";
+		WriteNumber(out, 0.4 / static_cast<double>(2 << i));
+		out << ",\n";
+		out << "\t\t\t\"indices\":";
+		WriteIndices(out, lods[i], "\t\t\t");
+		out << "\n\t\t}" << (i + 1 < lods.size() ? ",\n" : "\n");
+	}
+	out << "\t]\n";
+	out << "}\n";
+
+	SDL_Log("Cooked %s: %u levels of detail", fileName.c_str(), static_cast<unsigned int>(lods.size()) + 1);
+	for (size_t i = 0; i < lods.size(); i++) {
+		SDL_Log("  LOD %u: %u triangles, error %f", static_cast<unsigned int>(i) + 1, static_cast<unsigned int>(lods[i].size() / 3), errors[i]);
+	}
+	return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Offline processing of .gpmesh files, run from the command line (see Main.cpp)
+class MeshCooker {
+public:
+	// Generate the levels of detail of the mesh with the quadric error simplifier and
+	// write them in the "lods" array of the same file. Existing levels are replaced
+	static bool CookLods(const std::string& fileName);
+
+	// Each level targets this fraction of the triangles of the previous one
+	static const float LodReduction;
+	// Maximum number of levels, full detail included
+	static const unsigned int MaxLods = 4;
+};
@@ -0,0 +1,309 @@
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	// Scoring of Forsyth's algorithm ("Linear-Speed Vertex Cache Optimisation")
+	const unsigned int MaxCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriScore = 0.75f;
+	const float ValenceBoostScale = 2.f;
+	const float ValenceBoostPower = 0.5f;
+
+	// Score of a vertex from its position in the simulated LRU cache (-1 if not cached) and
+	// the number of triangles still to be emitted that use it
+	float VertexScore(int cachePos, unsigned int remainingTris) {
+		if (remainingTris == 0) return -1.f;
+		float score = 0.f;
+		if (cachePos >= 0) {
+			if (cachePos < 3) {
+				// The vertices of the last triangle get a fixed score, so the next triangle doesn't depend on their order
+				score = LastTriScore;
+			}
+			else {
+				float scaler = 1.f - static_cast<float>(cachePos - 3) / (MaxCacheSize - 3);
+				score = std::pow(scaler, CacheDecayPower);
+			}
+		}
+		// Boost the vertices with few triangles left, so they are finished before they leave the cache
+		score += ValenceBoostScale * std::pow(static_cast<float>(remainingTris), -ValenceBoostPower);
+		return score;
+	}
+
+	// FIFO cache simulated with the time of insertion of every vertex, counted in cache misses.
+	// A vertex is in the cache if it was inserted after the last flush and less than CacheSize misses ago
+	struct FifoCache {
+		std::vector<unsigned int> mTimestamps;
+		unsigned int mMisses;
+		unsigned int mFlushTime;
+
+		explicit FifoCache(unsigned int numVerts) : mTimestamps(numVerts, 0), mMisses(0), mFlushTime(0) {}
+		// Return true if the vertex had to be transformed
+		bool Access(unsigned int v) {
+			// Timestamps are stored + 1, so 0 means never inserted
+			unsigned int stamp = mTimestamps[v];
+			if (stamp > mFlushTime && mMisses - stamp < MeshOptimizer::CacheSize) {
+				return false;
+			}
+			mMisses++;
+			mTimestamps[v] = mMisses;
+			return true;
+		}
+		void Flush() { mFlushTime = mMisses; }
+	};
+}
+
+unsigned int MeshOptimizer::WeldVertices(std::vector<float>& vertices, unsigned int stride, std::vector<unsigned int>& indices) {
+	const unsigned int numVerts = static_cast<unsigned int>(vertices.size() / stride);
+	// Sort the vertices by their attributes, equal vertices end up next to each other
+	std::vector<unsigned int> order(numVerts);
+	for (unsigned int i = 0; i < numVerts; i++) order[i] = i;
+	auto attributes = [&](unsigned int v) { return vertices.begin() + v * stride; };
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+		return std::lexicographical_compare(attributes(a), attributes(a) + stride, attributes(b), attributes(b) + stride);
+	});
+
+	// Every vertex is replaced by the first vertex (in file order) with the same attributes
+	std::vector<unsigned int> remap(numVerts);
+	for (unsigned int begin = 0; begin < numVerts;) {
+		unsigned int end = begin + 1;
+		unsigned int first = order[begin];
+		while (end < numVerts && std::equal(attributes(order[begin]), attributes(order[begin]) + stride, attributes(order[end]))) {
+			first = std::min(first, order[end]);
+			end++;
+		}
+		for (unsigned int i = begin; i < end; i++) remap[order[i]] = first;
+		begin = end;
+	}
+
+	// Compact the vertices, keeping their relative order
+	std::vector<unsigned int> newIndex(numVerts);
+	unsigned int count = 0;
+	for (unsigned int v = 0; v < numVerts; v++) {
+		if (remap[v] == v) {
+			std::copy(attributes(v), attributes(v) + stride, vertices.begin() + count * stride);
+			newIndex[v] = count++;
+		}
+	}
+	vertices.resize(count * stride);
+	for (unsigned int& index : indices) index = newIndex[remap[index]];
+	return count;
+}
+
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int numVerts) {
+	const unsigned int numTris = indexCount / 3;
+	if (numTris == 0) return;
+
+	// Triangles not emitted yet around every vertex: vertTris[triOffsets[v] .. triOffsets[v] + remaining[v])
+	std::vector<unsigned int> triOffsets(numVerts + 1, 0);
+	for (unsigned int i = 0; i < numTris * 3; i++) triOffsets[indices[i] + 1]++;
+	for (unsigned int v = 0; v < numVerts; v++) triOffsets[v + 1] += triOffsets[v];
+	std::vector<unsigned int> vertTris(numTris * 3);
+	std::vector<unsigned int> remaining(numVerts, 0);
+	for (unsigned int i = 0; i < numTris * 3; i++) {
+		unsigned int v = indices[i];
+		vertTris[triOffsets[v] + remaining[v]++] = i / 3;
+	}
+
+	std::vector<int> cachePos(numVerts, -1);
+	std::vector<float> vertScore(numVerts);
+	for (unsigned int v = 0; v < numVerts; v++) vertScore[v] = VertexScore(-1, remaining[v]);
+	std::vector<bool> emitted(numTris, false);
+
+	std::vector<unsigned int> output;
+	output.reserve(numTris * 3);
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	unsigned int scanCursor = 0;
+	int best = -1;
+	while (output.size() < numTris * 3) {
+		if (best < 0) {
+			// No candidate around the cached vertices: continue with the next triangle in the original order
+			while (emitted[scanCursor]) scanCursor++;
+			best = static_cast<int>(scanCursor);
+		}
+
+		const unsigned int* tri = &indices[best * 3];
+		emitted[best] = true;
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int v = tri[k];
+			output.emplace_back(v);
+			// Remove the triangle from the list of the vertex
+			unsigned int* begin = &vertTris[triOffsets[v]];
+			unsigned int* end = begin + remaining[v];
+			unsigned int* it = std::find(begin, end, static_cast<unsigned int>(best));
+			if (it != end) {
+				*it = *(end - 1);
+				remaining[v]--;
+			}
+		}
+
+		// The vertices of the triangle go to the front of the LRU cache
+		newCache.clear();
+		for (unsigned int k = 0; k < 3; k++) {
+			if (std::find(newCache.begin(), newCache.end(), tri[k]) == newCache.end()) newCache.emplace_back(tri[k]);
+		}
+		for (unsigned int v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) newCache.emplace_back(v);
+		}
+		for (size_t i = MaxCacheSize; i < newCache.size(); i++) {
+			cachePos[newCache[i]] = -1;
+			vertScore[newCache[i]] = VertexScore(-1, remaining[newCache[i]]);
+		}
+		if (newCache.size() > MaxCacheSize) newCache.resize(MaxCacheSize);
+		for (size_t i = 0; i < newCache.size(); i++) {
+			unsigned int v = newCache[i];
+			cachePos[v] = static_cast<int>(i);
+			vertScore[v] = VertexScore(static_cast<int>(i), remaining[v]);
+		}
+		cache.swap(newCache);
+
+		// Next triangle: the best scoring one among the triangles of the cached vertices
+		best = -1;
+		float bestScore = -1.f;
+		for (unsigned int v : cache) {
+			for (unsigned int i = 0; i < remaining[v]; i++) {
+				unsigned int t = vertTris[triOffsets[v] + i];
+				float score = vertScore[indices[t * 3]] + vertScore[indices[t * 3 + 1]] + vertScore[indices[t * 3 + 2]];
+				if (score > bestScore) {
+					bestScore = score;
+					best = static_cast<int>(t);
+				}
+			}
+		}
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, unsigned int indexCount, const std::vector<float>& vertices, unsigned int stride, float threshold) {
+	const unsigned int numTris = indexCount / 3;
+	const unsigned int numVerts = static_cast<unsigned int>(vertices.size() / stride);
+	if (numTris < 2) return;
+
+	// Hard boundaries: triangles where the whole cache is missed, the order before them doesn't matter
+	std::vector<unsigned int> clusters;
+	{
+		FifoCache cache(numVerts);
+		for (unsigned int t = 0; t < numTris; t++) {
+			unsigned int misses = 0;
+			for (unsigned int k = 0; k < 3; k++) misses += cache.Access(indices[t * 3 + k]) ? 1 : 0;
+			if (t == 0 || misses == 3) clusters.emplace_back(t);
+		}
+	}
+	clusters.emplace_back(numTris);
+
+	// Soft boundaries: split every hard cluster as soon as the part since the previous split has an ACMR
+	// (with a cold cache) within the threshold of the ACMR of the whole cluster
+	std::vector<unsigned int> splits;
+	FifoCache cache(numVerts);
+	for (size_t c = 0; c + 1 < clusters.size(); c++) {
+		unsigned int begin = clusters[c];
+		unsigned int end = clusters[c + 1];
+		cache.Flush();
+		unsigned int startMisses = cache.mMisses;
+		for (unsigned int i = begin * 3; i < end * 3; i++) cache.Access(indices[i]);
+		float clusterACMR = static_cast<float>(cache.mMisses - startMisses) / (end - begin);
+
+		cache.Flush();
+		splits.emplace_back(begin);
+		unsigned int splitStart = begin;
+		startMisses = cache.mMisses;
+		for (unsigned int t = begin; t < end; t++) {
+			for (unsigned int k = 0; k < 3; k++) cache.Access(indices[t * 3 + k]);
+			float acmr = static_cast<float>(cache.mMisses - startMisses) / (t + 1 - splitStart);
+			if (t + 1 < end && acmr <= clusterACMR * threshold) {
+				splits.emplace_back(t + 1);
+				splitStart = t + 1;
+				cache.Flush();
+				startMisses = cache.mMisses;
+			}
+		}
+	}
+	splits.emplace_back(numTris);
+
+	// Area weighted centroid and normal of every cluster
+	const unsigned int numClusters = static_cast<unsigned int>(splits.size() - 1);
+	std::vector<float> centroids(numClusters * 3, 0.f);
+	std::vector<float> normals(numClusters * 3, 0.f);
+	std::vector<float> areas(numClusters, 0.f);
+	float meshCentroid[3] = { 0.f, 0.f, 0.f };
+	float meshArea = 0.f;
+	for (unsigned int c = 0; c < numClusters; c++) {
+		for (unsigned int t = splits[c]; t < splits[c + 1]; t++) {
+			const float* p0 = &vertices[indices[t * 3] * stride];
+			const float* p1 = &vertices[indices[t * 3 + 1] * stride];
+			const float* p2 = &vertices[indices[t * 3 + 2] * stride];
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (unsigned int k = 0; k < 3; k++) {
+				float center = (p0[k] + p1[k] + p2[k]) / 3.f;
+				centroids[c * 3 + k] += center * area;
+				normals[c * 3 + k] += n[k];
+				meshCentroid[k] += center * area;
+			}
+			areas[c] += area;
+			meshArea += area;
+		}
+	}
+	if (meshArea <= 0.f) return;
+	for (unsigned int k = 0; k < 3; k++) meshCentroid[k] /= meshArea;
+
+	// Sort key: how much the cluster faces away from the center of the mesh
+	std::vector<float> keys(numClusters, 0.f);
+	for (unsigned int c = 0; c < numClusters; c++) {
+		const float* n = &normals[c * 3];
+		float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (areas[c] <= 0.f || length <= 0.f) continue;
+		for (unsigned int k = 0; k < 3; k++) {
+			keys[c] += (centroids[c * 3 + k] / areas[c] - meshCentroid[k]) * n[k] / length;
+		}
+	}
+	std::vector<unsigned int> order(numClusters);
+	for (unsigned int c = 0; c < numClusters; c++) order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(numTris * 3);
+	for (unsigned int c : order) {
+		output.insert(output.end(), indices + splits[c] * 3, indices + splits[c + 1] * 3);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+unsigned int MeshOptimizer::OptimizeVertexFetch(std::vector<float>& vertices, unsigned int stride, std::vector<unsigned int>& indices) {
+	const unsigned int numVerts = static_cast<unsigned int>(vertices.size() / stride);
+	const unsigned int unused = static_cast<unsigned int>(-1);
+	std::vector<unsigned int> newIndex(numVerts, unused);
+	std::vector<float> reordered;
+	reordered.reserve(vertices.size());
+	unsigned int count = 0;
+	for (unsigned int& index : indices) {
+		if (newIndex[index] == unused) {
+			newIndex[index] = count++;
+			reordered.insert(reordered.end(), vertices.begin() + index * stride, vertices.begin() + (index + 1) * stride);
+		}
+		index = newIndex[index];
+	}
+	vertices.swap(reordered);
+	return count;
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, unsigned int indexCount, unsigned int numVerts) {
+	CacheStats stats = { 0.f, 0.f };
+	if (indexCount < 3) return stats;
+	FifoCache cache(numVerts);
+	std::vector<bool> referenced(numVerts, false);
+	unsigned int unique = 0;
+	for (unsigned int i = 0; i < indexCount; i++) {
+		cache.Access(indices[i]);
+		if (!referenced[indices[i]]) {
+			referenced[indices[i]] = true;
+			unique++;
+		}
+	}
+	stats.mACMR = static_cast<float>(cache.mMisses) / (indexCount / 3);
+	stats.mATVR = static_cast<float>(cache.mMisses) / unique;
+	return stats;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+// Load time optimisation of indexed triangle lists (see Mesh::Load).
+// Vertices are stride floats each, the first 3 floats are the position
+class MeshOptimizer {
+public:
+	// Post-transform vertex cache efficiency of a triangle list, measured with a FIFO cache of CacheSize entries
+	struct CacheStats {
+		// Average cache miss ratio: transformed vertices per triangle (0.5 is the ideal for a large regular grid, 3 is the worst)
+		float mACMR;
+		// Average transformed to vertex ratio: transformed vertices per referenced vertex (1 is the ideal)
+		float mATVR;
+	};
+
+	// Merge the vertices with exactly the same attributes and rewrite the indices.
+	// Return the new number of vertices
+	static unsigned int WeldVertices(std::vector<float>& vertices, unsigned int stride, std::vector<unsigned int>& indices);
+	// Reorder the triangles of the range for the post-transform vertex cache (Forsyth's linear-speed algorithm)
+	static void OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int numVerts);
+	// Reorder clusters of triangles (runs that were already cache friendly) so the ones facing away from the
+	// center of the mesh are drawn first: they are likely to occlude the others from any point of view.
+	// threshold is the maximum ACMR increase allowed by splitting the clusters (1.05 = 5%)
+	static void OptimizeOverdraw(unsigned int* indices, unsigned int indexCount, const std::vector<float>& vertices, unsigned int stride, float threshold);
+	// Renumber the vertices in the order of their first use, so the vertex fetch reads memory sequentially.
+	// Vertices not referenced by any index are removed. Return the new number of vertices
+	static unsigned int OptimizeVertexFetch(std::vector<float>& vertices, unsigned int stride, std::vector<unsigned int>& indices);
+	// Simulate the FIFO cache on the range
+	static CacheStats AnalyzeVertexCache(const unsigned int* indices, unsigned int indexCount, unsigned int numVerts);
+
+	// Size of the simulated FIFO cache
+	static const unsigned int CacheSize = 16;
+};
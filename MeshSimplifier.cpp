@@ -0,0 +1,256 @@
+#include "MeshSimplifier.h"
+#include <map>
+#include <array>
+#include <queue>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	// Candidate collapse of vertex mFrom onto vertex mTo, ordered by cost in the priority queue
+	struct Collapse {
+		double mCost;
+		unsigned int mFrom;
+		unsigned int mTo;
+		// Versions of the two vertices when the cost was computed. Stale entries are skipped
+		unsigned int mFromVersion;
+		unsigned int mToVersion;
+
+		bool operator>(const Collapse& other) const { return mCost > other.mCost; }
+	};
+
+	// Normal of a triangle (not normalized, length is twice the area)
+	void TriangleNormal(const float* a, const float* b, const float* c, double* n) {
+		double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+}
+
+MeshSimplifier::MeshSimplifier(const float* vertices, unsigned int numVerts, unsigned int stride, const std::vector<unsigned int>& indices) :
+	mIndices(indices),
+	mQuadrics(numVerts, Quadric{}),
+	mLocked(numVerts, false)
+{
+	mPositions.resize(numVerts * 3);
+	for (unsigned int i = 0; i < numVerts; i++) {
+		mPositions[i * 3] = vertices[i * stride];
+		mPositions[i * 3 + 1] = vertices[i * stride + 1];
+		mPositions[i * 3 + 2] = vertices[i * stride + 2];
+	}
+
+	// Group vertices with the same position. Groups with more than one vertex are attribute seams
+	std::map<std::array<float, 3>, unsigned int> positionIds;
+	std::vector<unsigned int> group(numVerts);
+	std::vector<unsigned int> groupSize;
+	for (unsigned int i = 0; i < numVerts; i++) {
+		std::array<float, 3> key = { mPositions[i * 3], mPositions[i * 3 + 1], mPositions[i * 3 + 2] };
+		auto iter = positionIds.find(key);
+		if (iter == positionIds.end()) {
+			iter = positionIds.emplace(key, static_cast<unsigned int>(groupSize.size())).first;
+			groupSize.emplace_back(0);
+		}
+		group[i] = iter->second;
+		groupSize[iter->second]++;
+	}
+
+	// Accumulate the plane quadrics per position, and count how many triangles use each edge
+	std::vector<Quadric> groupQuadrics(groupSize.size(), Quadric{});
+	std::map<std::pair<unsigned int, unsigned int>, unsigned int> edgeUse;
+	for (size_t t = 0; t + 2 < mIndices.size(); t += 3) {
+		unsigned int tri[3] = { mIndices[t], mIndices[t + 1], mIndices[t + 2] };
+		double n[3];
+		TriangleNormal(&mPositions[tri[0] * 3], &mPositions[tri[1] * 3], &mPositions[tri[2] * 3], n);
+		double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (len > 0.0) {
+			n[0] /= len; n[1] /= len; n[2] /= len;
+			const float* p = &mPositions[tri[0] * 3];
+			Quadric q = MakePlaneQuadric(n[0], n[1], n[2], -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]));
+			for (unsigned int k = 0; k < 3; k++) AddQuadric(groupQuadrics[group[tri[k]]], q);
+		}
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int a = group[tri[k]];
+			unsigned int b = group[tri[(k + 1) % 3]];
+			edgeUse[std::make_pair(std::min(a, b), std::max(a, b))]++;
+		}
+	}
+
+	// Lock seams and the end points of border edges (used by a single triangle)
+	std::vector<bool> groupLocked(groupSize.size(), false);
+	for (size_t g = 0; g < groupSize.size(); g++) {
+		if (groupSize[g] > 1) groupLocked[g] = true;
+	}
+	for (const auto& edge : edgeUse) {
+		if (edge.second == 1) {
+			groupLocked[edge.first.first] = true;
+			groupLocked[edge.first.second] = true;
+		}
+	}
+	for (unsigned int i = 0; i < numVerts; i++) {
+		mQuadrics[i] = groupQuadrics[group[i]];
+		mLocked[i] = groupLocked[group[i]];
+	}
+}
+
+std::vector<unsigned int> MeshSimplifier::Simplify(unsigned int targetIndexCount, float maxError, float& outError) const {
+	const unsigned int numVerts = static_cast<unsigned int>(mQuadrics.size());
+	const unsigned int numTris = static_cast<unsigned int>(mIndices.size() / 3);
+	const double maxCost = static_cast<double>(maxError) * maxError;
+
+	// Working copy of the mesh
+	std::vector<unsigned int> tris(mIndices.begin(), mIndices.begin() + numTris * 3);
+	std::vector<bool> triAlive(numTris, true);
+	std::vector<Quadric> quadrics(mQuadrics);
+	std::vector<bool> removed(numVerts, false);
+	std::vector<unsigned int> version(numVerts, 0);
+	std::vector<std::vector<unsigned int>> vertTris(numVerts);
+	for (unsigned int t = 0; t < numTris; t++) {
+		for (unsigned int k = 0; k < 3; k++) vertTris[tris[t * 3 + k]].emplace_back(t);
+	}
+	unsigned int aliveTris = numTris;
+
+	// Neighbours of a vertex through its alive triangles
+	auto gatherNeighbours = [&](unsigned int v, std::vector<unsigned int>& out) {
+		out.clear();
+		for (unsigned int t : vertTris[v]) {
+			if (!triAlive[t]) continue;
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int w = tris[t * 3 + k];
+				if (w != v && std::find(out.begin(), out.end(), w) == out.end()) out.emplace_back(w);
+			}
+		}
+	};
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+	auto pushCollapse = [&](unsigned int from, unsigned int to) {
+		if (mLocked[from] || removed[from] || removed[to]) return;
+		Quadric q = quadrics[from];
+		AddQuadric(q, quadrics[to]);
+		double cost = EvaluateQuadric(q, &mPositions[to * 3]);
+		queue.push(Collapse{ cost, from, to, version[from], version[to] });
+	};
+
+	// Initial candidates: both directions of every edge
+	for (unsigned int t = 0; t < numTris; t++) {
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int a = tris[t * 3 + k];
+			unsigned int b = tris[t * 3 + (k + 1) % 3];
+			pushCollapse(a, b);
+			pushCollapse(b, a);
+		}
+	}
+
+	std::vector<unsigned int> fromNeighbours;
+	std::vector<unsigned int> toNeighbours;
+	double lastCost = 0.0;
+	while (aliveTris * 3 > targetIndexCount && !queue.empty()) {
+		Collapse c = queue.top();
+		queue.pop();
+		if (removed[c.mFrom] || removed[c.mTo]) continue;
+		if (version[c.mFrom] != c.mFromVersion || version[c.mTo] != c.mToVersion) continue;
+		if (c.mCost > maxCost) break;
+
+		// Link condition: the vertices shared by both neighbourhoods must be exactly
+		// the opposite corners of the triangles on the edge, otherwise the collapse creates non-manifold geometry
+		gatherNeighbours(c.mFrom, fromNeighbours);
+		gatherNeighbours(c.mTo, toNeighbours);
+		if (std::find(fromNeighbours.begin(), fromNeighbours.end(), c.mTo) == fromNeighbours.end()) continue;
+		unsigned int shared = 0;
+		for (unsigned int w : fromNeighbours) {
+			if (std::find(toNeighbours.begin(), toNeighbours.end(), w) != toNeighbours.end()) shared++;
+		}
+		unsigned int edgeTris = 0;
+		for (unsigned int t : vertTris[c.mFrom]) {
+			if (!triAlive[t]) continue;
+			if (tris[t * 3] == c.mTo || tris[t * 3 + 1] == c.mTo || tris[t * 3 + 2] == c.mTo) edgeTris++;
+		}
+		if (shared > edgeTris) continue;
+
+		// Reject collapses that flip (or flatten) one of the remaining triangles
+		bool flips = false;
+		for (unsigned int t : vertTris[c.mFrom]) {
+			if (!triAlive[t]) continue;
+			unsigned int* tri = &tris[t * 3];
+			if (tri[0] == c.mTo || tri[1] == c.mTo || tri[2] == c.mTo) continue;
+			const float* p[3];
+			const float* q[3];
+			for (unsigned int k = 0; k < 3; k++) {
+				p[k] = &mPositions[tri[k] * 3];
+				q[k] = tri[k] == c.mFrom ? &mPositions[c.mTo * 3] : p[k];
+			}
+			double before[3], after[3];
+			TriangleNormal(p[0], p[1], p[2], before);
+			TriangleNormal(q[0], q[1], q[2], after);
+			double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+			double lenBefore = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+			double lenAfter = std::sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+			if (lenAfter <= 1e-12 * lenBefore || dot < 0.2 * lenBefore * lenAfter) {
+				flips = true;
+				break;
+			}
+		}
+		if (flips) continue;
+
+		// Collapse: the triangles on the edge disappear, the others move from mFrom to mTo
+		for (unsigned int t : vertTris[c.mFrom]) {
+			if (!triAlive[t]) continue;
+			unsigned int* tri = &tris[t * 3];
+			if (tri[0] == c.mTo || tri[1] == c.mTo || tri[2] == c.mTo) {
+				triAlive[t] = false;
+				aliveTris--;
+			}
+			else {
+				for (unsigned int k = 0; k < 3; k++) {
+					if (tri[k] == c.mFrom) tri[k] = c.mTo;
+				}
+				vertTris[c.mTo].emplace_back(t);
+			}
+		}
+		vertTris[c.mFrom].clear();
+		removed[c.mFrom] = true;
+		AddQuadric(quadrics[c.mTo], quadrics[c.mFrom]);
+		version[c.mTo]++;
+		lastCost = std::max(lastCost, c.mCost);
+
+		// The edges around mTo have a new cost
+		gatherNeighbours(c.mTo, toNeighbours);
+		for (unsigned int w : toNeighbours) {
+			pushCollapse(w, c.mTo);
+			pushCollapse(c.mTo, w);
+		}
+	}
+
+	outError = static_cast<float>(std::sqrt(lastCost));
+	std::vector<unsigned int> result;
+	result.reserve(aliveTris * 3);
+	for (unsigned int t = 0; t < numTris; t++) {
+		if (!triAlive[t]) continue;
+		result.emplace_back(tris[t * 3]);
+		result.emplace_back(tris[t * 3 + 1]);
+		result.emplace_back(tris[t * 3 + 2]);
+	}
+	return result;
+}
+
+MeshSimplifier::Quadric MeshSimplifier::MakePlaneQuadric(double a, double b, double c, double d) {
+	return Quadric{ a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+}
+
+void MeshSimplifier::AddQuadric(Quadric& q, const Quadric& o) {
+	q.a2 += o.a2; q.ab += o.ab; q.ac += o.ac; q.ad += o.ad;
+	q.b2 += o.b2; q.bc += o.bc; q.bd += o.bd;
+	q.c2 += o.c2; q.cd += o.cd;
+	q.d2 += o.d2;
+}
+
+double MeshSimplifier::EvaluateQuadric(const Quadric& q, const float* pos) {
+	double x = pos[0], y = pos[1], z = pos[2];
+	// v^T Q v with v = (x, y, z, 1)
+	double result = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x
+		+ q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y
+		+ q.c2 * z * z + 2.0 * q.cd * z
+		+ q.d2;
+	// Rounding can make the result slightly negative
+	return std::max(result, 0.0);
+}
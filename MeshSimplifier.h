@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+
+// Quadric error metric simplifier (Garland-Heckbert) based on half-edge collapses.
+// A vertex is always collapsed onto one of its neighbours, so the simplified index lists
+// reference a subset of the original vertices and every LOD can share the same vertex buffer.
+// Vertices on borders and on attribute seams (same position, different normal/UV) are never moved
+class MeshSimplifier {
+public:
+	// vertices holds numVerts vertices of stride floats each, the first 3 floats are the position
+	MeshSimplifier(const float* vertices, unsigned int numVerts, unsigned int stride, const std::vector<unsigned int>& indices);
+
+	// Collapse edges until the index list has at most targetIndexCount indices, or until
+	// the next collapse would exceed maxError (object space distance).
+	// Return the simplified index list. outError receives the error of the last collapse
+	std::vector<unsigned int> Simplify(unsigned int targetIndexCount, float maxError, float& outError) const;
+
+private:
+	// Symmetric 4x4 matrix of a quadric, stored as its 10 unique coefficients
+	struct Quadric {
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+	};
+
+	// Quadric of the plane ax + by + cz + d = 0
+	static Quadric MakePlaneQuadric(double a, double b, double c, double d);
+	static void AddQuadric(Quadric& q, const Quadric& other);
+	// Sum of squared distances of the point from the planes of the quadric
+	static double EvaluateQuadric(const Quadric& q, const float* pos);
+
+	// Position of every vertex
+	std::vector<float> mPositions;
+	// Original triangle list
+	std::vector<unsigned int> mIndices;
+	// Initial quadric of every vertex (sum of the planes of the triangles around its position)
+	std::vector<Quadric> mQuadrics;
+	// Vertices that must not move (borders and seams)
+	std::vector<bool> mLocked;
+};
@@ -0,0 +1,718 @@
+#include "NullRenderDevice.h"
+#include "VertexLayout.h"
+#include <SDL.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+
+NullRenderDevice::NullRenderDevice() :
+	mNextHandle(1),
+	mProgram(0),
+	mVertexArray(0),
+	mWidth(0),
+	mHeight(0),
+	mActiveQuery(0),
+	mPixelUnpackBuffer(0),
+	mTotalCounters{},
+	mFrames(0),
+	mErrors(0)
+{}
+
+NullRenderDevice::~NullRenderDevice() {}
+
+bool NullRenderDevice::Initialize(const std::string& title, int width, int height) {
+	mTotalCounters = DeviceCounters{};
+	mFrames = 0;
+	mErrors = 0;
+	mState.Reset();
+	mWidth = width;
+	mHeight = height;
+	SDL_Log("Null render device for \"%s\" (%dx%d): commands are validated, nothing is drawn", title.c_str(), width, height);
+	return true;
+}
+
+void NullRenderDevice::Shutdown() {
+	// Everything should have been destroyed by now
+	if (!mBuffers.empty() || !mTextures.empty() || !mVertexArrays.empty() || !mPrograms.empty() || !mQueries.empty() ||
+		!mFences.empty() || !mRenderTargets.empty()) {
+		Error("Shutdown with %u buffers, %u textures, %u vertex arrays, %u programs, %u queries, %u fences and %u render targets alive",
+			static_cast<unsigned>(mBuffers.size()), static_cast<unsigned>(mTextures.size()),
+			static_cast<unsigned>(mVertexArrays.size()), static_cast<unsigned>(mPrograms.size()), static_cast<unsigned>(mQueries.size()),
+			static_cast<unsigned>(mFences.size()), static_cast<unsigned>(mRenderTargets.size()));
+	}
+	const DeviceCounters& totals = mTotalCounters;
+	const double frames = mFrames > 0 ? static_cast<double>(mFrames) : 1.0;
+	SDL_Log("Null render device: %llu frames, %.1f draws, %.0f triangles, %.1f program binds, %.1f vertex array binds, "
+		"%.1f texture binds, %.1f uniform uploads, %.0f buffer bytes, %.1f state changes, %.1f skipped state changes per frame, "
+		"%llu errors",
+		static_cast<unsigned long long>(mFrames), totals.mDraws / frames, totals.mTriangles / frames,
+		totals.mProgramBinds / frames, totals.mVertexArrayBinds / frames, totals.mTextureBinds / frames,
+		totals.mUniformUploads / frames, totals.mBufferBytes / frames, totals.mStateChanges / frames,
+		totals.mSkippedStateChanges / frames, static_cast<unsigned long long>(mErrors));
+}
+
+void NullRenderDevice::Present() {
+	if (mActiveQuery) Error("Present: timer query %u still running", mActiveQuery);
+	mCounters.mSkippedStateChanges += mState.TakeSkipped();
+	mTotalCounters += mCounters;
+	mFrames++;
+	EndFrameCounters();
+}
+
+void NullRenderDevice::Error(const char* format, ...) {
+	mErrors++;
+	if (mErrors > MaxLoggedErrors) return;
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+	SDL_Log("Null render device error: %s", message);
+}
+
+NullRenderDevice::BufferInfo* NullRenderDevice::FindBuffer(BufferHandle buffer, const char* command) {
+	auto iter = mBuffers.find(buffer);
+	if (iter == mBuffers.end()) {
+		Error("%s: buffer %u doesn't exist", command, buffer);
+		return nullptr;
+	}
+	return &iter->second;
+}
+
+NullRenderDevice::BufferInfo* NullRenderDevice::FindUnmappedBuffer(BufferHandle buffer, const char* command) {
+	BufferInfo* info = FindBuffer(buffer, command);
+	if (info && info->mMapped) {
+		Error("%s: buffer %u is mapped", command, buffer);
+		return nullptr;
+	}
+	return info;
+}
+
+BufferHandle NullRenderDevice::CreateBuffer(BufferType type, unsigned int size, const void* data, BufferUsage) {
+	BufferHandle buffer = mNextHandle++;
+	mBuffers[buffer] = BufferInfo{ type, size, {}, false, false };
+	if (data) mCounters.mBufferBytes += size;
+	return buffer;
+}
+
+void NullRenderDevice::DestroyBuffer(BufferHandle buffer) {
+	if (FindBuffer(buffer, "DestroyBuffer")) mBuffers.erase(buffer);
+	mState.ForgetBuffer(buffer);
+}
+
+void NullRenderDevice::ResizeBuffer(BufferHandle buffer, unsigned int size, BufferUsage) {
+	BufferInfo* info = FindUnmappedBuffer(buffer, "ResizeBuffer");
+	if (!info) return;
+	if (info->mPersistent) {
+		Error("ResizeBuffer: buffer %u is persistently mapped", buffer);
+		return;
+	}
+	info->mSize = size;
+	info->mStorage.clear();
+}
+
+void NullRenderDevice::UpdateBuffer(BufferHandle buffer, unsigned int offset, unsigned int size, const void* data) {
+	BufferInfo* info = FindUnmappedBuffer(buffer, "UpdateBuffer");
+	if (!info) return;
+	if (!data || static_cast<uint64_t>(offset) + size > info->mSize) {
+		Error("UpdateBuffer: %u bytes at %u outside buffer %u of %u bytes", size, offset, buffer, info->mSize);
+		return;
+	}
+	mCounters.mBufferBytes += size;
+}
+
+void NullRenderDevice::CopyBuffer(BufferHandle source, unsigned int sourceOffset, BufferHandle dest, unsigned int destOffset, unsigned int size) {
+	BufferInfo* sourceInfo = FindUnmappedBuffer(source, "CopyBuffer");
+	BufferInfo* destInfo = FindUnmappedBuffer(dest, "CopyBuffer");
+	if (!sourceInfo || !destInfo) return;
+	if (static_cast<uint64_t>(sourceOffset) + size > sourceInfo->mSize || static_cast<uint64_t>(destOffset) + size > destInfo->mSize) {
+		Error("CopyBuffer: %u bytes from %u to %u outside the buffers", size, sourceOffset, destOffset);
+	}
+}
+
+void NullRenderDevice::BindUniformBuffer(BufferHandle buffer, unsigned int bindingPoint) {
+	BufferInfo* info = FindBuffer(buffer, "BindUniformBuffer");
+	if (info && info->mType != EUniformBuffer) Error("BindUniformBuffer: buffer %u is not a uniform buffer", buffer);
+	mState.BindBufferBase(bindingPoint, buffer);
+}
+
+void NullRenderDevice::BindUniformBufferRange(BufferHandle buffer, unsigned int bindingPoint, unsigned int offset, unsigned int size) {
+	BufferInfo* info = FindBuffer(buffer, "BindUniformBufferRange");
+	if (!info) return;
+	if (info->mType != EUniformBuffer) Error("BindUniformBufferRange: buffer %u is not a uniform buffer", buffer);
+	if (offset % UniformBufferAlignment != 0 || size == 0 || static_cast<uint64_t>(offset) + size > info->mSize) {
+		Error("BindUniformBufferRange: %u bytes at %u of buffer %u of %u bytes are not an aligned range", size, offset, buffer, info->mSize);
+		return;
+	}
+	mState.BindBufferRange(bindingPoint, buffer, offset, size);
+}
+
+unsigned int NullRenderDevice::GetUniformBufferAlignment() const {
+	return UniformBufferAlignment;
+}
+
+BufferHandle NullRenderDevice::CreateMappedBuffer(BufferType type, unsigned int size, void** outData) {
+	// Like a driver with persistent mapping
+	BufferHandle buffer = mNextHandle++;
+	BufferInfo& info = mBuffers[buffer];
+	info = BufferInfo{ type, size, std::vector<unsigned char>(size), false, true };
+	*outData = info.mStorage.data();
+	return buffer;
+}
+
+void* NullRenderDevice::MapBufferRange(BufferHandle buffer, unsigned int offset, unsigned int size) {
+	BufferInfo* info = FindUnmappedBuffer(buffer, "MapBufferRange");
+	if (!info) return nullptr;
+	if (info->mPersistent || size == 0 || static_cast<uint64_t>(offset) + size > info->mSize) {
+		Error("MapBufferRange: can't map %u bytes at %u of buffer %u of %u bytes", size, offset, buffer, info->mSize);
+		return nullptr;
+	}
+	info->mStorage.resize(info->mSize);
+	info->mMapped = true;
+	return info->mStorage.data() + offset;
+}
+
+void NullRenderDevice::UnmapBuffer(BufferHandle buffer) {
+	BufferInfo* info = FindBuffer(buffer, "UnmapBuffer");
+	if (!info) return;
+	if (!info->mMapped) Error("UnmapBuffer: buffer %u is not mapped", buffer);
+	info->mMapped = false;
+}
+
+TextureHandle NullRenderDevice::CreateTexture2D(int width, int height, int channels, const void* pixels) {
+	if (width <= 0 || height <= 0 || (channels != 3 && channels != 4)) {
+		Error("CreateTexture2D: invalid %dx%d texture with %d channels", width, height, channels);
+		return 0;
+	}
+	if (!CheckPixels(pixels, static_cast<unsigned int>(width * height * channels), "CreateTexture2D")) return 0;
+	TextureHandle texture = mNextHandle++;
+	mTextures[texture] = 0;
+	return texture;
+}
+
+TextureHandle NullRenderDevice::CreateTextureMips(TextureFormat format, const std::vector<TextureLevel>& levels) {
+	if (!CheckLevels(format, levels, "CreateTextureMips")) return 0;
+	TextureHandle texture = mNextHandle++;
+	mTextures[texture] = 0;
+	return texture;
+}
+
+bool NullRenderDevice::UpdateTextureMips(TextureHandle texture, TextureFormat format, const std::vector<TextureLevel>& levels) {
+	auto iter = mTextures.find(texture);
+	if (iter == mTextures.end() || iter->second != 0) {
+		Error("UpdateTextureMips: texture %u doesn't exist or is a buffer texture", texture);
+		return false;
+	}
+	return CheckLevels(format, levels, "UpdateTextureMips");
+}
+
+bool NullRenderDevice::CheckLevels(TextureFormat format, const std::vector<TextureLevel>& levels, const char* command) {
+	if (levels.empty()) {
+		Error("%s: texture without levels", command);
+		return false;
+	}
+	for (size_t level = 0; level < levels.size(); level++) {
+		const TextureLevel& mip = levels[level];
+		// Each level is half the size of the previous one (rounded down, at least 1)
+		const int width = level == 0 ? mip.mWidth : std::max(levels[level - 1].mWidth / 2, 1);
+		const int height = level == 0 ? mip.mHeight : std::max(levels[level - 1].mHeight / 2, 1);
+		// 4 bytes per texel, or 8/16 bytes per block of 4x4 texels
+		const unsigned int blocks = static_cast<unsigned int>(((width + 3) / 4) * ((height + 3) / 4));
+		const unsigned int size = format == ETextureBC1 ? blocks * 8 : format == ETextureBC3 ? blocks * 16 :
+			static_cast<unsigned int>(width * height * 4);
+		if (mip.mWidth <= 0 || mip.mHeight <= 0 || mip.mWidth != width || mip.mHeight != height || mip.mSize != size) {
+			Error("%s: level %u is %dx%d with %u bytes, expected %dx%d with %u bytes", command,
+				static_cast<unsigned>(level), mip.mWidth, mip.mHeight, mip.mSize, width, height, size);
+			return false;
+		}
+		if (!CheckPixels(mip.mData, mip.mSize, command)) return false;
+	}
+	return true;
+}
+
+bool NullRenderDevice::CheckPixels(const void* pixels, unsigned int size, const char* command) {
+	if (!mPixelUnpackBuffer) {
+		if (!pixels) {
+			Error("%s: texels missing", command);
+			return false;
+		}
+		mCounters.mBufferBytes += size;
+		return true;
+	}
+	// Offset in the pixel unpack buffer, whose bytes were counted by UpdateBuffer
+	BufferInfo* info = FindUnmappedBuffer(mPixelUnpackBuffer, command);
+	if (!info) return false;
+	const uint64_t offset = reinterpret_cast<uintptr_t>(pixels);
+	if (offset + size > info->mSize) {
+		Error("%s: %u bytes at %llu outside pixel unpack buffer %u of %u bytes", command, size,
+			static_cast<unsigned long long>(offset), mPixelUnpackBuffer, info->mSize);
+		return false;
+	}
+	return true;
+}
+
+TextureHandle NullRenderDevice::CreateTextureArray(TextureFormat format, const std::vector<std::vector<TextureLevel>>& layers) {
+	if (layers.empty()) {
+		Error("CreateTextureArray: array without layers");
+		return 0;
+	}
+	for (const std::vector<TextureLevel>& layer : layers) {
+		if (!CheckLevels(format, layer, "CreateTextureArray")) return 0;
+		// Every layer has the size and the levels of the first one
+		if (layer.size() != layers[0].size() || layer[0].mWidth != layers[0][0].mWidth || layer[0].mHeight != layers[0][0].mHeight) {
+			Error("CreateTextureArray: layer of %dx%d with %u levels in an array of %dx%d with %u levels", layer[0].mWidth,
+				layer[0].mHeight, static_cast<unsigned>(layer.size()), layers[0][0].mWidth, layers[0][0].mHeight,
+				static_cast<unsigned>(layers[0].size()));
+			return 0;
+		}
+	}
+	TextureHandle texture = mNextHandle++;
+	mTextures[texture] = 0;
+	return texture;
+}
+
+bool NullRenderDevice::SupportsTextureFormat(TextureFormat) const {
+	return true;
+}
+
+TextureHandle NullRenderDevice::CreateBufferTexture(BufferHandle buffer, TexelFormat) {
+	BufferInfo* info = FindBuffer(buffer, "CreateBufferTexture");
+	if (!info) return 0;
+	if (info->mType != ETextureBuffer) Error("CreateBufferTexture: buffer %u is not a texture buffer", buffer);
+	TextureHandle texture = mNextHandle++;
+	mTextures[texture] = buffer;
+	return texture;
+}
+
+void NullRenderDevice::SetPixelUnpackBuffer(BufferHandle buffer) {
+	BufferInfo* info = buffer ? FindBuffer(buffer, "SetPixelUnpackBuffer") : nullptr;
+	if (info && info->mType != EPixelUnpackBuffer) Error("SetPixelUnpackBuffer: buffer %u is not a pixel unpack buffer", buffer);
+	mPixelUnpackBuffer = buffer;
+}
+
+void NullRenderDevice::DestroyTexture(TextureHandle texture) {
+	if (mTextures.erase(texture) == 0) Error("DestroyTexture: texture %u doesn't exist", texture);
+	mState.ForgetTexture(texture);
+}
+
+void NullRenderDevice::BindTexture(TextureHandle texture, unsigned int unit) {
+	auto iter = mTextures.find(texture);
+	if (iter == mTextures.end()) {
+		Error("BindTexture: texture %u doesn't exist", texture);
+		return;
+	}
+	// The buffer of a buffer texture must outlive it
+	if (iter->second != 0 && mBuffers.find(iter->second) == mBuffers.end()) {
+		Error("BindTexture: buffer %u of texture %u was destroyed", iter->second, texture);
+	}
+	// Same target for every texture: the handle is enough to tell the binds apart
+	mState.SetActiveTextureUnit(unit);
+	if (mState.BindTexture(0, texture)) mCounters.mTextureBinds++;
+}
+
+VertexArrayHandle NullRenderDevice::CreateVertexArray(const VertexLayout& layout, BufferHandle vertices, BufferHandle indices) {
+	BufferInfo* vertexInfo = FindBuffer(vertices, "CreateVertexArray");
+	BufferInfo* indexInfo = FindBuffer(indices, "CreateVertexArray");
+	if (!vertexInfo || !indexInfo) return 0;
+	if (vertexInfo->mType != EVertexBuffer || indexInfo->mType != EIndexBuffer) {
+		Error("CreateVertexArray: buffers %u and %u are not a vertex and an index buffer", vertices, indices);
+	}
+	if (layout.GetStride() == 0) Error("CreateVertexArray: empty vertex layout");
+	VertexArrayHandle vertexArray = mNextHandle++;
+	mVertexArrays[vertexArray] = VertexArrayInfo{ vertices, indices, layout.GetStride() };
+	// Like OpenGL, the new vertex array is bound
+	mVertexArray = vertexArray;
+	mState.BindVertexArray(vertexArray);
+	return vertexArray;
+}
+
+void NullRenderDevice::DestroyVertexArray(VertexArrayHandle vertexArray) {
+	if (mVertexArrays.erase(vertexArray) == 0) {
+		Error("DestroyVertexArray: vertex array %u doesn't exist", vertexArray);
+		return;
+	}
+	if (mVertexArray == vertexArray) mVertexArray = 0;
+	mState.ForgetVertexArray(vertexArray);
+}
+
+void NullRenderDevice::BindVertexArray(VertexArrayHandle vertexArray) {
+	if (mVertexArrays.find(vertexArray) == mVertexArrays.end()) {
+		Error("BindVertexArray: vertex array %u doesn't exist", vertexArray);
+		return;
+	}
+	mVertexArray = vertexArray;
+	if (mState.BindVertexArray(vertexArray)) mCounters.mVertexArrayBinds++;
+}
+
+NullRenderDevice::ProgramInfo* NullRenderDevice::FindProgram(ProgramHandle program, const char* command) {
+	auto iter = mPrograms.find(program);
+	if (iter == mPrograms.end()) {
+		Error("%s: program %u doesn't exist", command, program);
+		return nullptr;
+	}
+	if (!iter->second.mFinished) {
+		Error("%s: program %u used before FinishProgram", command, program);
+		return nullptr;
+	}
+	return &iter->second;
+}
+
+ProgramHandle NullRenderDevice::BeginProgram(const std::string& vertexSource, const std::string& fragmentSource) {
+	ProgramInfo info;
+	info.mVertexSource = vertexSource;
+	info.mFragmentSource = fragmentSource;
+	info.mFinished = false;
+	ProgramHandle program = mNextHandle++;
+	mPrograms[program] = info;
+	return program;
+}
+
+bool NullRenderDevice::FinishProgram(ProgramHandle program, std::string& outError) {
+	auto iter = mPrograms.find(program);
+	if (iter == mPrograms.end()) {
+		Error("FinishProgram: program %u doesn't exist", program);
+		return false;
+	}
+	ProgramInfo& info = iter->second;
+	if (info.mFinished) {
+		Error("FinishProgram: program %u is already finished", program);
+		return true;
+	}
+	// No compiler: only check that both stages have an entry point
+	if (info.mVertexSource.find("main") == std::string::npos || info.mFragmentSource.find("main") == std::string::npos) {
+		outError = "Null device: shader source without main function";
+		mErrors++;
+		mPrograms.erase(iter);
+		return false;
+	}
+	ParseUniforms(info.mVertexSource, info);
+	ParseUniforms(info.mFragmentSource, info);
+	info.mFinished = true;
+	return true;
+}
+
+bool NullRenderDevice::GetProgramBinary(ProgramHandle program, uint32_t& outFormat, std::vector<unsigned char>& outBinary) {
+	ProgramInfo* info = FindProgram(program, "GetProgramBinary");
+	if (!info) return false;
+	outFormat = BinaryFormat;
+	outBinary.assign(info->mVertexSource.begin(), info->mVertexSource.end());
+	outBinary.push_back('\0');
+	outBinary.insert(outBinary.end(), info->mFragmentSource.begin(), info->mFragmentSource.end());
+	return true;
+}
+
+ProgramHandle NullRenderDevice::CreateProgramFromBinary(uint32_t format, const std::vector<unsigned char>& binary) {
+	// Like a driver, reject the binaries it doesn't know without an error
+	auto separator = std::find(binary.begin(), binary.end(), '\0');
+	if (format != BinaryFormat || separator == binary.end()) return 0;
+	ProgramHandle program = BeginProgram(std::string(binary.begin(), separator), std::string(separator + 1, binary.end()));
+	std::string error;
+	return FinishProgram(program, error) ? program : 0;
+}
+
+void NullRenderDevice::DestroyProgram(ProgramHandle program) {
+	if (mPrograms.erase(program) == 0) {
+		Error("DestroyProgram: program %u doesn't exist", program);
+		return;
+	}
+	if (mProgram == program) mProgram = 0;
+	mState.ForgetProgram(program);
+}
+
+void NullRenderDevice::UseProgram(ProgramHandle program) {
+	if (!FindProgram(program, "UseProgram")) return;
+	mProgram = program;
+	if (mState.UseProgram(program)) mCounters.mProgramBinds++;
+}
+
+void NullRenderDevice::GetProgramUniforms(ProgramHandle program, std::vector<ProgramUniform>& outUniforms) {
+	outUniforms.clear();
+	ProgramInfo* info = FindProgram(program, "GetProgramUniforms");
+	if (!info) return;
+	outUniforms = info->mUniforms;
+}
+
+bool NullRenderDevice::BindUniformBlock(ProgramHandle program, const std::string& blockName, unsigned int) {
+	ProgramInfo* info = FindProgram(program, "BindUniformBlock");
+	if (!info) return false;
+	const std::vector<std::string>& blocks = info->mBlocks;
+	return std::find(blocks.begin(), blocks.end(), blockName) != blocks.end();
+}
+
+void NullRenderDevice::SetUniform(int location, UniformType type, unsigned int count, const void* data) {
+	auto iter = mPrograms.find(mProgram);
+	if (iter == mPrograms.end()) {
+		Error("SetUniform: no program in use");
+		return;
+	}
+	const std::vector<ProgramUniform>& uniforms = iter->second.mUniforms;
+	if (location < 0 || location >= static_cast<int>(uniforms.size())) {
+		Error("SetUniform: location %d is not a uniform of program %u", location, mProgram);
+		return;
+	}
+	unsigned int elementSize = sizeof(float);
+	if (type == EUniformVec3) elementSize = 3 * sizeof(float);
+	else if (type == EUniformMat4) elementSize = 16 * sizeof(float);
+	const ProgramUniform& uniform = uniforms[location];
+	if (!data || elementSize != uniform.mElementSize || count > uniform.mCount) {
+		Error("SetUniform: %u values of %u bytes don't match uniform %s", count, elementSize, uniform.mName.c_str());
+		return;
+	}
+	mCounters.mUniformUploads++;
+}
+
+RenderTargetHandle NullRenderDevice::CreateRenderTarget(int width, int height) {
+	if (width <= 0 || height <= 0) {
+		Error("CreateRenderTarget: invalid size %dx%d", width, height);
+		return 0;
+	}
+	RenderTargetHandle target = mNextHandle++;
+	mRenderTargets[target] = RenderTargetInfo{ width, height };
+	mCounters.mBufferBytes += static_cast<uint64_t>(width) * height * 8;
+	return target;
+}
+
+void NullRenderDevice::DestroyRenderTarget(RenderTargetHandle target) {
+	if (mRenderTargets.erase(target) == 0) Error("DestroyRenderTarget: render target %u doesn't exist", target);
+	mState.ForgetRenderTarget(target);
+}
+
+void NullRenderDevice::BindRenderTarget(RenderTargetHandle target) {
+	if (target && mRenderTargets.find(target) == mRenderTargets.end()) {
+		Error("BindRenderTarget: render target %u doesn't exist", target);
+		return;
+	}
+	if (mState.BindRenderTarget(target)) mCounters.mStateChanges++;
+}
+
+void NullRenderDevice::BlitToWindow(RenderTargetHandle source, int sourceWidth, int sourceHeight, int width, int height) {
+	auto iter = mRenderTargets.find(source);
+	if (iter == mRenderTargets.end()) {
+		Error("BlitToWindow: render target %u doesn't exist", source);
+		return;
+	}
+	if (sourceWidth <= 0 || sourceHeight <= 0 || sourceWidth > iter->second.mWidth || sourceHeight > iter->second.mHeight) {
+		Error("BlitToWindow: %dx%d pixels out of render target %u (%dx%d)", sourceWidth, sourceHeight, source,
+			iter->second.mWidth, iter->second.mHeight);
+		return;
+	}
+	if (width != mWidth || height != mHeight) {
+		Error("BlitToWindow: %dx%d doesn't match the window (%dx%d)", width, height, mWidth, mHeight);
+	}
+	if (mState.BindRenderTarget(0)) mCounters.mStateChanges++;
+}
+
+void NullRenderDevice::SetPipelineState(const PipelineState& state) {
+	// Evaluate every state: each skipped one is counted
+	const bool depthTest = mState.SetDepthTest(state.mDepthTest);
+	const bool blend = mState.SetBlend(state.mBlend);
+	const bool cullFace = mState.SetCullFace(state.mCullBackFaces);
+	const bool depthWrite = mState.SetDepthWrite(state.mDepthWrite);
+	const bool colorWrite = mState.SetColorWrite(state.mColorWrite);
+	const bool depthFunc = mState.SetDepthFunc(state.mDepthFunc);
+	if (depthTest || blend || cullFace || depthWrite || colorWrite || depthFunc) mCounters.mStateChanges++;
+}
+
+void NullRenderDevice::SetViewport(int x, int y, int width, int height) {
+	if (x < 0 || y < 0 || width <= 0 || height <= 0) {
+		Error("SetViewport: invalid viewport %d,%d %dx%d", x, y, width, height);
+		return;
+	}
+	mState.SetViewport(x, y, width, height);
+}
+
+void NullRenderDevice::Clear(float red, float green, float blue, float alpha) {
+	mState.SetClearColor(red, green, blue, alpha);
+	mState.SetDepthWrite(true);
+	mState.SetColorWrite(true);
+}
+
+void NullRenderDevice::DrawIndexed(unsigned int count, unsigned int indexSize, unsigned int indexOffset, int baseVertex) {
+	if (mPrograms.find(mProgram) == mPrograms.end()) {
+		Error("DrawIndexed: no program in use");
+		return;
+	}
+	auto iter = mVertexArrays.find(mVertexArray);
+	if (iter == mVertexArrays.end()) {
+		Error("DrawIndexed: no vertex array bound");
+		return;
+	}
+	BufferInfo* vertices = FindUnmappedBuffer(iter->second.mVertices, "DrawIndexed");
+	BufferInfo* indices = FindUnmappedBuffer(iter->second.mIndices, "DrawIndexed");
+	if (!vertices || !indices) return;
+	if (count % 3 != 0 || (indexSize != 2 && indexSize != 4) || indexOffset % indexSize != 0) {
+		Error("DrawIndexed: %u indices of %u bytes at offset %u are not a triangle list", count, indexSize, indexOffset);
+		return;
+	}
+	if (static_cast<uint64_t>(indexOffset) + static_cast<uint64_t>(count) * indexSize > indices->mSize) {
+		Error("DrawIndexed: %u indices at offset %u outside index buffer %u of %u bytes", count, indexOffset, iter->second.mIndices, indices->mSize);
+		return;
+	}
+	if (baseVertex < 0 || static_cast<uint64_t>(baseVertex) * iter->second.mStride >= vertices->mSize) {
+		Error("DrawIndexed: base vertex %d outside vertex buffer %u", baseVertex, iter->second.mVertices);
+		return;
+	}
+	mCounters.mDraws++;
+	mCounters.mTriangles += count / 3;
+}
+
+QueryHandle NullRenderDevice::CreateTimerQuery() {
+	QueryHandle query = mNextHandle++;
+	mQueries[query] = false;
+	return query;
+}
+
+void NullRenderDevice::DestroyTimerQuery(QueryHandle query) {
+	if (mQueries.erase(query) == 0) Error("DestroyTimerQuery: query %u doesn't exist", query);
+	if (mActiveQuery == query) mActiveQuery = 0;
+}
+
+void NullRenderDevice::BeginTimerQuery(QueryHandle query) {
+	auto iter = mQueries.find(query);
+	if (iter == mQueries.end()) {
+		Error("BeginTimerQuery: query %u doesn't exist", query);
+		return;
+	}
+	if (mActiveQuery) {
+		Error("BeginTimerQuery: query %u is already running", mActiveQuery);
+		return;
+	}
+	mActiveQuery = query;
+	iter->second = false;
+}
+
+void NullRenderDevice::EndTimerQuery() {
+	if (!mActiveQuery) {
+		Error("EndTimerQuery: no query running");
+		return;
+	}
+	mQueries[mActiveQuery] = true;
+	mActiveQuery = 0;
+}
+
+bool NullRenderDevice::GetTimerQueryResult(QueryHandle query, uint64_t& outNanoseconds) {
+	auto iter = mQueries.find(query);
+	if (iter == mQueries.end() || !iter->second) {
+		Error("GetTimerQueryResult: query %u was not ended", query);
+		return false;
+	}
+	outNanoseconds = 0;
+	return true;
+}
+
+FenceHandle NullRenderDevice::InsertFence() {
+	FenceHandle fence = mNextHandle++;
+	mFences.insert(fence);
+	return fence;
+}
+
+bool NullRenderDevice::WaitFence(FenceHandle fence, uint64_t) {
+	// Nothing runs on a GPU: every fence is signaled
+	if (mFences.count(fence) == 0) {
+		Error("WaitFence: fence %u doesn't exist", fence);
+		return false;
+	}
+	return true;
+}
+
+void NullRenderDevice::DestroyFence(FenceHandle fence) {
+	if (mFences.erase(fence) == 0) Error("DestroyFence: fence %u doesn't exist", fence);
+}
+
+void NullRenderDevice::ParseUniforms(const std::string& glsl, ProgramInfo& outProgram) {
+	// Drop the comments, they talk about uniforms too
+	std::string source;
+	source.reserve(glsl.size());
+	for (size_t i = 0; i < glsl.size(); i++) {
+		if (glsl.compare(i, 2, "//") == 0) {
+			i = glsl.find('\n', i);
+			if (i == std::string::npos) break;
+		}
+		else if (glsl.compare(i, 2, "/*") == 0) {
+			i = glsl.find("*/", i + 2);
+			if (i == std::string::npos) break;
+			i++;
+			continue;
+		}
+		source += glsl[i];
+	}
+
+	// Keep the lines of the active #ifdef/#ifndef/#else branches, and the values of the #defines (array sizes)
+	std::unordered_map<std::string, std::string> defines;
+	// For each open #if: the enclosing code is active, and the condition
+	std::vector<std::pair<bool, bool>> branches;
+	std::string activeSource;
+	std::istringstream lines(source);
+	std::string line;
+	while (std::getline(lines, line)) {
+		const bool active = branches.empty() || (branches.back().first && branches.back().second);
+		std::istringstream words(line);
+		std::string directive, name, value;
+		words >> directive >> name >> value;
+		if (directive == "#define") {
+			if (active) defines[name] = value;
+		}
+		else if (directive == "#ifdef" || directive == "#ifndef") {
+			branches.emplace_back(active, (defines.find(name) != defines.end()) == (directive == "#ifdef"));
+		}
+		else if (directive == "#else" && !branches.empty()) {
+			branches.back().second = !branches.back().second;
+		}
+		else if (directive == "#endif" && !branches.empty()) {
+			branches.pop_back();
+		}
+		else if (active && (directive.empty() || directive[0] != '#')) {
+			activeSource += line + "\n";
+		}
+	}
+	source.swap(activeSource);
+
+	// Read the identifiers following each "uniform" keyword: "uniform type name[count];" is a uniform,
+	// "uniform Name {" is a block
+	auto readWord = [&source](size_t& pos) {
+		while (pos < source.size() && isspace(static_cast<unsigned char>(source[pos]))) pos++;
+		size_t start = pos;
+		while (pos < source.size() && (isalnum(static_cast<unsigned char>(source[pos])) || source[pos] == '_')) pos++;
+		return source.substr(start, pos - start);
+	};
+	size_t pos = 0;
+	while ((pos = source.find("uniform", pos)) != std::string::npos) {
+		// Whole word only
+		bool wordStart = pos == 0 || !(isalnum(static_cast<unsigned char>(source[pos - 1])) || source[pos - 1] == '_');
+		pos += 7;
+		if (!wordStart || pos >= source.size() || !isspace(static_cast<unsigned char>(source[pos]))) continue;
+
+		std::string type = readWord(pos);
+		while (pos < source.size() && isspace(static_cast<unsigned char>(source[pos]))) pos++;
+		if (pos < source.size() && source[pos] == '{') {
+			outProgram.mBlocks.emplace_back(type);
+			continue;
+		}
+		std::string name = readWord(pos);
+		if (type.empty() || name.empty()) continue;
+		unsigned int count = 1;
+		if (pos < source.size() && source[pos] == '[') {
+			pos++;
+			std::string size = readWord(pos);
+			auto define = defines.find(size);
+			count = static_cast<unsigned int>(atoi(define != defines.end() ? define->second.c_str() : size.c_str()));
+		}
+
+		// Declared in both stages: keep one
+		bool found = false;
+		for (const ProgramUniform& uniform : outProgram.mUniforms) found = found || uniform.mName == name;
+		if (found) continue;
+
+		unsigned int elementSize = sizeof(float);
+		if (type == "vec2" || type == "ivec2" || type == "uvec2") elementSize = 2 * sizeof(float);
+		else if (type == "vec3" || type == "ivec3" || type == "uvec3") elementSize = 3 * sizeof(float);
+		else if (type == "vec4" || type == "ivec4" || type == "uvec4") elementSize = 4 * sizeof(float);
+		else if (type == "mat3") elementSize = 9 * sizeof(float);
+		else if (type == "mat4") elementSize = 16 * sizeof(float);
+		const int location = static_cast<int>(outProgram.mUniforms.size());
+		outProgram.mUniforms.emplace_back(ProgramUniform{ name, location, count > 0 ? count : 1, elementSize });
+	}
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include "RenderDevice.h"
+#include "RenderStateCache.h"
+
+// Backend without window and GPU. Every command is checked (live handles, bound program and vertex array,
+// buffer ranges, uniform locations) and counted, so the whole render path (culling, sorting, batching)
+// runs and can be measured on machines without a display. Errors are logged, totals are logged at shutdown.
+// Timer queries are always ready and measure 0
+class NullRenderDevice : public RenderDevice {
+public:
+	NullRenderDevice();
+	~NullRenderDevice();
+
+	bool Initialize(const std::string& title, int width, int height) override;
+	void Shutdown() override;
+	void AcquireContext() override {}
+	void ReleaseContext() override {}
+	void Present() override;
+	RenderBackend GetBackend() const override { return ENullBackend; }
+	std::string GetDriverId() const override { return "Null render device"; }
+
+	BufferHandle CreateBuffer(BufferType type, unsigned int size, const void* data, BufferUsage usage) override;
+	void DestroyBuffer(BufferHandle buffer) override;
+	void ResizeBuffer(BufferHandle buffer, unsigned int size, BufferUsage usage) override;
+	void UpdateBuffer(BufferHandle buffer, unsigned int offset, unsigned int size, const void* data) override;
+	void CopyBuffer(BufferHandle source, unsigned int sourceOffset, BufferHandle dest, unsigned int destOffset, unsigned int size) override;
+	void BindUniformBuffer(BufferHandle buffer, unsigned int bindingPoint) override;
+	void BindUniformBufferRange(BufferHandle buffer, unsigned int bindingPoint, unsigned int offset, unsigned int size) override;
+	unsigned int GetUniformBufferAlignment() const override;
+	BufferHandle CreateMappedBuffer(BufferType type, unsigned int size, void** outData) override;
+	void* MapBufferRange(BufferHandle buffer, unsigned int offset, unsigned int size) override;
+	void UnmapBuffer(BufferHandle buffer) override;
+
+	TextureHandle CreateTexture2D(int width, int height, int channels, const void* pixels) override;
+	TextureHandle CreateTextureMips(TextureFormat format, const std::vector<TextureLevel>& levels) override;
+	bool UpdateTextureMips(TextureHandle texture, TextureFormat format, const std::vector<TextureLevel>& levels) override;
+	TextureHandle CreateTextureArray(TextureFormat format, const std::vector<std::vector<TextureLevel>>& layers) override;
+	bool SupportsTextureFormat(TextureFormat format) const override;
+	TextureHandle CreateBufferTexture(BufferHandle buffer, TexelFormat format) override;
+	void SetPixelUnpackBuffer(BufferHandle buffer) override;
+	void DestroyTexture(TextureHandle texture) override;
+	void BindTexture(TextureHandle texture, unsigned int unit) override;
+
+	VertexArrayHandle CreateVertexArray(const class VertexLayout& layout, BufferHandle vertices, BufferHandle indices) override;
+	void DestroyVertexArray(VertexArrayHandle vertexArray) override;
+	void BindVertexArray(VertexArrayHandle vertexArray) override;
+
+	ProgramHandle BeginProgram(const std::string& vertexSource, const std::string& fragmentSource) override;
+	bool FinishProgram(ProgramHandle program, std::string& outError) override;
+	bool GetProgramBinary(ProgramHandle program, uint32_t& outFormat, std::vector<unsigned char>& outBinary) override;
+	ProgramHandle CreateProgramFromBinary(uint32_t format, const std::vector<unsigned char>& binary) override;
+	void DestroyProgram(ProgramHandle program) override;
+	void UseProgram(ProgramHandle program) override;
+	void GetProgramUniforms(ProgramHandle program, std::vector<ProgramUniform>& outUniforms) override;
+	bool BindUniformBlock(ProgramHandle program, const std::string& blockName, unsigned int bindingPoint) override;
+	void SetUniform(int location, UniformType type, unsigned int count, const void* data) override;
+
+	RenderTargetHandle CreateRenderTarget(int width, int height) override;
+	void DestroyRenderTarget(RenderTargetHandle target) override;
+	void BindRenderTarget(RenderTargetHandle target) override;
+	void BlitToWindow(RenderTargetHandle source, int sourceWidth, int sourceHeight, int width, int height) override;
+
+	void SetPipelineState(const PipelineState& state) override;
+	void SetViewport(int x, int y, int width, int height) override;
+	void Clear(float red, float green, float blue, float alpha) override;
+	void DrawIndexed(unsigned int count, unsigned int indexSize, unsigned int indexOffset, int baseVertex) override;
+
+	QueryHandle CreateTimerQuery() override;
+	void DestroyTimerQuery(QueryHandle query) override;
+	void BeginTimerQuery(QueryHandle query) override;
+	void EndTimerQuery() override;
+	bool GetTimerQueryResult(QueryHandle query, uint64_t& outNanoseconds) override;
+
+	FenceHandle InsertFence() override;
+	bool WaitFence(FenceHandle fence, uint64_t timeoutNanoseconds) override;
+	void DestroyFence(FenceHandle fence) override;
+
+	// Commands of the presented frames since Initialize (the current frame is in the frame counters)
+	const DeviceCounters& GetTotalCounters() const { return mTotalCounters; }
+	uint64_t GetFrames() const { return mFrames; }
+	uint64_t GetErrors() const { return mErrors; }
+	// Maximum number of errors written to the log (the others are only counted)
+	static const unsigned int MaxLoggedErrors = 32;
+
+private:
+	struct BufferInfo {
+		BufferType mType;
+		unsigned int mSize;
+		// Memory given to the mappings (empty until mapped)
+		std::vector<unsigned char> mStorage;
+		// A range is mapped (the buffer can't be used), or the buffer is always mapped (CreateMappedBuffer)
+		bool mMapped;
+		bool mPersistent;
+	};
+	struct VertexArrayInfo {
+		BufferHandle mVertices;
+		BufferHandle mIndices;
+		unsigned int mStride;
+	};
+	struct RenderTargetInfo {
+		int mWidth;
+		int mHeight;
+	};
+	struct ProgramInfo {
+		// Uniforms declared by the sources. The location is the index in this vector
+		std::vector<ProgramUniform> mUniforms;
+		std::vector<std::string> mBlocks;
+		// Sources, saved as the program "binary"
+		std::string mVertexSource;
+		std::string mFragmentSource;
+		// FinishProgram was called (a program can't be used before)
+		bool mFinished;
+	};
+	// Format of the binaries: the two sources separated by a null character
+	static const uint32_t BinaryFormat = 0x4C4C554E;
+	// Largest GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT of the drivers, so misaligned offsets are caught
+	static const unsigned int UniformBufferAlignment = 256;
+
+	// support method. Count the error and log it (printf style)
+	void Error(const char* format, ...);
+	// support method. Check the sizes of a mip chain, logging an error if a level doesn't match
+	bool CheckLevels(TextureFormat format, const std::vector<TextureLevel>& levels, const char* command);
+	// support method. Check the texels of a texture: a pointer, or a range of the pixel unpack buffer
+	bool CheckPixels(const void* pixels, unsigned int size, const char* command);
+	// support method. Find the buffer, logging an error if the handle is not live
+	BufferInfo* FindBuffer(BufferHandle buffer, const char* command);
+	// support method. Find the buffer, logging an error if it is not live or a range is mapped
+	BufferInfo* FindUnmappedBuffer(BufferHandle buffer, const char* command);
+	// support method. Add the uniforms and blocks declared in a GLSL source (in the active #ifdef branches)
+	static void ParseUniforms(const std::string& glsl, ProgramInfo& outProgram);
+	// support method. Find the program, logging an error if the handle is not live or the program is not finished
+	ProgramInfo* FindProgram(ProgramHandle program, const char* command);
+
+	// Live objects. Handles are never reused, so a stale handle is always reported
+	std::unordered_map<BufferHandle, BufferInfo> mBuffers;
+	std::unordered_map<TextureHandle, BufferHandle> mTextures;
+	std::unordered_map<VertexArrayHandle, VertexArrayInfo> mVertexArrays;
+	std::unordered_map<ProgramHandle, ProgramInfo> mPrograms;
+	std::unordered_map<QueryHandle, bool> mQueries;
+	std::unordered_set<FenceHandle> mFences;
+	std::unordered_map<RenderTargetHandle, RenderTargetInfo> mRenderTargets;
+	unsigned int mNextHandle;
+	// Bound objects
+	ProgramHandle mProgram;
+	VertexArrayHandle mVertexArray;
+	// Size of the window (render target 0)
+	int mWidth;
+	int mHeight;
+	// Running timer query (0: none)
+	QueryHandle mActiveQuery;
+	// Buffer set by SetPixelUnpackBuffer (0: none)
+	BufferHandle mPixelUnpackBuffer;
+	// Same state cache as the OpenGL device, so the counters match
+	RenderStateCache mState;
+	// Totals since Initialize
+	DeviceCounters mTotalCounters;
+	uint64_t mFrames;
+	uint64_t mErrors;
+};
@@ -0,0 +1,295 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+// Use SSE to rasterize 4 pixels at once when the target supports it (always on x64)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+static_assert(OcclusionCuller::Width % OcclusionCuller::TileWidth == 0 && OcclusionCuller::Height % OcclusionCuller::TileHeight == 0,
+	"The depth buffer must be made of whole tiles");
+static_assert(OcclusionCuller::TileWidth % 4 == 0, "Rows of a tile are rasterized 4 pixels at a time");
+static_assert((OcclusionCuller::Width >> (OcclusionCuller::NumLevels - 1)) << (OcclusionCuller::NumLevels - 1) == OcclusionCuller::Width &&
+	(OcclusionCuller::Height >> (OcclusionCuller::NumLevels - 1)) << (OcclusionCuller::NumLevels - 1) == OcclusionCuller::Height,
+	"Every level of the hierarchy must halve the resolution exactly");
+
+OcclusionCuller::OcclusionCuller() :
+	mNear(1.f),
+	mBins(TilesX * TilesY),
+	mOccluderTriangles(0),
+	mTested(0),
+	mCulled(0)
+{
+	for (unsigned int level = 0; level < NumLevels; level++) {
+		mMinDepth[level].resize((Width >> level) * (Height >> level), 0.f);
+		mMaxDepth[level].resize((Width >> level) * (Height >> level), 0.f);
+	}
+}
+
+void OcclusionCuller::BeginFrame(const Matrix4& viewProj, float nearPlane) {
+	mViewProj = viewProj;
+	mNear = nearPlane;
+	mTriangles.clear();
+	for (auto& bin : mBins) bin.clear();
+	mOccluderTriangles = 0;
+	mTested = 0;
+	mCulled = 0;
+}
+
+void OcclusionCuller::AddOccluder(const float* vertices, unsigned int stride, const unsigned int* indices, unsigned int numIndices, const Matrix4& world) {
+	// Concatenate the world transform, so every vertex is transformed once to clip space
+	Matrix4 worldViewProj = world * mViewProj;
+	const float (*m)[4] = worldViewProj.mat;
+	std::vector<ClipVertex> clip;
+	unsigned int numVerts = 0;
+	for (unsigned int i = 0; i < numIndices; i++) numVerts = std::max(numVerts, indices[i] + 1);
+	clip.resize(numVerts);
+	for (unsigned int i = 0; i < numVerts; i++) {
+		const float* p = &vertices[i * stride];
+		// Row vector times matrix
+		clip[i].x = p[0] * m[0][0] + p[1] * m[1][0] + p[2] * m[2][0] + m[3][0];
+		clip[i].y = p[0] * m[0][1] + p[1] * m[1][1] + p[2] * m[2][1] + m[3][1];
+		clip[i].z = p[0] * m[0][2] + p[1] * m[1][2] + p[2] * m[2][2] + m[3][2];
+		clip[i].w = p[0] * m[0][3] + p[1] * m[1][3] + p[2] * m[2][3] + m[3][3];
+	}
+	for (unsigned int i = 0; i + 2 < numIndices; i += 3) {
+		const ClipVertex& a = clip[indices[i]];
+		const ClipVertex& b = clip[indices[i + 1]];
+		const ClipVertex& c = clip[indices[i + 2]];
+		// Trivial reject: the whole triangle is outside one of the side planes
+		if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+			(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w)) {
+			continue;
+		}
+		AddClippedTriangle(a, b, c);
+	}
+}
+
+void OcclusionCuller::AddClippedTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) {
+	const ClipVertex in[3] = { a, b, c };
+	if (a.w >= mNear && b.w >= mNear && c.w >= mNear) {
+		SetupTriangle(a, b, c);
+		return;
+	}
+	// Sutherland-Hodgman against w = near: a triangle becomes a triangle or a quad
+	ClipVertex out[4];
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < 3; i++) {
+		const ClipVertex& cur = in[i];
+		const ClipVertex& next = in[(i + 1) % 3];
+		bool curInside = cur.w >= mNear;
+		bool nextInside = next.w >= mNear;
+		if (curInside) out[count++] = cur;
+		if (curInside != nextInside) {
+			float t = (mNear - cur.w) / (next.w - cur.w);
+			out[count++] = ClipVertex{ cur.x + (next.x - cur.x) * t, cur.y + (next.y - cur.y) * t,
+				cur.z + (next.z - cur.z) * t, mNear };
+		}
+	}
+	if (count >= 3) SetupTriangle(out[0], out[1], out[2]);
+	if (count == 4) SetupTriangle(out[0], out[2], out[3]);
+}
+
+void OcclusionCuller::SetupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) {
+	// Pixel coordinates and 1/w of the vertices
+	const ClipVertex* v[3] = { &a, &b, &c };
+	float x[3], y[3], d[3];
+	for (unsigned int i = 0; i < 3; i++) {
+		d[i] = 1.f / v[i]->w;
+		x[i] = (v[i]->x * d[i] * 0.5f + 0.5f) * Width;
+		y[i] = (v[i]->y * d[i] * 0.5f + 0.5f) * Height;
+	}
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (std::fabs(area) < 1e-6f) return;
+	// Occluders are double sided: make the winding counter-clockwise so the inside of every edge is positive
+	if (area < 0.f) {
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(d[1], d[2]);
+		area = -area;
+	}
+
+	ScreenTriangle tri;
+	tri.mMinX = std::max(0, static_cast<int>(std::floor(std::min(x[0], std::min(x[1], x[2])))));
+	tri.mMaxX = std::min(static_cast<int>(Width) - 1, static_cast<int>(std::ceil(std::max(x[0], std::max(x[1], x[2])))));
+	tri.mMinY = std::max(0, static_cast<int>(std::floor(std::min(y[0], std::min(y[1], y[2])))));
+	tri.mMaxY = std::min(static_cast<int>(Height) - 1, static_cast<int>(std::ceil(std::max(y[0], std::max(y[1], y[2])))));
+	if (tri.mMinX > tri.mMaxX || tri.mMinY > tri.mMaxY) return;
+
+	for (unsigned int i = 0; i < 3; i++) {
+		unsigned int j = (i + 1) % 3;
+		tri.mEdgeA[i] = y[i] - y[j];
+		tri.mEdgeB[i] = x[j] - x[i];
+		tri.mEdgeC[i] = x[i] * y[j] - x[j] * y[i];
+	}
+	tri.mDepthA = ((d[1] - d[0]) * (y[2] - y[0]) - (d[2] - d[0]) * (y[1] - y[0])) / area;
+	tri.mDepthB = ((d[2] - d[0]) * (x[1] - x[0]) - (d[1] - d[0]) * (x[2] - x[0])) / area;
+	tri.mDepthC = d[0] - tri.mDepthA * x[0] - tri.mDepthB * y[0];
+
+	uint32_t index = static_cast<uint32_t>(mTriangles.size());
+	mTriangles.emplace_back(tri);
+	for (int ty = tri.mMinY / static_cast<int>(TileHeight); ty <= tri.mMaxY / static_cast<int>(TileHeight); ty++) {
+		for (int tx = tri.mMinX / static_cast<int>(TileWidth); tx <= tri.mMaxX / static_cast<int>(TileWidth); tx++) {
+			mBins[ty * TilesX + tx].emplace_back(index);
+		}
+	}
+}
+
+void OcclusionCuller::RenderOccluders() {
+	mOccluderTriangles = static_cast<unsigned int>(mTriangles.size());
+	std::fill(mMinDepth[0].begin(), mMinDepth[0].end(), 0.f);
+
+	// Every tile writes its own pixels only, so tiles are rasterized in parallel
+	JobSystem::ParallelFor(TilesX * TilesY, 4, [this](unsigned int begin, unsigned int end) {
+		for (unsigned int tile = begin; tile < end; tile++) {
+			RasterizeTile(tile);
+		}
+	});
+
+	// Level 0 has a single depth per texel. Each level keeps the farthest and the closest depth of its 2x2 children
+	mMaxDepth[0] = mMinDepth[0];
+	for (unsigned int level = 1; level < NumLevels; level++) {
+		unsigned int width = Width >> level;
+		unsigned int height = Height >> level;
+		const std::vector<float>& childMin = mMinDepth[level - 1];
+		const std::vector<float>& childMax = mMaxDepth[level - 1];
+		for (unsigned int y = 0; y < height; y++) {
+			for (unsigned int x = 0; x < width; x++) {
+				unsigned int c0 = (y * 2) * (width * 2) + x * 2;
+				unsigned int c1 = c0 + width * 2;
+				mMinDepth[level][y * width + x] = std::min(std::min(childMin[c0], childMin[c0 + 1]), std::min(childMin[c1], childMin[c1 + 1]));
+				mMaxDepth[level][y * width + x] = std::max(std::max(childMax[c0], childMax[c0 + 1]), std::max(childMax[c1], childMax[c1 + 1]));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(unsigned int tile) {
+	const int tileMinX = static_cast<int>((tile % TilesX) * TileWidth);
+	const int tileMinY = static_cast<int>((tile / TilesX) * TileHeight);
+	const int tileMaxX = tileMinX + static_cast<int>(TileWidth) - 1;
+	const int tileMaxY = tileMinY + static_cast<int>(TileHeight) - 1;
+	float* depth = mMinDepth[0].data();
+
+	for (uint32_t index : mBins[tile]) {
+		const ScreenTriangle& tri = mTriangles[index];
+		// Start on a multiple of 4 pixels: tiles are 4-aligned, so the 4 pixels never cross the tile
+		const int minX = std::max(tri.mMinX, tileMinX) & ~3;
+		const int maxX = std::min(tri.mMaxX, tileMaxX);
+		const int minY = std::max(tri.mMinY, tileMinY);
+		const int maxY = std::min(tri.mMaxY, tileMaxY);
+
+		for (int y = minY; y <= maxY; y++) {
+			// Sample at the pixel centers
+			const float py = static_cast<float>(y) + 0.5f;
+			float* row = depth + y * Width;
+#ifdef OCCLUSION_USE_SSE
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			__m128 edgeA[3], edgeRow[3];
+			for (unsigned int i = 0; i < 3; i++) {
+				edgeA[i] = _mm_set1_ps(tri.mEdgeA[i]);
+				edgeRow[i] = _mm_set1_ps(tri.mEdgeB[i] * py + tri.mEdgeC[i]);
+			}
+			const __m128 depthA = _mm_set1_ps(tri.mDepthA);
+			const __m128 depthRow = _mm_set1_ps(tri.mDepthB * py + tri.mDepthC);
+			for (int x = minX; x <= maxX; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), edgeRow[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px), edgeRow[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px), edgeRow[2]), zero));
+				if (_mm_movemask_ps(inside) == 0) continue;
+				__m128 triDepth = _mm_add_ps(_mm_mul_ps(depthA, px), depthRow);
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 closest = _mm_max_ps(old, triDepth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, old)));
+			}
+#else
+			for (int x = minX; x <= maxX; x++) {
+				const float px = static_cast<float>(x) + 0.5f;
+				if (tri.mEdgeA[0] * px + tri.mEdgeB[0] * py + tri.mEdgeC[0] < 0.f ||
+					tri.mEdgeA[1] * px + tri.mEdgeB[1] * py + tri.mEdgeC[1] < 0.f ||
+					tri.mEdgeA[2] * px + tri.mEdgeB[2] * py + tri.mEdgeC[2] < 0.f) {
+					continue;
+				}
+				row[x] = std::max(row[x], tri.mDepthA * px + tri.mDepthB * py + tri.mDepthC);
+			}
+#endif
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const Vector3& center, float radius) {
+	mTested++;
+	const float (*m)[4] = mViewProj.mat;
+	auto toClip = [m](const Vector3& p) {
+		return ClipVertex{
+			p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+			p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+			p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+			p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3] };
+	};
+	// The view depth of the center is its clip w. Spheres behind the near plane are culled, spheres crossing it are visible
+	float centerDepth = toClip(center).w;
+	if (centerDepth + radius < mNear) {
+		mCulled++;
+		return false;
+	}
+	if (centerDepth - radius <= mNear) return true;
+
+	// Screen bounds of the box around the sphere
+	float minX = Math::Infinity, minY = Math::Infinity;
+	float maxX = -Math::Infinity, maxY = -Math::Infinity;
+	for (unsigned int i = 0; i < 8; i++) {
+		Vector3 corner(center.x + ((i & 1) ? radius : -radius), center.y + ((i & 2) ? radius : -radius), center.z + ((i & 4) ? radius : -radius));
+		ClipVertex clip = toClip(corner);
+		if (clip.w <= mNear) return true;
+		float x = (clip.x / clip.w * 0.5f + 0.5f) * Width;
+		float y = (clip.y / clip.w * 0.5f + 0.5f) * Height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+	}
+	if (maxX < 0.f || maxY < 0.f || minX >= Width || minY >= Height) {
+		// Outside the screen
+		mCulled++;
+		return false;
+	}
+	int pixelMinX = std::max(0, static_cast<int>(minX));
+	int pixelMinY = std::max(0, static_cast<int>(minY));
+	int pixelMaxX = std::min(static_cast<int>(Width) - 1, static_cast<int>(maxX));
+	int pixelMaxY = std::min(static_cast<int>(Height) - 1, static_cast<int>(maxY));
+
+	// Closest point of the sphere, compared with the occluders starting from the coarsest level
+	const float nearestDepth = 1.f / (centerDepth - radius);
+	const unsigned int top = NumLevels - 1;
+	for (int y = pixelMinY >> top; y <= pixelMaxY >> top; y++) {
+		for (int x = pixelMinX >> top; x <= pixelMaxX >> top; x++) {
+			if (IsVisibleInTexel(top, x, y, pixelMinX, pixelMinY, pixelMaxX, pixelMaxY, nearestDepth)) return true;
+		}
+	}
+	mCulled++;
+	return false;
+}
+
+bool OcclusionCuller::IsVisibleInTexel(unsigned int level, int x, int y, int minX, int minY, int maxX, int maxY, float nearestDepth) const {
+	const unsigned int width = Width >> level;
+	// Behind the farthest occluder of the texel: hidden everywhere in it
+	if (nearestDepth < mMinDepth[level][y * width + x]) return false;
+	// In front of the closest occluder of the texel (or at full resolution): visible
+	if (level == 0 || nearestDepth >= mMaxDepth[level][y * width + x]) return true;
+	// Otherwise refine with the children that overlap the bounds
+	const unsigned int childLevel = level - 1;
+	for (int cy = y * 2; cy <= y * 2 + 1; cy++) {
+		if ((((cy + 1) << childLevel) - 1) < minY || (cy << childLevel) > maxY) continue;
+		for (int cx = x * 2; cx <= x * 2 + 1; cx++) {
+			if ((((cx + 1) << childLevel) - 1) < minX || (cx << childLevel) > maxX) continue;
+			if (IsVisibleInTexel(childLevel, cx, cy, minX, minY, maxX, maxY, nearestDepth)) return true;
+		}
+	}
+	return false;
+}
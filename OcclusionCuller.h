@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include "Math.h"
+
+// Software occlusion culling. Large occluders (the static batches) are rasterized on the CPU into a small
+// depth buffer, then the bounding sphere of every mesh is tested against a min/max hierarchy of that buffer.
+// The depth buffer stores 1/w (view depth), which is linear in screen space: bigger values are closer.
+// The screen is split in tiles rasterized in parallel by the job system, 4 pixels at a time with SSE
+class OcclusionCuller {
+public:
+	// Resolution of the depth buffer
+	static const unsigned int Width = 256;
+	static const unsigned int Height = 144;
+	// Size of the tiles rasterized by one job
+	static const unsigned int TileWidth = 32;
+	static const unsigned int TileHeight = 16;
+	static const unsigned int TilesX = Width / TileWidth;
+	static const unsigned int TilesY = Height / TileHeight;
+	// Levels of the hierarchy (level 0 is the depth buffer, each level halves the resolution)
+	static const unsigned int NumLevels = 5;
+
+	// Counters of the last frame
+	struct Stats {
+		unsigned int mOccluderTriangles;
+		unsigned int mTested;
+		unsigned int mCulled;
+	};
+
+	OcclusionCuller();
+
+	// Start a new frame: clear the occluders. viewProj transforms world space to clip space
+	void BeginFrame(const Matrix4& viewProj, float nearPlane);
+	// Add the triangles of an occluder. vertices have stride floats each, the first 3 are the position
+	// (transformed by world to world space)
+	void AddOccluder(const float* vertices, unsigned int stride, const unsigned int* indices, unsigned int numIndices, const Matrix4& world);
+	// Rasterize the occluders and build the depth hierarchy
+	void RenderOccluders();
+	// Return false if the world space sphere is outside the screen or hidden by the occluders.
+	// Safe to call from several threads after RenderOccluders
+	bool IsVisible(const Vector3& center, float radius);
+
+	Stats GetStats() const { return Stats{ mOccluderTriangles, mTested, mCulled }; }
+	// Depth buffer (1/w, 0 where there is no occluder), Width x Height values, bottom row first
+	const std::vector<float>& GetDepthBuffer() const { return mMinDepth[0]; }
+
+private:
+	// Vertex in clip space
+	struct ClipVertex {
+		float x, y, z, w;
+	};
+	// Triangle ready to be rasterized: edge functions and 1/w plane in pixel coordinates, and its pixel bounds
+	struct ScreenTriangle {
+		// Edge i is inside when mEdgeA[i] * x + mEdgeB[i] * y + mEdgeC[i] >= 0
+		float mEdgeA[3], mEdgeB[3], mEdgeC[3];
+		// 1/w = mDepthA * x + mDepthB * y + mDepthC
+		float mDepthA, mDepthB, mDepthC;
+		int mMinX, mMaxX, mMinY, mMaxY;
+	};
+
+	// support method. Clip the triangle against the near plane and add the result
+	void AddClippedTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+	// support method. Project a triangle that is in front of the near plane and add it to the bins of the tiles it covers
+	void SetupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c);
+	// support method. Rasterize all the triangles binned in a tile
+	void RasterizeTile(unsigned int tile);
+	// support method. Test a texel of the hierarchy and its children. Return true if the sphere may be visible there
+	bool IsVisibleInTexel(unsigned int level, int x, int y, int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+
+	// World to clip space transform of the frame
+	Matrix4 mViewProj;
+	float mNear;
+	// Triangles of the frame and, for every tile, the triangles that overlap it
+	std::vector<ScreenTriangle> mTriangles;
+	std::vector<std::vector<uint32_t>> mBins;
+	// Farthest (min 1/w) and closest (max 1/w) occluder depth of every texel, per level of the hierarchy
+	std::vector<float> mMinDepth[NumLevels];
+	std::vector<float> mMaxDepth[NumLevels];
+	// Counters of the frame. The tests are counted by the recording threads
+	unsigned int mOccluderTriangles;
+	std::atomic<unsigned int> mTested;
+	std::atomic<unsigned int> mCulled;
+};
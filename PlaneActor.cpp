@@ -7,6 +7,8 @@ PlaneActor::PlaneActor(Game* game)
 	:Actor(game)
 {
 	SetActorScale(10.0f);
+	// Floor and walls never move: their meshes are merged in static batches
+	SetStatic(true);
 	MeshComponent* mc = new MeshComponent(this);
 	mc->SetMesh(GetGame()->GetRenderer()->GetMesh("Assets/Plane.gpmesh"));
 }
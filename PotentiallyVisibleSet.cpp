@@ -0,0 +1,83 @@
+#include "PotentiallyVisibleSet.h"
+#include <fstream>
+#include <cmath>
+#include <SDL_log.h>
+
+PotentiallyVisibleSet::PotentiallyVisibleSet() :
+	mHeader{ 0, 0, 0, { 0.f, 0.f }, 1.f, 0.f, 0.f, 0, 0 },
+	mWordsPerCell(0)
+{}
+
+bool PotentiallyVisibleSet::Load(const std::string& fileName, uint64_t geometryHash) {
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open()) {
+		SDL_Log("File not found: PVS %s", fileName.c_str());
+		return false;
+	}
+	FileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		header.mMagic != FileMagic || header.mVersion != FileVersion || header.mCellSize <= 0.f) {
+		SDL_Log("PVS %s is not a valid file", fileName.c_str());
+		return false;
+	}
+	// Visibility baked for other walls would hide what can now be seen
+	if (header.mGeometryHash != geometryHash) {
+		SDL_Log("PVS %s was baked from another level geometry: run -bakepvs again", fileName.c_str());
+		return false;
+	}
+	unsigned int numCells = header.mCellsX * header.mCellsY;
+	unsigned int wordsPerCell = GetWordsPerCell(numCells);
+	std::vector<uint32_t> bits(static_cast<size_t>(numCells) * wordsPerCell);
+	if (!file.read(reinterpret_cast<char*>(bits.data()), bits.size() * sizeof(uint32_t))) {
+		SDL_Log("PVS %s is truncated", fileName.c_str());
+		return false;
+	}
+	mHeader = header;
+	mWordsPerCell = wordsPerCell;
+	mBits.swap(bits);
+	SDL_Log("Loaded PVS %s: %u x %u cells", fileName.c_str(), header.mCellsX, header.mCellsY);
+	return true;
+}
+
+uint64_t PotentiallyVisibleSet::HashGeometry(const std::vector<Vector3>& triangles) {
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(triangles.data());
+	for (size_t i = 0; i < triangles.size() * sizeof(Vector3); i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+int PotentiallyVisibleSet::GetCell(const Vector3& position) const {
+	if (position.z < mHeader.mMinZ || position.z > mHeader.mMaxZ) return -1;
+	int x = static_cast<int>(std::floor((position.x - mHeader.mOrigin[0]) / mHeader.mCellSize));
+	int y = static_cast<int>(std::floor((position.y - mHeader.mOrigin[1]) / mHeader.mCellSize));
+	if (x < 0 || y < 0 || x >= static_cast<int>(mHeader.mCellsX) || y >= static_cast<int>(mHeader.mCellsY)) return -1;
+	return y * static_cast<int>(mHeader.mCellsX) + x;
+}
+
+bool PotentiallyVisibleSet::IsCellVisible(int fromCell, int toCell) const {
+	const uint32_t* bits = &mBits[static_cast<size_t>(fromCell) * mWordsPerCell];
+	return (bits[toCell >> 5] & (1u << (toCell & 31))) != 0;
+}
+
+bool PotentiallyVisibleSet::IsVisible(int fromCell, const Vector3& center, float radius) const {
+	if (fromCell < 0) return true;
+	// Range of cells overlapped by the bounds of the sphere
+	const float invCellSize = 1.f / mHeader.mCellSize;
+	int minX = static_cast<int>(std::floor((center.x - radius - mHeader.mOrigin[0]) * invCellSize));
+	int maxX = static_cast<int>(std::floor((center.x + radius - mHeader.mOrigin[0]) * invCellSize));
+	int minY = static_cast<int>(std::floor((center.y - radius - mHeader.mOrigin[1]) * invCellSize));
+	int maxY = static_cast<int>(std::floor((center.y + radius - mHeader.mOrigin[1]) * invCellSize));
+	// Parts outside the grid (or above/below the cells) are not covered by the baked visibility
+	if (minX < 0 || minY < 0 || maxX >= static_cast<int>(mHeader.mCellsX) || maxY >= static_cast<int>(mHeader.mCellsY) ||
+		center.z + radius < mHeader.mMinZ || center.z - radius > mHeader.mMaxZ) {
+		return true;
+	}
+	for (int y = minY; y <= maxY; y++) {
+		for (int x = minX; x <= maxX; x++) {
+			if (IsCellVisible(fromCell, y * static_cast<int>(mHeader.mCellsX) + x)) return true;
+		}
+	}
+	return false;
+}
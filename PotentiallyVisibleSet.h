@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "Math.h"
+
+// Precomputed cell-to-cell visibility of a level (baked offline by PvsBaker).
+// The level is split in a grid of vertical columns (cells) on the xy plane. For every cell a bitset stores
+// which cells can be seen from somewhere inside it, so culling an actor is a bit lookup
+class PotentiallyVisibleSet {
+public:
+	// Header at the start of a .pvs file, followed by NumCells bitsets of WordsPerCell 32 bit words
+	struct FileHeader {
+		uint32_t mMagic;
+		uint32_t mVersion;
+		// Hash of the occluder triangles the file was baked from (see HashGeometry)
+		uint64_t mGeometryHash;
+		// Corner of the grid with the smallest coordinates and size of a cell
+		float mOrigin[2];
+		float mCellSize;
+		// Height range covered by the cells (where the camera can be)
+		float mMinZ;
+		float mMaxZ;
+		// Cells along x and y
+		uint32_t mCellsX;
+		uint32_t mCellsY;
+	};
+	// "PVS1"
+	static const uint32_t FileMagic = 0x31535650;
+	static const uint32_t FileVersion = 2;
+
+	PotentiallyVisibleSet();
+
+	// Load a file written by PvsBaker. Return false if the file is missing or invalid, or if it was baked from
+	// other geometry than the one of geometryHash (the level changed since the last bake)
+	bool Load(const std::string& fileName, uint64_t geometryHash);
+	// Hash (FNV-1a) of the world space positions of the occluder triangles
+	static uint64_t HashGeometry(const std::vector<Vector3>& triangles);
+
+	// Cell that contains the position, -1 outside the grid
+	int GetCell(const Vector3& position) const;
+	// Bit lookup: can toCell be seen from fromCell
+	bool IsCellVisible(int fromCell, int toCell) const;
+	// Return false if none of the cells overlapped by the sphere can be seen from fromCell.
+	// Everything is visible from outside the grid, and spheres outside the grid are always visible
+	bool IsVisible(int fromCell, const Vector3& center, float radius) const;
+
+	unsigned int GetNumCells() const { return mHeader.mCellsX * mHeader.mCellsY; }
+	// Number of 32 bit words in the bitset of a cell
+	static unsigned int GetWordsPerCell(unsigned int numCells) { return (numCells + 31) / 32; }
+
+private:
+	FileHeader mHeader;
+	unsigned int mWordsPerCell;
+	// Bitsets of all the cells, one after the other
+	std::vector<uint32_t> mBits;
+};
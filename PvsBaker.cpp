@@ -0,0 +1,188 @@
+#include "PvsBaker.h"
+#include "PotentiallyVisibleSet.h"
+#include "JobSystem.h"
+#include <fstream>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <SDL_log.h>
+
+const float PvsBaker::DefaultCellSize = 250.f;
+
+namespace {
+	// Triangles of the level binned in the cells their xy bounds overlap, so a segment only tests the
+	// triangles of the cells it crosses
+	class BakeScene {
+	public:
+		BakeScene(const std::vector<Vector3>& triangles, float originX, float originY, float cellSize, int cellsX, int cellsY) :
+			mTriangles(triangles),
+			mOriginX(originX),
+			mOriginY(originY),
+			mCellSize(cellSize),
+			mCellsX(cellsX),
+			mCellsY(cellsY),
+			mBins(cellsX * cellsY)
+		{
+			for (unsigned int t = 0; t + 2 < mTriangles.size(); t += 3) {
+				const Vector3& a = mTriangles[t];
+				const Vector3& b = mTriangles[t + 1];
+				const Vector3& c = mTriangles[t + 2];
+				int minX = CellX(Math::Min(a.x, Math::Min(b.x, c.x)));
+				int maxX = CellX(Math::Max(a.x, Math::Max(b.x, c.x)));
+				int minY = CellY(Math::Min(a.y, Math::Min(b.y, c.y)));
+				int maxY = CellY(Math::Max(a.y, Math::Max(b.y, c.y)));
+				for (int y = minY; y <= maxY; y++) {
+					for (int x = minX; x <= maxX; x++) {
+						mBins[y * mCellsX + x].emplace_back(t);
+					}
+				}
+			}
+		}
+
+		int CellX(float x) const { return Math::Clamp(static_cast<int>(std::floor((x - mOriginX) / mCellSize)), 0, mCellsX - 1); }
+		int CellY(float y) const { return Math::Clamp(static_cast<int>(std::floor((y - mOriginY) / mCellSize)), 0, mCellsY - 1); }
+
+		// Walk the cells crossed by the segment on the xy plane (2D DDA) and test their triangles
+		bool IsBlocked(const Vector3& start, const Vector3& end) const {
+			const Vector3 dir = end - start;
+			int x = CellX(start.x);
+			int y = CellY(start.y);
+			const int endX = CellX(end.x);
+			const int endY = CellY(end.y);
+			const int stepX = dir.x > 0.f ? 1 : -1;
+			const int stepY = dir.y > 0.f ? 1 : -1;
+			// Segment parameter where the next cell boundary on x/y is crossed, and between two boundaries
+			float nextX = dir.x != 0.f ? ((x + (stepX > 0 ? 1 : 0)) * mCellSize + mOriginX - start.x) / dir.x : Math::Infinity;
+			float nextY = dir.y != 0.f ? ((y + (stepY > 0 ? 1 : 0)) * mCellSize + mOriginY - start.y) / dir.y : Math::Infinity;
+			const float deltaX = dir.x != 0.f ? mCellSize / Math::Abs(dir.x) : Math::Infinity;
+			const float deltaY = dir.y != 0.f ? mCellSize / Math::Abs(dir.y) : Math::Infinity;
+			for (int steps = mCellsX + mCellsY; steps >= 0; steps--) {
+				for (unsigned int t : mBins[y * mCellsX + x]) {
+					if (Intersect(start, dir, mTriangles[t], mTriangles[t + 1], mTriangles[t + 2])) return true;
+				}
+				if (x == endX && y == endY) break;
+				if (nextX < nextY) {
+					x += stepX;
+					nextX += deltaX;
+				}
+				else {
+					y += stepY;
+					nextY += deltaY;
+				}
+				if (x < 0 || y < 0 || x >= mCellsX || y >= mCellsY) break;
+			}
+			return false;
+		}
+
+	private:
+		// Segment start + dir * t, t in (0, 1), against a double sided triangle (Moller-Trumbore)
+		static bool Intersect(const Vector3& start, const Vector3& dir, const Vector3& a, const Vector3& b, const Vector3& c) {
+			const float Epsilon = 1e-6f;
+			const Vector3 edge1 = b - a;
+			const Vector3 edge2 = c - a;
+			const Vector3 p = Vector3::Cross(dir, edge2);
+			const float det = Vector3::Dot(edge1, p);
+			if (Math::Abs(det) < Epsilon) return false;
+			const float invDet = 1.f / det;
+			const Vector3 s = start - a;
+			const float u = Vector3::Dot(s, p) * invDet;
+			if (u < 0.f || u > 1.f) return false;
+			const Vector3 q = Vector3::Cross(s, edge1);
+			const float v = Vector3::Dot(dir, q) * invDet;
+			if (v < 0.f || u + v > 1.f) return false;
+			const float t = Vector3::Dot(edge2, q) * invDet;
+			return t > Epsilon && t < 1.f - Epsilon;
+		}
+
+		const std::vector<Vector3>& mTriangles;
+		float mOriginX;
+		float mOriginY;
+		float mCellSize;
+		int mCellsX;
+		int mCellsY;
+		// First vertex of the triangles overlapping each cell
+		std::vector<std::vector<unsigned int>> mBins;
+	};
+}
+
+bool PvsBaker::Bake(const std::vector<Vector3>& triangles, float cellSize, float minZ, float maxZ,
+	unsigned int raysPerPair, const std::string& fileName) {
+	if (triangles.size() < 3 || cellSize <= 0.f || maxZ <= minZ) {
+		SDL_Log("PVS %s: nothing to bake", fileName.c_str());
+		return false;
+	}
+
+	// The grid covers the xy bounds of the level
+	float minX = Math::Infinity, minY = Math::Infinity;
+	float maxX = -Math::Infinity, maxY = -Math::Infinity;
+	for (const Vector3& v : triangles) {
+		minX = Math::Min(minX, v.x);
+		minY = Math::Min(minY, v.y);
+		maxX = Math::Max(maxX, v.x);
+		maxY = Math::Max(maxY, v.y);
+	}
+	PotentiallyVisibleSet::FileHeader header;
+	header.mMagic = PotentiallyVisibleSet::FileMagic;
+	header.mVersion = PotentiallyVisibleSet::FileVersion;
+	header.mGeometryHash = PotentiallyVisibleSet::HashGeometry(triangles);
+	header.mOrigin[0] = minX;
+	header.mOrigin[1] = minY;
+	header.mCellSize = cellSize;
+	header.mMinZ = minZ;
+	header.mMaxZ = maxZ;
+	header.mCellsX = static_cast<uint32_t>(Math::Max(1.f, std::ceil((maxX - minX) / cellSize)));
+	header.mCellsY = static_cast<uint32_t>(Math::Max(1.f, std::ceil((maxY - minY) / cellSize)));
+	const int cellsX = static_cast<int>(header.mCellsX);
+	const int cellsY = static_cast<int>(header.mCellsY);
+	const unsigned int numCells = header.mCellsX * header.mCellsY;
+	const unsigned int wordsPerCell = PotentiallyVisibleSet::GetWordsPerCell(numCells);
+
+	BakeScene scene(triangles, minX, minY, cellSize, cellsX, cellsY);
+	std::vector<uint32_t> bits(static_cast<size_t>(numCells) * wordsPerCell, 0);
+
+	// Each job owns the bitsets of its source cells and only tests the cells after them,
+	// the other half of the matrix is mirrored afterwards
+	JobSystem::ParallelFor(numCells, 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int from = begin; from < end; from++) {
+			// Seed with the cell, so the result does not depend on how the cells are split across threads
+			std::mt19937 generator(from);
+			std::uniform_real_distribution<float> unit(0.f, 1.f);
+			const int fromX = static_cast<int>(from) % cellsX;
+			const int fromY = static_cast<int>(from) / cellsX;
+			uint32_t* row = &bits[static_cast<size_t>(from) * wordsPerCell];
+			for (unsigned int to = from; to < numCells; to++) {
+				const int toX = static_cast<int>(to) % cellsX;
+				const int toY = static_cast<int>(to) / cellsX;
+				// Neighbour cells always see each other: the sampling can miss a gap along their shared border
+				bool visible = std::abs(toX - fromX) <= 1 && std::abs(toY - fromY) <= 1;
+				for (unsigned int ray = 0; ray < raysPerPair && !visible; ray++) {
+					Vector3 start(minX + (fromX + unit(generator)) * cellSize, minY + (fromY + unit(generator)) * cellSize, minZ + unit(generator) * (maxZ - minZ));
+					Vector3 end(minX + (toX + unit(generator)) * cellSize, minY + (toY + unit(generator)) * cellSize, minZ + unit(generator) * (maxZ - minZ));
+					visible = !scene.IsBlocked(start, end);
+				}
+				if (visible) row[to >> 5] |= 1u << (to & 31);
+			}
+		}
+	});
+	unsigned int numVisible = 0;
+	for (unsigned int from = 0; from < numCells; from++) {
+		for (unsigned int to = from; to < numCells; to++) {
+			if (bits[static_cast<size_t>(from) * wordsPerCell + (to >> 5)] & (1u << (to & 31))) {
+				bits[static_cast<size_t>(to) * wordsPerCell + (from >> 5)] |= 1u << (from & 31);
+				numVisible += from == to ? 1 : 2;
+			}
+		}
+	}
+
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open()) {
+		SDL_Log("Failed to write PVS %s", fileName.c_str());
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(bits.data()), bits.size() * sizeof(uint32_t));
+	SDL_Log("Baked PVS %s: %u x %u cells, %u triangles, %.1f%% of the cells visible on average",
+		fileName.c_str(), header.mCellsX, header.mCellsY, static_cast<unsigned int>(triangles.size() / 3),
+		100.f * numVisible / (static_cast<float>(numCells) * numCells));
+	return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "Math.h"
+
+// Offline computation of the potentially visible sets of a level (see PotentiallyVisibleSet), run from the command line (see Main.cpp)
+class PvsBaker {
+public:
+	// Split the xy bounds of the triangles (3 world space positions each) in columns of cellSize between minZ and maxZ
+	// and write to fileName which cells can see each other. Two cells see each other if at least one of raysPerPair
+	// random segments between them is not blocked by a triangle. The work is split by cell across the job system
+	static bool Bake(const std::vector<Vector3>& triangles, float cellSize, float minZ, float maxZ,
+		unsigned int raysPerPair, const std::string& fileName);
+
+	// Default size of a cell (the spacing of the floor and wall tiles)
+	static const float DefaultCellSize;
+	// Default number of random segments tested between two cells
+	static const unsigned int DefaultRaysPerPair = 64;
+};
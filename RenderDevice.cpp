@@ -0,0 +1,52 @@
+#include "RenderDevice.h"
+#include "GLRenderDevice.h"
+#include "NullRenderDevice.h"
+
+RenderDevice* RenderDevice::sDevice = nullptr;
+
+DeviceCounters& DeviceCounters::operator+=(const DeviceCounters& other) {
+	mDraws += other.mDraws;
+	mTriangles += other.mTriangles;
+	mProgramBinds += other.mProgramBinds;
+	mVertexArrayBinds += other.mVertexArrayBinds;
+	mTextureBinds += other.mTextureBinds;
+	mUniformUploads += other.mUniformUploads;
+	mBufferBytes += other.mBufferBytes;
+	mStateChanges += other.mStateChanges;
+	mSkippedStateChanges += other.mSkippedStateChanges;
+	return *this;
+}
+
+RenderDevice::RenderDevice() :
+	mCounters{},
+	mFrameCounters{}
+{}
+
+RenderDevice::~RenderDevice() {
+	if (sDevice == this) sDevice = nullptr;
+}
+
+void RenderDevice::EndFrameCounters() {
+	mFrameCounters = mCounters;
+	mCounters = DeviceCounters{};
+}
+
+ProgramHandle RenderDevice::CreateProgram(const std::string& vertexSource, const std::string& fragmentSource, std::string& outError) {
+	ProgramHandle program = BeginProgram(vertexSource, fragmentSource);
+	if (!program || !FinishProgram(program, outError)) return 0;
+	return program;
+}
+
+RenderDevice* RenderDevice::Create(RenderBackend backend) {
+	RenderDevice* device = nullptr;
+	switch (backend) {
+	case ENullBackend:
+		device = new NullRenderDevice();
+		break;
+	default:
+		device = new GLRenderDevice();
+		break;
+	}
+	sDevice = device;
+	return device;
+}
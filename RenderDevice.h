@@ -0,0 +1,263 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Implementations of the render device, chosen at startup
+enum RenderBackend {
+	// OpenGL 3.3 core profile, drawing in a SDL window
+	EOpenGLBackend,
+	// No window and no GPU: commands are validated and counted (headless benchmarks and regression runs)
+	ENullBackend
+};
+
+// Handles of the objects created by the device. 0 is never a valid object
+typedef unsigned int BufferHandle;
+typedef unsigned int TextureHandle;
+typedef unsigned int VertexArrayHandle;
+typedef unsigned int ProgramHandle;
+typedef unsigned int QueryHandle;
+typedef unsigned int FenceHandle;
+typedef unsigned int RenderTargetHandle;
+
+// What a buffer holds. Any buffer can be updated and copied, the type tells how the draws read it
+enum BufferType {
+	EVertexBuffer,
+	EIndexBuffer,
+	EUniformBuffer,
+	ETextureBuffer,
+	// Texels copied to the textures (see SetPixelUnpackBuffer)
+	EPixelUnpackBuffer,
+	// Per-frame data copied to the other buffers (see RingBuffer)
+	EStagingBuffer
+};
+
+// How often the content of a buffer changes
+enum BufferUsage {
+	// Written once, drawn many times
+	EStaticBuffer,
+	// Rewritten every few frames
+	EDynamicBuffer,
+	// Rewritten every frame
+	EStreamBuffer
+};
+
+// Format of the texels of a texture buffer
+enum TexelFormat {
+	ETexelRGBA32F,
+	ETexelRG32UI,
+	ETexelR16UI
+};
+
+// Format of the texels of a 2D texture created with its mip levels
+enum TextureFormat {
+	// 8 bit per channel, uncompressed
+	ETextureRGBA8,
+	// Block compressed, 4x4 texels per block: 8 bytes (opaque color) or 16 bytes (color + alpha)
+	ETextureBC1,
+	ETextureBC3
+};
+
+// One mip level of a texture
+struct TextureLevel {
+	int mWidth;
+	int mHeight;
+	const void* mData;
+	unsigned int mSize;
+};
+
+// Type of the values passed to SetUniform
+enum UniformType {
+	EUniformFloat,
+	EUniformInt,
+	EUniformVec3,
+	// Row major 4x4 matrices (Matrix4)
+	EUniformMat4
+};
+
+// Uniform of a linked program that is set with SetUniform (members of uniform blocks are not listed)
+struct ProgramUniform {
+	// Name as reported by the backend (arrays may end with "[0]")
+	std::string mName;
+	// Location to pass to SetUniform
+	int mLocation;
+	// Number of array elements (1 if not an array)
+	unsigned int mCount;
+	// Size in bytes of one element
+	unsigned int mElementSize;
+};
+
+// Comparison of the depth test: passes if the fragment is closer (less), or as close (less or equal, to draw over
+// the depth of a pre-pass)
+enum DepthFunc {
+	ELessDepth,
+	ELessEqualDepth
+};
+
+// Fixed function state of the draws. Blending is standard alpha blending, culling removes the back faces
+// (counter-clockwise front faces). Depth and color writes can be turned off (depth-only pass, or pass drawing
+// over the depth of a previous one)
+struct PipelineState {
+	bool mDepthTest;
+	bool mBlend;
+	bool mCullBackFaces;
+	bool mDepthWrite;
+	bool mColorWrite;
+	DepthFunc mDepthFunc;
+};
+
+// Commands sent to the device during a frame
+struct DeviceCounters {
+	uint64_t mDraws;
+	uint64_t mTriangles;
+	uint64_t mProgramBinds;
+	uint64_t mVertexArrayBinds;
+	uint64_t mTextureBinds;
+	uint64_t mUniformUploads;
+	// Bytes copied from the CPU into buffers and textures (the writes to mapped buffers are not seen by the device)
+	uint64_t mBufferBytes;
+	uint64_t mStateChanges;
+	// Binds and state changes skipped because the device state already matched
+	uint64_t mSkippedStateChanges;
+
+	DeviceCounters& operator+=(const DeviceCounters& other);
+};
+
+// Rendering hardware interface: the only place that talks to the graphics API.
+// Resources are created, used and destroyed by the thread that holds the device context
+// (the render thread once it is started, see Renderer::StartRenderThread)
+class RenderDevice {
+public:
+	virtual ~RenderDevice();
+
+	// Create the device for the given backend and make it the current one. Initialize must be called before use
+	static RenderDevice* Create(RenderBackend backend);
+	// Device used by the resources (Shader, Texture, ...). nullptr before Create and after the device is deleted
+	static RenderDevice* Get() { return sDevice; }
+
+	// Open the window (if any) and create the context. Return false on failure
+	virtual bool Initialize(const std::string& title, int width, int height) = 0;
+	virtual void Shutdown() = 0;
+	// Make the context current on the calling thread, or release it so another thread can acquire it
+	virtual void AcquireContext() = 0;
+	virtual void ReleaseContext() = 0;
+	// Show the frame
+	virtual void Present() = 0;
+	virtual RenderBackend GetBackend() const = 0;
+	// Driver identification (vendor, renderer and version). Program binaries are only valid for the same driver
+	virtual std::string GetDriverId() const = 0;
+
+	// Buffers. data may be nullptr (content undefined until updated)
+	virtual BufferHandle CreateBuffer(BufferType type, unsigned int size, const void* data, BufferUsage usage) = 0;
+	virtual void DestroyBuffer(BufferHandle buffer) = 0;
+	// Replace the storage of the buffer, keeping its handle (and the textures reading from it). The content is lost
+	virtual void ResizeBuffer(BufferHandle buffer, unsigned int size, BufferUsage usage) = 0;
+	virtual void UpdateBuffer(BufferHandle buffer, unsigned int offset, unsigned int size, const void* data) = 0;
+	virtual void CopyBuffer(BufferHandle source, unsigned int sourceOffset, BufferHandle dest, unsigned int destOffset, unsigned int size) = 0;
+	// Attach a uniform buffer to a binding point of the uniform blocks
+	virtual void BindUniformBuffer(BufferHandle buffer, unsigned int bindingPoint) = 0;
+	// Attach size bytes of a uniform buffer from offset, a multiple of GetUniformBufferAlignment
+	virtual void BindUniformBufferRange(BufferHandle buffer, unsigned int bindingPoint, unsigned int offset, unsigned int size) = 0;
+	virtual unsigned int GetUniformBufferAlignment() const = 0;
+	// Buffer whose storage stays mapped for its whole life (persistent, coherent mapping): the CPU writes through
+	// outData while the GPU reads other ranges. Return 0 if the device can't map persistently. It can't be resized
+	virtual BufferHandle CreateMappedBuffer(BufferType type, unsigned int size, void** outData) = 0;
+	// Map a range of a buffer for writing without waiting for the GPU (the caller makes sure with fences that the GPU
+	// doesn't read the range anymore). The previous content of the range is lost. The buffer can't be used by the
+	// device until it is unmapped
+	virtual void* MapBufferRange(BufferHandle buffer, unsigned int offset, unsigned int size) = 0;
+	virtual void UnmapBuffer(BufferHandle buffer) = 0;
+
+	// Textures. 2D textures have 3 (RGB) or 4 (RGBA) 8 bit channels and bilinear filtering
+	virtual TextureHandle CreateTexture2D(int width, int height, int channels, const void* pixels) = 0;
+	// Texture with a chain of mip levels (levels[0] is the full size one), trilinear filtering
+	virtual TextureHandle CreateTextureMips(TextureFormat format, const std::vector<TextureLevel>& levels) = 0;
+	// Replace the levels of a texture made by CreateTextureMips (texture streaming). The handle stays the same and the
+	// memory of the old levels is released
+	virtual bool UpdateTextureMips(TextureHandle texture, TextureFormat format, const std::vector<TextureLevel>& levels) = 0;
+	// Array of 2D textures of the same size, format and number of levels (sampler2DArray in the shaders), trilinear
+	// filtering. layers[i] is the mip chain of layer i
+	virtual TextureHandle CreateTextureArray(TextureFormat format, const std::vector<std::vector<TextureLevel>>& layers) = 0;
+	// The texture format can be sampled (block compressed formats need the S3TC extension)
+	virtual bool SupportsTextureFormat(TextureFormat format) const = 0;
+	// Texture reading its texels from a buffer (samplerBuffer in the shaders)
+	virtual TextureHandle CreateBufferTexture(BufferHandle buffer, TexelFormat format) = 0;
+	// While a pixel unpack buffer is set (0: none), the texel pointers given to CreateTexture2D, CreateTextureMips and
+	// UpdateTextureMips are byte offsets in it, and the copy to the texture doesn't stall the caller
+	virtual void SetPixelUnpackBuffer(BufferHandle buffer) = 0;
+	virtual void DestroyTexture(TextureHandle texture) = 0;
+	virtual void BindTexture(TextureHandle texture, unsigned int unit) = 0;
+
+	// Vertex arrays: vertices with the given layout and 16 or 32 bit indices. The new vertex array is left bound
+	virtual VertexArrayHandle CreateVertexArray(const class VertexLayout& layout, BufferHandle vertices, BufferHandle indices) = 0;
+	virtual void DestroyVertexArray(VertexArrayHandle vertexArray) = 0;
+	virtual void BindVertexArray(VertexArrayHandle vertexArray) = 0;
+
+	// Programs. Return 0 and the compiler/linker messages in outError on failure
+	ProgramHandle CreateProgram(const std::string& vertexSource, const std::string& fragmentSource, std::string& outError);
+	// Two steps creation: BeginProgram issues the compile and link without waiting for them, FinishProgram waits
+	// and checks the result (the program is destroyed on failure). Beginning all the programs before finishing
+	// any lets the driver compile them in parallel
+	virtual ProgramHandle BeginProgram(const std::string& vertexSource, const std::string& fragmentSource) = 0;
+	virtual bool FinishProgram(ProgramHandle program, std::string& outError) = 0;
+	// Linked program as a driver specific binary, and program created back from it.
+	// Return false/0 if binaries are not supported or the driver rejects the binary (e.g. after a driver update)
+	virtual bool GetProgramBinary(ProgramHandle program, uint32_t& outFormat, std::vector<unsigned char>& outBinary) = 0;
+	virtual ProgramHandle CreateProgramFromBinary(uint32_t format, const std::vector<unsigned char>& binary) = 0;
+	virtual void DestroyProgram(ProgramHandle program) = 0;
+	virtual void UseProgram(ProgramHandle program) = 0;
+	virtual void GetProgramUniforms(ProgramHandle program, std::vector<ProgramUniform>& outUniforms) = 0;
+	// Connect a uniform block of the program to a binding point. Return false if the program doesn't declare the block
+	virtual bool BindUniformBlock(ProgramHandle program, const std::string& blockName, unsigned int bindingPoint) = 0;
+	// Set count elements of a uniform of the program in use
+	virtual void SetUniform(int location, UniformType type, unsigned int count, const void* data) = 0;
+
+	// Render targets: offscreen color (RGBA8) and depth buffers of the given size, drawn to instead of the window
+	virtual RenderTargetHandle CreateRenderTarget(int width, int height) = 0;
+	virtual void DestroyRenderTarget(RenderTargetHandle target) = 0;
+	// Target of the draws and clears (0: the window)
+	virtual void BindRenderTarget(RenderTargetHandle target) = 0;
+	// Copy the color of the bottom left sourceWidth x sourceHeight pixels of the target to the whole window
+	// (width x height), with bilinear filtering. The window becomes the bound target
+	virtual void BlitToWindow(RenderTargetHandle source, int sourceWidth, int sourceHeight, int width, int height) = 0;
+
+	// Draws
+	virtual void SetPipelineState(const PipelineState& state) = 0;
+	// Area of the window the draws go to, in pixels from the bottom left corner
+	virtual void SetViewport(int x, int y, int width, int height) = 0;
+	// Clear the color buffer to the given color and the depth buffer (whatever the writes of the pipeline state)
+	virtual void Clear(float red, float green, float blue, float alpha) = 0;
+	// Draw count indices (triangle list) of the bound vertex array. indexSize is 2 or 4, indexOffset is in bytes,
+	// baseVertex is added to every index
+	virtual void DrawIndexed(unsigned int count, unsigned int indexSize, unsigned int indexOffset, int baseVertex) = 0;
+
+	// GPU timer queries: measure the GPU time of the commands between Begin and End. Only one query can be running.
+	// The result is ready a few frames later: GetTimerQueryResult never waits and returns false until then
+	virtual QueryHandle CreateTimerQuery() = 0;
+	virtual void DestroyTimerQuery(QueryHandle query) = 0;
+	virtual void BeginTimerQuery(QueryHandle query) = 0;
+	virtual void EndTimerQuery() = 0;
+	virtual bool GetTimerQueryResult(QueryHandle query, uint64_t& outNanoseconds) = 0;
+
+	// Fences: signaled once the GPU has executed the commands sent before InsertFence
+	virtual FenceHandle InsertFence() = 0;
+	// Wait until the fence is signaled, at most timeoutNanoseconds. Return false if it is not signaled
+	virtual bool WaitFence(FenceHandle fence, uint64_t timeoutNanoseconds) = 0;
+	virtual void DestroyFence(FenceHandle fence) = 0;
+
+	// Commands of the last presented frame
+	const DeviceCounters& GetFrameCounters() const { return mFrameCounters; }
+
+protected:
+	RenderDevice();
+	// Called by Present: the counters of the frame become the frame counters and restart from zero
+	void EndFrameCounters();
+
+	// Commands of the current frame, incremented by the backends
+	DeviceCounters mCounters;
+	DeviceCounters mFrameCounters;
+
+private:
+	// Current device
+	static RenderDevice* sDevice;
+};
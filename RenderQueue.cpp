@@ -0,0 +1,169 @@
+#include "RenderQueue.h"
+#include "MeshComponent.h"
+#include "SpriteComponent.h"
+#include "StaticBatch.h"
+#include "Actor.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "PotentiallyVisibleSet.h"
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "ShaderPermutations.h"
+#include <algorithm>
+
+RenderQueue::RenderQueue() :
+	mContext{ Matrix4::Identity, 1.f, 1.f, 0.f, 1.f, nullptr, -1, nullptr, 0 },
+	mTrianglesSubmitted(0),
+	mTrianglesFullDetail(0)
+{}
+
+RenderQueue::~RenderQueue() {
+	for (auto list : mLists) {
+		delete list;
+	}
+}
+
+void RenderQueue::BeginFrame(const RecordContext& context) {
+	mContext = context;
+	mSlices.clear();
+	mPackets.clear();
+	mTextureRequests.clear();
+	mTrianglesSubmitted = 0;
+	mTrianglesFullDetail = 0;
+}
+
+void RenderQueue::AddMeshes(ShaderPermutations* shader, unsigned int shaderIndex, const std::vector<MeshComponent*>& meshes) {
+	for (unsigned int begin = 0; begin < meshes.size(); begin += SliceSize) {
+		unsigned int end = std::min(begin + SliceSize, static_cast<unsigned int>(meshes.size()));
+		mSlices.emplace_back(Slice{ shader, shaderIndex, meshes.data(), nullptr, nullptr, begin, end });
+	}
+}
+
+void RenderQueue::AddBatches(ShaderPermutations* shader, unsigned int shaderIndex, const std::vector<StaticBatch*>& batches) {
+	for (unsigned int begin = 0; begin < batches.size(); begin += SliceSize) {
+		unsigned int end = std::min(begin + SliceSize, static_cast<unsigned int>(batches.size()));
+		mSlices.emplace_back(Slice{ shader, shaderIndex, nullptr, batches.data(), nullptr, begin, end });
+	}
+}
+
+void RenderQueue::AddSprites(ShaderPermutations* shader, const std::vector<SpriteComponent*>& sprites) {
+	for (unsigned int begin = 0; begin < sprites.size(); begin += SliceSize) {
+		unsigned int end = std::min(begin + SliceSize, static_cast<unsigned int>(sprites.size()));
+		mSlices.emplace_back(Slice{ shader, 0, nullptr, nullptr, sprites.data(), begin, end });
+	}
+}
+
+void RenderQueue::Record() {
+	while (mLists.size() < mSlices.size()) {
+		mLists.emplace_back(new CommandList());
+	}
+	// Every slice writes its own list: no locks while recording
+	JobSystem::ParallelFor(static_cast<unsigned int>(mSlices.size()), 1, [this](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++) {
+			mLists[i]->Reset();
+			RecordSlice(mSlices[i], *mLists[i]);
+			mLists[i]->Sort();
+		}
+	});
+
+	// The lists are sorted: merge them in a single pass, taking the smallest head of the lists from a min-heap.
+	// Equal keys keep the order of the slices
+	size_t numPackets = 0;
+	mMergeHeap.clear();
+	for (unsigned int i = 0; i < mSlices.size(); i++) {
+		const std::vector<DrawPacket>& packets = mLists[i]->GetPackets();
+		numPackets += packets.size();
+		if (!packets.empty()) mMergeHeap.emplace_back(MergeHead{ packets[0].mSortKey, i, 0 });
+		const std::vector<TextureRequest>& requests = mLists[i]->GetTextureRequests();
+		mTextureRequests.insert(mTextureRequests.end(), requests.begin(), requests.end());
+		mTrianglesSubmitted += mLists[i]->GetTrianglesSubmitted();
+		mTrianglesFullDetail += mLists[i]->GetTrianglesFullDetail();
+	}
+	mPackets.reserve(numPackets);
+	// std heaps keep the largest element on top: "greater" puts the smallest head there
+	auto greater = [](const MergeHead& a, const MergeHead& b) {
+		return a.mSortKey != b.mSortKey ? a.mSortKey > b.mSortKey : a.mList > b.mList;
+	};
+	std::make_heap(mMergeHeap.begin(), mMergeHeap.end(), greater);
+	while (!mMergeHeap.empty()) {
+		std::pop_heap(mMergeHeap.begin(), mMergeHeap.end(), greater);
+		MergeHead& head = mMergeHeap.back();
+		const std::vector<DrawPacket>& packets = mLists[head.mList]->GetPackets();
+		mPackets.emplace_back(packets[head.mIndex]);
+		if (++head.mIndex < packets.size()) {
+			head.mSortKey = packets[head.mIndex].mSortKey;
+			std::push_heap(mMergeHeap.begin(), mMergeHeap.end(), greater);
+		}
+		else {
+			mMergeHeap.pop_back();
+		}
+	}
+}
+
+void RenderQueue::RecordSlice(const Slice& slice, CommandList& list) {
+	for (unsigned int i = slice.mBegin; i < slice.mEnd; i++) {
+		if (slice.mMeshes) {
+			MeshComponent* mc = slice.mMeshes[i];
+			// Static meshes are drawn by the batches
+			if (mc->IsBatched() || !mc->GetMesh()) continue;
+			// Skip the meshes in cells the camera can't see, then the meshes hidden by the occluders
+			Actor* owner = mc->GetOwner();
+			const float radius = mc->GetMesh()->GetRadius() * owner->GetActorScale();
+			if (!IsVisible(owner->GetActorPosition(), radius)) continue;
+			// Pick the level of detail from the projected size of the mesh
+			mc->UpdateLod(mContext.mView, mContext.mYScale, mContext.mNearPlane, mContext.mLodHysteresis);
+			unsigned int shaderIndex = 0;
+			Texture* texture = mc->GetMesh()->GetTexture(mc->GetTextureIndex());
+			Shader* shader = SelectShader(slice, (mc->GetMesh()->IsSkinned() ? ESkinningFeature : 0) | GetTextureFeatures(texture), shaderIndex);
+			mc->Record(list, shader, shaderIndex, GetViewDepth(owner->GetActorPosition()));
+			RequestTextureLevel(list, texture, owner->GetActorPosition(), radius);
+		}
+		else if (slice.mBatches) {
+			StaticBatch* batch = slice.mBatches[i];
+			if (!IsVisible(batch->GetCenter(), batch->GetRadius())) continue;
+			unsigned int shaderIndex = 0;
+			Shader* shader = SelectShader(slice, GetTextureFeatures(batch->GetMesh()->GetTexture(0)), shaderIndex);
+			batch->Record(list, shader, shaderIndex, GetViewDepth(batch->GetCenter()));
+			RequestTextureLevel(list, batch->GetMesh()->GetTexture(0), batch->GetCenter(), batch->GetRadius());
+		}
+		else {
+			unsigned int shaderIndex = 0;
+			slice.mSprites[i]->Record(list, SelectShader(slice, GetTextureFeatures(slice.mSprites[i]->GetTexture()), shaderIndex), i);
+			// Sprites are drawn at the size of their texture
+			if (slice.mSprites[i]->GetTexture()) list.AddTextureRequest(slice.mSprites[i]->GetTexture(), 0);
+		}
+	}
+}
+
+Shader* RenderQueue::SelectShader(const Slice& slice, unsigned int features, unsigned int& outShaderIndex) const {
+	unsigned int variant = slice.mShader->GetVariantIndex(mContext.mShaderFeatures | features);
+	outShaderIndex = slice.mShaderIndex + variant;
+	return slice.mShader->GetVariant(variant);
+}
+
+unsigned int RenderQueue::GetTextureFeatures(const Texture* texture) {
+	return texture && texture->GetArray() ? ETextureArrayFeature : 0;
+}
+
+bool RenderQueue::IsVisible(const Vector3& center, float radius) const {
+	if (mContext.mPvs && !mContext.mPvs->IsVisible(mContext.mCameraCell, center, radius)) return false;
+	if (mContext.mOcclusionCuller && !mContext.mOcclusionCuller->IsVisible(center, radius)) return false;
+	return true;
+}
+
+float RenderQueue::GetViewDepth(const Vector3& position) const {
+	return Vector3::Transform(position, mContext.mView).z;
+}
+
+void RenderQueue::RequestTextureLevel(CommandList& list, Texture* texture, const Vector3& center, float radius) const {
+	if (!texture || !texture->IsStreamable()) return;
+	const float depth = GetViewDepth(center);
+	if (depth - radius <= mContext.mNearPlane) {
+		list.AddTextureRequest(texture, 0);
+		return;
+	}
+	// Diameter of the projected sphere in pixels. One level finer than that size: the texture coordinates rarely map
+	// the texture exactly once across the bounds
+	const float pixels = radius * mContext.mYScale / depth * mContext.mScreenHeight;
+	list.AddTextureRequest(texture, texture->GetLevelForSize(static_cast<int>(pixels * 2.f)));
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include "Math.h"
+#include "CommandList.h"
+
+// Camera and culling state of the frame, read by the recording jobs
+struct RecordContext {
+	// Camera view matrix, vertical scale of the projection and near plane (level of detail selection)
+	Matrix4 mView;
+	float mYScale;
+	float mNearPlane;
+	float mLodHysteresis;
+	// Height of the screen in pixels (mip level of the textures)
+	float mScreenHeight;
+	// Cell to cell visibility and cell of the camera (nullptr/-1: no cell culling)
+	const class PotentiallyVisibleSet* mPvs;
+	int mCameraCell;
+	// Software depth buffer of the occluders (nullptr: no occlusion culling)
+	class OcclusionCuller* mOcclusionCuller;
+	// Shader features used by the whole frame (ShaderFeature mask). The mesh features are added to them
+	unsigned int mShaderFeatures;
+};
+
+// Records the draw packets of a frame on the job system threads.
+// The mesh components, batches and sprites to draw are split in slices of at most SliceSize items, each slice
+// culls its items, selects their level of detail and writes packets in its own command list. The lists are then
+// merged in a single list sorted by key, that the GL thread executes. No OpenGL call is made here
+class RenderQueue {
+public:
+	// Maximum number of items recorded by one job
+	static const unsigned int SliceSize = 64;
+
+	RenderQueue();
+	~RenderQueue();
+
+	// Start a new frame: forget the slices and packets of the previous one
+	void BeginFrame(const RecordContext& context);
+	// Queue items to record. The vectors must not change until Record returns.
+	// The variant of the shader is picked for each item; variant i is sorted with the index shaderIndex + i
+	void AddMeshes(class ShaderPermutations* shader, unsigned int shaderIndex, const std::vector<class MeshComponent*>& meshes);
+	void AddBatches(class ShaderPermutations* shader, unsigned int shaderIndex, const std::vector<class StaticBatch*>& batches);
+	void AddSprites(class ShaderPermutations* shader, const std::vector<class SpriteComponent*>& sprites);
+	// Record all the queued slices in parallel, then merge the command lists
+	void Record();
+
+	// Packets of the frame, sorted by key
+	const std::vector<DrawPacket>& GetPackets() const { return mPackets; }
+	unsigned int GetTrianglesSubmitted() const { return mTrianglesSubmitted; }
+	unsigned int GetTrianglesFullDetail() const { return mTrianglesFullDetail; }
+	// Mip levels of the textures drawn by the packets (a texture can be asked for several times)
+	const std::vector<TextureRequest>& GetTextureRequests() const { return mTextureRequests; }
+
+private:
+	// Range of items recorded by one job into one command list
+	struct Slice {
+		class ShaderPermutations* mShader;
+		unsigned int mShaderIndex;
+		// Only one of the three is set
+		class MeshComponent* const* mMeshes;
+		class StaticBatch* const* mBatches;
+		class SpriteComponent* const* mSprites;
+		// Range of the items. For sprites, mBegin is also the draw order of the first one
+		unsigned int mBegin;
+		unsigned int mEnd;
+	};
+
+	// support method. Record the packets of a slice in its command list
+	void RecordSlice(const Slice& slice, CommandList& list);
+	// support method. Return false if the world space sphere is culled by the visible sets or the occluders
+	bool IsVisible(const Vector3& center, float radius) const;
+	// support method. Variant of the slice shader for an item with the given features, and its sort index
+	class Shader* SelectShader(const Slice& slice, unsigned int features, unsigned int& outShaderIndex) const;
+	// support method. Shader features needed to sample the texture (texture arrays)
+	static unsigned int GetTextureFeatures(const class Texture* texture);
+	// support method. Distance of a point from the camera plane
+	float GetViewDepth(const Vector3& position) const;
+	// support method. Ask for the mip level of the texture matching the projected size of the world space sphere
+	void RequestTextureLevel(CommandList& list, class Texture* texture, const Vector3& center, float radius) const;
+
+	RecordContext mContext;
+	std::vector<Slice> mSlices;
+	// One command list per slice, kept across frames
+	std::vector<CommandList*> mLists;
+	// Next packet of a command list to merge
+	struct MergeHead {
+		uint64_t mSortKey;
+		unsigned int mList;
+		unsigned int mIndex;
+	};
+	// Merged packets, and the heads of the lists still merging
+	std::vector<DrawPacket> mPackets;
+	std::vector<MergeHead> mMergeHeap;
+	std::vector<TextureRequest> mTextureRequests;
+	unsigned int mTrianglesSubmitted;
+	unsigned int mTrianglesFullDetail;
+};
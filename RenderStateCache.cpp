@@ -0,0 +1,178 @@
+#include "RenderStateCache.h"
+#include <algorithm>
+
+RenderStateCache::RenderStateCache() {
+	Reset();
+}
+
+void RenderStateCache::Reset() {
+	mProgram = Unknown;
+	mVertexArray = Unknown;
+	mRenderTarget = Unknown;
+	mActiveUnit = Unknown;
+	mTextures.clear();
+	mBuffers.clear();
+	mBufferRanges.clear();
+	mDepthTest = Unknown;
+	mBlend = Unknown;
+	mBlendFunc = Unknown;
+	mCullFace = Unknown;
+	mDepthWrite = Unknown;
+	mColorWrite = Unknown;
+	mDepthFunc = Unknown;
+	std::fill(mViewport, mViewport + 4, 0);
+	std::fill(mClearColor, mClearColor + 4, 0.f);
+	mViewportKnown = false;
+	mClearColorKnown = false;
+	mSkipped = 0;
+}
+
+template<typename T>
+bool RenderStateCache::Set(T& current, const T& value) {
+	if (current == value) {
+		mSkipped++;
+		return false;
+	}
+	current = value;
+	return true;
+}
+
+bool RenderStateCache::SetBinding(std::vector<std::pair<unsigned int, unsigned int>>& bindings, unsigned int target, unsigned int value) {
+	for (auto& binding : bindings) {
+		if (binding.first == target) return Set(binding.second, value);
+	}
+	bindings.emplace_back(target, value);
+	return true;
+}
+
+bool RenderStateCache::UseProgram(ProgramHandle program) {
+	return Set(mProgram, program);
+}
+
+bool RenderStateCache::BindVertexArray(VertexArrayHandle vertexArray) {
+	return Set(mVertexArray, vertexArray);
+}
+
+bool RenderStateCache::SetActiveTextureUnit(unsigned int unit) {
+	if (unit >= mTextures.size()) mTextures.resize(unit + 1);
+	return Set(mActiveUnit, unit);
+}
+
+bool RenderStateCache::BindTexture(unsigned int target, TextureHandle texture) {
+	// The unit is unknown until the first SetActiveTextureUnit: always bind
+	if (mActiveUnit == Unknown) return true;
+	return SetBinding(mTextures[mActiveUnit], target, texture);
+}
+
+bool RenderStateCache::BindBuffer(unsigned int target, BufferHandle buffer) {
+	return SetBinding(mBuffers, target, buffer);
+}
+
+bool RenderStateCache::BindRenderTarget(RenderTargetHandle target) {
+	return Set(mRenderTarget, target);
+}
+
+bool RenderStateCache::BindBufferBase(unsigned int bindingPoint, BufferHandle buffer) {
+	return BindBufferRange(bindingPoint, buffer, 0, Unknown);
+}
+
+bool RenderStateCache::BindBufferRange(unsigned int bindingPoint, BufferHandle buffer, unsigned int offset, unsigned int size) {
+	if (bindingPoint >= mBufferRanges.size()) mBufferRanges.resize(bindingPoint + 1, BufferRange{ Unknown, 0, 0 });
+	BufferRange& range = mBufferRanges[bindingPoint];
+	if (range.mBuffer == buffer && range.mOffset == offset && range.mSize == size) {
+		mSkipped++;
+		return false;
+	}
+	range = BufferRange{ buffer, offset, size };
+	return true;
+}
+
+bool RenderStateCache::SetDepthTest(bool enabled) {
+	return Set(mDepthTest, enabled ? 1u : 0u);
+}
+
+bool RenderStateCache::SetBlend(bool enabled) {
+	return Set(mBlend, enabled ? 1u : 0u);
+}
+
+bool RenderStateCache::SetBlendFunc(unsigned int func) {
+	return Set(mBlendFunc, func);
+}
+
+bool RenderStateCache::SetCullFace(bool enabled) {
+	return Set(mCullFace, enabled ? 1u : 0u);
+}
+
+bool RenderStateCache::SetDepthWrite(bool enabled) {
+	return Set(mDepthWrite, enabled ? 1u : 0u);
+}
+
+bool RenderStateCache::SetColorWrite(bool enabled) {
+	return Set(mColorWrite, enabled ? 1u : 0u);
+}
+
+bool RenderStateCache::SetDepthFunc(unsigned int func) {
+	return Set(mDepthFunc, func);
+}
+
+bool RenderStateCache::SetViewport(int x, int y, int width, int height) {
+	if (mViewportKnown && mViewport[0] == x && mViewport[1] == y && mViewport[2] == width && mViewport[3] == height) {
+		mSkipped++;
+		return false;
+	}
+	mViewport[0] = x;
+	mViewport[1] = y;
+	mViewport[2] = width;
+	mViewport[3] = height;
+	mViewportKnown = true;
+	return true;
+}
+
+bool RenderStateCache::SetClearColor(float red, float green, float blue, float alpha) {
+	if (mClearColorKnown && mClearColor[0] == red && mClearColor[1] == green && mClearColor[2] == blue && mClearColor[3] == alpha) {
+		mSkipped++;
+		return false;
+	}
+	mClearColor[0] = red;
+	mClearColor[1] = green;
+	mClearColor[2] = blue;
+	mClearColor[3] = alpha;
+	mClearColorKnown = true;
+	return true;
+}
+
+void RenderStateCache::ForgetProgram(ProgramHandle program) {
+	if (mProgram == program) mProgram = 0;
+}
+
+void RenderStateCache::ForgetVertexArray(VertexArrayHandle vertexArray) {
+	if (mVertexArray == vertexArray) mVertexArray = 0;
+}
+
+void RenderStateCache::ForgetRenderTarget(RenderTargetHandle target) {
+	// Deleting the bound framebuffer binds the window
+	if (mRenderTarget == target) mRenderTarget = 0;
+}
+
+void RenderStateCache::ForgetTexture(TextureHandle texture) {
+	for (auto& unit : mTextures) {
+		for (auto& binding : unit) {
+			if (binding.second == texture) binding.second = 0;
+		}
+	}
+}
+
+void RenderStateCache::ForgetBuffer(BufferHandle buffer) {
+	for (auto& binding : mBuffers) {
+		if (binding.second == buffer) binding.second = 0;
+	}
+	for (BufferRange& range : mBufferRanges) {
+		if (range.mBuffer == buffer) range = BufferRange{ 0, 0, Unknown };
+	}
+}
+
+uint64_t RenderStateCache::TakeSkipped() {
+	const uint64_t skipped = mSkipped;
+	mSkipped = 0;
+	return skipped;
+}
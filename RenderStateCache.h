@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "RenderDevice.h"
+
+// Mirror of the state of the device context: bound program, vertex array and render target, textures of each unit, buffers of each
+// target, depth/blend/cull state, write masks, viewport and clear color. Each call returns true when the value changes and the
+// backend must make the API call; redundant calls return false and are counted as skipped.
+// Targets are the values of the backend (GL enums). The backend must route every change of the mirrored state
+// through the cache, and forget the objects it destroys (their handles are reused)
+class RenderStateCache {
+public:
+	RenderStateCache();
+
+	// Forget everything: the next call of each kind goes to the API (new context)
+	void Reset();
+
+	bool UseProgram(ProgramHandle program);
+	bool BindVertexArray(VertexArrayHandle vertexArray);
+	bool SetActiveTextureUnit(unsigned int unit);
+	// Texture bound to the target of the active unit
+	bool BindTexture(unsigned int target, TextureHandle texture);
+	bool BindBuffer(unsigned int target, BufferHandle buffer);
+	// Render target of the draws (0: the window)
+	bool BindRenderTarget(RenderTargetHandle target);
+	// Buffer attached to an indexed binding point of the uniform blocks: the whole buffer, or a range of it
+	bool BindBufferBase(unsigned int bindingPoint, BufferHandle buffer);
+	bool BindBufferRange(unsigned int bindingPoint, BufferHandle buffer, unsigned int offset, unsigned int size);
+	bool SetDepthTest(bool enabled);
+	bool SetBlend(bool enabled);
+	// Blend equation and factors, identified by the backend
+	bool SetBlendFunc(unsigned int func);
+	bool SetCullFace(bool enabled);
+	bool SetDepthWrite(bool enabled);
+	bool SetColorWrite(bool enabled);
+	// Depth comparison, identified by the backend
+	bool SetDepthFunc(unsigned int func);
+	bool SetViewport(int x, int y, int width, int height);
+	bool SetClearColor(float red, float green, float blue, float alpha);
+
+	// A destroyed object is unbound everywhere it was bound
+	void ForgetProgram(ProgramHandle program);
+	void ForgetVertexArray(VertexArrayHandle vertexArray);
+	void ForgetTexture(TextureHandle texture);
+	void ForgetBuffer(BufferHandle buffer);
+	void ForgetRenderTarget(RenderTargetHandle target);
+
+	// Calls skipped since the last call
+	uint64_t TakeSkipped();
+
+private:
+	// support method. Store the value and return true if it changed, count a skipped call otherwise
+	template<typename T>
+	bool Set(T& current, const T& value);
+	// support method. Same for the value bound to a target in a list of (target, value)
+	bool SetBinding(std::vector<std::pair<unsigned int, unsigned int>>& bindings, unsigned int target, unsigned int value);
+
+	// Value of the state not known yet
+	static const unsigned int Unknown = ~0u;
+
+	ProgramHandle mProgram;
+	VertexArrayHandle mVertexArray;
+	RenderTargetHandle mRenderTarget;
+	unsigned int mActiveUnit;
+	// Textures bound to each unit, by target
+	std::vector<std::vector<std::pair<unsigned int, TextureHandle>>> mTextures;
+	// Buffer range attached to a uniform binding point (size Unknown: the whole buffer)
+	struct BufferRange {
+		BufferHandle mBuffer;
+		unsigned int mOffset;
+		unsigned int mSize;
+	};
+
+	// Buffers bound to each target, and to each uniform binding point
+	std::vector<std::pair<unsigned int, BufferHandle>> mBuffers;
+	std::vector<BufferRange> mBufferRanges;
+	// Enables, write masks, blend and depth functions (Unknown until set)
+	unsigned int mDepthTest;
+	unsigned int mBlend;
+	unsigned int mBlendFunc;
+	unsigned int mCullFace;
+	unsigned int mDepthWrite;
+	unsigned int mColorWrite;
+	unsigned int mDepthFunc;
+	int mViewport[4];
+	float mClearColor[4];
+	bool mViewportKnown;
+	bool mClearColorKnown;
+	uint64_t mSkipped;
+};
@@ -0,0 +1,84 @@
+#include "RenderStats.h"
+#include <SDL.h>
+
+// Names of the columns/keys, in the order they are written
+static const char* StatNames[] = {
+	"frame", "frameMs", "buildMs", "submitMs", "presentMs",
+	"draws", "triangles", "programBinds", "vertexArrayBinds", "textureBinds", "uniformUploads", "bufferBytes", "stateChanges",
+	"skippedStateChanges",
+	"gpuFrame", "gpuUploadMs", "gpuDepthMs", "gpuOpaqueMs", "gpuSpriteMs", "gpuMs", "gpuBound",
+	"resolutionScale"
+};
+
+static_assert(ENumGpuPasses == 4, "StatNames lists one column per GPU pass");
+
+RenderStatsFile::RenderStatsFile() :
+	mJson(false),
+	mFirst(true)
+{}
+
+RenderStatsFile::~RenderStatsFile() {
+	Close();
+}
+
+bool RenderStatsFile::Open(const std::string& fileName) {
+	Close();
+	mFile.open(fileName, std::ios::out | std::ios::trunc);
+	if (!mFile.is_open()) {
+		SDL_Log("Failed to open the render stats file %s", fileName.c_str());
+		return false;
+	}
+	// Enough digits for the byte counters
+	mFile.precision(12);
+	mJson = fileName.size() >= 5 && fileName.compare(fileName.size() - 5, 5, ".json") == 0;
+	mFirst = true;
+	if (mJson) {
+		mFile << "[\n";
+	}
+	else {
+		for (size_t i = 0; i < sizeof(StatNames) / sizeof(StatNames[0]); i++) {
+			mFile << (i > 0 ? "," : "") << StatNames[i];
+		}
+		mFile << "\n";
+	}
+	return true;
+}
+
+void RenderStatsFile::Write(const FrameStats& stats) {
+	if (!mFile.is_open()) return;
+	const DeviceCounters& counters = stats.mCounters;
+	// Same order as StatNames
+	const double values[] = {
+		static_cast<double>(stats.mFrame), stats.mFrameMs, stats.mBuildMs, stats.mSubmitMs, stats.mPresentMs,
+		static_cast<double>(counters.mDraws), static_cast<double>(counters.mTriangles),
+		static_cast<double>(counters.mProgramBinds), static_cast<double>(counters.mVertexArrayBinds),
+		static_cast<double>(counters.mTextureBinds), static_cast<double>(counters.mUniformUploads),
+		static_cast<double>(counters.mBufferBytes), static_cast<double>(counters.mStateChanges),
+		static_cast<double>(counters.mSkippedStateChanges),
+		static_cast<double>(stats.mGpuFrame), stats.mGpuPassMs[EUploadGpuPass], stats.mGpuPassMs[EDepthGpuPass],
+		stats.mGpuPassMs[EOpaqueGpuPass], stats.mGpuPassMs[ESpriteGpuPass], stats.mGpuMs, stats.IsGpuBound() ? 1.0 : 0.0,
+		stats.mResolutionScale
+	};
+	static_assert(sizeof(values) / sizeof(values[0]) == sizeof(StatNames) / sizeof(StatNames[0]), "One value per stat name");
+
+	if (mJson) {
+		mFile << (mFirst ? "" : ",\n") << "{";
+		for (size_t i = 0; i < sizeof(StatNames) / sizeof(StatNames[0]); i++) {
+			mFile << (i > 0 ? ", " : "") << "\"" << StatNames[i] << "\": " << values[i];
+		}
+		mFile << "}";
+	}
+	else {
+		for (size_t i = 0; i < sizeof(StatNames) / sizeof(StatNames[0]); i++) {
+			mFile << (i > 0 ? "," : "") << values[i];
+		}
+		mFile << "\n";
+	}
+	mFirst = false;
+}
+
+void RenderStatsFile::Close() {
+	if (!mFile.is_open()) return;
+	if (mJson) mFile << "\n]\n";
+	mFile.close();
+}
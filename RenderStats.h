@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include "RenderDevice.h"
+#include "GpuTimer.h"
+
+// Cost of a frame on the CPU (game and render threads) and on the GPU
+struct FrameStats {
+	// Index of the frame, counted by Renderer::Draw
+	uint64_t mFrame;
+	// Game thread time since the previous frame (update + snapshot, including the wait of the frame limiter)
+	float mFrameMs;
+	// Game thread time spent culling and recording the frame (Renderer::BuildSnapshot)
+	float mBuildMs;
+	// Render thread time spent sending the commands, and waiting in Present (buffer swap)
+	float mSubmitMs;
+	float mPresentMs;
+	// Commands sent to the device
+	DeviceCounters mCounters;
+	// GPU time of each pass and of the whole frame. They belong to the older frame mGpuFrame (-1: none measured yet)
+	int64_t mGpuFrame;
+	float mGpuPassMs[ENumGpuPasses];
+	float mGpuMs;
+	// Resolution of the 3D scene relative to the window (see DynamicResolution)
+	float mResolutionScale;
+
+	// The GPU takes longer than the CPU work of each thread: reducing draw calls won't make the frame faster
+	bool IsGpuBound() const { return mGpuFrame >= 0 && mGpuMs > mBuildMs && mGpuMs > mSubmitMs; }
+};
+
+// Writes one line per frame. The format is taken from the extension of the file: ".json" writes an array
+// of objects, anything else writes comma separated values with a header line
+class RenderStatsFile {
+public:
+	RenderStatsFile();
+	~RenderStatsFile();
+
+	bool Open(const std::string& fileName);
+	void Write(const FrameStats& stats);
+	// Terminate the file (closing bracket of the JSON array)
+	void Close();
+	bool IsOpen() const { return mFile.is_open(); }
+
+private:
+	std::ofstream mFile;
+	bool mJson;
+	// No frame written yet (no separator before the first JSON object)
+	bool mFirst;
+};
@@ -0,0 +1,87 @@
+#include "RenderThread.h"
+#include <utility>
+
+RenderThread::RenderThread() :
+	mWriteIndex(0),
+	mReadyIndex(1),
+	mReadIndex(2),
+	mHasNewSnapshot(false),
+	mRunning(false),
+	mTasksQueued(0),
+	mTasksDone(0)
+{}
+
+RenderThread::~RenderThread() {
+	Stop();
+}
+
+void RenderThread::Start(std::function<void()> onStart, std::function<void(const RenderSnapshot&)> draw, std::function<void()> onStop) {
+	if (IsRunning()) return;
+	mOnStart = std::move(onStart);
+	mDraw = std::move(draw);
+	mOnStop = std::move(onStop);
+	mHasNewSnapshot = false;
+	mRunning = true;
+	mThread = std::thread(&RenderThread::ThreadLoop, this);
+}
+
+void RenderThread::Stop() {
+	if (!IsRunning()) return;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+	}
+	mCondition.notify_all();
+	mThread.join();
+	mHasNewSnapshot = false;
+}
+
+void RenderThread::Publish() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		std::swap(mWriteIndex, mReadyIndex);
+		mHasNewSnapshot = true;
+	}
+	mCondition.notify_all();
+}
+
+void RenderThread::RunAndWait(const std::function<void()>& task) {
+	if (!IsRunning() || IsRenderThread()) {
+		task();
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mMutex);
+	mTasks.emplace_back(task);
+	uint64_t ticket = ++mTasksQueued;
+	mCondition.notify_all();
+	mCondition.wait(lock, [this, ticket] { return mTasksDone >= ticket; });
+}
+
+void RenderThread::ThreadLoop() {
+	mOnStart();
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true) {
+		mCondition.wait(lock, [this] { return mHasNewSnapshot || !mTasks.empty() || !mRunning; });
+		// Tasks first: a snapshot may use the resources they create
+		while (!mTasks.empty()) {
+			std::function<void()> task = std::move(mTasks.front());
+			mTasks.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+			mTasksDone++;
+			mCondition.notify_all();
+		}
+		if (!mRunning) break;
+		if (mHasNewSnapshot) {
+			// Take the latest snapshot, the one read before becomes the next published slot
+			std::swap(mReadIndex, mReadyIndex);
+			mHasNewSnapshot = false;
+			lock.unlock();
+			mDraw(mSnapshots[mReadIndex]);
+			lock.lock();
+		}
+	}
+	lock.unlock();
+	mOnStop();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "Renderer.h"
+#include "CommandList.h"
+
+// Everything the render thread needs to draw a frame, built by the game thread at the end of the update.
+// The draw packets only point to renderer resources (shaders, textures, geometry), never to actors or components
+struct RenderSnapshot {
+	// Content of the frame constants uniform buffer
+	FrameConstants mFrameConstants;
+	// Point light texels, cluster grid and light index list uploaded to the light texture buffers
+	std::vector<float> mLightData;
+	std::vector<uint32_t> mClusterGrid;
+	std::vector<uint16_t> mLightIndices;
+	// Draw packets of the visible meshes and of the sprites, sorted
+	std::vector<DrawPacket> mPackets;
+	// Size in pixels of the 3D scene, drawn in the scene target and stretched to the window with dynamic resolution
+	// (the window size otherwise)
+	bool mDynamicResolution;
+	int mSceneWidth;
+	int mSceneHeight;
+	// Draw the depth pre-pass, and the indices of the opaque packets from front to back
+	bool mDepthPrepass;
+	std::vector<uint32_t> mDepthOrder;
+	// Index of the frame and game thread times, completed by the render thread into the frame stats
+	uint64_t mFrame;
+	float mFrameMs;
+	float mBuildMs;
+};
+
+// Thread that owns the OpenGL context and draws the snapshots published by the game thread.
+// Three snapshots rotate between the game thread (writing), the render thread (reading) and the latest published one,
+// so neither thread waits for the other: the render thread always draws the most recent frame
+class RenderThread {
+public:
+	RenderThread();
+	~RenderThread();
+
+	// Start the thread. onStart and onStop run on the render thread (make the context current/release it),
+	// draw is called for every published snapshot
+	void Start(std::function<void()> onStart, std::function<void(const RenderSnapshot&)> draw, std::function<void()> onStop);
+	// Run the pending tasks and join the thread. Snapshots not drawn yet are dropped
+	void Stop();
+	bool IsRunning() const { return mThread.joinable(); }
+	// True when called from the render thread
+	bool IsRenderThread() const { return std::this_thread::get_id() == mThread.get_id(); }
+
+	// Snapshot to fill for the next frame. Only the game thread uses it, until Publish
+	RenderSnapshot& GetWriteSnapshot() { return mSnapshots[mWriteIndex]; }
+	// Hand the written snapshot to the render thread and get a free one for the next frame
+	void Publish();
+	// Run a task that needs the OpenGL context (resource creation) on the render thread, between two frames,
+	// and wait for it. Called from the render thread or when the thread is not running, the task runs immediately
+	void RunAndWait(const std::function<void()>& task);
+
+private:
+	// Main loop of the render thread
+	void ThreadLoop();
+
+	std::thread mThread;
+	// Protect the indices, the tasks and the flags below
+	std::mutex mMutex;
+	// Wake up the render thread (new snapshot, task or stop) and the threads waiting for a task
+	std::condition_variable mCondition;
+	// Three snapshots, and which one is written, published and read
+	RenderSnapshot mSnapshots[3];
+	unsigned int mWriteIndex;
+	unsigned int mReadyIndex;
+	unsigned int mReadIndex;
+	// A snapshot was published after the last one the render thread took
+	bool mHasNewSnapshot;
+	// Cleared by Stop
+	bool mRunning;
+	// Tasks waiting for the render thread, and number of tasks executed (to wake up who waits for them)
+	std::deque<std::function<void()>> mTasks;
+	uint64_t mTasksQueued;
+	uint64_t mTasksDone;
+	// Callbacks given to Start
+	std::function<void()> mOnStart;
+	std::function<void(const RenderSnapshot&)> mDraw;
+	std::function<void()> mOnStop;
+};
@@ -1,70 +1,97 @@
-#include <glew.h>
 #include "Renderer.h"
+#include "RenderDevice.h"
 #include "Game.h"
 #include "Shader.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
 #include "Mesh.h"
 #include "Texture.h"
 #include "VertexArray.h"
+#include "GeometryArena.h"
+#include "StaticBatch.h"
 #include "SpriteComponent.h"
 #include "MeshComponent.h"
+#include "Actor.h"
+#include "UniformBuffer.h"
+#include "TextureBuffer.h"
+#include "LightClusters.h"
+#include "OcclusionCuller.h"
+#include "PotentiallyVisibleSet.h"
+#include "PvsBaker.h"
+#include "RenderQueue.h"
+#include "RenderThread.h"
+#include "TextureStreamer.h"
+#include "AsyncLoader.h"
+#include "TextureArray.h"
+#include "RingBuffer.h"
+#include "DynamicResolution.h"
 #include <filesystem>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <algorithm>
 
 namespace fs = std::filesystem;
 
 Renderer::Renderer(Game* game) :
-	mGame(game)
-{}
+	mTextureStreamer(new TextureStreamer()),
+	mAsyncLoader(nullptr),
+	mUploadBudgetMs(2.f),
+	mPlaceholderTexture(0),
+	mGame(game),
+	mDepthShader(nullptr),
+	mDepthPrepass(false),
+	mNearPlane(25.f),
+	mFarPlane(10000.f),
+	mDynamicResolution(new DynamicResolution()),
+	mSceneTarget(0),
+	mFrameConstantsBuffer(nullptr),
+	mLightClusters(nullptr),
+	mLightDataBuffer(nullptr),
+	mClusterGridBuffer(nullptr),
+	mLightIndexBuffer(nullptr),
+	mStreamBuffer(nullptr),
+	mObjectConstantsBuffer(nullptr),
+	mObjectConstantsStride(0),
+	mLodHysteresis(0.1f),
+	mLodStats{ 0, 0 },
+	mOcclusionCuller(nullptr),
+	mOcclusionCulling(true),
+	mPvs(nullptr),
+	mRenderQueue(nullptr),
+	mRenderThread(new RenderThread()),
+	mDevice(nullptr),
+	mGpuTimer(new GpuTimer()),
+	mLastFrameStats{},
+	mStatsFile(nullptr),
+	mFrameIndex(0),
+	mLastDrawCounter(0)
+{
+	mLastFrameStats.mGpuFrame = -1;
+	mAsyncLoader = new AsyncLoader(this);
+}
 
-Renderer::~Renderer(){}
+Renderer::~Renderer(){
+	delete mRenderThread;
+	delete mAsyncLoader;
+	delete mTextureStreamer;
+	delete mGpuTimer;
+	delete mStatsFile;
+	delete mDynamicResolution;
+}
 
-bool Renderer::Initialize(float screenWidth, float screenHeight) {
+bool Renderer::Initialize(float screenWidth, float screenHeight, RenderBackend backend) {
 	mScreenWidth = screenWidth;
 	mScreenHeight = screenHeight;
 
-	// Set OpneGL window's attribute
-	// return 0 if successfull, otherwise negative value
-	// Use the core OpenGL profile
-	SDL_GL_SetAttribute(
-		SDL_GL_CONTEXT_PROFILE_MASK,
-		SDL_GL_CONTEXT_PROFILE_CORE
-	);
-	// Specify OpenGL 3.3
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-	// Request a color buffer with 8-bits per RGBA channel
-	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
-	// Request a z-buffer (depth buffer) of 24 bit
-	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
-	// Enable double buffering
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	// Force OpenGL to use hardware acceleration (GPU)
-	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
-
-	// Create a window with support to OpenGL
-	mWindow = SDL_CreateWindow("CoderNik Game Engine", 100, 100, static_cast<int>(mScreenWidth), static_cast<int>(mScreenHeight), SDL_WINDOW_OPENGL);
-	if (!mWindow) {
-		SDL_Log("Failed to create window: %s", SDL_GetError());
-		return false;
-	}
-
-	// Create OpenGL Context
-	mContext = SDL_GL_CreateContext(mWindow);
-
-	// Enable GLEW library. Automatically initialize all extension functions supported by the current OpenGL context's version (3.3 in this case)
-	glewExperimental = GL_TRUE;
-	if (glewInit() != GLEW_OK) {
-		SDL_Log("Failed to initialize GLEW: %s", SDL_GetError());
+	// Create the render device: window and OpenGL context, or the null device without GPU
+	mDevice = RenderDevice::Create(backend);
+	if (!mDevice->Initialize("CoderNik Game Engine", static_cast<int>(mScreenWidth), static_cast<int>(mScreenHeight))) {
+		SDL_Log("Failed to initialize the render device");
 		return false;
 	}
-	// Clear benign error
-	glGetError();
 
-	// Call LoadShader after the initialization of OpenGL and GLEW and before creation of the vertex array object
+	// Call LoadShader after the initialization of the device and before creation of the vertex array object
 	if (!LoadShaders()) {
 		SDL_Log("Failed to load shaders");
 		return false;
@@ -73,27 +100,100 @@ bool Renderer::Initialize(float screenWidth, float screenHeight) {
 	// Create quad for drawing sprites
 	CreateSpriteVerts();
 
+	// Create the uniform buffer shared by the 3D shaders
+	mFrameConstantsBuffer = new UniformBuffer(sizeof(FrameConstants), EFrameConstantsBinding);
+
+	// Create the clustered lighting structures. Cluster bounds only depend on the projection
+	mLightClusters = new LightClusters();
+	mLightClusters->SetProjection(mProjection.mat[0][0], mProjection.mat[1][1], mNearPlane, mFarPlane);
+	mLightDataBuffer = new TextureBuffer(ETexelRGBA32F);
+	mClusterGridBuffer = new TextureBuffer(ETexelRG32UI);
+	mLightIndexBuffer = new TextureBuffer(ETexelR16UI);
+	mStreamBuffer = new RingBuffer(EStagingBuffer, StreamBufferFrameSize);
+	mObjectConstantsBuffer = new RingBuffer(EUniformBuffer, ObjectConstantsFrameSize);
+
+	// Create the software depth buffer used to cull hidden meshes
+	mOcclusionCuller = new OcclusionCuller();
+	// Create the command lists recorded by the job system threads
+	mRenderQueue = new RenderQueue();
+	// Create the timer queries of the passes
+	mGpuTimer->Create();
+	// Create the placeholder of the textures loading in the background
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	mPlaceholderTexture = mDevice->CreateTexture2D(1, 1, 4, grey);
+	Texture::SetPlaceholder(mPlaceholderTexture);
+	// Target of the 3D scene with dynamic resolution: window sized, the scene uses the bottom left part of it
+	mSceneTarget = mDevice->CreateRenderTarget(static_cast<int>(mScreenWidth), static_cast<int>(mScreenHeight));
+
 	return true;
 }
 
 void Renderer::ShutDown() {
+// The context must be current on this thread to delete the device objects
+if (!mDevice) return;
+StopRenderThread();
 delete mSpriteVerts;
+// Meshes were unloaded by UnloadData, the arenas are empty
+for (auto arena : mGeometryArenas) {
+	delete arena;
+}
+mGeometryArenas.clear();
+delete mFrameConstantsBuffer;
+delete mLightClusters;
+delete mLightDataBuffer;
+delete mClusterGridBuffer;
+delete mLightIndexBuffer;
+delete mStreamBuffer;
+delete mObjectConstantsBuffer;
+if (mSceneTarget) mDevice->DestroyRenderTarget(mSceneTarget);
+mSceneTarget = 0;
+delete mOcclusionCuller;
+delete mRenderQueue;
+mGpuTimer->Destroy();
+mAsyncLoader->DestroyDeviceObjects();
+mDevice->DestroyTexture(mPlaceholderTexture);
+mPlaceholderTexture = 0;
+Texture::SetPlaceholder(0);
+StopStatsCapture();
 for (auto shader : mMeshShaders) {
-	shader.second->Unload();
 	delete shader.second;
 }
-SDL_GL_DeleteContext(mContext);
-SDL_DestroyWindow(mWindow);
+mMeshShaders.clear();
+mDevice->Shutdown();
+delete mDevice;
+mDevice = nullptr;
 }
 
 void Renderer::UnloadData() {
-	// Destroy textures
+	// Destroy textures, once the loader and the streamer have forgotten them
+	mAsyncLoader->Cancel();
+	mTextureStreamer->Clear();
 	for (auto i : mTextures)
 	{
 		i.second->Unload();
 		delete i.second;
 	}
 	mTextures.clear();
+	// The textures were unloaded before their arrays
+	for (auto array : mTextureArrays)
+	{
+		array->Unload();
+		delete array;
+	}
+	mTextureArrays.clear();
+
+	delete mPvs;
+	mPvs = nullptr;
+
+	// Destroy the static batches before the meshes they were built from
+	for (auto& shaderBatches : mStaticBatches)
+	{
+		for (auto batch : shaderBatches.second)
+		{
+			delete batch;
+		}
+	}
+	mStaticBatches.clear();
 
 	// Destroy meshes
 	for (auto i : mMeshes)
@@ -105,50 +205,357 @@ void Renderer::UnloadData() {
 }
 
 void Renderer::Draw() {
-	// Set the clear color (equivalent to SDL_SetRendererDrawColor of SDL): Red: 0-1; Green: 0-1; Blue: 0-1; Alpha: 0-1
-	glClearColor(0.f, 0.3f, .5f, 1.f);
-	// Clear the color buffer (equivalent to SDL_RenderClear of SDL) and Depth Buffer
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // This parameter clear the buffer with the specified color and Depth Buffer
-
-	// Draw meshes
-	// Enable depth buffer and disable alpha blending when draw meshes 
-	// Enable depth buffering
-	glEnable(GL_DEPTH_TEST);
-	// Disable alpha blending when using depth buffer
-	glDisable(GL_BLEND);
+	const uint64_t start = SDL_GetPerformanceCounter();
+	const double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
 
-	for (auto shader : mMeshShaders) {
-		if (shader.first != "Sprite") {
-			// Set the basic mesh shader active
-			shader.second->SetActive();
-			// Update view-projection matrix (is necessary to account, for example, camera moving)
-			shader.second->SetMatrixUniform("uViewProj", mView * mProjection);
-			if (shader.first == "PhongMesh") {
-				SetLightUniforms(shader.second);
-			}
-			// Iterate and draw all mesh components grouped by shader type
-			for (auto mc : mMeshComponents[shader.first]) {
-				mc->Draw(shader.second);
+	// The snapshot of the frame is built on the game thread. With the render thread running, it is drawn there
+	// while the game thread updates the next frame
+	RenderSnapshot& snapshot = mRenderThread->GetWriteSnapshot();
+	UpdateAsyncLoads();
+	BuildSnapshot(snapshot);
+	snapshot.mFrame = mFrameIndex++;
+	snapshot.mFrameMs = mLastDrawCounter ? static_cast<float>((start - mLastDrawCounter) * msPerCount) : 0.f;
+	snapshot.mBuildMs = static_cast<float>((SDL_GetPerformanceCounter() - start) * msPerCount);
+	mLastDrawCounter = start;
+	if (mRenderThread->IsRunning()) {
+		mRenderThread->Publish();
+	}
+	else {
+		DrawSnapshot(snapshot);
+	}
+	CollectFrameStats();
+}
+
+void Renderer::CollectFrameStats() {
+	std::vector<FrameStats> drawn;
+	{
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		drawn.swap(mDrawnFrameStats);
+	}
+	if (drawn.empty()) return;
+	mLastFrameStats = drawn.back();
+	for (const FrameStats& stats : drawn) {
+		mDynamicResolution->AddFrameTime(stats.mGpuFrame, stats.mGpuMs);
+	}
+	if (mStatsFile) {
+		for (const FrameStats& stats : drawn) {
+			mStatsFile->Write(stats);
+		}
+	}
+}
+
+bool Renderer::StartStatsCapture(const std::string& fileName) {
+	StopStatsCapture();
+	mStatsFile = new RenderStatsFile();
+	if (!mStatsFile->Open(fileName)) {
+		delete mStatsFile;
+		mStatsFile = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void Renderer::StopStatsCapture() {
+	if (!mStatsFile) return;
+	// Write the frames drawn since the last Draw
+	CollectFrameStats();
+	mStatsFile->Close();
+	delete mStatsFile;
+	mStatsFile = nullptr;
+}
+
+void Renderer::SetTextureBudget(size_t bytes) {
+	mTextureStreamer->SetBudget(bytes);
+}
+
+size_t Renderer::GetResidentTextureBytes() const {
+	return mTextureStreamer->GetResidentBytes();
+}
+
+void Renderer::StartRenderThread() {
+	// The context can be current on one thread only: release it here, the render thread takes it
+	mDevice->ReleaseContext();
+	mRenderThread->Start(
+		[this] { mDevice->AcquireContext(); },
+		[this](const RenderSnapshot& snapshot) { DrawSnapshot(snapshot); },
+		[this] { mDevice->ReleaseContext(); });
+}
+
+void Renderer::StopRenderThread() {
+	if (!mRenderThread->IsRunning()) return;
+	mRenderThread->Stop();
+	mDevice->AcquireContext();
+}
+
+void Renderer::SetDynamicResolution(bool enabled) {
+	if (enabled && !mSceneTarget) {
+		SDL_Log("No render target for the dynamic resolution: the scene is drawn at the window resolution");
+		return;
+	}
+	mDynamicResolution->SetEnabled(enabled);
+}
+
+void Renderer::BuildSnapshot(RenderSnapshot& snapshot) {
+	// Resolution of the 3D scene, from the GPU time of the frames measured so far
+	const float scale = mDynamicResolution->Update(static_cast<int64_t>(mFrameIndex));
+	snapshot.mDynamicResolution = mDynamicResolution->IsEnabled();
+	snapshot.mSceneWidth = Math::Max(1, static_cast<int>(mScreenWidth * scale + 0.5f));
+	snapshot.mSceneHeight = Math::Max(1, static_cast<int>(mScreenHeight * scale + 0.5f));
+
+	// View-projection, camera and lights, uploaded once for all the 3D shaders
+	UpdateFrameUniforms(snapshot);
+
+	// Rasterize the static batches (floor, walls) as occluders on the CPU
+	if (mOcclusionCulling) {
+		mOcclusionCuller->BeginFrame(mView * mProjection, mNearPlane);
+		for (auto& shaderBatches : mStaticBatches) {
+			for (auto batch : shaderBatches.second) {
+				Mesh* mesh = batch->GetMesh();
+				mOcclusionCuller->AddOccluder(mesh->GetVertices().data(), mesh->GetVertexSize(),
+					mesh->GetIndices().data(), mesh->GetLod(0).mIndexCount, Matrix4::Identity);
 			}
 		}
+		mOcclusionCuller->RenderOccluders();
 	}
 
-	// Draw sprites
-	// Enable alpha blending and disable depth buffer when drawing sprites
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
-	// On each frime, active the vertex array object and shader before drawing any model (sprite in this case)
-	// Active vertex array object and shader
-	mMeshShaders["Sprite"]->SetActive();
-	mSpriteVerts->SetActive();
-	// Draw all sprites
-	for (auto sprite : mSprites)
-		sprite->Draw(mMeshShaders["Sprite"]);
+	// Record the draw packets of the visible meshes and of the sprites on the job system threads
+	RecordContext context;
+	context.mView = mView;
+	context.mYScale = mProjection.mat[1][1];
+	context.mNearPlane = mNearPlane;
+	context.mLodHysteresis = mLodHysteresis;
+	// Lower resolutions sample smaller mip levels
+	context.mScreenHeight = static_cast<float>(snapshot.mSceneHeight);
+	// Cell of the camera in the potentially visible sets (-1 outside the level: everything is visible)
+	context.mPvs = mPvs;
+	context.mCameraCell = mPvs ? mPvs->GetCell(mCameraPosition) : -1;
+	context.mOcclusionCuller = mOcclusionCulling ? mOcclusionCuller : nullptr;
+	// Skip the point light loop of the shaders when no light reaches the view
+	context.mShaderFeatures = snapshot.mLightIndices.empty() ? 0 : EPointLightsFeature;
+	mRenderQueue->BeginFrame(context);
+	// Every variant has its own sort index, so the packets are grouped by program
+	unsigned int shaderIndex = 0;
+	for (auto shader : mMeshShaders) {
+		if (shader.first != "Sprite" && shader.first != "Depth") {
+			mRenderQueue->AddMeshes(shader.second, shaderIndex, mMeshComponents[shader.first]);
+			mRenderQueue->AddBatches(shader.second, shaderIndex, mStaticBatches[shader.first]);
+			shaderIndex += shader.second->GetNumVariants();
+		}
+	}
+	mRenderQueue->AddSprites(mMeshShaders["Sprite"], mSprites);
+	mRenderQueue->Record();
+	mLodStats.mTrianglesSubmitted = mRenderQueue->GetTrianglesSubmitted();
+	mLodStats.mTrianglesFullDetail = mRenderQueue->GetTrianglesFullDetail();
+	// Stream the texture levels the packets need
+	for (const TextureRequest& request : mRenderQueue->GetTextureRequests()) {
+		mTextureStreamer->RequestLevel(request.mTexture, request.mLevel);
+	}
+	mTextureStreamer->Update(mFrameIndex);
+	// The snapshot vectors keep their memory from frame to frame
+	snapshot.mPackets.assign(mRenderQueue->GetPackets().begin(), mRenderQueue->GetPackets().end());
+	// The colour pass keeps the packets grouped by shader and texture (front to back inside a group). The depth
+	// pre-pass binds a single shader, so it draws all the opaque packets strictly front to back
+	snapshot.mDepthPrepass = mDepthPrepass && mDepthShader;
+	snapshot.mDepthOrder.clear();
+	if (snapshot.mDepthPrepass) {
+		const std::vector<DrawPacket>& packets = snapshot.mPackets;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(packets.size()); i++) {
+			if (packets[i].mPass == EOpaquePass) snapshot.mDepthOrder.emplace_back(i);
+		}
+		// The low 32 bits of the key of an opaque packet are the order of its view depth (see CommandList::DepthOrder)
+		std::sort(snapshot.mDepthOrder.begin(), snapshot.mDepthOrder.end(), [&packets](uint32_t a, uint32_t b) {
+			return static_cast<uint32_t>(packets[a].mSortKey) < static_cast<uint32_t>(packets[b].mSortKey);
+		});
+	}
+}
+
+void Renderer::DrawSnapshot(const RenderSnapshot& snapshot) {
+	const uint64_t start = SDL_GetPerformanceCounter();
+	const double msPerCount = 1000.0 / SDL_GetPerformanceFrequency();
+	mGpuTimer->BeginFrame(static_cast<int64_t>(snapshot.mFrame));
+
+	// Draw the 3D scene in the scene target at the resolution of the frame, or directly to the whole window
+	const int windowWidth = static_cast<int>(mScreenWidth);
+	const int windowHeight = static_cast<int>(mScreenHeight);
+	if (snapshot.mDynamicResolution) mDevice->BindRenderTarget(mSceneTarget);
+	mDevice->SetViewport(0, 0, snapshot.mSceneWidth, snapshot.mSceneHeight);
+	// Clear the color buffer with the specified color (Red: 0-1; Green: 0-1; Blue: 0-1; Alpha: 0-1) and the depth buffer
+	mDevice->Clear(0.f, 0.3f, .5f, 1.f);
+
+	// Upload the frame constants and the light lists, and bind the light lists used by the Phong shader
+	mGpuTimer->BeginPass(EUploadGpuPass);
+	mFrameConstantsBuffer->Update(&snapshot.mFrameConstants, sizeof(FrameConstants));
+	// The light lists are written in the stream buffer, then copied by the GPU: no copy in the driver and no wait for
+	// the draws of the previous frame still reading them. They are updated directly if the stream buffer is full
+	TextureBuffer* lightBuffers[] = { mLightDataBuffer, mClusterGridBuffer, mLightIndexBuffer };
+	const void* lightLists[] = { snapshot.mLightData.data(), snapshot.mClusterGrid.data(), snapshot.mLightIndices.data() };
+	const unsigned int lightListSizes[] = {
+		static_cast<unsigned int>(snapshot.mLightData.size() * sizeof(float)),
+		static_cast<unsigned int>(snapshot.mClusterGrid.size() * sizeof(uint32_t)),
+		static_cast<unsigned int>(snapshot.mLightIndices.size() * sizeof(uint16_t))
+	};
+	unsigned int lightListOffsets[3];
+	bool streamed[3];
+	mStreamBuffer->BeginFrame();
+	for (int i = 0; i < 3; i++) {
+		streamed[i] = mStreamBuffer->Write(lightLists[i], lightListSizes[i], 16, lightListOffsets[i]);
+	}
+	mStreamBuffer->FinishWrites();
+	for (int i = 0; i < 3; i++) {
+		if (streamed[i]) lightBuffers[i]->CopyFrom(mStreamBuffer->GetBuffer(), lightListOffsets[i], lightListSizes[i]);
+		else lightBuffers[i]->Update(lightLists[i], lightListSizes[i]);
+	}
+	// The constants of all the draws are written at once, each draw binds its range
+	const unsigned int objectsOffset = WriteObjectConstants(snapshot.mPackets);
+	mLightDataBuffer->SetActive(ELightDataUnit);
+	mClusterGridBuffer->SetActive(EClusterGridUnit);
+	mLightIndexBuffer->SetActive(ELightIndicesUnit);
+	// Upload the texture levels streamed in since the last frame, and a slice of the resources loaded in the background
+	mTextureStreamer->ApplyLoads();
+	mAsyncLoader->ProcessUploads(mUploadBudgetMs);
+
+	// Lay down the depth of the opaque meshes, then draw their colour over it: only the visible fragments are shaded
+	if (snapshot.mDepthPrepass) {
+		mGpuTimer->BeginPass(EDepthGpuPass);
+		ExecuteDepthPrepass(snapshot, objectsOffset);
+	}
+
+	// Submit the recorded packets
+	// Enable depth buffer and disable alpha blending when draw meshes. After the pre-pass the depth is final:
+	// it is tested (less or equal passes the same depth) but not written again
+	mGpuTimer->BeginPass(EOpaqueGpuPass);
+	if (snapshot.mDepthPrepass) mDevice->SetPipelineState(PipelineState{ true, false, false, false, true, ELessEqualDepth });
+	else mDevice->SetPipelineState(PipelineState{ true, false, false, true, true, ELessDepth });
+	// The opaque packets come first: the pass is in the top bits of the sort key
+	const size_t spritesBegin = std::partition_point(snapshot.mPackets.begin(), snapshot.mPackets.end(),
+		[](const DrawPacket& packet) { return packet.mPass == EOpaquePass; }) - snapshot.mPackets.begin();
+	ExecutePackets(snapshot.mPackets, 0, spritesBegin, objectsOffset);
+
+	// Stretch the scene to the window, then draw the sprites over it at the window resolution
+	mGpuTimer->BeginPass(ESpriteGpuPass);
+	if (snapshot.mDynamicResolution) {
+		mDevice->BlitToWindow(mSceneTarget, snapshot.mSceneWidth, snapshot.mSceneHeight, windowWidth, windowHeight);
+		mDevice->SetViewport(0, 0, windowWidth, windowHeight);
+	}
+	ExecutePackets(snapshot.mPackets, spritesBegin, snapshot.mPackets.size(), objectsOffset);
+	mGpuTimer->EndPass();
+	// The regions of the ring buffers written this frame are reused once the GPU is past this point
+	mStreamBuffer->EndFrame();
+	mObjectConstantsBuffer->EndFrame();
+	const uint64_t submitted = SDL_GetPerformanceCounter();
 
 	// Swap back and front buffer to render the scene (equivalent to SDL_RenderPresent of SDL)
-	SDL_GL_SwapWindow(mWindow);
+	mDevice->Present();
+	const uint64_t presented = SDL_GetPerformanceCounter();
+
+	// Stats of the frame, collected by the game thread in Draw
+	FrameStats stats;
+	stats.mFrame = snapshot.mFrame;
+	stats.mFrameMs = snapshot.mFrameMs;
+	stats.mBuildMs = snapshot.mBuildMs;
+	stats.mSubmitMs = static_cast<float>((submitted - start) * msPerCount);
+	stats.mPresentMs = static_cast<float>((presented - submitted) * msPerCount);
+	stats.mCounters = mDevice->GetFrameCounters();
+	stats.mGpuFrame = mGpuTimer->GetMeasuredFrame();
+	for (unsigned int pass = 0; pass < ENumGpuPasses; pass++) {
+		stats.mGpuPassMs[pass] = mGpuTimer->GetPassTime(static_cast<GpuPass>(pass));
+	}
+	stats.mGpuMs = mGpuTimer->GetTotalTime();
+	stats.mResolutionScale = snapshot.mSceneWidth / mScreenWidth;
+	std::lock_guard<std::mutex> lock(mStatsMutex);
+	mDrawnFrameStats.emplace_back(stats);
+}
+
+unsigned int Renderer::WriteObjectConstants(const std::vector<DrawPacket>& packets) {
+	const unsigned int alignment = mDevice->GetUniformBufferAlignment();
+	mObjectConstantsStride = (sizeof(ObjectConstants) + alignment - 1) / alignment * alignment;
+	const unsigned int size = static_cast<unsigned int>(packets.size()) * mObjectConstantsStride;
+	unsigned int offset = 0;
+	mObjectConstantsBuffer->BeginFrame();
+	unsigned char* data = static_cast<unsigned char*>(mObjectConstantsBuffer->Allocate(size, alignment, offset));
+	if (!data && size > 0) {
+		// More draws than the buffer holds: replace it with a larger one (the old one lives until the GPU is done)
+		delete mObjectConstantsBuffer;
+		mObjectConstantsBuffer = new RingBuffer(EUniformBuffer, size * 2);
+		mObjectConstantsBuffer->BeginFrame();
+		data = static_cast<unsigned char*>(mObjectConstantsBuffer->Allocate(size, alignment, offset));
+	}
+	if (data) {
+		// A packet without texture keeps the one of the previous packet, and its layer
+		float textureLayer = 0.f;
+		for (size_t i = 0; i < packets.size(); i++) {
+			const DrawPacket& packet = packets[i];
+			if (packet.mTexture) textureLayer = packet.mTexture->GetArray() ? static_cast<float>(packet.mTexture->GetLayer()) : 0.f;
+			ObjectConstants constants = { packet.mWorldTransform, packet.mSpecPower, textureLayer, { 0.f, 0.f } };
+			// Write-only memory: copy the whole struct, never read it back
+			memcpy(data + i * mObjectConstantsStride, &constants, sizeof(ObjectConstants));
+		}
+	}
+	mObjectConstantsBuffer->FinishWrites();
+	return offset;
+}
+
+void Renderer::ExecutePackets(const std::vector<DrawPacket>& packets, size_t first, size_t last, unsigned int objectsOffset) {
+	// Bind only what changes between two packets. The packets are sorted by pass, shader and texture
+	int pass = -1;
+	Shader* shader = nullptr;
+	Texture* texture = nullptr;
+	TextureArray* array = nullptr;
+	const BufferHandle objectConstants = mObjectConstantsBuffer->GetBuffer();
+	for (size_t i = first; i < last; i++) {
+		const DrawPacket& packet = packets[i];
+		if (packet.mPass != pass) {
+			pass = packet.mPass;
+			if (pass == ESpritePass) {
+				// Enable alpha blending and disable depth buffer when drawing sprites
+				mDevice->SetPipelineState(PipelineState{ false, true, false, true, true, ELessDepth });
+				// All the sprites share the quad vertex array. It replaced the one of the geometry arenas
+				mSpriteVerts->SetActive();
+				GeometryArena::InvalidateBinding();
+			}
+		}
+		if (packet.mShader != shader) {
+			shader = packet.mShader;
+			shader->SetActive();
+		}
+		if (packet.mTexture && packet.mTexture != texture) {
+			texture = packet.mTexture;
+			// The textures of an array share its binding, only their layer changes
+			if (!texture->GetArray() || texture->GetArray() != array) texture->SetActive(EDiffuseTextureUnit);
+			array = texture->GetArray();
+		}
+		// World transform, specular power and texture layer of the draw
+		mDevice->BindUniformBufferRange(objectConstants, EObjectConstantsBinding,
+			objectsOffset + static_cast<unsigned int>(i) * mObjectConstantsStride, sizeof(ObjectConstants));
+		if (packet.mGeometry) {
+			packet.mGeometry->mArena->Draw(*packet.mGeometry, packet.mFirstIndex, packet.mIndexCount);
+		}
+		else {
+			// Sprite quad
+			mSpriteVerts->Draw(packet.mIndexCount);
+		}
+	}
+}
+
+void Renderer::ExecuteDepthPrepass(const RenderSnapshot& snapshot, unsigned int objectsOffset) {
+	// Depth only: no color writes, no texture. The packets are not grouped by shader, but every draw uses a variant of
+	// the depth shader (skinned or not)
+	mDevice->SetPipelineState(PipelineState{ true, false, false, true, false, ELessDepth });
+	const BufferHandle objectConstants = mObjectConstantsBuffer->GetBuffer();
+	Shader* shader = nullptr;
+	for (uint32_t i : snapshot.mDepthOrder) {
+		const DrawPacket& packet = snapshot.mPackets[i];
+		const bool skinned = packet.mGeometry->mArena->GetLayout().HasAttribute(ESkinIndicesAttribute);
+		Shader* variant = mDepthShader->Select(skinned ? ESkinningFeature : 0);
+		if (variant != shader) {
+			shader = variant;
+			shader->SetActive();
+		}
+		// The constants written for the colour pass: world transform of the draw
+		mDevice->BindUniformBufferRange(objectConstants, EObjectConstantsBinding,
+			objectsOffset + i * mObjectConstantsStride, sizeof(ObjectConstants));
+		packet.mGeometry->mArena->Draw(*packet.mGeometry, packet.mFirstIndex, packet.mIndexCount);
+	}
 }
 
 void Renderer::AddSprite(SpriteComponent* sprite) {
@@ -180,8 +587,18 @@ void Renderer::AddMeshComp(std::string shader, MeshComponent* mesh)
 	mMeshComponents[shader].emplace_back(mesh);
 }
 
+void Renderer::AddPendingMeshComp(MeshComponent* mesh)
+{
+	mPendingMeshComps.emplace_back(mesh);
+}
+
 void Renderer::RemoveMeshComp(std::string shader, MeshComponent* mesh)
 {
+	auto pending = std::find(mPendingMeshComps.begin(), mPendingMeshComps.end(), mesh);
+	if (pending != mPendingMeshComps.end()) {
+		mPendingMeshComps.erase(pending);
+		return;
+	}
 	if (mMeshComponents.find(shader) != mMeshComponents.end()) {
 		auto it = std::find(mMeshComponents[shader].begin(), mMeshComponents[shader].end(), mesh);
 		if (it != mMeshComponents[shader].end()) {
@@ -196,13 +613,24 @@ Texture* Renderer::GetTexture(const std::string& fileName) {
 	if (iter != mTextures.end())
 	{
 		tex = iter->second;
+		if (!tex->IsLoaded())
+		{
+			// Loading in the background, or failed
+			FinishAsyncLoad(tex);
+			if (!tex->IsLoaded()) tex = nullptr;
+		}
 	}
 	else
 	{
 		tex = new Texture();
-		if (tex->Load(fileName))
+		// Loading creates the OpenGL texture: it runs on the render thread if it is running.
+		// Cooked textures start with their small levels, the streamer loads the others when they are drawn
+		bool loaded = false;
+		mRenderThread->RunAndWait([&] { loaded = tex->Load(fileName, true); });
+		if (loaded)
 		{
 			mTextures.emplace(fileName, tex);
+			if (tex->IsStreamable()) mTextureStreamer->AddTexture(tex);
 		}
 		else
 		{
@@ -213,6 +641,144 @@ Texture* Renderer::GetTexture(const std::string& fileName) {
 	return tex;
 }
 
+void Renderer::BuildStaticBatches()
+{
+	for (auto& shaderBatches : mStaticBatches)
+	{
+		for (auto batch : shaderBatches.second)
+		{
+			delete batch;
+		}
+	}
+	mStaticBatches.clear();
+	unsigned int numComps = 0;
+	for (auto& shaderComps : mMeshComponents)
+	{
+		for (auto mc : shaderComps.second)
+		{
+			mc->SetBatched(false);
+			numComps++;
+		}
+	}
+
+	std::vector<StaticBatch*> batches;
+	StaticBatch::BuildBatches(mMeshComponents, this, batches);
+	unsigned int numBatched = 0;
+	for (auto batch : batches)
+	{
+		mStaticBatches[batch->GetShaderName()].emplace_back(batch);
+		numBatched += batch->GetNumMeshes();
+	}
+	SDL_Log("Static batching: %u of %u meshes merged in %u batches", numBatched, numComps, static_cast<unsigned>(batches.size()));
+}
+
+void Renderer::BuildTextureArrays()
+{
+	// Loaded textures not packed yet, in the order of their names so the layers are the same from run to run
+	std::vector<std::string> names;
+	for (auto& iter : mTextures)
+	{
+		if (iter.second->IsLoaded() && !iter.second->GetArray()) names.emplace_back(iter.first);
+	}
+	std::sort(names.begin(), names.end());
+	std::vector<Texture*> textures;
+	for (const std::string& name : names)
+	{
+		textures.emplace_back(mTextures[name]);
+	}
+
+	std::vector<std::vector<Texture*>> pages;
+	TextureArray::Pack(textures, pages);
+	unsigned int numPacked = 0;
+	for (const std::vector<Texture*>& page : pages)
+	{
+		TextureArray* array = new TextureArray();
+		// The array replaces the textures on the thread of the device
+		bool created = array->Read(page);
+		if (created) mRenderThread->RunAndWait([&] { created = array->Upload(); });
+		if (!created)
+		{
+			delete array;
+			continue;
+		}
+		for (Texture* tex : page)
+		{
+			mTextureStreamer->RemoveTexture(tex);
+		}
+		mTextureArrays.emplace_back(array);
+		numPacked += array->GetNumLayers();
+	}
+	SDL_Log("Texture arrays: %u of %u textures packed in %u arrays", numPacked, static_cast<unsigned>(textures.size()),
+		static_cast<unsigned>(mTextureArrays.size()));
+}
+
+bool Renderer::LoadPvs(const std::string& fileName)
+{
+	delete mPvs;
+	mPvs = nullptr;
+	// No file until the level is baked with -bakepvs: nothing is culled by cell, which is not an error
+	if (!fs::exists(fileName)) return false;
+	// The file must have been baked from the static geometry loaded now
+	std::vector<Vector3> triangles;
+	GetOccluderTriangles(triangles);
+	mPvs = new PotentiallyVisibleSet();
+	if (!mPvs->Load(fileName, PotentiallyVisibleSet::HashGeometry(triangles)))
+	{
+		// Without potentially visible sets every cell is visible
+		delete mPvs;
+		mPvs = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool Renderer::BakePvs(const std::string& fileName, float minZ, float maxZ)
+{
+	std::vector<Vector3> triangles;
+	GetOccluderTriangles(triangles);
+	return PvsBaker::Bake(triangles, PvsBaker::DefaultCellSize, minZ, maxZ, PvsBaker::DefaultRaysPerPair, fileName);
+}
+
+void Renderer::GetOccluderTriangles(std::vector<Vector3>& outTriangles)
+{
+	// World space triangles of the full detail meshes of the static actors
+	outTriangles.clear();
+	for (auto& shaderComps : mMeshComponents)
+	{
+		for (auto mc : shaderComps.second)
+		{
+			Mesh* mesh = mc->GetMesh();
+			Actor* owner = mc->GetOwner();
+			if (!mesh || !owner->IsStatic()) continue;
+			owner->ComputeWorldTransform();
+			const Matrix4 world = owner->GetWorldTransform();
+			const std::vector<float>& vertices = mesh->GetVertices();
+			const std::vector<unsigned int>& indices = mesh->GetIndices();
+			const MeshLod& lod = mesh->GetLod(0);
+			for (unsigned int i = lod.mIndexOffset; i < lod.mIndexOffset + lod.mIndexCount; i++)
+			{
+				const float* pos = &vertices[indices[i] * mesh->GetVertexSize()];
+				outTriangles.emplace_back(Vector3::Transform(Vector3(pos[0], pos[1], pos[2]), world));
+			}
+		}
+	}
+}
+
+GeometryArena* Renderer::GetGeometryArena(const VertexLayout& layout)
+{
+	for (auto arena : mGeometryArenas)
+	{
+		if (arena->GetLayout() == layout)
+		{
+			return arena;
+		}
+	}
+	// Room for 64K vertices and 1MB of indices, the arena grows when needed
+	GeometryArena* arena = new GeometryArena(layout, 65536, 1 << 20);
+	mGeometryArenas.emplace_back(arena);
+	return arena;
+}
+
 Mesh* Renderer::GetMesh(const std::string& fileName)
 {
 	Mesh* m = nullptr;
@@ -220,11 +786,20 @@ Mesh* Renderer::GetMesh(const std::string& fileName)
 	if (iter != mMeshes.end())
 	{
 		m = iter->second;
+		if (!m->IsLoaded())
+		{
+			// Loading in the background, or failed
+			FinishAsyncLoad(m);
+			if (!m->IsLoaded()) m = nullptr;
+		}
 	}
 	else
 	{
 		m = new Mesh();
-		if (m->Load(fileName, this))
+		// Loading creates OpenGL buffers: it runs on the render thread if it is running
+		bool loaded = false;
+		mRenderThread->RunAndWait([&] { loaded = m->Load(fileName, this); });
+		if (loaded)
 		{
 			mMeshes.emplace(fileName, m);
 		}
@@ -237,21 +812,120 @@ Mesh* Renderer::GetMesh(const std::string& fileName)
 	return m;
 }
 
+Mesh* Renderer::CreateMeshCopy(const std::string& name, Mesh* source, const std::vector<Texture*>& textures)
+{
+	if (mMeshes.find(name) != mMeshes.end() || source->IsSkinned())
+	{
+		SDL_Log("Failed to create mesh %s", name.c_str());
+		return nullptr;
+	}
+	// Create consumes the geometry: copy the vertices and the indices of the full detail level
+	std::vector<float> vertices = source->GetVertices();
+	const MeshLod& lod = source->GetLod(0);
+	std::vector<unsigned int> indices(source->GetIndices().begin() + lod.mIndexOffset,
+		source->GetIndices().begin() + lod.mIndexOffset + lod.mIndexCount);
+	Mesh* m = new Mesh();
+	bool created = false;
+	mRenderThread->RunAndWait([&] {
+		created = m->Create(name, source->GetShaderName(), textures, source->GetSpecPower(), vertices, source->GetVertexSize(), indices, this);
+	});
+	if (!created)
+	{
+		delete m;
+		return nullptr;
+	}
+	mMeshes.emplace(name, m);
+	return m;
+}
+
+Texture* Renderer::GetTextureAsync(const std::string& fileName)
+{
+	auto iter = mTextures.find(fileName);
+	if (iter != mTextures.end())
+	{
+		return iter->second;
+	}
+	// The texture stays in the map if it fails to load: it keeps the placeholder
+	Texture* tex = new Texture();
+	mTextures.emplace(fileName, tex);
+	mAsyncLoader->QueueTexture(tex, fileName, true);
+	return tex;
+}
+
+Mesh* Renderer::GetMeshAsync(const std::string& fileName)
+{
+	auto iter = mMeshes.find(fileName);
+	if (iter != mMeshes.end())
+	{
+		return iter->second;
+	}
+	// The mesh stays in the map if it fails to load: its components are never drawn
+	Mesh* m = new Mesh();
+	mMeshes.emplace(fileName, m);
+	mAsyncLoader->QueueMesh(m, fileName);
+	return m;
+}
+
+void Renderer::UpdateAsyncLoads()
+{
+	std::vector<Mesh*> meshes;
+	std::vector<Texture*> textures;
+	mAsyncLoader->GetUploaded(meshes, textures);
+	for (Texture* tex : textures)
+	{
+		tex->SetLoaded();
+		if (tex->IsStreamable()) mTextureStreamer->AddTexture(tex);
+	}
+	for (Mesh* m : meshes)
+	{
+		m->SetLoaded();
+	}
+	if (!meshes.empty())
+	{
+		// Draw the components of the meshes loaded
+		auto loaded = std::stable_partition(mPendingMeshComps.begin(), mPendingMeshComps.end(),
+			[](MeshComponent* mc) { return !mc->GetMesh()->IsLoaded(); });
+		for (auto it = loaded; it != mPendingMeshComps.end(); ++it)
+		{
+			AddMeshComp((*it)->GetMesh()->GetShaderName(), *it);
+		}
+		mPendingMeshComps.erase(loaded, mPendingMeshComps.end());
+	}
+
+	// The meshes read can be uploaded once their textures are known (they may still be loading)
+	mAsyncLoader->GetRead(meshes);
+	for (Mesh* m : meshes)
+	{
+		textures.clear();
+		for (const std::string& texName : m->GetTextureNames())
+		{
+			textures.emplace_back(GetTextureAsync(texName));
+		}
+		m->SetTextures(textures);
+		mAsyncLoader->QueueUpload(m);
+	}
+}
+
+void Renderer::FinishAsyncLoad(const void* resource)
+{
+	while (mAsyncLoader->IsPending(resource))
+	{
+		UpdateAsyncLoads();
+		mRenderThread->RunAndWait([this] { mAsyncLoader->ProcessUploads(0.f); });
+		std::this_thread::yield();
+	}
+	UpdateAsyncLoads();
+}
+
 bool Renderer::LoadShaders()
 {
-	// Load all shaders
-	std::string shadersPath(fs::current_path().string() + "\\Shaders");
-	std::string vertName = "";
-	std::string fragName = "";
-	for (auto it = fs::directory_iterator(shadersPath); it != fs::directory_iterator(); it++) {
-		std::string shadehName = it->path().stem().string();
-		// first is a frag, second is a vert (alphabetical order)
-		fragName = it->path().filename().string();
-		vertName = (++it)->path().filename().string();
-		Shader* sh = new Shader();
-		if (!sh->Load("Shaders/" + vertName, "Shaders/" + fragName)) return false;
-		mMeshShaders[shadehName] = sh;
+	// Load all the shader programs listed in the manifest (from the program binary cache when possible)
+	if (!ShaderCache::LoadManifest("Shaders/Shaders.json", mMeshShaders)) {
+		return false;
 	}
+	auto depthShader = mMeshShaders.find("Depth");
+	if (depthShader != mMeshShaders.end()) mDepthShader = depthShader->second;
+	else SDL_Log("No Depth shader in the manifest: the depth pre-pass is disabled");
 	
 	// Set the view-projection matrix
 	mView = Matrix4::CreateLookAt(
@@ -263,21 +937,38 @@ bool Renderer::LoadShaders()
 		Math::ToRadians(70.f),	// Horizontal FOV
 		mScreenWidth,			// width of view
 		mScreenHeight,			// height of view
-		25.f,					// near plane
-		10000.f					// far plane
+		mNearPlane,				// near plane
+		mFarPlane				// far plane
 	);
 
+	// Skeletons are not animated yet: skinned meshes are drawn in their bind pose
+	std::vector<Matrix4> bindPose(MaxSkeletonBones, Matrix4::Identity);
 	// Activate all shaders
-	for (auto shader : mMeshShaders) {
-		if (shader.first == "Sprite") {
-			shader.second->SetActive();
-			// Set the view-projection matrix
-			Matrix4 viewProj = Matrix4::CreateSimpleViewProj(mScreenWidth, mScreenHeight);
-			shader.second->SetMatrixUniform("uViewProj", viewProj);
-		}
-		else {
-			shader.second->SetActive();
-			shader.second->SetMatrixUniform("uViewProj", mView * mProjection);
+	for (auto permutations : mMeshShaders) {
+		for (unsigned int variant = 0; variant < permutations.second->GetNumVariants(); variant++) {
+			Shader* shader = permutations.second->GetVariant(variant);
+			if (permutations.first == "Sprite") {
+				shader->SetActive();
+				// Set the view-projection matrix
+				Matrix4 viewProj = Matrix4::CreateSimpleViewProj(mScreenWidth, mScreenHeight);
+				shader->SetMatrixUniform(Uniform::ViewProj, viewProj);
+				// The world transform of each sprite is in the object constants
+				shader->BindUniformBlock("ObjectConstants", EObjectConstantsBinding);
+			}
+			else {
+				// Connect the uniform blocks of the 3D shaders to the shared uniform buffers
+				// (view-projection, camera and lights are uploaded once per frame in DrawSnapshot, the constants of each draw
+				// are a range bound by ExecutePackets)
+				shader->BindUniformBlock("FrameConstants", EFrameConstantsBinding);
+				shader->BindUniformBlock("ObjectConstants", EObjectConstantsBinding);
+				// Texture units of the samplers never change, set them once. Variants without a sampler ignore it
+				shader->SetActive();
+				shader->SetIntUniform(Uniform::Texture, EDiffuseTextureUnit);
+				shader->SetIntUniform(Uniform::LightData, ELightDataUnit);
+				shader->SetIntUniform(Uniform::ClusterGrid, EClusterGridUnit);
+				shader->SetIntUniform(Uniform::LightIndices, ELightIndicesUnit);
+				shader->SetArrayUniform(Uniform::MatrixPalette, bindPose.data(), MaxSkeletonBones);
+			}
 		}
 	}
 	return true;
@@ -300,25 +991,59 @@ void Renderer::CreateSpriteVerts()
 	mSpriteVerts = new VertexArray(vertices, 4, indices, 6);
 }
 
-void Renderer::SetLightUniforms(Shader* shader) {
-	// Camera position is from inverted view
-	// Inverting camera matrix, allow us to get camera position from the first row using GetTranslation()
-	Matrix4 invView = mView;
-	invView.Invert();
-	shader->SetVectorUniform("uCameraPos", invView.GetTranslation());
+void Renderer::UpdateFrameUniforms(RenderSnapshot& snapshot) {
+	FrameConstants& frame = snapshot.mFrameConstants;
+	frame.mViewProj = mView * mProjection;
+	// The view matrix is a rigid transform (rotation in the upper 3x3, translation in the last row),
+	// so the camera position is the translation rotated back by the transposed rotation. No need to invert the whole matrix
+	const Vector3 trans = mView.GetTranslation();
+	frame.mCameraPos = Vector3(
+		-(trans.x * mView.mat[0][0] + trans.y * mView.mat[0][1] + trans.z * mView.mat[0][2]),
+		-(trans.x * mView.mat[1][0] + trans.y * mView.mat[1][1] + trans.z * mView.mat[1][2]),
+		-(trans.x * mView.mat[2][0] + trans.y * mView.mat[2][1] + trans.z * mView.mat[2][2])
+	);
+	mCameraPosition = frame.mCameraPos;
 	// Ambient light
-	shader->SetVectorUniform("uAmbientLight", mAmbientLight);
+	frame.mAmbientLight = mAmbientLight;
 	// Directional light
-	shader->SetVectorUniform("uDirLight.mDirection", mDirectionalLight.mDirection);
-	shader->SetVectorUniform("uDirLight.mDiffuseColor", mDirectionalLight.mDiffuseColor);
-	shader->SetVectorUniform("uDirLight.mSpecularColor", mDirectionalLight.mSpecularColor);
-	// Point lights
-	const unsigned int numPointLights = 4;
-	for (unsigned int i = 0; i < numPointLights; i++) {
-		shader->SetVectorUniform("uPointLights[" + std::to_string(i) + "].mPosition", mPointLights[i].mPosition);
-		shader->SetVectorUniform("uPointLights[" + std::to_string(i) + "].mDiffuseColor", mPointLights[i].mDiffuseColor);
-		shader->SetVectorUniform("uPointLights[" + std::to_string(i) + "].mSpecularColor", mPointLights[i].mSpecularColor);
-		shader->SetFloatUniform("uPointLights[" + std::to_string(i) + "].mSpecPower", mPointLights[i].mSpecPower);
-		shader->SetFloatUniform("uPointLights[" + std::to_string(i) + "].mRadius", mPointLights[i].mRadius);
-	}
-}
\ No newline at end of file
+	frame.mDirDirection = mDirectionalLight.mDirection;
+	frame.mDirDiffuseColor = mDirectionalLight.mDiffuseColor;
+	frame.mDirSpecularColor = mDirectionalLight.mSpecularColor;
+	// Clusters
+	frame.mView = mView;
+	frame.mClusterDims[0] = static_cast<float>(LightClusters::TilesX);
+	frame.mClusterDims[1] = static_cast<float>(LightClusters::TilesY);
+	frame.mClusterDims[2] = static_cast<float>(LightClusters::Slices);
+	frame.mClusterDims[3] = 0.f;
+	frame.mClusterDepth[0] = mLightClusters->GetSliceScale();
+	frame.mClusterDepth[1] = mLightClusters->GetSliceBias();
+	// The fragment coordinates are in the pixels of the scene
+	frame.mClusterDepth[2] = static_cast<float>(snapshot.mSceneWidth);
+	frame.mClusterDepth[3] = static_cast<float>(snapshot.mSceneHeight);
+
+	// Point lights: 3 texels per light (position + radius, diffuse + specular power, specular)
+	snapshot.mLightData.resize(mPointLights.size() * 12);
+	for (size_t i = 0; i < mPointLights.size(); i++) {
+		const PointLight& light = mPointLights[i];
+		float* texels = &snapshot.mLightData[i * 12];
+		texels[0] = light.mPosition.x;
+		texels[1] = light.mPosition.y;
+		texels[2] = light.mPosition.z;
+		texels[3] = light.mRadius;
+		texels[4] = light.mDiffuseColor.x;
+		texels[5] = light.mDiffuseColor.y;
+		texels[6] = light.mDiffuseColor.z;
+		texels[7] = light.mSpecPower;
+		texels[8] = light.mSpecularColor.x;
+		texels[9] = light.mSpecularColor.y;
+		texels[10] = light.mSpecularColor.z;
+		texels[11] = 0.f;
+	}
+
+	// Assign the lights to the clusters and copy the lists
+	mLightClusters->AssignLights(mPointLights, mView);
+	const std::vector<uint32_t>& grid = mLightClusters->GetClusterGrid();
+	snapshot.mClusterGrid.assign(grid.begin(), grid.end());
+	const std::vector<uint16_t>& indices = mLightClusters->GetLightIndices();
+	snapshot.mLightIndices.assign(indices.begin(), indices.end());
+}
@@ -1,7 +1,13 @@
 #pragma once
 #include <SDL.h>
 #include <unordered_map>
+#include <vector>
+#include <string>
+#include <mutex>
 #include "Math.h"
+#include "OcclusionCuller.h"
+#include "RenderDevice.h"
+#include "RenderStats.h"
 
 // Struct for directional light (to pass as uniform to Phong.frag)
 struct DirectionaLight {
@@ -26,20 +32,81 @@ struct PointLight {
 	float mRadius;
 };
 
+// Layout of the "FrameConstants" uniform block (std140). Every vec3 takes 16 bytes, so each one is padded with a float
+struct FrameConstants {
+	// View-projection matrix for 3D shaders
+	Matrix4 mViewProj;
+	// Camera position in world space
+	Vector3 mCameraPos;
+	float mPad0;
+	// Ambient light level
+	Vector3 mAmbientLight;
+	float mPad1;
+	// Directional light
+	Vector3 mDirDirection;
+	float mPad2;
+	Vector3 mDirDiffuseColor;
+	float mPad3;
+	Vector3 mDirSpecularColor;
+	float mPad4;
+	// View matrix, used to find the depth slice of the fragment
+	Matrix4 mView;
+	// Number of clusters along x, y and depth (w unused)
+	float mClusterDims[4];
+	// Slice scale and bias (slice = log(depth) * scale + bias), screen width and height
+	float mClusterDepth[4];
+};
+
+static_assert(sizeof(FrameConstants) == 240, "FrameConstants must match the std140 layout of the uniform block");
+
+// Constants of one draw, same layout as the uniform block in Shaders/Include/ObjectConstants.glsl
+struct ObjectConstants {
+	Matrix4 mWorldTransform;
+	float mSpecPower;
+	// Layer of the texture in its array (0 if not packed)
+	float mTextureLayer;
+	float mPad[2];
+};
+
+static_assert(sizeof(ObjectConstants) == 80, "ObjectConstants must match the std140 layout of the uniform block");
+
+// Texture units used by the 3D shaders
+enum TextureUnit {
+	// Diffuse texture of the mesh
+	EDiffuseTextureUnit = 0,
+	// Clustered lighting buffers: light data, cluster grid and light index list
+	ELightDataUnit = 1,
+	EClusterGridUnit = 2,
+	ELightIndicesUnit = 3
+};
+
+// Level of detail statistics of the last frame
+struct LodStats {
+	// Triangles drawn with the selected levels of detail
+	unsigned int mTrianglesSubmitted;
+	// Triangles that would have been drawn with every mesh at full detail
+	unsigned int mTrianglesFullDetail;
+};
+
 class Renderer {
 public:
 	Renderer(class Game* game);
 	~Renderer();
 
-	// Initialize and shutdown renderer
-	bool Initialize(float screenWidth, float screenHeight);
+	// Initialize and shutdown renderer. The backend selects the render device (OpenGL or null)
+	bool Initialize(float screenWidth, float screenHeight, RenderBackend backend = EOpenGLBackend);
 	void ShutDown();
 
 	// Unload all textures/meshes
 	void UnloadData();
 
-	// Draw the fram
+	// Draw the frame: build the snapshot of the frame and draw it, or hand it to the render thread if it is running
 	void Draw();
+	// Move the device context to a render thread that draws the frames while the game updates the next one.
+	// Call it after the level is loaded; meshes and textures loaded later are created on the render thread
+	void StartRenderThread();
+	// Join the render thread and take the context back (called by ShutDown)
+	void StopRenderThread();
 
 	// add sprite
 	void AddSprite(class SpriteComponent* sprite);
@@ -49,34 +116,121 @@ public:
 	// Add/Remove mesh components
 	void AddMeshComp(std::string shader, class MeshComponent* mesh);
 	void RemoveMeshComp(std::string shader, class MeshComponent* mesh);
+	// Add a component whose mesh is still loading: it is drawn once the mesh is loaded
+	void AddPendingMeshComp(class MeshComponent* mesh);
 
-	// Get a texture from map
+	// Get a texture from map. A texture still loading asynchronously is finished first
 	class Texture* GetTexture(const std::string& fileName);
-	// Get a mesh from map
+	// Get a mesh from map. A mesh still loading asynchronously is finished first
 	class Mesh* GetMesh(const std::string& mesh);
+	// Get a texture/mesh from map without waiting: a new one is returned at once and loaded in the background
+	// (see AsyncLoader). Meshes are drawn once loaded, textures bind a placeholder until then
+	class Texture* GetTextureAsync(const std::string& fileName);
+	class Mesh* GetMeshAsync(const std::string& fileName);
+	// Add a copy of a loaded mesh (full detail only) drawn with other textures, selected by the texture index of its
+	// components. nullptr if the name is taken or the mesh is skinned
+	class Mesh* CreateMeshCopy(const std::string& name, class Mesh* source, const std::vector<class Texture*>& textures);
+	// Time the thread of the device spends creating the resources loaded in the background, per frame
+	void SetUploadBudget(float ms) { mUploadBudgetMs = ms; }
+	// Merge the meshes of the static actors into world space batches (replacing the previous ones).
+	// Call it after the level is loaded. Batched actors must not move or be destroyed until the batches are rebuilt
+	void BuildStaticBatches();
+	// Pack the loaded textures of the same size and format in texture arrays, so their draws don't rebind textures
+	// (see TextureArray). Packed textures are not streamed anymore. Call it after the level is loaded
+	void BuildTextureArrays();
+	// Load the potentially visible sets of the level. Without them (missing file, or baked from other geometry) nothing is
+	// culled by cell
+	bool LoadPvs(const std::string& fileName);
+	// Bake the potentially visible sets of the static actors for a camera moving between minZ and maxZ
+	bool BakePvs(const std::string& fileName, float minZ, float maxZ);
+	// World space triangles (3 positions each) of the static actors, baked in the potentially visible sets
+	void GetOccluderTriangles(std::vector<Vector3>& outTriangles);
+	// Get the geometry arena of the vertex layout (created the first time)
+	class GeometryArena* GetGeometryArena(const class VertexLayout& layout);
 
 	void SetViewMatrix(const Matrix4& view) { mView = view; }
 	void SetAmbientLight(const Vector3& ambientLight) { mAmbientLight = ambientLight; }
 	DirectionaLight& GetDirectionalLight() { return mDirectionalLight; }
-	PointLight* GetPointLights() { return mPointLights; }
+	std::vector<PointLight>& GetPointLights() { return mPointLights; }
+	// Level of detail selection
+	const LodStats& GetLodStats() const { return mLodStats; }
+	void SetLodHysteresis(float hysteresis) { mLodHysteresis = hysteresis; }
+	// Software occlusion culling against the static batches
+	void SetOcclusionCulling(bool enabled) { mOcclusionCulling = enabled; }
+	// Draw the 3D scene at a resolution adjusted to the GPU time of the frames, then stretch it to the window (the
+	// sprites stay at the window resolution). The target time and the scale bounds are set on the controller
+	void SetDynamicResolution(bool enabled);
+	class DynamicResolution* GetDynamicResolution() const { return mDynamicResolution; }
+	// Draw the depth of the opaque meshes front to back before their colour, so each pixel is shaded once.
+	// It costs a second geometry pass: toggle it at runtime and compare the GPU time of the frames (see FrameStats)
+	void SetDepthPrepass(bool enabled) { mDepthPrepass = enabled; }
+	bool GetDepthPrepass() const { return mDepthPrepass; }
+	OcclusionCuller::Stats GetOcclusionStats() const { return mOcclusionCuller->GetStats(); }
+	// CPU, GPU and command counts of the last frame drawn (GPU times lag a few frames behind, see FrameStats)
+	FrameStats GetFrameStats() const { return mLastFrameStats; }
+	// Write the stats of every frame drawn to a CSV file (or JSON if the name ends with ".json"), until StopStatsCapture
+	bool StartStatsCapture(const std::string& fileName);
+	void StopStatsCapture();
+	// Device memory allowed for the streamed texture levels (see TextureStreamer)
+	void SetTextureBudget(size_t bytes);
+	size_t GetResidentTextureBytes() const;
+	// Transient data of the frame drawn (see RingBuffer). Thread of the device, in the upload pass of DrawSnapshot
+	class RingBuffer* GetStreamBuffer() const { return mStreamBuffer; }
+
+	// Bytes of the stream buffer available to each frame
+	static const unsigned int StreamBufferFrameSize = 4 << 20;
+	// Bytes of object constants available to each frame at first (the buffer grows with the draws)
+	static const unsigned int ObjectConstantsFrameSize = 1 << 20;
 
 private:
 	// Load sprite shader program and active it
 	bool LoadShaders();
 	// Create a quad shader
 	void CreateSpriteVerts();
-	// Set light uniforms
-	void SetLightUniforms(class Shader* shader);
+	// Fill the frame constants, assign the point lights to the clusters and copy the light lists in the snapshot.
+	// Called once per frame
+	void UpdateFrameUniforms(struct RenderSnapshot& snapshot);
+	// Cull, record and copy in the snapshot everything needed to draw the frame. Game thread, no OpenGL calls
+	void BuildSnapshot(struct RenderSnapshot& snapshot);
+	// Upload the snapshot data, draw its packets and swap the buffers. Called by the thread that owns the context
+	void DrawSnapshot(const struct RenderSnapshot& snapshot);
+	// Write the object constants of every packet in mObjectConstantsBuffer, mObjectConstantsStride bytes apart.
+	// Return the offset of the constants of the first packet
+	unsigned int WriteObjectConstants(const std::vector<struct DrawPacket>& packets);
+	// Bind and draw the recorded packets from first to last (excluded), whose constants were written at objectsOffset.
+	// The only place where the draw calls of the packets are made
+	void ExecutePackets(const std::vector<struct DrawPacket>& packets, size_t first, size_t last, unsigned int objectsOffset);
+	// Draw the depth of the opaque packets in the depth order of the snapshot, with the depth shader
+	void ExecuteDepthPrepass(const struct RenderSnapshot& snapshot, unsigned int objectsOffset);
+	// Mark the resources uploaded since the last frame loaded, set the textures of the meshes read and queue
+	// their upload, and move the components of the loaded meshes in the drawn ones. Game thread
+	void UpdateAsyncLoads();
+	// support method. Wait for a resource loading in the background, uploading it from this thread
+	void FinishAsyncLoad(const void* resource);
+	// Take the stats of the frames drawn since the last call, keep the last one and write them to the capture file.
+	// Game thread
+	void CollectFrameStats();
 
 	// map of textures
 	std::unordered_map<std::string, class Texture*> mTextures;
+	// Arrays of the packed textures
+	std::vector<class TextureArray*> mTextureArrays;
+	// Loads the mip levels of the cooked textures that the frames need, under a memory budget
+	class TextureStreamer* mTextureStreamer;
 	// map of meshes
 	std::unordered_map<std::string, class Mesh*> mMeshes;
+	// Reads meshes and textures on its threads, uploads them in slices of mUploadBudgetMs
+	class AsyncLoader* mAsyncLoader;
+	float mUploadBudgetMs;
+	// Texture bound instead of the textures still loading (1x1 grey)
+	TextureHandle mPlaceholderTexture;
 
 	// All the sprite components drawn
 	std::vector<class SpriteComponent*> mSprites;
 	// All the mesh components drawn
 	std::unordered_map<std::string, std::vector<class MeshComponent*>> mMeshComponents;
+	// Mesh components waiting for their mesh
+	std::vector<class MeshComponent*> mPendingMeshComps;
 
 	// Game
 	class Game* mGame;
@@ -85,26 +239,78 @@ private:
 	//class Shader* mSpriteShader;
 	// Vertex array for sprites
 	class VertexArray* mSpriteVerts;
-	// Mesh shader
-	std::unordered_map<std::string, class Shader*> mMeshShaders;
+	// Mesh shader, with the variants of its features
+	std::unordered_map<std::string, class ShaderPermutations*> mMeshShaders;
+	// Shader of the depth pre-pass ("Depth" in the manifest, nullptr if missing) and whether the pre-pass is drawn
+	class ShaderPermutations* mDepthShader;
+	bool mDepthPrepass;
+	// Merged meshes of the static actors, drawn instead of their mesh components
+	// (grouped by shader, like the mesh components)
+	std::unordered_map<std::string, std::vector<class StaticBatch*>> mStaticBatches;
+	// Shared vertex/index buffers of the meshes, one arena per vertex layout
+	std::vector<class GeometryArena*> mGeometryArenas;
 	//class Shader* mMeshShader;
 
 
 	// View/projection for 3D shaders
 	Matrix4 mView;
 	Matrix4 mProjection;
+	// Near/far planes of the projection
+	float mNearPlane;
+	float mFarPlane;
 	// Width/height of screen
 	float mScreenWidth;
 	float mScreenHeight;
+	// Resolution of the 3D scene, and the window sized target it is drawn in (0 if it can't be created)
+	class DynamicResolution* mDynamicResolution;
+	RenderTargetHandle mSceneTarget;
 
 	// Light members
 	Vector3 mAmbientLight;
 	DirectionaLight mDirectionalLight;
-	PointLight mPointLights[4];
+	std::vector<PointLight> mPointLights;
+
+	// Uniform buffer object shared by all the 3D shaders
+	class UniformBuffer* mFrameConstantsBuffer;
+	// Assignment of the point lights to the view frustum clusters
+	class LightClusters* mLightClusters;
+	// Point light data (3 RGBA32F texels per light), cluster grid (offset, count) and light index list
+	class TextureBuffer* mLightDataBuffer;
+	class TextureBuffer* mClusterGridBuffer;
+	class TextureBuffer* mLightIndexBuffer;
+	// Per-frame data written by the CPU (the light lists), copied by the GPU to the buffers read by the shaders
+	class RingBuffer* mStreamBuffer;
+	// Constants of the draws of the frame, and bytes between those of two draws (uniform buffer offset alignment)
+	class RingBuffer* mObjectConstantsBuffer;
+	unsigned int mObjectConstantsStride;
+
+	// Fraction past a level of detail threshold needed to switch level
+	float mLodHysteresis;
+	// Triangles submitted in the last frame
+	LodStats mLodStats;
+	// CPU depth buffer of the occluders, and whether meshes are tested against it
+	OcclusionCuller* mOcclusionCuller;
+	bool mOcclusionCulling;
+	// Cell to cell visibility of the level (nullptr if not loaded)
+	class PotentiallyVisibleSet* mPvs;
+	// Draw packets of the frame, recorded in parallel
+	class RenderQueue* mRenderQueue;
+	// Thread that owns the device context once started, and the snapshots it draws
+	class RenderThread* mRenderThread;
+	// World space position of the camera, extracted from the view matrix every frame
+	Vector3 mCameraPosition;
 
-	// Window created by SDL
-	SDL_Window* mWindow;
-	// OpenGL Context: this is the "world" of OpenGL that contains every item that OpengGl knows about
-	// such as color buffer, images, model loaded and any other OpenGL objects
-	SDL_GLContext mContext;
+	// Render device: window, context and every call to the graphics API
+	class RenderDevice* mDevice;
+	// GPU time of the passes, measured on the thread that draws
+	GpuTimer* mGpuTimer;
+	// Stats of the frames drawn by the render thread, waiting to be collected by the game thread
+	std::vector<FrameStats> mDrawnFrameStats;
+	std::mutex mStatsMutex;
+	// Last frame collected, and file the stats are written to (nullptr: no capture)
+	FrameStats mLastFrameStats;
+	RenderStatsFile* mStatsFile;
+	// Frames built so far, and performance counter at the start of the last Draw
+	uint64_t mFrameIndex;
+	uint64_t mLastDrawCounter;
 };
\ No newline at end of file
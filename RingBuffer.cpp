@@ -0,0 +1,84 @@
+#include "RingBuffer.h"
+#include <SDL.h>
+#include <cstring>
+
+RingBuffer::RingBuffer(BufferType type, unsigned int frameSize) :
+	mBuffer(0),
+	mFrameSize((frameSize + MaxAlignment - 1) & ~(MaxAlignment - 1)),
+	mPersistentData(nullptr),
+	mRegion(0),
+	mData(nullptr),
+	mUsed(0),
+	mFences{},
+	mOverflowLogged(false)
+{
+	RenderDevice* device = RenderDevice::Get();
+	void* data = nullptr;
+	mBuffer = device->CreateMappedBuffer(type, mFrameSize * NumFrames, &data);
+	if (mBuffer) {
+		mPersistentData = static_cast<unsigned char*>(data);
+	}
+	else {
+		mBuffer = device->CreateBuffer(type, mFrameSize * NumFrames, nullptr, EStreamBuffer);
+	}
+}
+
+RingBuffer::~RingBuffer() {
+	RenderDevice* device = RenderDevice::Get();
+	if (mData && !mPersistentData) device->UnmapBuffer(mBuffer);
+	for (FenceHandle fence : mFences) {
+		if (fence) device->DestroyFence(fence);
+	}
+	device->DestroyBuffer(mBuffer);
+}
+
+void RingBuffer::BeginFrame() {
+	RenderDevice* device = RenderDevice::Get();
+	mRegion = (mRegion + 1) % NumFrames;
+	FenceHandle& fence = mFences[mRegion];
+	if (fence) {
+		if (!device->WaitFence(fence, FenceTimeout)) SDL_Log("Ring buffer: the GPU is still reading the region %u", mRegion);
+		device->DestroyFence(fence);
+		fence = 0;
+	}
+	mUsed = 0;
+	if (mPersistentData) {
+		mData = mPersistentData + mRegion * mFrameSize;
+	}
+	else {
+		mData = static_cast<unsigned char*>(device->MapBufferRange(mBuffer, mRegion * mFrameSize, mFrameSize));
+		if (!mData) SDL_Log("Ring buffer: failed to map the region %u", mRegion);
+	}
+}
+
+void* RingBuffer::Allocate(unsigned int size, unsigned int alignment, unsigned int& outOffset) {
+	if (!mData || size == 0) return nullptr;
+	// The regions start at a multiple of MaxAlignment: aligning in the region aligns in the buffer
+	const unsigned int start = (mUsed + alignment - 1) & ~(alignment - 1);
+	if (start > mFrameSize || size > mFrameSize - start) {
+		if (!mOverflowLogged) SDL_Log("Ring buffer: the %u bytes of the frame are full", mFrameSize);
+		mOverflowLogged = true;
+		return nullptr;
+	}
+	mUsed = start + size;
+	outOffset = mRegion * mFrameSize + start;
+	return mData + start;
+}
+
+bool RingBuffer::Write(const void* data, unsigned int size, unsigned int alignment, unsigned int& outOffset) {
+	void* dest = Allocate(size, alignment, outOffset);
+	if (!dest) return false;
+	memcpy(dest, data, size);
+	return true;
+}
+
+void RingBuffer::FinishWrites() {
+	// Coherent persistent mappings need no flush
+	if (mData && !mPersistentData) RenderDevice::Get()->UnmapBuffer(mBuffer);
+	mData = nullptr;
+}
+
+void RingBuffer::EndFrame() {
+	if (mData) FinishWrites();
+	mFences[mRegion] = RenderDevice::Get()->InsertFence();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "RenderDevice.h"
+
+// Transient per-frame data (dynamic vertices, constants, light lists) written by the CPU into one large buffer split
+// in NumFrames regions. Each frame writes its own region while the GPU still reads the regions of the previous frames:
+// a fence inserted after the commands of a frame guards its region, and BeginFrame waits for it before the region is
+// written again (which only blocks when the CPU is NumFrames frames ahead of the GPU). The storage is mapped
+// persistently when the device can, otherwise the region of the frame is mapped unsynchronized.
+// A frame is BeginFrame, Allocate/Write, FinishWrites, the commands reading the data, EndFrame. Thread of the device
+class RingBuffer {
+public:
+	// frameSize: bytes available to each frame
+	RingBuffer(BufferType type, unsigned int frameSize);
+	~RingBuffer();
+
+	// Wait until the GPU is done with the region of this frame and map it
+	void BeginFrame();
+	// Bytes in the region of the frame, at an offset (in the buffer) multiple of alignment, a power of two up to
+	// MaxAlignment. The memory is write-only and valid until FinishWrites. Return nullptr if the region is full
+	void* Allocate(unsigned int size, unsigned int alignment, unsigned int& outOffset);
+	// Allocate and copy the data. Return false if it doesn't fit
+	bool Write(const void* data, unsigned int size, unsigned int alignment, unsigned int& outOffset);
+	// End of the writes of the frame: the device can read the buffer from now on (copies, draws)
+	void FinishWrites();
+	// After the last command reading the region of the frame
+	void EndFrame();
+
+	BufferHandle GetBuffer() const { return mBuffer; }
+	bool IsPersistent() const { return mPersistentData != nullptr; }
+	unsigned int GetFrameSize() const { return mFrameSize; }
+	// Bytes allocated in the region of the frame
+	unsigned int GetUsed() const { return mUsed; }
+
+	static const unsigned int NumFrames = 3;
+	// Largest alignment of the allocations (uniform buffer offsets need up to 256 bytes)
+	static const unsigned int MaxAlignment = 256;
+	// Longest wait for the fence of a region. The region is written anyway after it
+	static const uint64_t FenceTimeout = 1000000000;
+
+private:
+	// Render device handle of the buffer, with NumFrames regions of mFrameSize bytes
+	BufferHandle mBuffer;
+	unsigned int mFrameSize;
+	// The whole storage, mapped for the life of the buffer (nullptr: the region is mapped each frame)
+	unsigned char* mPersistentData;
+	// Region of the current frame, its mapped memory (nullptr outside BeginFrame/FinishWrites) and the bytes allocated
+	unsigned int mRegion;
+	unsigned char* mData;
+	unsigned int mUsed;
+	// Fence of each region (0: not read by the GPU)
+	FenceHandle mFences[NumFrames];
+	// A region overflowed (logged the first time only)
+	bool mOverflowLogged;
+};
@@ -1,178 +1,208 @@
 #include <fstream>
 #include <sstream>
 #include "Shader.h"
-#include "Texture.h"
 #include <SDL.h>
 #include <iostream>
+#include <algorithm>
 
 Shader::Shader() :
-	mVertexShader(0),
-	mFragShader(0),
 	mShaderProgram(0)
 {}
 
 Shader::~Shader(){}
 
-bool Shader::CompileShader(const std::string& shaderName, GLenum shaderType, GLuint& outShader) {
+bool Shader::ReadSource(const std::string& fileName, std::string& outSource) {
 	// Open the shader file
-	std::ifstream shaderFile(shaderName);
-	if (shaderFile.is_open()) {
-		// Insert all the code inside the shader file into a string
-		std::stringstream sstream;
-		// read the file buffer
-		sstream << shaderFile.rdbuf();
-		// insert the sstream content inside a string
-		std::string contents = sstream.str();
-		// convert string to a pointer to char
-		const char* contentsChar = contents.c_str();
-
-		// create a shader of the specified type
-		outShader = glCreateShader(shaderType);
-		// puts the entire program inside the char array into the shader source and compile it
-		glShaderSource(outShader, 1, &(contentsChar), nullptr);
-		glCompileShader(outShader);
-
-		// check if compiled successfully
-		if (!IsCompiled(outShader)) {
-			SDL_Log("Failed to compile shader program %s", shaderName.c_str());
-			return false;
-		}
-	}
-	else {
-		SDL_Log("Failed to open the shader file %s", shaderName.c_str());
+	std::ifstream shaderFile(fileName);
+	if (!shaderFile.is_open()) {
+		SDL_Log("Failed to open the shader file %s", fileName.c_str());
 		return false;
 	}
-	// Shader compiled successfully
+	// Insert all the code inside the shader file into a string
+	std::stringstream sstream;
+	sstream << shaderFile.rdbuf();
+	outSource = sstream.str();
 	return true;
 }
 
-bool Shader::IsCompiled(GLuint shaderID) {
-	// store the compilation status
-	GLint status;
-	// Query the compilation status of the specified shader and store the status
-	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &status);
-	if (status != GL_TRUE) {
-		char errMsg[512];
-		memset(errMsg, 0, 512);
-		glGetShaderInfoLog(shaderID, 511, nullptr, errMsg);
-		SDL_Log("GLSL Compile failed: \n%s", errMsg);
+bool Shader::Load(const std::string& vertName, const std::string& fragName) {
+	std::string vertSource;
+	std::string fragSource;
+	if (!ReadSource(vertName, vertSource) || !ReadSource(fragName, fragSource)) {
 		return false;
 	}
-	// Shader compiled successfully
-	return true;
-}
 
-bool Shader::Load(const std::string& vertName, const std::string& fragName) {
-	// Compile vertex and fragment shaders, stores theirs ID and check if compiled
-	if (!CompileShader(vertName, GL_VERTEX_SHADER, mVertexShader) ||
-		!CompileShader(fragName, GL_FRAGMENT_SHADER, mFragShader)) {
+	// Compile vertex and fragment shaders and link them in a program
+	std::string error;
+	mShaderProgram = RenderDevice::Get()->CreateProgram(vertSource, fragSource, error);
+	if (!mShaderProgram) {
+		SDL_Log("Failed to build shader program %s / %s:\n%s", vertName.c_str(), fragName.c_str(), error.c_str());
 		return false;
 	}
 
-	// Create a program that link vertex and fragment shaders, and store the shader program ID
-	mShaderProgram = glCreateProgram();
-	glAttachShader(mShaderProgram, mVertexShader);
-	glAttachShader(mShaderProgram, mFragShader);
-	glLinkProgram(mShaderProgram);
-
-	// verify is program linked successfully
-	if (!IsValidProgram()) return false;
+	SetProgram(mShaderProgram);
 
 	// Shader program created successfully
 	return true;
 }
 
+void Shader::SetProgram(ProgramHandle program) {
+	mShaderProgram = program;
+	// Build the table of active uniforms so that setters don't need to query the device by name
+	ReflectUniforms();
+}
+
 void Shader::Unload() {
-	// delete program and shaders
-	glDeleteProgram(mShaderProgram);
-	glDeleteShader(mVertexShader);
-	glDeleteShader(mFragShader);
-}
-
-bool Shader::IsValidProgram() {
-	// Store the linking status
-	GLint status;
-	// Query the linking status of the specified program
-	glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &status);
-	if (status != GL_TRUE) {
-		char errMsg[512];
-		memset(errMsg, 0, 512);
-		glGetProgramInfoLog(mShaderProgram, 511, nullptr, errMsg);
-		SDL_Log("GLSL Link Failed:\n%s", errMsg);
-		return false;
-	}
-	// program linked successfully
-	return true;
+	// delete program
+	if (mShaderProgram) RenderDevice::Get()->DestroyProgram(mShaderProgram);
+	mShaderProgram = 0;
 }
 
 void Shader::SetActive() {
 	// Use the specified shader program to draw polygons
-	glUseProgram(mShaderProgram);
-}
-
-void Shader::SetMatrixUniform(const std::string matrixName, const Matrix4& matrix) {
-	// Find the uniform variable by its name
-	GLuint uniformId;
-	// Check if the ID was already obtained. Otherwise, create new ID and cache it
-	if (mUniforms.find(matrixName) != mUniforms.end())
-		uniformId = mUniforms.at(matrixName);
-	else {
-		uniformId = glGetUniformLocation(mShaderProgram, matrixName.c_str());
-		mUniforms[matrixName] = uniformId;
-	}
+	RenderDevice::Get()->UseProgram(mShaderProgram);
+}
 
-	// Send the matrix data to the uniform
-	glUniformMatrix4fv(
-		uniformId,				// Uniform ID
-		1,						// Number of matrices
-		GL_TRUE,				// Set to true if use row vector for multiplication
-		matrix.GetAsFloatPtr()	// Pointer to the matrix data
-	);
-}
-
-void Shader::SetVectorUniform(const std::string vectorName, const Vector3& vec) {
-	// Find the uniform variable by its name
-	GLuint uniformId;
-	// Check if the ID was already obtained. Otherwise, create new ID and cache it
-	if (mUniforms.find(vectorName) != mUniforms.end()) {
-		uniformId = mUniforms.at(vectorName);
-	}
-	else {
-		uniformId = glGetUniformLocation(mShaderProgram, vectorName.c_str());
-		mUniforms[vectorName] = uniformId;
+void Shader::ReflectUniforms() {
+	mUniforms.clear();
+	mShadowData.clear();
+
+	std::vector<ProgramUniform> uniforms;
+	RenderDevice::Get()->GetProgramUniforms(mShaderProgram, uniforms);
+	for (const ProgramUniform& uniform : uniforms) {
+		// Arrays may be reported as "name[0]". Strip the suffix so that the handle is the hash of the plain name
+		std::string uniformName(uniform.mName);
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+			uniformName.resize(uniformName.size() - 3);
+		}
+
+		UniformSlot slot;
+		slot.mHandle = HashUniformName(uniformName.c_str());
+		slot.mLocation = uniform.mLocation;
+		slot.mCount = uniform.mCount;
+		slot.mElementSize = uniform.mElementSize;
+		slot.mShadowOffset = static_cast<unsigned int>(mShadowData.size());
+		// Size of the shadow copy: one element size per array element
+		slot.mShadowSize = uniform.mElementSize * uniform.mCount;
+		slot.mHasValue = false;
+		mShadowData.resize(mShadowData.size() + slot.mShadowSize);
+		mUniforms.emplace_back(slot);
 	}
 
-	// Send the vector data to the uniform
-	glUniform3fv(uniformId, 1, vec.GetAsFloatPtr());
+	// Sort by handle so that lookups are a binary search over a contiguous array
+	std::sort(mUniforms.begin(), mUniforms.end(), [](const UniformSlot& a, const UniformSlot& b) {
+		return a.mHandle < b.mHandle;
+	});
+	for (size_t i = 1; i < mUniforms.size(); i++) {
+		if (mUniforms[i].mHandle == mUniforms[i - 1].mHandle) {
+			SDL_Log("Uniform name hash collision in shader program %u", mShaderProgram);
+		}
+	}
 }
 
-template<typename T>
-void Shader::SetArrayUniform(const std::string arrayName, const T* arr, const unsigned int n) {
-	// Find the uniform location by name
-	GLuint uniformId;
-	if (mUniforms.find(arrayName) != mUniforms.end()) {
-		uniformId = mUniforms.at(arrayName);
+Shader::UniformSlot* Shader::FindUniform(UniformHandle handle) {
+	auto iter = std::lower_bound(mUniforms.begin(), mUniforms.end(), handle, [](const UniformSlot& slot, UniformHandle h) {
+		return slot.mHandle < h;
+	});
+	if (iter != mUniforms.end() && iter->mHandle == handle) {
+		return &(*iter);
 	}
-	else {
-		uniformId = glGetUniformLocation(mShaderProgram, arrayName.c_str());
-		mUniforms[arrayName] = uniformId;
+	return nullptr;
+}
+
+bool Shader::UpdateShadow(UniformSlot& slot, const void* data, unsigned int elementSize, unsigned int count) {
+	// A value of another type would overwrite the shadows of the next uniforms
+	const unsigned int size = elementSize * count;
+	if (elementSize != slot.mElementSize || size > slot.mShadowSize) {
+		SDL_Log("Uniform %u of shader program %u: %u values of %u bytes don't match its type (%u values of %u bytes)",
+			slot.mHandle, mShaderProgram, count, elementSize, slot.mCount, slot.mElementSize);
+		return false;
 	}
+	unsigned char* shadow = mShadowData.data() + slot.mShadowOffset;
+	// Same value already uploaded: skip the upload
+	if (slot.mHasValue && memcmp(shadow, data, size) == 0) return false;
+	memcpy(shadow, data, size);
+	slot.mHasValue = true;
+	return true;
+}
 
-	// Send the array data to the uniform
-	glUniform1f(uniformId, n, arr);
+void Shader::SetMatrixUniform(UniformHandle handle, const Matrix4& matrix) {
+	// Find the uniform variable by its handle
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot || !UpdateShadow(*slot, matrix.GetAsFloatPtr(), 16 * sizeof(float), 1)) return;
+
+	// Send the matrix data to the uniform
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformMat4, 1, matrix.GetAsFloatPtr());
 }
 
-void Shader::SetFloatUniform(const std::string floatName, const float& flt) {
-	// Find the uniform location by its name
-	GLuint uniformId;
-	if (mUniforms.find(floatName) != mUniforms.end()) {
-		uniformId = mUniforms.at(floatName);
-	}
-	else {
-		uniformId = glGetUniformLocation(mShaderProgram, floatName.c_str());
-		mUniforms[floatName] = uniformId;
-	}
+void Shader::SetVectorUniform(UniformHandle handle, const Vector3& vec) {
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot || !UpdateShadow(*slot, vec.GetAsFloatPtr(), 3 * sizeof(float), 1)) return;
+
+	// Send the vector data to the uniform
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformVec3, 1, vec.GetAsFloatPtr());
+}
+
+void Shader::SetFloatUniform(UniformHandle handle, float flt) {
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot || !UpdateShadow(*slot, &flt, sizeof(float), 1)) return;
 
 	// Send the float data to the uniform
-	glUniform1f(uniformId, flt);
-}
\ No newline at end of file
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformFloat, 1, &flt);
+}
+
+void Shader::SetIntUniform(UniformHandle handle, int value) {
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot || !UpdateShadow(*slot, &value, sizeof(int), 1)) return;
+
+	// Send the int data to the uniform (also used for sampler units)
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformInt, 1, &value);
+}
+
+template<>
+void Shader::SetArrayUniform<float>(UniformHandle handle, const float* arr, unsigned int n) {
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot) return;
+	// Never write past the end of the uniform array
+	n = Math::Min(n, slot->mCount);
+	if (!UpdateShadow(*slot, arr, sizeof(float), n)) return;
+
+	// Send the whole array with a single call
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformFloat, n, arr);
+}
+
+template<>
+void Shader::SetArrayUniform<int>(UniformHandle handle, const int* arr, unsigned int n) {
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot) return;
+	n = Math::Min(n, slot->mCount);
+	if (!UpdateShadow(*slot, arr, sizeof(int), n)) return;
+
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformInt, n, arr);
+}
+
+template<>
+void Shader::SetArrayUniform<Vector3>(UniformHandle handle, const Vector3* arr, unsigned int n) {
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot) return;
+	n = Math::Min(n, slot->mCount);
+	// Vector3 is tightly packed (3 floats), so the array can be sent as it is
+	if (!UpdateShadow(*slot, arr, 3 * sizeof(float), n)) return;
+
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformVec3, n, arr->GetAsFloatPtr());
+}
+
+template<>
+void Shader::SetArrayUniform<Matrix4>(UniformHandle handle, const Matrix4* arr, unsigned int n) {
+	UniformSlot* slot = FindUniform(handle);
+	if (!slot) return;
+	n = Math::Min(n, slot->mCount);
+	if (!UpdateShadow(*slot, arr, 16 * sizeof(float), n)) return;
+
+	RenderDevice::Get()->SetUniform(slot->mLocation, EUniformMat4, n, arr->GetAsFloatPtr());
+}
+
+bool Shader::BindUniformBlock(const std::string& blockName, unsigned int bindingPoint) {
+	// The block reads its data from the buffer attached to the binding point
+	return RenderDevice::Get()->BindUniformBlock(mShaderProgram, blockName, bindingPoint);
+}
@@ -1,9 +1,29 @@
 #pragma once
 #include <string>
-#include <glew.h>
 #include "Math.h"
-#include <map>
-#include <string>
+#include "RenderDevice.h"
+#include <vector>
+
+// Integer handle of an uniform variable. It is the hash of the uniform name, so it can be computed at compile time
+typedef unsigned int UniformHandle;
+
+// FNV-1a hash of an uniform name. With a string literal the hash is computed by the compiler
+constexpr UniformHandle HashUniformName(const char* name, UniformHandle hash = 2166136261u) {
+	return *name ? HashUniformName(name + 1, (hash ^ static_cast<unsigned char>(*name)) * 16777619u) : hash;
+}
+
+// Handles of the uniforms used by the engine
+namespace Uniform {
+	constexpr UniformHandle ViewProj = HashUniformName("uViewProj");
+	constexpr UniformHandle Texture = HashUniformName("uTexture");
+	constexpr UniformHandle LightData = HashUniformName("uLightData");
+	constexpr UniformHandle ClusterGrid = HashUniformName("uClusterGrid");
+	constexpr UniformHandle LightIndices = HashUniformName("uLightIndices");
+	constexpr UniformHandle MatrixPalette = HashUniformName("uMatrixPalette");
+}
+
+// Size of uMatrixPalette (MAX_SKELETON_BONES of Shaders/Include/MeshVertex.glsl)
+const unsigned int MaxSkeletonBones = 96;
 
 class Shader {
 public:
@@ -12,29 +32,63 @@ public:
 
 	// Load the vertex/fragment shaders with the given name
 	bool Load(const std::string& vertName, const std::string& fragName);
-	// Unload the shader program by deleting vertex/fragment shaders and shader program
+	// Take ownership of a program already linked (see ShaderCache)
+	void SetProgram(ProgramHandle program);
+	// Unload the shader program
 	void Unload();
 	// Set this shader as the active shader program
 	void SetActive();
 	// Set the uniform matrix
-	void SetMatrixUniform(const std::string matrixName, const Matrix4& matrix);
-	void SetVectorUniform(const std::string vectorName, const Vector3& vec);
-	void SetFloatUniform(const std::string floatName, const float& flt);
+	// Uniforms that are not active in the program are ignored, values equal to the last uploaded one are skipped
+	void SetMatrixUniform(UniformHandle handle, const Matrix4& matrix);
+	void SetVectorUniform(UniformHandle handle, const Vector3& vec);
+	void SetFloatUniform(UniformHandle handle, float flt);
+	void SetIntUniform(UniformHandle handle, int value);
+	// Upload the first n elements of an uniform array with a single call
+	// Specialized for float, int, Vector3 and Matrix4
 	template<typename T>
-	void SetArrayUniform(const std::string arrayName, const T* arr, const unsigned int n);
+	void SetArrayUniform(UniformHandle handle, const T* arr, unsigned int n);
+	// Connect the uniform block with the given name to a uniform buffer binding point
+	// Return false if the program doesn't declare the block
+	bool BindUniformBlock(const std::string& blockName, unsigned int bindingPoint);
 
 private:
-	// support method. Tries to compile the specified shader program
-	bool CompileShader(const std::string& shaderName, GLenum shaderType, GLuint& outShader);
-	// support method. Tests whether shader compiled successfully
-	bool IsCompiled(GLuint shader);
-	// support method. Tests wheter vertex/fragment programs link
-	bool IsValidProgram();
-	// Store the shader object IDs
-	GLuint mVertexShader;
-	GLuint mFragShader;
-	// OpenGL use the current active shader program to render polygons
-	GLuint mShaderProgram;
-	// Map of uniform of the active shader
-	std::map<std::string, GLuint> mUniforms;
-};
\ No newline at end of file
+	// Active uniform found by reflection when the program is linked
+	struct UniformSlot {
+		// Hash of the uniform name (without the "[0]" suffix of arrays)
+		UniformHandle mHandle;
+		// Location of the uniform inside the program
+		int mLocation;
+		// Number of array elements (1 if not an array)
+		unsigned int mCount;
+		// Size in bytes of one element, from the reflected type (4: float, int, bool or sampler, 12: vec3, 64: mat4...)
+		unsigned int mElementSize;
+		// Offset and size (in bytes) of the shadow copy of the uniform value
+		unsigned int mShadowOffset;
+		unsigned int mShadowSize;
+		// The shadow copy holds a value uploaded at least once
+		bool mHasValue;
+	};
+
+	// support method. Read the whole source file of a shader
+	bool ReadSource(const std::string& fileName, std::string& outSource);
+	// support method. Query all the active uniforms of the linked program and build the uniform table
+	void ReflectUniforms();
+	// support method. Find the uniform with the given handle. Return nullptr if not active in the program
+	UniformSlot* FindUniform(UniformHandle handle);
+	// support method. Compare count elements of elementSize bytes with the shadow copy and store them.
+	// Return false if the uniform already holds this value (upload can be skipped), or if the value doesn't match the
+	// reflected type of the uniform (logged, nothing is stored or uploaded)
+	bool UpdateShadow(UniformSlot& slot, const void* data, unsigned int elementSize, unsigned int count);
+	// The render device uses the current active shader program to render polygons
+	ProgramHandle mShaderProgram;
+	// Flat table of the active uniforms of the program, sorted by handle
+	std::vector<UniformSlot> mUniforms;
+	// Shadow copy of the last value uploaded for each uniform
+	std::vector<unsigned char> mShadowData;
+};
+
+template<> void Shader::SetArrayUniform<float>(UniformHandle handle, const float* arr, unsigned int n);
+template<> void Shader::SetArrayUniform<int>(UniformHandle handle, const int* arr, unsigned int n);
+template<> void Shader::SetArrayUniform<Vector3>(UniformHandle handle, const Vector3* arr, unsigned int n);
+template<> void Shader::SetArrayUniform<Matrix4>(UniformHandle handle, const Matrix4* arr, unsigned int n);
@@ -0,0 +1,217 @@
+#include "ShaderCache.h"
+#include "Shader.h"
+#include "ShaderPermutations.h"
+#include "ShaderPreprocessor.h"
+#include "RenderDevice.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <rapidjson/document.h>
+#include <SDL.h>
+
+namespace fs = std::filesystem;
+
+const char* ShaderCache::CacheDirectory = "ShaderCache";
+
+// Read a whole text file (the manifest)
+static bool ReadFile(const std::string& fileName, std::string& outContents) {
+	std::ifstream file(fileName);
+	if (!file.is_open()) {
+		SDL_Log("Failed to open the shader file %s", fileName.c_str());
+		return false;
+	}
+	std::stringstream sstream;
+	sstream << file.rdbuf();
+	outContents = sstream.str();
+	return true;
+}
+
+uint64_t ShaderCache::Hash(const std::string& data, uint64_t hash) {
+	for (unsigned char c : data) {
+		hash = (hash ^ c) * 1099511628211ull;
+	}
+	return hash;
+}
+
+bool ShaderCache::ReadBinary(const std::string& fileName, uint64_t sourceHash, uint64_t driverHash, uint32_t& outFormat, std::vector<unsigned char>& outBinary) {
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open()) return false;
+	FileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		header.mMagic != FileMagic || header.mVersion != FileVersion ||
+		header.mSourceHash != sourceHash || header.mDriverHash != driverHash) {
+		return false;
+	}
+	outBinary.resize(header.mSize);
+	if (!file.read(reinterpret_cast<char*>(outBinary.data()), header.mSize)) return false;
+	outFormat = header.mFormat;
+	return true;
+}
+
+bool ShaderCache::WriteBinary(const std::string& fileName, uint64_t sourceHash, uint64_t driverHash, uint32_t format, const std::vector<unsigned char>& binary) {
+	std::error_code error;
+	fs::create_directories(CacheDirectory, error);
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		SDL_Log("Failed to write the program binary %s", fileName.c_str());
+		return false;
+	}
+	FileHeader header;
+	header.mMagic = FileMagic;
+	header.mVersion = FileVersion;
+	header.mSourceHash = sourceHash;
+	header.mDriverHash = driverHash;
+	header.mFormat = format;
+	header.mSize = static_cast<uint32_t>(binary.size());
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+	return true;
+}
+
+// Source string numbers of the #line directives, for the compiler messages
+static std::string DescribeFiles(const std::vector<std::string>& fileNames) {
+	std::string files;
+	for (size_t i = 0; i < fileNames.size(); i++) {
+		files += (i > 0 ? ", " : "") + std::to_string(i) + ": " + fileNames[i];
+	}
+	return files;
+}
+
+bool ShaderCache::LoadManifest(const std::string& manifestName, std::unordered_map<std::string, ShaderPermutations*>& outShaders) {
+	const uint64_t start = SDL_GetPerformanceCounter();
+	std::string contents;
+	if (!ReadFile(manifestName, contents)) return false;
+	rapidjson::StringStream jsonStr(contents.c_str());
+	rapidjson::Document doc;
+	doc.ParseStream(jsonStr);
+	if (!doc.IsObject() || !doc.HasMember("programs") || !doc["programs"].IsArray()) {
+		SDL_Log("Shader manifest %s is not valid json", manifestName.c_str());
+		return false;
+	}
+
+	// A variant of a program of the manifest, with its sources and where it comes from
+	struct ProgramEntry {
+		std::string mName;
+		ShaderPermutations* mPermutations;
+		unsigned int mVariant;
+		std::string mVertexSource;
+		std::string mFragmentSource;
+		std::string mFiles;
+		uint64_t mSourceHash;
+		ProgramHandle mProgram;
+		bool mCached;
+	};
+	std::vector<ProgramEntry> entries;
+	std::vector<ShaderPermutations*> permutations;
+	bool success = true;
+	const fs::path directory = fs::path(manifestName).parent_path();
+	const rapidjson::Value& programsJson = doc["programs"];
+	for (rapidjson::SizeType i = 0; i < programsJson.Size() && success; i++) {
+		const rapidjson::Value& programJson = programsJson[i];
+		if (!programJson.IsObject() || !programJson.HasMember("name") || !programJson.HasMember("vertex") || !programJson.HasMember("fragment")) {
+			SDL_Log("Shader manifest %s: program %u needs a name, a vertex and a fragment shader", manifestName.c_str(), i);
+			success = false;
+			break;
+		}
+		// Optional features: one variant is built for each combination
+		unsigned int features = 0;
+		if (programJson.HasMember("features")) {
+			const rapidjson::Value& featuresJson = programJson["features"];
+			for (rapidjson::SizeType j = 0; j < featuresJson.Size(); j++) {
+				unsigned int feature = ShaderPermutations::GetFeature(featuresJson[j].GetString());
+				if (!feature) {
+					SDL_Log("Shader manifest %s: unknown feature %s", manifestName.c_str(), featuresJson[j].GetString());
+				}
+				features |= feature;
+			}
+		}
+		ShaderPermutations* programPermutations = new ShaderPermutations(features);
+		permutations.emplace_back(programPermutations);
+
+		const std::string vertexName = (directory / programJson["vertex"].GetString()).string();
+		const std::string fragmentName = (directory / programJson["fragment"].GetString()).string();
+		ShaderPreprocessor preprocessor;
+		std::vector<std::string> defines;
+		for (unsigned int variant = 0; variant < programPermutations->GetNumVariants() && success; variant++) {
+			ShaderPermutations::GetDefines(programPermutations->GetVariantFeatures(variant), defines);
+			ProgramEntry entry;
+			entry.mName = programJson["name"].GetString();
+			entry.mPermutations = programPermutations;
+			entry.mVariant = variant;
+			success = preprocessor.Process(vertexName, defines, entry.mVertexSource);
+			entry.mFiles = "vertex " + DescribeFiles(preprocessor.GetFileNames());
+			success = success && preprocessor.Process(fragmentName, defines, entry.mFragmentSource);
+			entry.mFiles += "; fragment " + DescribeFiles(preprocessor.GetFileNames());
+			// The separator keeps "ab" + "c" and "a" + "bc" apart. Defines and includes are part of the sources
+			entry.mSourceHash = Hash(entry.mFragmentSource, Hash(std::string(1, '\0'), Hash(entry.mVertexSource)));
+			entry.mProgram = 0;
+			entry.mCached = false;
+			entries.emplace_back(entry);
+		}
+	}
+
+	RenderDevice* device = RenderDevice::Get();
+	const uint64_t driverHash = Hash(device->GetDriverId());
+	auto binaryName = [](const ProgramEntry& entry) {
+		return (fs::path(CacheDirectory) / (entry.mName + "." + std::to_string(entry.mVariant) + ".bin")).string();
+	};
+
+	// Warm start: programs whose binary matches the sources and the driver are ready without compiling
+	uint32_t format = 0;
+	std::vector<unsigned char> binary;
+	for (ProgramEntry& entry : entries) {
+		if (!success) break;
+		if (ReadBinary(binaryName(entry), entry.mSourceHash, driverHash, format, binary)) {
+			entry.mProgram = device->CreateProgramFromBinary(format, binary);
+			entry.mCached = entry.mProgram != 0;
+		}
+	}
+
+	// Send every remaining compilation before waiting for any of them
+	for (ProgramEntry& entry : entries) {
+		if (success && !entry.mCached) entry.mProgram = device->BeginProgram(entry.mVertexSource, entry.mFragmentSource);
+	}
+	unsigned int numCached = 0;
+	for (ProgramEntry& entry : entries) {
+		if (!entry.mProgram) continue;
+		if (entry.mCached) {
+			numCached++;
+			continue;
+		}
+		std::string error;
+		if (!device->FinishProgram(entry.mProgram, error)) {
+			SDL_Log("Failed to build shader program %s (variant %u):\n%s\nSource strings: %s", entry.mName.c_str(),
+				entry.mVariant, error.c_str(), entry.mFiles.c_str());
+			entry.mProgram = 0;
+			success = false;
+			continue;
+		}
+		// Save the binary for the next start
+		if (device->GetProgramBinary(entry.mProgram, format, binary)) {
+			WriteBinary(binaryName(entry), entry.mSourceHash, driverHash, format, binary);
+		}
+	}
+
+	// On failure nothing is kept, like a single program failing to load
+	for (ProgramEntry& entry : entries) {
+		if (!entry.mProgram) continue;
+		if (!success) {
+			device->DestroyProgram(entry.mProgram);
+			continue;
+		}
+		Shader* shader = new Shader();
+		shader->SetProgram(entry.mProgram);
+		entry.mPermutations->SetVariant(entry.mVariant, shader);
+		outShaders[entry.mName] = entry.mPermutations;
+	}
+	if (!success) {
+		for (ShaderPermutations* programPermutations : permutations) {
+			delete programPermutations;
+		}
+		return false;
+	}
+	const double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+	SDL_Log("Shader programs: %u loaded from the cache, %u compiled in %.1f ms", numCached,
+		static_cast<unsigned int>(entries.size()) - numCached, ms);
+	return true;
+}
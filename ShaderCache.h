@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+// Builds the shader programs listed in a manifest:
+// { "programs": [ { "name": "PhongMesh", "vertex": "PhongMesh.vert", "fragment": "PhongMesh.frag",
+//                   "features": [ "POINT_LIGHTS" ] }, ... ] }
+// Shader files are relative to the manifest and go through the ShaderPreprocessor. A program is built once for each
+// combination of its optional features (see ShaderPermutations).
+// Linked programs are saved as driver binaries in CacheDirectory, keyed by the hash of their sources and of the
+// driver: a warm start loads the binaries and compiles nothing.
+// Programs missing from the cache are all sent to the driver before the first status check, so that it can compile
+// them in parallel
+class ShaderCache {
+public:
+	// Build all the variants of the programs of the manifest and add them to outShaders with their name.
+	// Return false if a program fails to build
+	static bool LoadManifest(const std::string& manifestName, std::unordered_map<std::string, class ShaderPermutations*>& outShaders);
+
+	// Directory of the program binaries (created when the first binary is saved)
+	static const char* CacheDirectory;
+
+	// Header of a program binary file, followed by mSize bytes of binary
+	struct FileHeader {
+		uint32_t mMagic;
+		uint32_t mVersion;
+		// Hash of the vertex and fragment sources, and of the driver id
+		uint64_t mSourceHash;
+		uint64_t mDriverHash;
+		// Driver format of the binary
+		uint32_t mFormat;
+		uint32_t mSize;
+	};
+	static const uint32_t FileMagic = 0x48535043;
+	static const uint32_t FileVersion = 1;
+
+private:
+	// 64 bit FNV-1a hash
+	static uint64_t Hash(const std::string& data, uint64_t hash = 14695981039346656037ull);
+	// Read a program binary. Return false if the file is missing or was made from other sources or by another driver
+	static bool ReadBinary(const std::string& fileName, uint64_t sourceHash, uint64_t driverHash, uint32_t& outFormat, std::vector<unsigned char>& outBinary);
+	static bool WriteBinary(const std::string& fileName, uint64_t sourceHash, uint64_t driverHash, uint32_t format, const std::vector<unsigned char>& binary);
+};
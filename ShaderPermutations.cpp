@@ -0,0 +1,68 @@
+#include "ShaderPermutations.h"
+#include "Shader.h"
+
+// Define names, in the order of the feature bits
+static const char* FeatureDefines[ENumShaderFeatures] = { "POINT_LIGHTS", "SKINNING", "TEXTURE_ARRAY" };
+
+ShaderPermutations::ShaderPermutations(unsigned int features) :
+	mFeatures(features & ((1u << ENumShaderFeatures) - 1))
+{
+	unsigned int numFeatures = 0;
+	for (unsigned int bit = 0; bit < ENumShaderFeatures; bit++) {
+		if (mFeatures & (1u << bit)) numFeatures++;
+	}
+	mVariants.resize(static_cast<size_t>(1) << numFeatures, nullptr);
+}
+
+ShaderPermutations::~ShaderPermutations() {
+	for (Shader* shader : mVariants) {
+		if (!shader) continue;
+		shader->Unload();
+		delete shader;
+	}
+}
+
+unsigned int ShaderPermutations::GetVariantIndex(unsigned int features) const {
+	// Pack the supported bits of the mask
+	unsigned int index = 0;
+	unsigned int indexBit = 1;
+	for (unsigned int bit = 0; bit < ENumShaderFeatures; bit++) {
+		if (!(mFeatures & (1u << bit))) continue;
+		if (features & (1u << bit)) index |= indexBit;
+		indexBit <<= 1;
+	}
+	return index;
+}
+
+unsigned int ShaderPermutations::GetVariantFeatures(unsigned int index) const {
+	// Unpack the bits of the index on the supported features
+	unsigned int features = 0;
+	unsigned int indexBit = 1;
+	for (unsigned int bit = 0; bit < ENumShaderFeatures; bit++) {
+		if (!(mFeatures & (1u << bit))) continue;
+		if (index & indexBit) features |= 1u << bit;
+		indexBit <<= 1;
+	}
+	return features;
+}
+
+unsigned int ShaderPermutations::GetFeature(const std::string& define) {
+	for (unsigned int bit = 0; bit < ENumShaderFeatures; bit++) {
+		if (define == FeatureDefines[bit]) return 1u << bit;
+	}
+	return 0;
+}
+
+const char* ShaderPermutations::GetDefine(ShaderFeature feature) {
+	for (unsigned int bit = 0; bit < ENumShaderFeatures; bit++) {
+		if (feature == (1u << bit)) return FeatureDefines[bit];
+	}
+	return nullptr;
+}
+
+void ShaderPermutations::GetDefines(unsigned int features, std::vector<std::string>& outDefines) {
+	outDefines.clear();
+	for (unsigned int bit = 0; bit < ENumShaderFeatures; bit++) {
+		if (features & (1u << bit)) outDefines.emplace_back(FeatureDefines[bit]);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <string>
+
+// Optional features of a shader program. Each one is a #define given to the shader sources, so a variant compiled
+// without a feature doesn't contain its code
+enum ShaderFeature {
+	// Clustered point lights ("POINT_LIGHTS")
+	EPointLightsFeature = 1 << 0,
+	// Bone indices and weights in the vertices, matrix palette ("SKINNING")
+	ESkinningFeature = 1 << 1,
+	// Diffuse texture in a layer of a texture array ("TEXTURE_ARRAY")
+	ETextureArrayFeature = 1 << 2,
+	ENumShaderFeatures = 3
+};
+
+// Variants of a shader program: one per combination of the features it supports (listed in the shader manifest).
+// All the variants are built at load time, then picked when recording the draws with a feature mask
+class ShaderPermutations {
+public:
+	// features: mask of the features the program can be compiled with
+	ShaderPermutations(unsigned int features);
+	~ShaderPermutations();
+
+	unsigned int GetFeatures() const { return mFeatures; }
+	unsigned int GetNumVariants() const { return static_cast<unsigned int>(mVariants.size()); }
+	// Index of the variant for a feature mask. Features the program doesn't support are ignored
+	unsigned int GetVariantIndex(unsigned int features) const;
+	// Features the variant is compiled with
+	unsigned int GetVariantFeatures(unsigned int index) const;
+	class Shader* GetVariant(unsigned int index) const { return mVariants[index]; }
+	// Variant for a feature mask
+	class Shader* Select(unsigned int features) const { return mVariants[GetVariantIndex(features)]; }
+	// Take ownership of a variant
+	void SetVariant(unsigned int index, class Shader* shader) { mVariants[index] = shader; }
+
+	// Feature of a define name and define name of a feature. Return 0/nullptr if unknown
+	static unsigned int GetFeature(const std::string& define);
+	static const char* GetDefine(ShaderFeature feature);
+	// Defines of a feature mask
+	static void GetDefines(unsigned int features, std::vector<std::string>& outDefines);
+
+private:
+	unsigned int mFeatures;
+	// Indexed by the variant index: the bits of the feature mask that the program supports, packed together
+	std::vector<class Shader*> mVariants;
+};
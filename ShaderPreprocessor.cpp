@@ -0,0 +1,72 @@
+#include "ShaderPreprocessor.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <SDL.h>
+
+namespace fs = std::filesystem;
+
+bool ShaderPreprocessor::Process(const std::string& fileName, const std::vector<std::string>& defines, std::string& outSource) {
+	mFileNames.clear();
+	std::string body;
+	if (!Include(fs::path(fileName).lexically_normal().string(), 0, body)) return false;
+
+	// The defines go right after #version, which must stay the first directive
+	std::string header;
+	size_t versionEnd = 0;
+	size_t version = body.find("#version");
+	if (version != std::string::npos) {
+		versionEnd = body.find('\n', version);
+		versionEnd = versionEnd == std::string::npos ? body.size() : versionEnd + 1;
+		header = body.substr(0, versionEnd);
+		if (header.back() != '\n') header += '\n';
+	}
+	const size_t versionLine = std::count(body.begin(), body.begin() + versionEnd, '\n');
+	for (const std::string& define : defines) {
+		header += "#define " + define + " 1\n";
+	}
+	header += "#line " + std::to_string(versionLine + 1) + " 0\n";
+	outSource = header + body.substr(versionEnd);
+	return true;
+}
+
+bool ShaderPreprocessor::Include(const std::string& fileName, unsigned int depth, std::string& outSource) {
+	// Include guard: every file is expanded once
+	if (std::find(mFileNames.begin(), mFileNames.end(), fileName) != mFileNames.end()) return true;
+	std::ifstream file(fileName);
+	if (!file.is_open()) {
+		SDL_Log("Failed to open the shader file %s", fileName.c_str());
+		return false;
+	}
+	const unsigned int fileIndex = static_cast<unsigned int>(mFileNames.size());
+	mFileNames.emplace_back(fileName);
+	if (depth > 0) outSource += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+	std::string line;
+	unsigned int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+			outSource += line;
+			outSource += '\n';
+			continue;
+		}
+		size_t open = line.find('"', start + 8);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos) {
+			SDL_Log("%s(%u): #include needs a quoted file name", fileName.c_str(), lineNumber);
+			return false;
+		}
+		if (depth + 1 >= MaxIncludeDepth) {
+			SDL_Log("%s(%u): #include nested too deep", fileName.c_str(), lineNumber);
+			return false;
+		}
+		const fs::path included = fs::path(fileName).parent_path() / line.substr(open + 1, close - open - 1);
+		if (!Include(included.lexically_normal().string(), depth + 1, outSource)) return false;
+		// Back to the next line of this file
+		outSource += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+	}
+	return true;
+}
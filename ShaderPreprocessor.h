@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Expands the shader sources before they are sent to the driver:
+// - #include "file" is replaced by the file, relative to the including one. A file is included once per source
+// - the given defines are inserted after #version (as "#define NAME 1")
+// #line directives keep the compiler messages pointing at the right line. Each file is a GLSL source string
+// number: 0 for the main file, then the included files in order (see GetFileNames)
+class ShaderPreprocessor {
+public:
+	// Return false if a file can't be read
+	bool Process(const std::string& fileName, const std::vector<std::string>& defines, std::string& outSource);
+
+	// Files read by the last Process, indexed by source string number
+	const std::vector<std::string>& GetFileNames() const { return mFileNames; }
+
+	// Nesting limit of the includes
+	static const unsigned int MaxIncludeDepth = 16;
+
+private:
+	// support method. Append the file to outSource, expanding its includes
+	bool Include(const std::string& fileName, unsigned int depth, std::string& outSource);
+
+	std::vector<std::string> mFileNames;
+};
@@ -7,10 +7,10 @@ in vec2 fragTexCoord;
 out vec4 outColor;
 // For texture sampling
 // get the color from a texture given a UV coord
-// we bind one texture at a time, so we don't need to pass uniform data from code. GLSL know which texture use
-uniform sampler2D uTexture;
+// the unit of uTexture is set once, the renderer binds the texture (or the texture array) of each draw
+#include "Include/Texture.glsl"
 
 void main(){
     // sample color from texture
-    outColor = texture(uTexture, fragTexCoord);
+    outColor = SampleTexture(fragTexCoord);
 }
\ No newline at end of file
@@ -0,0 +1,5 @@
+#version 330
+
+// Depth-only pre-pass: the color writes are off, only the depth of the fragment is written
+void main(){
+}
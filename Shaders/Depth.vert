@@ -0,0 +1,16 @@
+#version 330
+
+// Depth-only pre-pass of the meshes: position only, no output to the fragment shader
+
+// Vertex inputs, uWorldTransform and skinning (in the SKINNING variant)
+#include "Include/MeshVertex.glsl"
+// View-projection (the block is shared with the lit shaders)
+#include "Include/FrameConstants.glsl"
+
+void main(){
+    vec4 worldPos;
+    vec4 worldNormal;
+    GetWorldVertex(worldPos, worldNormal);
+    // Same transform as the colour pass, so its fragments pass the depth test against this pass
+    gl_Position = worldPos * uViewProj;
+}
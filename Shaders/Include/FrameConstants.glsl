@@ -0,0 +1,29 @@
+// Per-frame constants shared by all the 3D shaders, filled once per frame by the renderer (uniform buffer object)
+// Same layout as the FrameConstants struct of the renderer
+
+// Struct for directional light
+struct DirectionalLight{
+    // Direction of light
+    vec3 mDirection;
+    // Diffuse color
+    vec3 mDiffuseColor;
+    // Specular color
+    vec3 mSpecularColor;
+};
+
+// row_major keeps the same memory layout of the engine matrices (row vectors)
+layout(std140, row_major) uniform FrameConstants{
+    mat4 uViewProj;
+    // Camera position in world space
+    vec3 uCameraPos;
+    // Ambient light level
+    vec3 uAmbientLight;
+    // Directional light (only one for now)
+    DirectionalLight uDirLight;
+    // View matrix, to compute the view depth of the fragment
+    mat4 uView;
+    // Number of clusters along x, y and depth
+    vec4 uClusterDims;
+    // x: slice scale, y: slice bias, zw: screen size
+    vec4 uClusterDepth;
+};
@@ -0,0 +1,99 @@
+// Phong lighting: directional light and, in the POINT_LIGHTS variants, the clustered point lights.
+// Needs FrameConstants.glsl
+
+struct PointLight{
+    // Point light position
+    vec3 mPosition;
+    // Diffuse color
+    vec3 mDiffuseColor;
+    // Specular color
+    vec3 mSpecularColor;
+    // Specular power
+    float mSpecPower;
+    // radius of influence
+    float mRadius;
+};
+
+#ifdef POINT_LIGHTS
+// Clustered point lights
+// Light data: 3 texels per light (position + radius, diffuse color + specular power, specular color)
+uniform samplerBuffer uLightData;
+// Per cluster: offset of the first light in the index list and number of lights
+uniform usamplerBuffer uClusterGrid;
+// Indices of the lights of each cluster
+uniform usamplerBuffer uLightIndices;
+#endif
+
+vec3 CalcDirLight(DirectionalLight dirLight, vec3 fragPos, vec3 normal, vec3 cameraPos, float specPower){
+    // Surface normal
+    vec3 N = normalize(normal);
+    // Vector from surface to light
+    vec3 L = normalize(-dirLight.mDirection);
+    // Vector from surface to camera
+    vec3 V = normalize(cameraPos - fragPos);
+    // Reflection of -L about N
+    vec3 R = normalize(reflect(-L, N));
+
+    // Compute phong reflection
+    vec3 Phong = vec3(0.0);
+    float NdotL = dot(N, L);
+    if (NdotL > 0)
+    {
+        vec3 Diffuse = dirLight.mDiffuseColor * NdotL;
+        vec3 Specular = dirLight.mSpecularColor * pow(max(0.0, dot(R, V)), specPower);
+        Phong = Diffuse + Specular;
+    }
+    return Phong;
+}
+
+vec3 CalcPointLight(PointLight ptLight, vec3 fragPos, vec3 normal, vec3 cameraPos, float specPower){
+    // Surface normal
+    vec3 N = normalize(normal);
+    // Vector from surface to light
+    vec3 L = normalize(ptLight.mPosition - fragPos);
+    // Vector form surface to camera
+    vec3 V = normalize(cameraPos - fragPos);
+    // Reflection of -L about N
+    vec3 R = normalize(reflect(-L, N));
+
+    vec3 Phong = vec3(0.0);
+    float NdotL = dot(N, L);
+    if(NdotL > 0 && (length(fragPos - ptLight.mPosition) <= ptLight.mRadius)){
+        vec3 Diffuse = ptLight.mDiffuseColor * NdotL;
+        vec3 Specular = ptLight.mSpecularColor * pow(max(0.0, dot(R, V)), specPower);
+        Phong = Diffuse + Specular;
+    }
+    return Phong;
+}
+
+// Ambient, directional and point lights reflected by the fragment
+vec3 CalcLighting(vec3 fragPos, vec3 normal, float specPower){
+    vec3 Phong = uAmbientLight;
+    Phong += CalcDirLight(uDirLight, fragPos, normal, uCameraPos, specPower);
+
+#ifdef POINT_LIGHTS
+    // Find the cluster of this fragment: screen tile from the window position, slice from the view depth
+    float viewDepth = (vec4(fragPos, 1.0) * uView).z;
+    ivec3 grid = ivec3(uClusterDims.xyz);
+    ivec3 cluster;
+    cluster.xy = clamp(ivec2(gl_FragCoord.xy / uClusterDepth.zw * uClusterDims.xy), ivec2(0), grid.xy - 1);
+    cluster.z = clamp(int(log(max(viewDepth, 0.0001)) * uClusterDepth.x + uClusterDepth.y), 0, grid.z - 1);
+    int clusterIndex = cluster.x + cluster.y * grid.x + cluster.z * grid.x * grid.y;
+
+    // Only evaluate the lights assigned to this cluster
+    uvec2 lightRange = texelFetch(uClusterGrid, clusterIndex).xy;
+    for(uint i = 0u; i < lightRange.y; i++){
+        int lightIndex = int(texelFetch(uLightIndices, int(lightRange.x + i)).x);
+        vec4 posRadius = texelFetch(uLightData, lightIndex * 3);
+        vec4 diffusePower = texelFetch(uLightData, lightIndex * 3 + 1);
+        PointLight ptLight;
+        ptLight.mPosition = posRadius.xyz;
+        ptLight.mRadius = posRadius.w;
+        ptLight.mDiffuseColor = diffusePower.xyz;
+        ptLight.mSpecPower = diffusePower.w;
+        ptLight.mSpecularColor = texelFetch(uLightData, lightIndex * 3 + 2).xyz;
+        Phong += CalcPointLight(ptLight, fragPos, normal, uCameraPos, specPower);
+    }
+#endif
+    return Phong;
+}
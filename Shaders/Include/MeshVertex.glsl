@@ -0,0 +1,48 @@
+// Vertex inputs of the meshes and their transform to world space.
+// Meshes use the compact vertex layout (see Mesh::PackVertices): the position is a snorm16 vec4 (w = 1) relative
+// to the mesh bounds, uWorldTransform includes the dequantize transform
+#include "ObjectConstants.glsl"
+
+// Specify attribute position with layout(location=n), same locations of VertexAttributeLocation
+layout(location=0) in vec4 inPosition;
+// Normal, octahedral encoded (snorm16 x 2)
+layout(location=1) in vec2 inNormal;
+// UV coordinates
+layout(location=2) in vec2 inTexCoord;
+
+// The depth pre-pass and the colour pass must compute the same depth for a vertex
+invariant gl_Position;
+
+#ifdef SKINNING
+// Maximum number of bones of a skeleton
+#define MAX_SKELETON_BONES 96
+// Four bones per vertex and their weights (unorm8, the sum is 1)
+layout(location=3) in uvec4 inSkinBones;
+layout(location=4) in vec4 inSkinWeights;
+// Pose of the skeleton. The matrices work on the quantized positions (quantize * bone * dequantize)
+uniform mat4 uMatrixPalette[MAX_SKELETON_BONES];
+#endif
+
+// Decode an unit vector from the octahedral encoding (the lower hemisphere is folded over the upper one)
+vec3 DecodeOctahedral(vec2 e){
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// Position (w = 1) and normal (w = 0) of the vertex in world space
+void GetWorldVertex(out vec4 worldPos, out vec4 worldNormal){
+    vec4 pos = inPosition; // Position in QUANTIZED OBJECT SPACE
+    vec4 normal = vec4(DecodeOctahedral(inNormal), 0.0);
+#ifdef SKINNING
+    // Blend the pose of the bones that move the vertex
+    mat4 skin = uMatrixPalette[inSkinBones.x] * inSkinWeights.x + uMatrixPalette[inSkinBones.y] * inSkinWeights.y +
+        uMatrixPalette[inSkinBones.z] * inSkinWeights.z + uMatrixPalette[inSkinBones.w] * inSkinWeights.w;
+    pos = pos * skin;
+    normal = normal * skin;
+#endif
+    worldPos = pos * uWorldTransform; // Convert vertex position from Object space to WORLD SPACE
+    worldNormal = normal * uWorldTransform;
+}
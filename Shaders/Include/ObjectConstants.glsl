@@ -0,0 +1,13 @@
+// Per-object constants of the draw. The renderer writes the constants of every draw of the frame in one uniform buffer
+// and binds the range of each draw, instead of setting the uniforms one by one
+// Same layout as the ObjectConstants struct of the renderer
+
+// row_major keeps the same memory layout of the engine matrices (row vectors)
+layout(std140, row_major) uniform ObjectConstants{
+    // Object space to world space
+    mat4 uWorldTransform;
+    // Specular power of the surface (meshes)
+    float uSpecPower;
+    // Layer of the texture in its array (TEXTURE_ARRAY variants)
+    float uTextureLayer;
+};
@@ -0,0 +1,19 @@
+// Diffuse texture: a 2D texture, or a layer of a texture array in the TEXTURE_ARRAY variants.
+// Textures of the same size and format share an array, so the draws using them don't rebind it
+
+// Layer of the texture in the array (uTextureLayer), set for each draw. Outside of the #ifdef: a file is included once
+#include "ObjectConstants.glsl"
+
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray uTexture;
+
+vec4 SampleTexture(vec2 texCoord){
+    return texture(uTexture, vec3(texCoord, uTextureLayer));
+}
+#else
+uniform sampler2D uTexture;
+
+vec4 SampleTexture(vec2 texCoord){
+    return texture(uTexture, texCoord);
+}
+#endif
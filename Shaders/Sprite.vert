@@ -9,7 +9,8 @@
 
 // Uniform variable. A uniform is a global variable that stays the same between different invocation of the shader program
 // Define two uniform for each matrix: a world transform matrix e a view-projection matrix that convert world space to clip space
-uniform mat4 uWorldTransform;
+// The world transform is in the per-object constants
+#include "Include/ObjectConstants.glsl"
 uniform mat4 uViewProj;
 
 // input of shaders are marked with "in" keyword
@@ -3,6 +3,7 @@
 #include "Game.h"
 #include "Texture.h"
 #include "Shader.h"
+#include "CommandList.h"
 
 SpriteComponent::SpriteComponent(Actor* owner, int drawOrder) :
 	Component(owner),
@@ -19,26 +20,24 @@ SpriteComponent::~SpriteComponent() {
 	mOwner->GetGame()->GetRenderer()->RemoveSprite(this);
 }
 
-void SpriteComponent::Draw(Shader* shader) {
+void SpriteComponent::Record(CommandList& list, Shader* shader, unsigned int order) {
 	if (mTexture) {
+		DrawPacket packet;
+		// Sprites keep their draw order: the key only depends on the order
+		packet.mSortKey = CommandList::MakeSortKey(ESpritePass, 0, 0, order);
 		// Create a scale matrix to scale by the width and the height of the texture
 		Matrix4 scaleMat = Matrix4::CreateScale(static_cast<float>(mWidth), static_cast<float>(mHeight), 1.0f);
 		// Create the world transform matrix for the sprite using owner's world transform
-		Matrix4 worldMat = scaleMat * mOwner->GetWorldTransform();
-		// Set world transform
-		shader->SetMatrixUniform("uWorldTransform", worldMat);
-
-		// Active current texture
-		mTexture->SetActive();
-
-		// Draw a sprite using triangles as polygons
-		// This function requires both an active vertex array object and shader program
-		glDrawElements(
-			GL_TRIANGLES,		// Type of polygon to draw
-			6,					// Number of indices in index buffer
-			GL_UNSIGNED_INT,	// value type of indices
-			nullptr				// usually nullptr
-		);
+		packet.mWorldTransform = scaleMat * mOwner->GetWorldTransform();
+		packet.mShader = shader;
+		packet.mTexture = mTexture;
+		// The sprite quad: 6 indices, bound by the renderer before the sprite pass
+		packet.mGeometry = nullptr;
+		packet.mFirstIndex = 0;
+		packet.mIndexCount = 6;
+		packet.mSpecPower = 0.f;
+		packet.mPass = ESpritePass;
+		list.AddDraw(packet);
 	}
 }
 
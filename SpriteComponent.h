@@ -10,13 +10,14 @@ public:
 	SpriteComponent(class Actor* owner, int drawOrder = 100);
 	~SpriteComponent();
 
-	// draw sprite
-	virtual void Draw(Shader* shader);
+	// record the draw packet of the sprite. order is the position of the sprite in the draw order
+	virtual void Record(class CommandList& list, Shader* shader, unsigned int order);
 	virtual void SetTexture(Texture* texture);
 
 	int GetDrawOrder() { return mDrawOrder; }
 	int GetTextureWidth() { return mWidth; }
 	int GetTextureHeight() { return mHeight; }
+	Texture* GetTexture() const { return mTexture; }
 
 private:
 	// texture to draw
@@ -0,0 +1,132 @@
+#include "StaticBatch.h"
+#include "Mesh.h"
+#include "MeshComponent.h"
+#include "Actor.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "CommandList.h"
+#include <map>
+#include <tuple>
+#include <cmath>
+
+const float StaticBatch::CellSize = 2500.f;
+
+namespace {
+	// Mesh components that can be merged: same shader, texture and specular power, inside the same grid cell
+	struct BatchKey {
+		std::string mShaderName;
+		Texture* mTexture;
+		float mSpecPower;
+		int mCell[3];
+
+		bool operator<(const BatchKey& other) const {
+			return std::tie(mShaderName, mTexture, mSpecPower, mCell[0], mCell[1], mCell[2]) <
+				std::tie(other.mShaderName, other.mTexture, other.mSpecPower, other.mCell[0], other.mCell[1], other.mCell[2]);
+		}
+	};
+}
+
+StaticBatch::StaticBatch(Mesh* mesh, const Vector3& center, float radius, unsigned int numMeshes) :
+	mMesh(mesh),
+	mCenter(center),
+	mRadius(radius),
+	mNumMeshes(numMeshes)
+{}
+
+StaticBatch::~StaticBatch() {
+	mMesh->Unload();
+	delete mMesh;
+}
+
+const std::string& StaticBatch::GetShaderName() const {
+	return mMesh->GetShaderName();
+}
+
+void StaticBatch::Record(CommandList& list, Shader* shader, unsigned int shaderIndex, float viewDepth) {
+	if (!mMesh->GetGeometry()) return;
+	Texture* tex = mMesh->GetTexture(0);
+	DrawPacket packet;
+	packet.mSortKey = CommandList::MakeSortKey(EOpaquePass, shaderIndex, tex ? tex->GetTextureID() : 0, CommandList::DepthOrder(viewDepth));
+	// The vertices are already in world space, only the dequantize transform is left
+	packet.mWorldTransform = mMesh->GetDequantizeTransform();
+	packet.mShader = shader;
+	packet.mTexture = tex;
+	packet.mGeometry = mMesh->GetGeometry();
+	packet.mFirstIndex = 0;
+	packet.mIndexCount = mMesh->GetLod(0).mIndexCount;
+	packet.mSpecPower = mMesh->GetSpecPower();
+	packet.mPass = EOpaquePass;
+	list.AddDraw(packet);
+	list.AddTriangles(packet.mIndexCount / 3, packet.mIndexCount / 3);
+}
+
+void StaticBatch::BuildBatches(const std::unordered_map<std::string, std::vector<MeshComponent*>>& meshComps,
+	Renderer* renderer, std::vector<StaticBatch*>& outBatches) {
+	// Group the mesh components of the static actors
+	std::map<BatchKey, std::vector<MeshComponent*>> groups;
+	for (const auto& shaderComps : meshComps) {
+		for (MeshComponent* mc : shaderComps.second) {
+			Mesh* mesh = mc->GetMesh();
+			Actor* owner = mc->GetOwner();
+			// Skinned meshes are deformed every frame, they can't be merged
+			if (!mesh || !owner->IsStatic() || mesh->GetVertexSize() != 8) continue;
+			owner->ComputeWorldTransform();
+			Vector3 pos = owner->GetActorPosition();
+			BatchKey key = { shaderComps.first, mesh->GetTexture(mc->GetTextureIndex()), mesh->GetSpecPower(),
+				{ static_cast<int>(std::floor(pos.x / CellSize)), static_cast<int>(std::floor(pos.y / CellSize)), static_cast<int>(std::floor(pos.z / CellSize)) } };
+			groups[key].emplace_back(mc);
+		}
+	}
+
+	for (const auto& group : groups) {
+		if (group.second.size() < 2) continue;
+
+		// Transform the full detail geometry of every mesh to world space and append it
+		std::vector<float> vertices;
+		std::vector<unsigned int> indices;
+		Vector3 minPos(Math::Infinity, Math::Infinity, Math::Infinity);
+		Vector3 maxPos(-Math::Infinity, -Math::Infinity, -Math::Infinity);
+		for (MeshComponent* mc : group.second) {
+			const Mesh* mesh = mc->GetMesh();
+			const Matrix4 world = mc->GetOwner()->GetWorldTransform();
+			const std::vector<float>& source = mesh->GetVertices();
+			const unsigned int baseVertex = static_cast<unsigned int>(vertices.size() / 8);
+			for (size_t i = 0; i + 7 < source.size(); i += 8) {
+				Vector3 pos = Vector3::Transform(Vector3(source[i], source[i + 1], source[i + 2]), world);
+				// The world transform is a rotation with uniform scale, it can transform the normals as well
+				Vector3 normal = Vector3::Transform(Vector3(source[i + 3], source[i + 4], source[i + 5]), world, 0.f);
+				normal.Normalize();
+				minPos = Vector3(Math::Min(minPos.x, pos.x), Math::Min(minPos.y, pos.y), Math::Min(minPos.z, pos.z));
+				maxPos = Vector3(Math::Max(maxPos.x, pos.x), Math::Max(maxPos.y, pos.y), Math::Max(maxPos.z, pos.z));
+				const float vert[8] = { pos.x, pos.y, pos.z, normal.x, normal.y, normal.z, source[i + 6], source[i + 7] };
+				vertices.insert(vertices.end(), vert, vert + 8);
+			}
+			const MeshLod& lod = mesh->GetLod(0);
+			const std::vector<unsigned int>& sourceIndices = mesh->GetIndices();
+			for (unsigned int i = lod.mIndexOffset; i < lod.mIndexOffset + lod.mIndexCount; i++) {
+				indices.emplace_back(baseVertex + sourceIndices[i]);
+			}
+		}
+
+		Vector3 center = (minPos + maxPos) * 0.5f;
+		float radius = 0.f;
+		for (size_t i = 0; i + 7 < vertices.size(); i += 8) {
+			radius = Math::Max(radius, (Vector3(vertices[i], vertices[i + 1], vertices[i + 2]) - center).LengthSq());
+		}
+		radius = Math::Sqrt(radius);
+
+		const BatchKey& key = group.first;
+		std::string name = "StaticBatch(" + key.mShaderName + ", " + std::to_string(key.mCell[0]) + ", " +
+			std::to_string(key.mCell[1]) + ", " + std::to_string(key.mCell[2]) + ")";
+		Mesh* batchMesh = new Mesh();
+		std::vector<Texture*> textures(1, key.mTexture);
+		if (!batchMesh->Create(name, key.mShaderName, textures, key.mSpecPower, vertices, 8, indices, renderer)) {
+			delete batchMesh;
+			continue;
+		}
+		for (MeshComponent* mc : group.second) {
+			mc->SetBatched(true);
+		}
+		outBatches.emplace_back(new StaticBatch(batchMesh, center, radius, static_cast<unsigned int>(group.second.size())));
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "Math.h"
+
+// Meshes of static actors with the same material, transformed to world space and merged in a single mesh.
+// A batch covers one cell of a world space grid, so it stays small enough to be culled.
+// The merged actors keep their mesh components (for gameplay queries), flagged as batched so they are not drawn
+class StaticBatch {
+public:
+	StaticBatch(class Mesh* mesh, const Vector3& center, float radius, unsigned int numMeshes);
+	~StaticBatch();
+
+	// Record the draw packet of the merged mesh (no OpenGL calls). shaderIndex and viewDepth are used to sort the packet
+	void Record(class CommandList& list, class Shader* shader, unsigned int shaderIndex, float viewDepth);
+
+	class Mesh* GetMesh() const { return mMesh; }
+	const std::string& GetShaderName() const;
+	// World space bounding sphere
+	const Vector3& GetCenter() const { return mCenter; }
+	float GetRadius() const { return mRadius; }
+	// Number of meshes merged in this batch
+	unsigned int GetNumMeshes() const { return mNumMeshes; }
+
+	// Merge the static mesh components (grouped by shader) into batches. Groups of a single mesh are not batched
+	static void BuildBatches(const std::unordered_map<std::string, std::vector<class MeshComponent*>>& meshComps,
+		class Renderer* renderer, std::vector<StaticBatch*>& outBatches);
+
+	// Size of the cells of the grid used to split the batches
+	static const float CellSize;
+
+private:
+	// Merged mesh (world space vertices)
+	class Mesh* mMesh;
+	// World space bounding sphere
+	Vector3 mCenter;
+	float mRadius;
+	// Number of meshes merged
+	unsigned int mNumMeshes;
+};
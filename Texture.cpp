@@ -1,16 +1,52 @@
 #include "Texture.h"
 #include <SOIL.h>
 #include <SDL.h>
-#include <glew.h>
+#include "RenderDevice.h"
+#include "TextureCooker.h"
+#include "KtxFile.h"
+#include "BlockCompression.h"
+#include "TextureArray.h"
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+
+namespace fs = std::filesystem;
 
 Texture::Texture() :
 	mTextureID(0),
 	mWidth(0),
-	mHeight(0){}
+	mHeight(0),
+	mNumLevels(1),
+	mFormat(ETextureRGBA8),
+	mStaged(nullptr),
+	mStagedChannels(0),
+	mLoaded(false),
+	mArray(nullptr),
+	mLayer(0){}
+
+Texture::~Texture(){
+	delete mStaged;
+}
+
+TextureHandle Texture::sPlaceholder = 0;
+
+bool Texture::Load(const std::string& fileName, bool streamed) {
+	if (!Read(fileName, streamed)) return false;
+	mLoaded = Upload();
+	return mLoaded;
+}
 
-Texture::~Texture(){}
+bool Texture::Read(const std::string& fileName, bool streamed) {
+	mFileName = fileName;
+	// The cooked texture (compressed, with its mip chain) is used unless the source was edited after cooking
+	const std::string cookedName = TextureCooker::GetCookedName(fileName);
+	std::error_code error;
+	if (cookedName != fileName && fs::exists(cookedName, error) &&
+		(!fs::exists(fileName, error) || fs::last_write_time(cookedName, error) >= fs::last_write_time(fileName, error))) {
+		return ReadCooked(cookedName, streamed);
+	}
+	if (fs::path(fileName).extension() == ".ktx") return ReadCooked(fileName, streamed);
 
-bool Texture::Load(const std::string& fileName) {
 	// Number of color channel
 	int channels = 0;
 	// Load the texture
@@ -25,41 +61,166 @@ bool Texture::Load(const std::string& fileName) {
 		SDL_Log("Failed to load texture %s: %s", fileName.c_str(), SOIL_last_result());
 		return false;
 	}
-	// Set color format. Check channels: RGB = 3; RGBA = 4
-	int format = GL_RGB;
-	if (channels == 4) format = GL_RGBA;
-
-	// Generate a openGL texture object and store its ID
-	glGenTextures(1, &mTextureID);
-	glBindTexture(GL_TEXTURE_2D, mTextureID); // GL_TEXTURE_2D is the most commot texture target
-
-	// Copy the raw image data into the texture
-	glTexImage2D(
-		GL_TEXTURE_2D,		// Texture target
-		0,					// Level of detail (assume 0 for now)
-		format,				// Color format OpenGL should use (RGB/RGBA)
-		mWidth,				// Width of texture
-		mHeight,			// Height of texture
-		0,					// Border - "MUST BE 0"
-		format,				// Color format of input data
-		GL_UNSIGNED_BYTE,	// Bit depth of input data. Unsigned byte specifies 8-bit channels
-		image				// Pointer to image data
-	);
+	// Single level of 3 (RGB) or 4 (RGBA) channels
+	delete mStaged;
+	mStaged = new KtxImage{ ETextureRGBA8, mWidth, mHeight, 0, {} };
+	mStaged->mLevels.emplace_back(image, image + mWidth * mHeight * channels);
+	mStagedChannels = channels;
 
 	// Tell SOIL to free the image from memory once loaded
 	SOIL_free_image_data(image);
+	return true;
+}
+
+bool Texture::ReadCooked(const std::string& fileName, bool streamed) {
+	KtxImage* image = new KtxImage();
+	// Streamed textures start with the small levels, the size of the others is only known from the header
+	if (!KtxFile::Read(fileName, *image, streamed ? TailSize : 0)) {
+		delete image;
+		return false;
+	}
+	mCookedName = fileName;
+	mWidth = image->mWidth;
+	mHeight = image->mHeight;
+	mNumLevels = image->mFirstLevel + static_cast<unsigned int>(image->mLevels.size());
+	mFormat = RenderDevice::Get()->SupportsTextureFormat(image->mFormat) ? image->mFormat : ETextureRGBA8;
+	DecodeLevels(*image);
+	delete mStaged;
+	mStaged = image;
+	mStagedChannels = 0;
+	return true;
+}
+
+bool Texture::Upload(BufferHandle pixelBuffer) {
+	if (!mStaged) return false;
+	RenderDevice* device = RenderDevice::Get();
+	std::vector<TextureLevel> levels;
+	GetLevels(*mStaged, levels);
+	if (pixelBuffer) {
+		// Copy the texels in the (orphaned) pixel buffer: the texture is then filled from it by the GPU, without
+		// waiting for the copy. The texel pointers become offsets in the buffer
+		unsigned int size = 0;
+		for (const TextureLevel& level : levels) size += level.mSize;
+		device->ResizeBuffer(pixelBuffer, size, EStreamBuffer);
+		unsigned int offset = 0;
+		for (TextureLevel& level : levels) {
+			device->UpdateBuffer(pixelBuffer, offset, level.mSize, level.mData);
+			level.mData = reinterpret_cast<const void*>(static_cast<uintptr_t>(offset));
+			offset += level.mSize;
+		}
+		device->SetPixelUnpackBuffer(pixelBuffer);
+	}
+	if (mStagedChannels) {
+		// Copy the raw image data into a texture with bilinear filtering (3 channels: RGB, 4 channels: RGBA)
+		mTextureID = device->CreateTexture2D(mWidth, mHeight, mStagedChannels, levels[0].mData);
+	}
+	else {
+		mTextureID = device->CreateTextureMips(mStaged->mFormat, levels);
+	}
+	if (pixelBuffer) device->SetPixelUnpackBuffer(0);
+	delete mStaged;
+	mStaged = nullptr;
+	if (!mTextureID) {
+		SDL_Log("Failed to create texture %s", mFileName.c_str());
+		mCookedName.clear();
+		return false;
+	}
+	return true;
+}
+
+unsigned int Texture::GetTextureID() const {
+	if (!mLoaded) return 0;
+	return mArray ? mArray->GetHandle() : mTextureID;
+}
+
+void Texture::SetArray(TextureArray* array, unsigned int layer) {
+	if (mTextureID) RenderDevice::Get()->DestroyTexture(mTextureID);
+	mTextureID = 0;
+	mArray = array;
+	mLayer = layer;
+}
+
+bool Texture::ReadImage(KtxImage& outImage) const {
+	if (!mCookedName.empty()) return ReadLevels(0, outImage);
+	// Images that were not cooked have a single RGBA8 level
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	unsigned char* image = SOIL_load_image(mFileName.c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+	if (!image) {
+		SDL_Log("Failed to load texture %s: %s", mFileName.c_str(), SOIL_last_result());
+		return false;
+	}
+	outImage = KtxImage{ ETextureRGBA8, width, height, 0, {} };
+	outImage.mLevels.emplace_back(image, image + width * height * 4);
+	SOIL_free_image_data(image);
+	return true;
+}
+
+unsigned int Texture::GetLevelForSize(int size) const {
+	unsigned int level = 0;
+	while (level + 1 < mNumLevels && ((mWidth >> level) > size || (mHeight >> level) > size)) level++;
+	return level;
+}
 
-	// Enable bilinear filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+unsigned int Texture::GetLevelsSize(unsigned int firstLevel) const {
+	unsigned int size = 0;
+	for (unsigned int level = firstLevel; level < mNumLevels; level++) {
+		size += BlockCompression::GetImageSize(mFormat, std::max(mWidth >> level, 1), std::max(mHeight >> level, 1));
+	}
+	return size;
+}
 
+bool Texture::ReadLevels(unsigned int firstLevel, KtxImage& outImage) const {
+	const int maxSize = std::max(std::max(mWidth >> firstLevel, mHeight >> firstLevel), 1);
+	if (!KtxFile::Read(mCookedName, outImage, maxSize)) return false;
+	DecodeLevels(outImage);
 	return true;
 }
 
+void Texture::DecodeLevels(KtxImage& image) const {
+	// Without the compressed format the levels are decoded and uploaded uncompressed
+	if (image.mFormat == mFormat) return;
+	std::vector<unsigned char> rgba;
+	for (size_t i = 0; i < image.mLevels.size(); i++) {
+		const unsigned int level = image.mFirstLevel + static_cast<unsigned int>(i);
+		BlockCompression::Decompress(image.mFormat, std::max(mWidth >> level, 1), std::max(mHeight >> level, 1),
+			image.mLevels[i].data(), rgba);
+		image.mLevels[i].swap(rgba);
+	}
+	image.mFormat = mFormat;
+}
+
+bool Texture::SetLevels(const KtxImage& image) {
+	// A load queued before the texture was packed: the array has all the levels
+	if (mArray) return true;
+	std::vector<TextureLevel> levels;
+	GetLevels(image, levels);
+	return RenderDevice::Get()->UpdateTextureMips(mTextureID, image.mFormat, levels);
+}
+
+void Texture::GetLevels(const KtxImage& image, std::vector<TextureLevel>& outLevels) const {
+	for (size_t i = 0; i < image.mLevels.size(); i++) {
+		const unsigned int level = image.mFirstLevel + static_cast<unsigned int>(i);
+		outLevels.push_back({ std::max(image.mWidth >> level, 1), std::max(image.mHeight >> level, 1), image.mLevels[i].data(),
+			static_cast<unsigned int>(image.mLevels[i].size()) });
+	}
+}
+
 void Texture::Unload() {
-	glDeleteTextures(1, &mTextureID);
+	if (mTextureID) RenderDevice::Get()->DestroyTexture(mTextureID);
+	mTextureID = 0;
+	mCookedName.clear();
+	mLoaded = false;
+	mArray = nullptr;
+	mLayer = 0;
 }
 
-void Texture::SetActive(){
-	glBindTexture(GL_TEXTURE_2D, mTextureID);
+void Texture::SetActive(unsigned int unit){
+	if (mArray) {
+		mArray->SetActive(unit);
+		return;
+	}
+	// Textures still loading are drawn with the placeholder
+	RenderDevice::Get()->BindTexture(mTextureID ? mTextureID : sPlaceholder, unit);
 }
\ No newline at end of file
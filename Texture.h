@@ -1,23 +1,88 @@
 #pragma once
 #include <string>
+#include <vector>
+#include "RenderDevice.h"
 
 class Texture {
 public:
 	Texture();
 	~Texture();
 
-	// load the specified texture
-	bool Load(const std::string& fileName);
+	// load the specified texture. The cooked .ktx of the file (see TextureCooker) is loaded instead when it is up to date.
+	// streamed: only the levels of the cooked texture up to TailSize are loaded, the TextureStreamer loads the others
+	bool Load(const std::string& fileName, bool streamed = false);
+	// Asynchronous loading is done in two steps. Read decodes the file (any thread, no device call) and Upload creates
+	// the device texture from it (thread of the device), copying the texels through the pixel buffer if one is given.
+	// The texture is used once the renderer marks it loaded; until then it binds the placeholder
+	bool Read(const std::string& fileName, bool streamed = false);
+	bool Upload(BufferHandle pixelBuffer = 0);
+	// Loaded textures can be used. Game thread
+	bool IsLoaded() const { return mLoaded; }
+	void SetLoaded() { mLoaded = true; }
 	void Unload();
 
-	void SetActive();
+	// Bind the texture to the given texture unit
+	void SetActive(unsigned int unit = 0);
 
 	int GetWidth() const { return mWidth; }
 	int GetHeight() const { return mHeight; }
+	// Render device handle bound to draw with the texture, used to sort the draw calls by texture (0 until loaded).
+	// Streaming keeps the same handle. Packed textures share the handle of their array
+	unsigned int GetTextureID() const;
+	TextureFormat GetFormat() const { return mFormat; }
+	// Texture bound instead of the textures still loading (created by the renderer)
+	static void SetPlaceholder(TextureHandle texture) { sPlaceholder = texture; }
+
+	// Texture array holding the texture (nullptr: not packed) and its layer. The levels of the texture are released,
+	// the array is bound instead. Thread of the device (see TextureArray)
+	void SetArray(class TextureArray* array, unsigned int layer);
+	class TextureArray* GetArray() const { return mArray; }
+	unsigned int GetLayer() const { return mLayer; }
+	// Read every level of the texture as it is on the device (the image is read again if it was not cooked)
+	bool ReadImage(struct KtxImage& outImage) const;
+
+	// Streaming. Only cooked textures have their mip chain on disk and can be streamed (packed textures are complete)
+	bool IsStreamable() const { return !mCookedName.empty() && !mArray; }
+	unsigned int GetNumLevels() const { return mNumLevels; }
+	// First level whose width and height are at most size (the last level if none is that small)
+	unsigned int GetLevelForSize(int size) const;
+	// Bytes of the levels from firstLevel to the last one, as uploaded to the device
+	unsigned int GetLevelsSize(unsigned int firstLevel) const;
+	// Read the levels from firstLevel of the cooked file, decoded if the device can't sample their format.
+	// No device call: the streamer runs it on its own thread
+	bool ReadLevels(unsigned int firstLevel, struct KtxImage& outImage) const;
+	// Replace the levels on the device with the ones read by ReadLevels (ignored once packed). Thread of the device
+	bool SetLevels(const struct KtxImage& image);
+
+	// Largest level loaded by a streamed Load
+	static const int TailSize = 64;
 
 private:
-	// OpenGL ID of this texture
+	// Read a .ktx file: the levels are kept as they are, or decoded if the device lacks their format
+	bool ReadCooked(const std::string& fileName, bool streamed);
+	// Levels of the device texture pointing to the data of the image
+	void GetLevels(const struct KtxImage& image, std::vector<TextureLevel>& outLevels) const;
+	// Decode the levels to RGBA8 if the device can't sample their format
+	void DecodeLevels(struct KtxImage& image) const;
+
+	// Render device handle of this texture
 	unsigned int mTextureID;
 	// Width/Height of the texture
 	int mWidth, mHeight;
-};
\ No newline at end of file
+	// Cooked file the levels are read from (empty if the texture was loaded from an image) and its number of levels
+	std::string mCookedName;
+	unsigned int mNumLevels;
+	// Format of the levels on the device (RGBA8 when the device can't sample the compressed format of the file)
+	TextureFormat mFormat;
+	// File given to Read
+	std::string mFileName;
+	// Texels read by Read, waiting for Upload. Images that were not cooked have a single level of mStagedChannels
+	struct KtxImage* mStaged;
+	int mStagedChannels;
+	// Uploaded and marked loaded (see SetLoaded)
+	bool mLoaded;
+	// Texture array and layer of a packed texture
+	class TextureArray* mArray;
+	unsigned int mLayer;
+	static TextureHandle sPlaceholder;
+};
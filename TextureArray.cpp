@@ -0,0 +1,82 @@
+#include "TextureArray.h"
+#include "Texture.h"
+#include "KtxFile.h"
+#include "JobSystem.h"
+#include <SDL.h>
+#include <map>
+#include <tuple>
+#include <algorithm>
+
+TextureArray::TextureArray() :
+	mTexture(0){}
+
+TextureArray::~TextureArray(){}
+
+bool TextureArray::Read(const std::vector<Texture*>& textures) {
+	mTextures = textures;
+	mImages.assign(textures.size(), KtxImage());
+	std::vector<char> read(textures.size(), 0);
+	// One file per job: the layers are read and decoded in parallel
+	JobSystem::ParallelFor(static_cast<unsigned int>(textures.size()), 1, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++) {
+			read[i] = textures[i]->ReadImage(mImages[i]) ? 1 : 0;
+		}
+	});
+	for (size_t i = 0; i < read.size(); i++) {
+		if (!read[i]) {
+			SDL_Log("Failed to read layer %u of a texture array", static_cast<unsigned>(i));
+			mImages.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool TextureArray::Upload() {
+	if (mImages.empty()) return false;
+	std::vector<std::vector<TextureLevel>> layers(mImages.size());
+	for (size_t i = 0; i < mImages.size(); i++) {
+		const KtxImage& image = mImages[i];
+		for (size_t level = 0; level < image.mLevels.size(); level++) {
+			layers[i].push_back({ std::max(image.mWidth >> level, 1), std::max(image.mHeight >> level, 1),
+				image.mLevels[level].data(), static_cast<unsigned int>(image.mLevels[level].size()) });
+		}
+	}
+	mTexture = RenderDevice::Get()->CreateTextureArray(mImages[0].mFormat, layers);
+	mImages.clear();
+	if (!mTexture) return false;
+	for (size_t i = 0; i < mTextures.size(); i++) {
+		mTextures[i]->SetArray(this, static_cast<unsigned int>(i));
+	}
+	return true;
+}
+
+void TextureArray::Unload() {
+	if (mTexture) RenderDevice::Get()->DestroyTexture(mTexture);
+	mTexture = 0;
+	mTextures.clear();
+}
+
+void TextureArray::SetActive(unsigned int unit) {
+	RenderDevice::Get()->BindTexture(mTexture, unit);
+}
+
+void TextureArray::Pack(const std::vector<Texture*>& textures, std::vector<std::vector<Texture*>>& outPages) {
+	// Resolution classes, in a stable order
+	typedef std::tuple<int, int, int, unsigned int> Class;
+	std::map<Class, std::vector<Texture*>> classes;
+	for (Texture* texture : textures) {
+		classes[Class(texture->GetFormat(), texture->GetWidth(), texture->GetHeight(), texture->GetNumLevels())].push_back(texture);
+	}
+	for (auto& textureClass : classes) {
+		const std::vector<Texture*>& members = textureClass.second;
+		if (members.size() < MinLayers) continue;
+		// Pages of similar sizes: a last page of a single texture would save nothing
+		const size_t numPages = (members.size() + MaxLayers - 1) / MaxLayers;
+		const size_t pageSize = (members.size() + numPages - 1) / numPages;
+		for (size_t begin = 0; begin < members.size(); begin += pageSize) {
+			const size_t end = std::min(begin + pageSize, members.size());
+			outPages.emplace_back(members.begin() + begin, members.begin() + end);
+		}
+	}
+}
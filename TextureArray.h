@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "RenderDevice.h"
+
+// Textures of the same size, format and number of levels packed in the layers of one device texture array.
+// Draws of the textures of an array share the texture binding: the TEXTURE_ARRAY variants of the shaders read
+// the layer of each draw from uTextureLayer. Packed textures keep their whole mip chain and are not streamed
+class TextureArray {
+public:
+	TextureArray();
+	~TextureArray();
+
+	// Read the mip chains of the textures (any thread, no device call), then create the array and move each texture
+	// to its layer (thread of the device). textures must have the same size, format and levels (see Pack)
+	bool Read(const std::vector<class Texture*>& textures);
+	bool Upload();
+	// Destroy the device array. Its textures must be unloaded first
+	void Unload();
+
+	// Bind the array to the given texture unit
+	void SetActive(unsigned int unit);
+	TextureHandle GetHandle() const { return mTexture; }
+	unsigned int GetNumLayers() const { return static_cast<unsigned int>(mTextures.size()); }
+
+	// Packing policy: textures are grouped by resolution class (format, size and number of levels, which must match
+	// exactly to share an array), in pages of at most MaxLayers. Classes of fewer than MinLayers textures have
+	// nothing to share and stay unpacked
+	static void Pack(const std::vector<class Texture*>& textures, std::vector<std::vector<class Texture*>>& outPages);
+	static const unsigned int MaxLayers = 64;
+	static const unsigned int MinLayers = 2;
+
+private:
+	// Render device handle of the array
+	TextureHandle mTexture;
+	// Texture of each layer, and its levels waiting for Upload
+	std::vector<class Texture*> mTextures;
+	std::vector<struct KtxImage> mImages;
+};
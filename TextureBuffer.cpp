@@ -0,0 +1,40 @@
+#include "TextureBuffer.h"
+
+TextureBuffer::TextureBuffer(TexelFormat format) :
+	mBuffer(0),
+	mTexture(0),
+	mCapacity(0)
+{
+	RenderDevice* device = RenderDevice::Get();
+	mBuffer = device->CreateBuffer(ETextureBuffer, 0, nullptr, EStreamBuffer);
+	// Connect the texture to the buffer: texels are read directly from the buffer storage
+	mTexture = device->CreateBufferTexture(mBuffer, format);
+}
+
+TextureBuffer::~TextureBuffer() {
+	RenderDevice::Get()->DestroyTexture(mTexture);
+	RenderDevice::Get()->DestroyBuffer(mBuffer);
+}
+
+void TextureBuffer::Update(const void* data, unsigned int size) {
+	if (size == 0) return;
+	Reserve(size);
+	RenderDevice::Get()->UpdateBuffer(mBuffer, 0, size, data);
+}
+
+void TextureBuffer::CopyFrom(BufferHandle source, unsigned int offset, unsigned int size) {
+	if (size == 0) return;
+	Reserve(size);
+	RenderDevice::Get()->CopyBuffer(source, offset, mBuffer, 0, size);
+}
+
+void TextureBuffer::Reserve(unsigned int size) {
+	if (size <= mCapacity) return;
+	// Grow with some slack so that a few more lights don't reallocate every frame
+	mCapacity = size + size / 2;
+	RenderDevice::Get()->ResizeBuffer(mBuffer, mCapacity, EStreamBuffer);
+}
+
+void TextureBuffer::SetActive(unsigned int unit) {
+	RenderDevice::Get()->BindTexture(mTexture, unit);
+}
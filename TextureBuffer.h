@@ -0,0 +1,29 @@
+#pragma once
+#include "RenderDevice.h"
+
+// Buffer object read by shaders as a 1D texture (samplerBuffer/usamplerBuffer)
+// Used for large arrays that don't fit in a uniform block, such as the clustered light lists
+class TextureBuffer {
+public:
+	// format is the format of each texel (ETexelRGBA32F, ETexelRG32UI, ETexelR16UI)
+	TextureBuffer(TexelFormat format);
+	~TextureBuffer();
+
+	// Replace the content of the buffer. The storage grows when needed
+	void Update(const void* data, unsigned int size);
+	// Same, copying on the GPU from a range of another buffer (a RingBuffer): the driver doesn't copy the data
+	void CopyFrom(BufferHandle source, unsigned int offset, unsigned int size);
+	// Bind the buffer texture to the given texture unit
+	void SetActive(unsigned int unit);
+
+private:
+	// support method. Grow the storage to hold size bytes
+	void Reserve(unsigned int size);
+
+	// Render device handle of the buffer holding the data
+	BufferHandle mBuffer;
+	// Render device handle of the buffer texture
+	TextureHandle mTexture;
+	// Size of the buffer storage in bytes
+	unsigned int mCapacity;
+};
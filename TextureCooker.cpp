@@ -0,0 +1,96 @@
+#include "TextureCooker.h"
+#include "BlockCompression.h"
+#include "KtxFile.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <SOIL.h>
+#include <SDL_log.h>
+
+namespace fs = std::filesystem;
+
+// Textures are sRGB: the texels are averaged in linear space, otherwise the small levels get darker
+static float SrgbToLinear(unsigned char value) {
+	float c = value / 255.f;
+	return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static unsigned char LinearToSrgb(float value) {
+	float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+	return static_cast<unsigned char>(std::lround(std::min(std::max(c, 0.f), 1.f) * 255.f));
+}
+
+// Next level of the mip chain: each texel is the average of 2x2 texels (the last row/column of odd sizes is
+// repeated). Colors are weighted by their alpha so that the transparent texels do not bleed into the others
+static void Downsample(const std::vector<unsigned char>& rgba, int width, int height, const float* linear,
+	std::vector<unsigned char>& outRgba, int outWidth, int outHeight) {
+	outRgba.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+	for (int y = 0; y < outHeight; y++) {
+		for (int x = 0; x < outWidth; x++) {
+			float color[3] = { 0.f, 0.f, 0.f };
+			float alpha = 0.f;
+			for (int i = 0; i < 4; i++) {
+				int sx = std::min(x * 2 + (i & 1), width - 1);
+				int sy = std::min(y * 2 + (i >> 1), height - 1);
+				const unsigned char* texel = &rgba[(static_cast<size_t>(sy) * width + sx) * 4];
+				float a = texel[3] / 255.f;
+				for (int c = 0; c < 3; c++) color[c] += linear[texel[c]] * a;
+				alpha += a;
+			}
+			unsigned char* out = &outRgba[(static_cast<size_t>(y) * outWidth + x) * 4];
+			for (int c = 0; c < 3; c++) out[c] = alpha > 0.f ? LinearToSrgb(color[c] / alpha) : 0;
+			out[3] = static_cast<unsigned char>(std::lround(alpha / 4.f * 255.f));
+		}
+	}
+}
+
+std::string TextureCooker::GetCookedName(const std::string& fileName) {
+	return fs::path(fileName).replace_extension(".ktx").string();
+}
+
+bool TextureCooker::Cook(const std::string& fileName) {
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	unsigned char* image = SOIL_load_image(fileName.c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+	if (!image) {
+		SDL_Log("Failed to load texture %s: %s", fileName.c_str(), SOIL_last_result());
+		return false;
+	}
+	std::vector<unsigned char> rgba(image, image + static_cast<size_t>(width) * height * 4);
+	SOIL_free_image_data(image);
+
+	KtxImage ktx;
+	ktx.mFormat = ETextureBC1;
+	ktx.mWidth = width;
+	ktx.mHeight = height;
+	ktx.mFirstLevel = 0;
+	for (size_t i = 3; i < rgba.size(); i += 4) {
+		if (rgba[i] < 255) {
+			ktx.mFormat = ETextureBC3;
+			break;
+		}
+	}
+	float linear[256];
+	for (int i = 0; i < 256; i++) linear[i] = SrgbToLinear(static_cast<unsigned char>(i));
+
+	// Every level down to 1x1
+	std::vector<unsigned char> next;
+	while (true) {
+		ktx.mLevels.emplace_back();
+		BlockCompression::Compress(ktx.mFormat, width, height, rgba.data(), ktx.mLevels.back());
+		if (width == 1 && height == 1) break;
+		int nextWidth = std::max(width / 2, 1);
+		int nextHeight = std::max(height / 2, 1);
+		Downsample(rgba, width, height, linear, next, nextWidth, nextHeight);
+		rgba.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	const std::string cookedName = GetCookedName(fileName);
+	if (!KtxFile::Write(cookedName, ktx)) return false;
+	SDL_Log("Cooked %s: %dx%d, %u levels, %s", cookedName.c_str(), ktx.mWidth, ktx.mHeight,
+		static_cast<unsigned int>(ktx.mLevels.size()), ktx.mFormat == ETextureBC1 ? "BC1" : "BC3");
+	return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+// Offline processing of textures, run from the command line (see Main.cpp)
+class TextureCooker {
+public:
+	// Generate the mip chain of the image, block compress it (BC3 if it has transparent texels, BC1 otherwise)
+	// and write it as a .ktx file next to the source (see GetCookedName)
+	static bool Cook(const std::string& fileName);
+
+	// Name of the cooked file of a texture: same name, .ktx extension
+	static std::string GetCookedName(const std::string& fileName);
+};
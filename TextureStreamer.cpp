@@ -0,0 +1,171 @@
+#include "TextureStreamer.h"
+#include "Texture.h"
+#include <algorithm>
+#include <queue>
+#include <SDL_log.h>
+
+TextureStreamer::TextureStreamer() :
+	mBudget(DefaultBudget),
+	mResidentBytes(0),
+	mReading(false),
+	mRunning(true)
+{
+	mThread = std::thread(&TextureStreamer::ThreadLoop, this);
+}
+
+TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mRunning = false;
+	}
+	mCondition.notify_all();
+	mThread.join();
+}
+
+void TextureStreamer::AddTexture(Texture* texture) {
+	// The texture was loaded with its tail only
+	const unsigned int tail = texture->GetLevelForSize(Texture::TailSize);
+	mTextures[texture] = StreamedTexture{ NoRequest, tail, tail, tail, 0 };
+	mResidentBytes += texture->GetLevelsSize(tail);
+}
+
+void TextureStreamer::RemoveTexture(Texture* texture) {
+	auto iter = mTextures.find(texture);
+	if (iter == mTextures.end()) return;
+	// A load still pending for it is applied, or ignored by the texture, without being counted
+	mResidentBytes -= texture->GetLevelsSize(iter->second.mLevel);
+	mTextures.erase(iter);
+}
+
+void TextureStreamer::Clear() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	mQueue.clear();
+	mCondition.wait(lock, [this] { return !mReading; });
+	mLoaded.clear();
+	mPending.clear();
+	mFailed.clear();
+	mTextures.clear();
+	mResidentBytes = 0;
+}
+
+void TextureStreamer::RequestLevel(Texture* texture, unsigned int level) {
+	auto iter = mTextures.find(texture);
+	if (iter != mTextures.end()) {
+		iter->second.mRequestedLevel = std::min(iter->second.mRequestedLevel, level);
+	}
+}
+
+void TextureStreamer::Update(uint64_t frame) {
+	std::vector<Load> loads;
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (Texture* texture : mFailed) {
+		auto iter = mTextures.find(texture);
+		if (iter == mTextures.end()) continue;
+		mResidentBytes -= texture->GetLevelsSize(iter->second.mLevel);
+		mTextures.erase(iter);
+	}
+	mFailed.clear();
+
+	// The textures drawn want the level they were asked for. The others keep their levels until the budget needs them
+	size_t total = 0;
+	for (auto& iter : mTextures) {
+		StreamedTexture& streamed = iter.second;
+		if (streamed.mRequestedLevel != NoRequest) {
+			streamed.mLastUsedFrame = frame;
+			streamed.mWantedLevel = std::min(streamed.mRequestedLevel, streamed.mTailLevel);
+		}
+		else {
+			streamed.mWantedLevel = streamed.mLevel;
+		}
+		streamed.mRequestedLevel = NoRequest;
+		total += iter.first->GetLevelsSize(streamed.mWantedLevel);
+	}
+
+	// Over budget: drop the largest level of the least recently drawn texture, one level at a time.
+	// Among the textures drawn in the same frame, the ones with the largest levels lose them first
+	if (total > mBudget) {
+		typedef std::pair<Texture* const, StreamedTexture>* Entry;
+		auto lowerPriority = [](Entry a, Entry b) {
+			if (a->second.mLastUsedFrame != b->second.mLastUsedFrame) return a->second.mLastUsedFrame > b->second.mLastUsedFrame;
+			return a->second.mWantedLevel > b->second.mWantedLevel;
+		};
+		std::priority_queue<Entry, std::vector<Entry>, decltype(lowerPriority)> candidates(lowerPriority);
+		for (auto& iter : mTextures) {
+			if (iter.second.mWantedLevel < iter.second.mTailLevel) candidates.push(&iter);
+		}
+		while (total > mBudget && !candidates.empty()) {
+			Entry entry = candidates.top();
+			candidates.pop();
+			StreamedTexture& streamed = entry->second;
+			total -= entry->first->GetLevelsSize(streamed.mWantedLevel) - entry->first->GetLevelsSize(streamed.mWantedLevel + 1);
+			streamed.mWantedLevel++;
+			if (streamed.mWantedLevel < streamed.mTailLevel) candidates.push(entry);
+		}
+	}
+
+	// Drop the levels at once, add them one at a time. A texture waits for its previous load
+	for (auto& iter : mTextures) {
+		Texture* texture = iter.first;
+		StreamedTexture& streamed = iter.second;
+		if (streamed.mWantedLevel == streamed.mLevel || mPending.count(texture)) continue;
+		const unsigned int level = streamed.mWantedLevel > streamed.mLevel ? streamed.mWantedLevel : streamed.mLevel - 1;
+		mResidentBytes += texture->GetLevelsSize(level);
+		mResidentBytes -= texture->GetLevelsSize(streamed.mLevel);
+		mPending.insert(texture);
+		loads.push_back(Load{ texture, level, level > streamed.mLevel, KtxImage(), false });
+	}
+	if (loads.empty()) return;
+	// Memory is freed first, then the most recently drawn textures get their next level, the smallest reads first
+	std::sort(loads.begin(), loads.end(), [this](const Load& a, const Load& b) {
+		if (a.mDrop != b.mDrop) return a.mDrop;
+		const uint64_t aUsed = mTextures[a.mTexture].mLastUsedFrame;
+		const uint64_t bUsed = mTextures[b.mTexture].mLastUsedFrame;
+		if (aUsed != bUsed) return aUsed > bUsed;
+		return a.mTexture->GetLevelsSize(a.mLevel) < b.mTexture->GetLevelsSize(b.mLevel);
+	});
+	for (Load& load : loads) {
+		mTextures[load.mTexture].mLevel = load.mLevel;
+		mQueue.emplace_back(std::move(load));
+	}
+	mCondition.notify_all();
+}
+
+void TextureStreamer::ApplyLoads() {
+	std::vector<Load> loaded;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mLoaded.empty()) return;
+		loaded.swap(mLoaded);
+	}
+	std::vector<Texture*> failed;
+	for (Load& load : loaded) {
+		if (!load.mRead || !load.mTexture->SetLevels(load.mImage)) {
+			SDL_Log("Failed to stream level %u of a texture: it keeps the levels it has", load.mLevel);
+			failed.emplace_back(load.mTexture);
+		}
+	}
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (Load& load : loaded) {
+		mPending.erase(load.mTexture);
+	}
+	mFailed.insert(mFailed.end(), failed.begin(), failed.end());
+}
+
+void TextureStreamer::ThreadLoop() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true) {
+		mCondition.wait(lock, [this] { return !mRunning || !mQueue.empty(); });
+		if (!mRunning) break;
+		Load load = std::move(mQueue.front());
+		mQueue.pop_front();
+		mReading = true;
+		// Read without the lock: the game thread keeps queuing loads
+		lock.unlock();
+		load.mRead = load.mTexture->ReadLevels(load.mLevel, load.mImage);
+		lock.lock();
+		mReading = false;
+		mLoaded.emplace_back(std::move(load));
+		// Clear may be waiting for the read
+		mCondition.notify_all();
+	}
+}
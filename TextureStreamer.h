@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "KtxFile.h"
+
+// Streams the mip levels of the cooked textures under a memory budget.
+// Streamed textures are loaded with their small levels only (see Texture::Load). Every frame the renderer reports the
+// finest level each drawn texture needs; Update chooses the levels to keep on the device and queues the changes.
+// When the levels don't fit in the budget, the large levels of the least recently drawn textures are dropped first.
+// A loading thread reads the levels from disk and the thread of the device uploads them (ApplyLoads).
+// Textures get sharper one level at a time, so the smaller (faster to read) levels show up first
+class TextureStreamer {
+public:
+	TextureStreamer();
+	// Stop the loading thread
+	~TextureStreamer();
+
+	// Stream the levels of a texture loaded with streaming. Game thread
+	void AddTexture(class Texture* texture);
+	// Stop streaming a texture (its levels are then managed elsewhere, see TextureArray). Game thread
+	void RemoveTexture(class Texture* texture);
+	// Forget every texture, before they are unloaded. Waits for the load in progress; the device thread must not
+	// be in ApplyLoads
+	void Clear();
+	// A packet of this frame samples the texture down to the level. Textures not streamed are ignored. Game thread
+	void RequestLevel(class Texture* texture, unsigned int level);
+	// Choose the levels to keep on the device from the requests of the frame and queue the loads. Game thread
+	void Update(uint64_t frame);
+	// Upload the levels loaded since the last call. Thread of the device, before drawing
+	void ApplyLoads();
+
+	// Bytes of the levels of the streamed textures allowed on the device. The smallest levels of the textures
+	// (up to Texture::TailSize) always stay
+	void SetBudget(size_t bytes) { mBudget = bytes; }
+	size_t GetBudget() const { return mBudget; }
+	// Bytes of the levels on the device once the queued loads are done
+	size_t GetResidentBytes() const { return mResidentBytes; }
+
+	static const size_t DefaultBudget = static_cast<size_t>(256) << 20;
+
+private:
+	// Streaming state of a texture. Game thread
+	struct StreamedTexture {
+		// Finest level drawn this frame (NoRequest: not drawn)
+		unsigned int mRequestedLevel;
+		// Level the budget allows this frame
+		unsigned int mWantedLevel;
+		// First level on the device once the queued loads are done, and first level of the tail
+		unsigned int mLevel;
+		unsigned int mTailLevel;
+		// Last frame the texture was drawn
+		uint64_t mLastUsedFrame;
+	};
+	// Levels of a texture, from mLevel to the last one, read by the loading thread
+	struct Load {
+		class Texture* mTexture;
+		unsigned int mLevel;
+		// Levels are dropped (no level is added)
+		bool mDrop;
+		KtxImage mImage;
+		bool mRead;
+	};
+	static const unsigned int NoRequest = ~0u;
+
+	// Main loop of the loading thread
+	void ThreadLoop();
+
+	std::unordered_map<class Texture*, StreamedTexture> mTextures;
+	size_t mBudget;
+	size_t mResidentBytes;
+
+	std::thread mThread;
+	// Protect everything below
+	std::mutex mMutex;
+	// Wake up the loading thread (new load or stop) and Clear (load finished)
+	std::condition_variable mCondition;
+	// Loads waiting for the loading thread, and loads read waiting for ApplyLoads
+	std::deque<Load> mQueue;
+	std::vector<Load> mLoaded;
+	// Textures with a load queued, being read or waiting for ApplyLoads: their next load waits for it
+	std::unordered_set<class Texture*> mPending;
+	// Textures whose levels could not be read: they are not streamed anymore
+	std::vector<class Texture*> mFailed;
+	// The loading thread is reading a texture
+	bool mReading;
+	// Cleared by the destructor
+	bool mRunning;
+};
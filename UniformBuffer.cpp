@@ -0,0 +1,29 @@
+#include "UniformBuffer.h"
+#include "RenderDevice.h"
+#include <SDL.h>
+
+UniformBuffer::UniformBuffer(unsigned int size, unsigned int bindingPoint) :
+	mBuffer(0),
+	mSize(size),
+	mBindingPoint(bindingPoint)
+{
+	// Create the buffer and allocate its storage. Data is written once per frame, so use dynamic draw
+	RenderDevice* device = RenderDevice::Get();
+	mBuffer = device->CreateBuffer(EUniformBuffer, mSize, nullptr, EDynamicBuffer);
+
+	// Attach the whole buffer to the binding point. Every program whose uniform block is bound to the
+	// same point reads from this buffer, so there is no need to rebind it when switching shader
+	device->BindUniformBuffer(mBuffer, mBindingPoint);
+}
+
+UniformBuffer::~UniformBuffer() {
+	RenderDevice::Get()->DestroyBuffer(mBuffer);
+}
+
+void UniformBuffer::Update(const void* data, unsigned int size) {
+	if (size > mSize) {
+		SDL_Log("Uniform buffer update of %u bytes exceeds buffer size of %u bytes", size, mSize);
+		return;
+	}
+	RenderDevice::Get()->UpdateBuffer(mBuffer, 0, size, data);
+}
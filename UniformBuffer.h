@@ -0,0 +1,32 @@
+#pragma once
+
+// Binding points of the uniform blocks shared by every shader program
+// The numbers must match the uniform block bindings done for each program in Renderer::LoadShaders
+enum UniformBlockBinding {
+	// View-projection, camera, ambient and directional light (uniform block "FrameConstants")
+	EFrameConstantsBinding = 0,
+	// World transform and material of the draw (uniform block "ObjectConstants"), a range of a RingBuffer
+	EObjectConstantsBinding = 1
+};
+
+class UniformBuffer {
+public:
+	// Create an uniform buffer object of the given size (in bytes) and attach it to the given binding point
+	UniformBuffer(unsigned int size, unsigned int bindingPoint);
+	~UniformBuffer();
+
+	// Copy the data into the buffer with a single update. size must not exceed the buffer size
+	void Update(const void* data, unsigned int size);
+
+	// Getters
+	unsigned int GetSize() const { return mSize; }
+	unsigned int GetBindingPoint() const { return mBindingPoint; }
+
+private:
+	// Render device handle of the uniform buffer object
+	unsigned int mBuffer;
+	// Size of the buffer in bytes
+	unsigned int mSize;
+	// Index of the binding point the buffer is attached to
+	unsigned int mBindingPoint;
+};
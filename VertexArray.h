@@ -2,26 +2,41 @@
 
 class VertexArray {
 public:
+	// Vertices with the uncompressed layout (3 float position, 3 float normal, 2 float UV)
 	VertexArray(const float* verts, const unsigned int numVerts,
 		const unsigned int* indices, const unsigned int numIndices);
+	// Vertices with the given layout (numVerts * layout.GetStride() bytes)
+	VertexArray(const void* verts, const unsigned int numVerts, const class VertexLayout& layout,
+		const unsigned int* indices, const unsigned int numIndices);
 	~VertexArray();
 
 	// Activate this Vertex Array so we can draw it
 	void SetActive();
+	// Draw the indices of the bound vertex array as triangles
+	void Draw(unsigned int count);
 
 	// Getters
 	unsigned int GetNumIndices() const { return mNumIndices; }
 	unsigned int GetNumVerts() const { return mNumVerts; }
+	// Size in bytes of an index (2 or 4)
+	unsigned int GetIndexSize() const { return mIndexSize; }
+	// Size in bytes of the vertex buffer and the index buffer
+	unsigned int GetVertexBytes() const { return mVertexBytes; }
+	unsigned int GetIndexBytes() const { return mNumIndices * mIndexSize; }
 
 private:
 	// How many vertex in the vertex buffer?
 	unsigned int mNumVerts;
 	// How many indeces in the index buffer?
 	unsigned int mNumIndices;
-	// OpenGL ID of the vertex buffer (used by OpenGL to reference to vertex buffer)
+	// Indices are stored in 16 bits when every vertex can be addressed with them
+	unsigned int mIndexSize;
+	// Size of the vertex buffer in bytes
+	unsigned int mVertexBytes;
+	// Render device handle of the vertex buffer
 	unsigned int mVertexBuffer;
-	// OpenGL ID of the indices buffer (used by OpenGL to reference to indices buffer)
+	// Render device handle of the indices buffer
 	unsigned int mIndexBuffer;
-	// OpenGL ID of the vertex array object (used by OpenGL to create, bind, etc..)
+	// Render device handle of the vertex array object (attribute layout + the two buffers)
 	unsigned int mVertexArray;
-};
\ No newline at end of file
+};
@@ -0,0 +1,56 @@
+#include "VertexLayout.h"
+
+VertexLayout::VertexLayout() :
+	mStride(0)
+{}
+
+void VertexLayout::AddAttribute(unsigned int location, int components, GLenum type, bool normalized, bool integer) {
+	VertexAttribute attribute = { location, components, type, normalized, integer, mStride };
+	mAttributes.emplace_back(attribute);
+	// Keep the next attribute aligned to 4 bytes (unaligned attributes are slow or unsupported on many GPUs)
+	mStride += (components * GetTypeSize(type) + 3) & ~3u;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+	if (mStride != other.mStride || mAttributes.size() != other.mAttributes.size()) return false;
+	for (size_t i = 0; i < mAttributes.size(); i++) {
+		const VertexAttribute& a = mAttributes[i];
+		const VertexAttribute& b = other.mAttributes[i];
+		if (a.mLocation != b.mLocation || a.mComponents != b.mComponents || a.mType != b.mType ||
+			a.mNormalized != b.mNormalized || a.mInteger != b.mInteger || a.mOffset != b.mOffset) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool VertexLayout::HasAttribute(unsigned int location) const {
+	for (const VertexAttribute& attribute : mAttributes) {
+		if (attribute.mLocation == location) return true;
+	}
+	return false;
+}
+
+unsigned int VertexLayout::GetTypeSize(GLenum type) {
+	switch (type) {
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+const VertexLayout& VertexLayout::PosNormTex() {
+	static VertexLayout layout;
+	if (layout.mAttributes.empty()) {
+		layout.AddAttribute(EPositionAttribute, 3, GL_FLOAT, false);
+		layout.AddAttribute(ENormalAttribute, 3, GL_FLOAT, false);
+		layout.AddAttribute(ETexCoordAttribute, 2, GL_FLOAT, false);
+	}
+	return layout;
+}
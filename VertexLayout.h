@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <glew.h>
+
+// Attribute locations shared by the vertex layouts and the shaders (layout(location=n))
+enum VertexAttributeLocation {
+	EPositionAttribute = 0,
+	ENormalAttribute = 1,
+	ETexCoordAttribute = 2,
+	ESkinIndicesAttribute = 3,
+	ESkinWeightsAttribute = 4
+};
+
+// One attribute of a vertex: where it is inside the vertex and how the GPU converts it to the shader input
+struct VertexAttribute {
+	// Location of the shader input
+	unsigned int mLocation;
+	// Number of components (1 to 4)
+	int mComponents;
+	// Type of the components (GL_FLOAT, GL_HALF_FLOAT, GL_SHORT, ...)
+	GLenum mType;
+	// Integer components are mapped to [0, 1] (unsigned types) or [-1, 1] (signed types)
+	bool mNormalized;
+	// Integer components read as ivec/uvec by the shader (not converted to float)
+	bool mInteger;
+	// Offset in bytes from the start of the vertex
+	unsigned int mOffset;
+};
+
+// Memory layout of a vertex. VertexArray uses it to size the vertex buffer, the render device to set the attribute pointers
+class VertexLayout {
+public:
+	VertexLayout();
+
+	// Append an attribute after the previous ones. Every attribute starts on a 4 bytes boundary
+	void AddAttribute(unsigned int location, int components, GLenum type, bool normalized, bool integer = false);
+	// Two layouts are equal if they have the same attributes at the same offsets
+	bool operator==(const VertexLayout& other) const;
+
+	// Size of a vertex in bytes
+	unsigned int GetStride() const { return mStride; }
+	const std::vector<VertexAttribute>& GetAttributes() const { return mAttributes; }
+	// The layout has an attribute at the given location (VertexAttributeLocation)
+	bool HasAttribute(unsigned int location) const;
+
+	// Size in bytes of a component of the given type
+	static unsigned int GetTypeSize(GLenum type);
+	// Uncompressed layout: 3 float position, 3 float normal, 2 float UV (32 bytes). Used by the sprite quad
+	static const VertexLayout& PosNormTex();
+
+private:
+	// Attributes in the order they appear inside the vertex
+	std::vector<VertexAttribute> mAttributes;
+	// Size of a vertex in bytes
+	unsigned int mStride;
+};